@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+
+//! Index of an asset in the AssetManager, typed so a mesh handle can't be used to look up anything else
+template<typename T>
+struct AssetHandle
+{
+	static const uint32_t INVALID = UINT32_MAX;
+
+	uint32_t id = INVALID;
+
+	bool isValid() const
+	{
+		return id != INVALID;
+	}
+
+	bool operator==(const AssetHandle& other) const
+	{
+		return id == other.id;
+	}
+
+	bool operator!=(const AssetHandle& other) const
+	{
+		return id != other.id;
+	}
+};
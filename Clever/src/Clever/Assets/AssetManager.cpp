@@ -0,0 +1,222 @@
+#include "AssetManager.h"
+#include "Clever/WorldManager/Components/Component/Renderable.h"
+#include "Clever/WorldManager/Object/MeshCache.h"
+#include "Clever/Developer/DevTools.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <algorithm>
+#include <iostream>
+
+void AssetManager::init(std::shared_ptr<ResourceCache> resources, const std::string& rootDirectory)
+{
+	m_Resources = resources;
+	m_RootDirectory = rootDirectory;
+	m_Stopping = false;
+
+	//! Creating the placeholders, a cube in every vertex format
+	{
+		std::vector<Vertex> cube;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 position((corner & 1) ? 0.5f : -0.5f, (corner & 2) ? 0.5f : -0.5f, (corner & 4) ? 0.5f : -0.5f);
+			cube.push_back({ position, glm::normalize(position) * 0.5f + 0.5f });
+		}
+		std::vector<uint16_t> indices = {
+			0, 2, 1, 1, 2, 3,
+			4, 5, 6, 5, 7, 6,
+			0, 1, 4, 1, 5, 4,
+			2, 6, 3, 3, 6, 7,
+			0, 4, 2, 2, 4, 6,
+			1, 3, 5, 3, 7, 5
+		};
+
+		for (uint32_t format = 0; format < GeometryBuffer::VERTEX_FORMAT_COUNT; format++)
+			m_Placeholders[format] = m_Resources->acquireMesh(cube, indices, static_cast<VertexFormat>(format));
+	}
+
+	//! Creating the workers, one core is left for the main thread
+	{
+		uint32_t cores = std::max(2u, std::thread::hardware_concurrency());
+		uint32_t workerCount = std::min(MAX_WORKERS, cores - 1);
+		for (uint32_t i = 0; i < workerCount; i++)
+			m_Workers.emplace_back(&AssetManager::workerLoop, this);
+	}
+
+	DevTools::addDockFunction(assetGui, { this });
+}
+
+void AssetManager::cleanup()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+		m_Queue.clear();
+	}
+	m_Wake.notify_all();
+	for (std::thread& worker : m_Workers)
+		worker.join();
+	m_Workers.clear();
+
+	m_Meshes.clear();
+	m_MeshLookup.clear();
+
+	for (ResourceRef<MeshData>& placeholder : m_Placeholders)
+		placeholder.reset();
+}
+
+AssetHandle<MeshData> AssetManager::loadMesh(const std::string& path, VertexFormat format, glm::vec3 position)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	std::string key = path + "|" + VertexFormats::getName(format);
+
+	auto found = m_MeshLookup.find(key);
+	if (found != m_MeshLookup.end())
+	{
+		//Needed somewhere closer, it moves up the queue if it is still in it
+		MeshEntry& entry = m_Meshes[found->second];
+		if (glm::distance(position, m_CameraPosition) < glm::distance(entry.position, m_CameraPosition))
+			entry.position = position;
+		return { found->second };
+	}
+
+	uint32_t id = static_cast<uint32_t>(m_Meshes.size());
+	m_Meshes.emplace_back();
+	MeshEntry& entry = m_Meshes.back();
+	entry.path = path;
+	entry.format = format;
+	entry.position = position;
+	m_MeshLookup[key] = id;
+
+	m_Queue.push_back(id);
+	m_Wake.notify_one();
+	return { id };
+}
+
+AssetManager::State AssetManager::getState(AssetHandle<MeshData> handle)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Meshes.at(handle.id).state;
+}
+
+ResourceRef<MeshData> AssetManager::getMesh(AssetHandle<MeshData> handle)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	MeshEntry& entry = m_Meshes.at(handle.id);
+	if (entry.state == State::Resident)
+		return entry.mesh;
+	return m_Placeholders[static_cast<uint32_t>(entry.format)];
+}
+
+void AssetManager::update(glm::vec3 cameraPosition, Renderable* renderables, uint32_t count)
+{
+	CLEVER_PROFILE_FUNCTION();
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_CameraPosition = cameraPosition;
+
+		for (MeshEntry& entry : m_Meshes)
+		{
+			if (entry.state == State::Uploading && entry.mesh.get().isResident())
+				entry.state = State::Resident;
+		}
+	}
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Renderable& renderable = renderables[i];
+		if (!renderable.meshAsset.isValid())
+			continue;
+
+		ResourceRef<MeshData> current = getMesh(renderable.meshAsset);
+		if (current != renderable.mesh)
+			renderable.setMesh(std::move(current));
+	}
+}
+
+void AssetManager::workerLoop()
+{
+	while (true)
+	{
+		uint32_t id;
+		std::string path;
+		VertexFormat format;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Wake.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+			if (m_Stopping)
+				return;
+
+			//Closest to the camera as it is now, not as it was when the load was queued
+			auto next = std::min_element(m_Queue.begin(), m_Queue.end(), [this](uint32_t a, uint32_t b)
+				{
+					return glm::distance(m_Meshes[a].position, m_CameraPosition) < glm::distance(m_Meshes[b].position, m_CameraPosition);
+				});
+			id = *next;
+			m_Queue.erase(next);
+
+			MeshEntry& entry = m_Meshes[id];
+			entry.state = State::Loading;
+			path = m_RootDirectory + entry.path;
+			format = entry.format;
+		}
+
+		ResourceRef<MeshData> mesh;
+		std::string error;
+		try
+		{
+			MeshCache::CookedMesh cooked;
+			MeshCache::load(path, cooked);
+			mesh = m_Resources->acquireMesh(cooked, format);
+		}
+		catch (const std::exception& exception)
+		{
+			error = exception.what();
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		MeshEntry& entry = m_Meshes[id];
+		if (error.empty())
+		{
+			entry.mesh = std::move(mesh);
+			entry.state = State::Uploading;
+		}
+		else
+		{
+			std::cerr << "AssetManager: " << path << ": " << error << std::endl;
+			entry.error = error;
+			entry.state = State::Failed;
+		}
+	}
+}
+
+std::string AssetManager::getStateName(State state)
+{
+	switch (state)
+	{
+	case State::Queued: return "Queued";
+	case State::Loading: return "Loading";
+	case State::Uploading: return "Uploading";
+	case State::Resident: return "Resident";
+	case State::Failed: return "Failed";
+	}
+	return "";
+}
+
+void AssetManager::assetGui(std::vector<void*> classInstances)
+{
+	AssetManager* assets = (AssetManager*)classInstances.at(0);
+	DevTools::newDock("Assets");
+
+	std::lock_guard<std::mutex> lock(assets->m_Mutex);
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, std::to_string(assets->m_Workers.size()) + " workers, " + std::to_string(assets->m_Queue.size()) + " queued");
+	for (const MeshEntry& entry : assets->m_Meshes)
+	{
+		glm::vec3 color = entry.state == State::Failed ? glm::vec3(0.9, 0.3, 0.3) : entry.state == State::Resident ? glm::vec3(0.25, 0.76, 0.50) : glm::vec3(0.8, 0.8, 0.8);
+		std::string line = entry.path + " (" + VertexFormats::getName(entry.format) + "): " + getStateName(entry.state);
+		if (!entry.error.empty())
+			line += ", " + entry.error;
+		DevTools::coloredText(color, line);
+	}
+
+	DevTools::endDock();
+}
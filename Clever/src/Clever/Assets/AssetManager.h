@@ -0,0 +1,97 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <glm.hpp>
+
+#include "Clever/Assets/AssetHandle.h"
+#include "Clever/WorldManager/MeshData.h"
+#include "Clever/WorldManager/VertexFormats.h"
+#include "OS-Dependant/Vulkan/ResourceCache.h"
+
+struct Renderable;
+
+/*
+-------------Asset Manager----------------
+
+Loads assets without ever blocking the main thread:
+	Handles: a load returns a typed handle right away, loading the same file in the same format twice gives the same one.
+	Workers: queued loads are taken by worker threads closest to the camera first, they go through the MeshCache
+			 (cooking the source if needed) and acquire the mesh from the ResourceCache, so two files with the same
+			 content share it. The GeometryBuffer uploads it on the transfer queue.
+	Placeholders: until a mesh is resident, and forever if it failed to load, its handle resolves to a small cube
+				  of the same vertex format, so renderables can be built with the pipeline they will keep.
+
+update() swaps the real mesh into every renderable that uses its handle once the upload is done.
+*/
+class AssetManager
+{
+public:
+	static const uint32_t MAX_WORKERS = 4;
+
+	enum class State
+	{
+		Queued,
+		Loading,
+		Uploading,
+		Resident,
+		Failed
+	};
+
+public:
+	AssetManager() = default;
+
+	//! rootDirectory is put in front of every path passed to a load
+	void init(std::shared_ptr<ResourceCache> resources, const std::string& rootDirectory);
+	//! Waits for the loads in progress and drops the manager's references, renderables may still hold theirs
+	void cleanup();
+
+	//! position is where the mesh will be used, loads nearer the camera are picked first
+	AssetHandle<MeshData> loadMesh(const std::string& path, VertexFormat format, glm::vec3 position = glm::vec3(0.0f));
+
+	State getState(AssetHandle<MeshData> handle);
+
+	//! The loaded mesh once it is resident, the placeholder of its format until then
+	ResourceRef<MeshData> getMesh(AssetHandle<MeshData> handle);
+
+	//! Main thread, once per frame
+	void update(glm::vec3 cameraPosition, Renderable* renderables, uint32_t count);
+
+	static void assetGui(std::vector<void*> classInstances);
+
+private:
+	struct MeshEntry
+	{
+		std::string path;
+		VertexFormat format = VertexFormat::Float;
+		glm::vec3 position = glm::vec3(0.0f);
+		State state = State::Queued;
+		ResourceRef<MeshData> mesh;
+		std::string error;
+	};
+
+	void workerLoop();
+	static std::string getStateName(State state);
+
+private:
+	std::shared_ptr<ResourceCache> m_Resources;
+	std::string m_RootDirectory;
+
+	//A deque so entries keep their address while workers fill them in
+	std::deque<MeshEntry> m_Meshes;
+	std::unordered_map<std::string, uint32_t> m_MeshLookup;
+	std::vector<uint32_t> m_Queue;
+	ResourceRef<MeshData> m_Placeholders[GeometryBuffer::VERTEX_FORMAT_COUNT];
+
+	std::vector<std::thread> m_Workers;
+	std::mutex m_Mutex;
+	std::condition_variable m_Wake;
+	bool m_Stopping = false;
+	glm::vec3 m_CameraPosition = glm::vec3(0.0f);
+};
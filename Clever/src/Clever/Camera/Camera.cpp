@@ -3,6 +3,9 @@
 void Camera::update(float time)
 {
 	GLFWwindow* window = m_Window;
+	if (window == nullptr)
+		return;
+
 	if (glfwGetKey(window, GLFW_KEY_A))
 	{
 		//std::cout << "left" << std::endl;
@@ -20,12 +20,17 @@ class Camera
 
 public:
 	Camera(float fov, float width, float height, float fnear, float ffar, glm::vec3 position, GLFWwindow* window)
-		: m_ProjectionMatrix(glm::perspective(glm::radians(fov), width / height, fnear, ffar)), m_Position(position), m_Window(window), m_Width(width), m_Height(height)
+		: m_ProjectionMatrix(glm::perspective(glm::radians(fov), width / height, fnear, ffar)), m_Position(position), m_Window(window), m_Width(width), m_Height(height),
+		m_Fov(fov), m_Near(fnear), m_Far(ffar)
 	{
 		m_ProjectionMatrix[1][1] *= -1;
 		RecaluclateViewMatrix();
-		glfwSetCursorPos(m_Window, m_LastX, m_LastY);
-		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		//Headless has no window to take input from
+		if (m_Window != nullptr)
+		{
+			glfwSetCursorPos(m_Window, m_LastX, m_LastY);
+			glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		}
 		std::cout << "Im Creating a new Camera" << std::endl;
 		
 	}
@@ -55,6 +60,17 @@ public:
 
 	const void Translate(Camera_Movement direction, float deltaTime);
 
+	//! Keeps the aspect ratio in sync with the swapchain after a resize
+	void SetViewportSize(float width, float height)
+	{
+		m_Width = static_cast<int>(width);
+		m_Height = static_cast<int>(height);
+		m_MiddleOfScreen = { width / 2, height / 2 };
+		m_ProjectionMatrix = glm::perspective(glm::radians(m_Fov), width / height, m_Near, m_Far);
+		m_ProjectionMatrix[1][1] *= -1;
+		RecaluclateViewMatrix();
+	}
+
 	void ProcessMouseMovement(float xoffset, float yoffset, bool constrainPitch = true);
 
 	void updateCameraVectors();
@@ -94,6 +110,8 @@ private:
 	glm::vec3 m_Up = glm::vec3(0, 1, 0);
 	glm::vec3 m_WorldUp = m_Up;
 	float m_Fov = 45.0f;
+	float m_Near = 0.1f;
+	float m_Far = 1000.0f;
 
 	glm::vec3 m_Position = { 0.0f,0.0f,0.0f };
 	glm::vec3 m_Velocity = { 0,0,0 };
@@ -7,7 +7,8 @@
 
 namespace DevTools
 {
-	static std::unordered_map<void (*)(std::vector<void*>), std::vector<void*>> docks;
+	//! inline so docks registered from any translation unit end up in the one map the DockManager draws
+	inline std::unordered_map<void (*)(std::vector<void*>), std::vector<void*>> docks;
 
 	static void newDock(std::string name)
 	{
@@ -19,11 +20,27 @@ namespace DevTools
 		ImGui::TextColored(ImVec4(color.r, color.g, color.b, 1.0f), text.c_str());
 	}
 
+	static void text(std::string text)
+	{
+		ImGui::TextUnformatted(text.c_str());
+	}
+
+	//! values is a ring buffer starting at offset
+	static void plotLines(std::string label, const std::vector<float>& values, int offset = 0, std::string overlay = "", glm::vec2 size = {0,60})
+	{
+		ImGui::PlotLines(label.c_str(), values.data(), static_cast<int>(values.size()), offset, overlay.c_str(), 0.0f, FLT_MAX, ImVec2(size.x, size.y));
+	}
+
 	static bool button(std::string label, glm::vec2 size = {0,0})
 	{
 		return ImGui::Button(label.c_str(), ImVec2(size.x, size.y));
 	}
 
+	static bool checkbox(std::string label, bool* value)
+	{
+		return ImGui::Checkbox(label.c_str(), value);
+	}
+
 	static void floatSlider(std::string label, float* value, float min, float max)
 	{
 		ImGui::SliderFloat(label.c_str(), value, min, max, "%f", 1);
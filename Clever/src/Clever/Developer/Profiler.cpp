@@ -0,0 +1,316 @@
+#include "Profiler.h"
+#include "DevTools.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+
+namespace Profiler
+{
+	//! A Zone that other threads can read while its owner writes it again. sequence is 2 * index + 1 while zone index
+	//! is being written and 2 * index + 2 once it is complete, a reader keeps a copy only if it saw the same complete
+	//! sequence before and after reading the fields.
+	struct ZoneSlot
+	{
+		std::atomic<uint64_t> sequence{ 0 };
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<uint64_t> start{ 0 };
+		std::atomic<uint64_t> end{ 0 };
+		std::atomic<uint32_t> depth{ 0 };
+	};
+
+	struct ThreadBuffer
+	{
+		uint32_t threadId = 0;
+		std::string threadName;
+		std::vector<ZoneSlot> zones = std::vector<ZoneSlot>(ZONES_PER_THREAD);
+		std::atomic<uint64_t> written{ 0 };//Only ever written by the owning thread
+		uint32_t depth = 0;
+	};
+
+	//Buffers are kept alive after their thread exits so its zones still show up in captures
+	static std::mutex s_ThreadsMutex;
+	static std::vector<std::shared_ptr<ThreadBuffer>> s_Threads;
+	static thread_local ThreadBuffer* t_Buffer = nullptr;
+
+	static const std::chrono::steady_clock::time_point s_Epoch = std::chrono::steady_clock::now();
+
+	//Frame markers and capture state, main thread only
+	static uint64_t s_FrameTimes[FRAME_HISTORY] = {};
+	static uint64_t s_FrameCount = 0;
+
+	static uint32_t s_CaptureFramesLeft = 0;
+	static uint64_t s_CaptureStart = 0;
+	static std::string s_CaptureFile;
+
+	static bool s_Paused = false;
+	static uint64_t s_ViewStart = 0;
+	static uint64_t s_ViewEnd = 0;
+
+	static ThreadBuffer& getThreadBuffer()
+	{
+		if (t_Buffer == nullptr)
+		{
+			std::shared_ptr<ThreadBuffer> buffer = std::make_shared<ThreadBuffer>();
+
+			std::lock_guard<std::mutex> lock(s_ThreadsMutex);
+			buffer->threadId = static_cast<uint32_t>(s_Threads.size());
+			buffer->threadName = buffer->threadId == 0 ? "Main" : "Thread " + std::to_string(buffer->threadId);
+			s_Threads.push_back(buffer);
+			t_Buffer = buffer.get();
+		}
+		return *t_Buffer;
+	}
+
+	uint64_t now()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_Epoch).count());
+	}
+
+	void beginZone()
+	{
+		getThreadBuffer().depth++;
+	}
+
+	void endZone(const char* name, uint64_t start)
+	{
+		ThreadBuffer& buffer = getThreadBuffer();
+		buffer.depth--;
+
+		uint64_t index = buffer.written.load(std::memory_order_relaxed);
+		uint64_t end = now();
+
+		ZoneSlot& slot = buffer.zones[index % ZONES_PER_THREAD];
+		//Release on every field, a reader that sees any of them also sees the odd sequence before it
+		slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+		slot.name.store(name, std::memory_order_release);
+		slot.start.store(start, std::memory_order_release);
+		slot.end.store(end, std::memory_order_release);
+		slot.depth.store(buffer.depth, std::memory_order_release);
+		slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+		buffer.written.store(index + 1, std::memory_order_release);
+	}
+
+	void setThreadName(const std::string& name)
+	{
+		ThreadBuffer& buffer = getThreadBuffer();
+
+		std::lock_guard<std::mutex> lock(s_ThreadsMutex);
+		buffer.threadName = name;
+	}
+
+	void markFrame()
+	{
+		uint64_t time = now();
+		s_FrameTimes[s_FrameCount % FRAME_HISTORY] = time;
+		s_FrameCount++;
+
+		if (s_CaptureFramesLeft == 0)
+			return;
+
+		if (s_CaptureStart == 0)
+		{
+			s_CaptureStart = time;
+			return;
+		}
+
+		if (--s_CaptureFramesLeft == 0)
+		{
+			if (writeChromeTrace(s_CaptureFile, s_CaptureStart, time))
+				std::cout << "CPU trace written to " << s_CaptureFile << std::endl;
+			else
+				std::cout << "Failed to write CPU trace " << s_CaptureFile << std::endl;
+			s_CaptureStart = 0;
+		}
+	}
+
+	bool getLastFrame(uint64_t& start, uint64_t& end)
+	{
+		if (s_FrameCount < 2)
+			return false;
+
+		start = s_FrameTimes[(s_FrameCount - 2) % FRAME_HISTORY];
+		end = s_FrameTimes[(s_FrameCount - 1) % FRAME_HISTORY];
+		return true;
+	}
+
+	std::vector<ThreadZones> collectZones(uint64_t start, uint64_t end)
+	{
+		std::vector<std::shared_ptr<ThreadBuffer>> threads;
+		std::vector<ThreadZones> result;
+		{
+			std::lock_guard<std::mutex> lock(s_ThreadsMutex);
+			threads = s_Threads;
+			for (const auto& buffer : threads)
+				result.push_back({ buffer->threadId, buffer->threadName, {} });
+		}
+
+		for (size_t i = 0; i < threads.size(); i++)
+		{
+			ThreadBuffer& buffer = *threads[i];
+
+			uint64_t written = buffer.written.load(std::memory_order_acquire);
+			uint64_t first = written > ZONES_PER_THREAD ? written - ZONES_PER_THREAD : 0;
+
+			std::vector<Zone>& zones = result[i].zones;
+			for (uint64_t index = first; index < written; index++)
+			{
+				//The owning thread may lap the ring while we copy, a slot it is writing or has reused is dropped
+				const ZoneSlot& slot = buffer.zones[index % ZONES_PER_THREAD];
+				uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+				if (sequence != 2 * index + 2)
+					continue;
+
+				Zone zone;
+				zone.name = slot.name.load(std::memory_order_acquire);
+				zone.start = slot.start.load(std::memory_order_acquire);
+				zone.end = slot.end.load(std::memory_order_acquire);
+				zone.depth = slot.depth.load(std::memory_order_acquire);
+				if (slot.sequence.load(std::memory_order_relaxed) != sequence)
+					continue;
+
+				if (zone.end > start && zone.start < end)
+					zones.push_back(zone);
+			}
+
+			std::sort(zones.begin(), zones.end(), [](const Zone& a, const Zone& b) { return a.start < b.start; });
+		}
+		return result;
+	}
+
+	void captureFrames(uint32_t frameCount, const std::string& filename)
+	{
+		s_CaptureFramesLeft = std::max<uint32_t>(frameCount, 1);
+		s_CaptureStart = 0;
+		s_CaptureFile = filename;
+	}
+
+	static std::string escapeJson(const std::string& text)
+	{
+		std::string escaped;
+		escaped.reserve(text.size());
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	bool writeChromeTrace(const std::string& filename, uint64_t start, uint64_t end)
+	{
+		std::ofstream file(filename);
+		if (!file.is_open())
+			return false;
+
+		std::vector<ThreadZones> threads = collectZones(start, end);
+
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+		bool first = true;
+		for (const ThreadZones& thread : threads)
+		{
+			file << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << thread.threadId
+				<< ",\"args\":{\"name\":\"" << escapeJson(thread.threadName) << "\"}}";
+			first = false;
+
+			//Complete events, timestamps in microseconds
+			for (const Zone& zone : thread.zones)
+			{
+				file << ",\n{\"name\":\"" << escapeJson(zone.name) << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread.threadId
+					<< ",\"ts\":" << zone.start / 1000.0 << ",\"dur\":" << (zone.end - zone.start) / 1000.0 << "}";
+			}
+		}
+		file << "\n]}\n";
+		return file.good();
+	}
+
+	void init()
+	{
+		getThreadBuffer();
+		DevTools::addDockFunction(profilerGui, {});
+	}
+
+	static ImU32 zoneColor(const char* name)
+	{
+		//FNV-1a of the name so a zone keeps its color across frames
+		uint32_t hash = 2166136261u;
+		for (const char* c = name; *c; c++)
+			hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+
+		return IM_COL32(80 + (hash & 0x7F), 80 + ((hash >> 8) & 0x7F), 80 + ((hash >> 16) & 0x7F), 255);
+	}
+
+	void profilerGui(std::vector<void*>)
+	{
+		DevTools::newDock("CPU-Profiler");
+
+		uint64_t start, end;
+		if (!s_Paused && getLastFrame(start, end))
+		{
+			s_ViewStart = start;
+			s_ViewEnd = end;
+		}
+
+		DevTools::checkbox("Pause", &s_Paused);
+		if (s_CaptureFramesLeft == 0 && DevTools::button("Capture 120 Frames"))
+			captureFrames(120, "cpu_trace.json");
+		else if (s_CaptureFramesLeft > 0)
+			DevTools::text("Capturing, " + std::to_string(s_CaptureFramesLeft) + " frames left");
+
+		if (s_ViewEnd <= s_ViewStart)
+		{
+			DevTools::endDock();
+			return;
+		}
+
+		double frameLength = static_cast<double>(s_ViewEnd - s_ViewStart);
+		DevTools::text("Frame: " + std::to_string(frameLength / 1000000.0) + " ms");
+
+		const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+		for (const ThreadZones& thread : collectZones(s_ViewStart, s_ViewEnd))
+		{
+			if (thread.zones.empty())
+				continue;
+
+			DevTools::text(thread.threadName);
+
+			uint32_t maxDepth = 0;
+			for (const Zone& zone : thread.zones)
+				maxDepth = std::max(maxDepth, zone.depth);
+
+			ImVec2 origin = ImGui::GetCursorScreenPos();
+			float width = std::max(ImGui::GetContentRegionAvail().x, 1.0f);
+
+			for (const Zone& zone : thread.zones)
+			{
+				uint64_t zoneStart = std::max(zone.start, s_ViewStart);
+				uint64_t zoneEnd = std::min(zone.end, s_ViewEnd);
+
+				ImVec2 min(origin.x + static_cast<float>((zoneStart - s_ViewStart) / frameLength) * width, origin.y + zone.depth * rowHeight);
+				ImVec2 max(origin.x + static_cast<float>((zoneEnd - s_ViewStart) / frameLength) * width, min.y + rowHeight - 1.0f);
+				if (max.x - min.x < 1.0f)
+					max.x = min.x + 1.0f;
+
+				drawList->AddRectFilled(min, max, zoneColor(zone.name));
+
+				if (ImGui::CalcTextSize(zone.name).x < max.x - min.x - 4.0f)
+					drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(0, 0, 0, 255), zone.name);
+
+				if (ImGui::IsMouseHoveringRect(min, max))
+					ImGui::SetTooltip("%s: %.3f ms", zone.name, (zone.end - zone.start) / 1000000.0);
+			}
+
+			ImGui::Dummy(ImVec2(width, (maxDepth + 1) * rowHeight));
+		}
+
+		DevTools::endDock();
+	}
+}
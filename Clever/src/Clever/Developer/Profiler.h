@@ -0,0 +1,99 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+-------------CPU Profiler----------------
+
+Every thread that opens a zone gets its own ring buffer, so recording never takes a lock.
+Zones are closed RAII scopes, timestamps come from steady_clock in nanoseconds since the profiler started.
+
+Usage:
+	CLEVER_PROFILE_FUNCTION();			Zone named after the enclosing function
+	CLEVER_PROFILE_SCOPE("Name");		Zone with a custom name, the name must be a string literal (it's stored as a pointer)
+	CLEVER_PROFILE_FRAME();				Called once per frame from the main loop, drives the flame view and captures
+	CLEVER_PROFILE_THREAD("Name");		Optional name for the calling thread in traces
+
+The macros only exist when CLEVER_PROFILE is defined (Debug and Release), Dist compiles them out.
+*/
+namespace Profiler
+{
+	static const uint32_t ZONES_PER_THREAD = 1 << 16;
+	static const uint32_t FRAME_HISTORY = 256;
+
+	struct Zone
+	{
+		const char* name;
+		uint64_t start;
+		uint64_t end;
+		uint32_t depth;
+	};
+
+	//! Zones of one thread in [start, end), oldest first
+	struct ThreadZones
+	{
+		uint32_t threadId;
+		std::string threadName;
+		std::vector<Zone> zones;
+	};
+
+	uint64_t now();
+
+	void beginZone();
+	void endZone(const char* name, uint64_t start);
+
+	void setThreadName(const std::string& name);
+	void markFrame();
+
+	//! Start and end time of the last completed frame, false before two frames have been marked
+	bool getLastFrame(uint64_t& start, uint64_t& end);
+
+	std::vector<ThreadZones> collectZones(uint64_t start, uint64_t end);
+
+	//! Records every zone of every thread for frameCount frames then writes a Chrome trace (chrome://tracing, ui.perfetto.dev)
+	void captureFrames(uint32_t frameCount, const std::string& filename);
+	bool writeChromeTrace(const std::string& filename, uint64_t start, uint64_t end);
+
+	//! Registers the flame view dock
+	void init();
+	void profilerGui(std::vector<void*> classInstances);
+
+	class ScopedZone
+	{
+	public:
+		ScopedZone(const char* name) :
+			m_Name(name)
+		{
+			beginZone();
+			m_Start = now();
+		}
+
+		~ScopedZone()
+		{
+			endZone(m_Name, m_Start);
+		}
+
+		ScopedZone(const ScopedZone&) = delete;
+		ScopedZone& operator=(const ScopedZone&) = delete;
+
+	private:
+		const char* m_Name;
+		uint64_t m_Start;
+	};
+}
+
+#define CLEVER_PROFILE_CONCAT_INNER(a, b) a##b
+#define CLEVER_PROFILE_CONCAT(a, b) CLEVER_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef CLEVER_PROFILE
+	#define CLEVER_PROFILE_SCOPE(name) Profiler::ScopedZone CLEVER_PROFILE_CONCAT(profilerZone, __LINE__)(name)
+	#define CLEVER_PROFILE_FUNCTION() CLEVER_PROFILE_SCOPE(__FUNCTION__)
+	#define CLEVER_PROFILE_FRAME() Profiler::markFrame()
+	#define CLEVER_PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+	#define CLEVER_PROFILE_SCOPE(name)
+	#define CLEVER_PROFILE_FUNCTION()
+	#define CLEVER_PROFILE_FRAME()
+	#define CLEVER_PROFILE_THREAD(name)
+#endif
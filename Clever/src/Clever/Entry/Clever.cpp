@@ -1,4 +1,5 @@
 #include "Clever.h"
+#include <cctype>
 
 Clever::ManagerPointers Clever::managerpointers = Clever::ManagerPointers{};
 
@@ -11,7 +12,7 @@ Clever::~Clever()
 {
 }
 
-void Clever::init()
+void Clever::init(int argc, char** argv)
 {
     std::cout << "Hello World!\n";
     //TODO -----------Desired Code----------------
@@ -23,6 +24,24 @@ void Clever::init()
     windowFlags.height = 810;
     windowFlags.max_frames_in_flight = 2;
     windowFlags.DeveloperMode = true;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--headless")
+        {
+            windowFlags.Headless = true;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0])))
+                windowFlags.HeadlessFrameCount = std::stoi(argv[++i]);
+        }
+        else if (arg == "--capture" && i + 1 < argc)
+            windowFlags.CaptureDirectory = argv[++i];
+        else if (arg == "--capture-interval" && i + 1 < argc)
+            windowFlags.CaptureInterval = std::stoi(argv[++i]);
+        else if (arg == "--png")
+            windowFlags.CaptureExtension = ".png";
+        else if (arg == "--dynamic-resolution")
+            windowFlags.DynamicResolution = true;
+    }
     window->WindowInit(windowFlags);
     //!        IE:
     //            Raytracing/Rasterizing
@@ -39,7 +58,8 @@ void Clever::init()
     //
     material.reset(new Material::MaterialManager{});
     managerpointers.material = &material;
-    material->MaterialInit({ "Clever/Resource/Materials/stone.json" });
+    material->MaterialInit({ { "Clever/Resource/Materials/stone.json" } });
+    managerpointers.window->get()->getVulkan()->setMaterials(material->getMaterials());
     //!        IE:
     //            File location of material types and material properties, and how they mix together
     //!        Usage:
@@ -48,7 +68,7 @@ void Clever::init()
     //
     world.reset(new World::WorldManager{});
     managerpointers.world = &world;
-    world->worldInit(managerpointers.window->get()->getVulkan());
+    world->worldInit(managerpointers.window->get()->getVulkan(), *material);
     //!        IE:
     //            File location to load world Mesh and initial state
     //!        Usage:
@@ -79,6 +99,7 @@ void Clever::init()
     //
     //TODO    Loop()
     while (!managerpointers.window->get()->shouldClose()) {
+        CLEVER_PROFILE_FRAME();
         events->UpdateKeyPresses();
 
         float time = events->getTime();
@@ -109,6 +130,6 @@ void Clever::init()
         }
     }
 
-    window->cleanup(managerpointers.world->get()->getRenderables(), managerpointers.world->get()->getRenderablesSize());
     world->cleanup();
+    window->cleanup(managerpointers.world->get()->getRenderables(), managerpointers.world->get()->getRenderablesSize());
 }
\ No newline at end of file
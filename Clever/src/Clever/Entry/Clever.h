@@ -4,6 +4,7 @@
 #include "Clever/WorldManager/WorldManager.h"
 #include "Clever/Material/MaterialManager.h"
 #include "Clever/EventSystem/EventManager.h"
+#include "Clever/Tests/Tests.h"
 
 class Clever
 {
@@ -19,7 +20,8 @@ public:
 public:
     Clever();
     ~Clever();
-    void init();
+    //! --headless [frames] --capture <directory> --capture-interval <frames> --png --dynamic-resolution, --test alone runs the self tests instead
+    void init(int argc = 0, char** argv = nullptr);
 
 private:
     std::unique_ptr<World::WorldManager> world;
@@ -35,7 +37,11 @@ private:
 };
 
 
-int main(){
+int main(int argc, char** argv){
+    //Self tests need no window or device, nothing else is created
+    if (argc > 1 && std::string(argv[1]) == "--test")
+        return Tests::runAll();
+
     Clever clever{};
-    clever.init();
+    clever.init(argc, argv);
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "EventManager.h"
+#include "Clever/Developer/Profiler.h"
 
 
 namespace Event
@@ -43,6 +44,12 @@ namespace Event
 	void EventManager::Init(GLFWwindow* window)
 	{
 		p_Window = window;
+		m_StartTime = std::chrono::steady_clock::now();
+
+		//Headless, there is no window to get input from
+		if (window == nullptr)
+			return;
+
 		glfwSetWindowUserPointer(window, this);
 		glfwSetKeyCallback(window, key_callback);
 		glfwSetMouseButtonCallback(window, mouseButton_callback);
@@ -55,6 +62,10 @@ namespace Event
 
 	void EventManager::UpdateKeyPresses()
 	{
+		CLEVER_PROFILE_FUNCTION();
+		if (p_Window == nullptr)
+			return;
+
 		glfwPollEvents();
 
 		for (const auto& [key, value] : keyboardGLFWtoCleverKeyCodes)
@@ -68,12 +79,18 @@ namespace Event
 
 	float EventManager::getTime()
 	{
+		if (p_Window == nullptr)
+			return std::chrono::duration<float>(std::chrono::steady_clock::now() - m_StartTime).count();
+
 		return (float)glfwGetTime();
 	}
 
 	std::pair<int, int> EventManager::getMousePos()
 	{
-		std::pair<double, double> pos;
+		std::pair<double, double> pos = { 0, 0 };
+		if (p_Window == nullptr)
+			return pos;
+
 		glfwGetCursorPos(p_Window, &pos.first, &pos.second);
 		return pos;
 	}
@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <set>
 #include <vector>
+#include <chrono>
 //#include "Clever/Entry/Clever.h"
 
 namespace Event
@@ -52,7 +53,8 @@ namespace Event
 		}
 
 	private:
-		GLFWwindow* p_Window;
+		GLFWwindow* p_Window = nullptr;
+		std::chrono::steady_clock::time_point m_StartTime;
 
 		static std::vector<bool> keys;
 		bool mouseButtons[InputCodes::BUTTON_UNDEFINED];
@@ -0,0 +1,48 @@
+#include "InteractionTable.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <stdexcept>
+
+namespace Material
+{
+	void InteractionTable::build(const MaterialCache::MaterialLibrary& library)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		m_MaterialCount = library.getCount();
+		m_Interactions.clear();
+		m_Interactions.push_back(Interaction{});
+		m_Table.assign(size_t(m_MaterialCount) * m_MaterialCount, 0);
+		InteractionLookup lookup = { { std::make_tuple(Reaction::None, NO_MATERIAL, 0.0f), uint16_t(0) } };
+
+		for (uint32_t i = 0; i < library.getRuleCount(); i++)
+		{
+			const MaterialRule& rule = library.getRule(i);
+			Interaction interaction;
+			interaction.reaction = static_cast<Reaction>(rule.reaction);
+			interaction.result = rule.result;
+			interaction.blend = rule.blend;
+			m_Table[size_t(rule.a) * m_MaterialCount + rule.b] = intern(interaction, lookup);
+
+			//A material meeting itself has one entry, reversing it would overwrite the rule
+			if (rule.a == rule.b)
+				continue;
+			interaction.blend = 1.0f - rule.blend;
+			m_Table[size_t(rule.b) * m_MaterialCount + rule.a] = intern(interaction, lookup);
+		}
+	}
+
+	uint16_t InteractionTable::intern(const Interaction& interaction, InteractionLookup& lookup)
+	{
+		auto key = std::make_tuple(interaction.reaction, interaction.result, interaction.blend);
+		auto found = lookup.find(key);
+		if (found != lookup.end())
+			return found->second;
+
+		if (m_Interactions.size() == MAX_INTERACTIONS)
+			throw std::runtime_error("failed to build interaction table, too many distinct interactions!");
+		uint16_t index = static_cast<uint16_t>(m_Interactions.size());
+		m_Interactions.push_back(interaction);
+		lookup[key] = index;
+		return index;
+	}
+}
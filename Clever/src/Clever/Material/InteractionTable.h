@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include <map>
+#include <tuple>
+#include <cstdint>
+
+#include "Clever/Material/Material.h"
+#include "Clever/Material/MaterialCache.h"
+
+/*
+-------------Interaction Table----------------
+
+Every pair of materials resolved ahead of time, so asking what happens when two materials meet is a lookup and no
+rule is looked at while the game runs:
+	Table: N x N entries, row a column b, each the index of the pair's interaction. 16 bits so a thousand materials
+		   take 2MB and the table has to be rebuilt, not grown, when materials are added.
+	Interactions: every distinct outcome once, index 0 is Reaction::None which every pair without a rule gets.
+				  Few enough to stay in cache next to the row being read.
+
+b meeting a is the rule of a and b with the blend reversed, a material meeting itself is None unless it has a rule.
+*/
+namespace Material
+{
+	class InteractionTable
+	{
+	public:
+		static const uint32_t MAX_INTERACTIONS = UINT16_MAX + 1;
+
+	public:
+		InteractionTable() = default;
+
+		//! Throws if the rules make more than MAX_INTERACTIONS distinct outcomes
+		void build(const MaterialCache::MaterialLibrary& library);
+
+		//! Both ids have to be below the material count the table was built with
+		const Interaction& get(MaterialId a, MaterialId b) const
+		{
+			return m_Interactions[m_Table[size_t(a) * m_MaterialCount + b]];
+		}
+
+		uint32_t getMaterialCount() const
+		{
+			return m_MaterialCount;
+		}
+
+		uint32_t getInteractionCount() const
+		{
+			return static_cast<uint32_t>(m_Interactions.size());
+		}
+
+	private:
+		typedef std::map<std::tuple<Reaction, MaterialId, float>, uint16_t> InteractionLookup;
+
+		//! Index of interaction in m_Interactions, added if it is new
+		uint16_t intern(const Interaction& interaction, InteractionLookup& lookup);
+
+	private:
+		uint32_t m_MaterialCount = 0;
+		std::vector<uint16_t> m_Table;
+		std::vector<Interaction> m_Interactions;
+	};
+}
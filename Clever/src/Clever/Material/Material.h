@@ -0,0 +1,42 @@
+#pragma once
+#include <glm.hpp>
+#include <string>
+#include <cstdint>
+
+namespace Material
+{
+	//! Index into the MaterialManager's list, the GPU material buffer is in the same order
+	typedef uint32_t MaterialId;
+	//! Instances without a material keep their vertex color
+	const MaterialId NO_MATERIAL = UINT32_MAX;
+
+	//! What happens when two materials meet
+	enum class Reaction : uint32_t
+	{
+		None,		//Nothing, the default for every pair without a rule
+		Blend,		//They mix, blend is how much of the second one ends up in the first
+		Transform,	//Both become result
+		Count
+	};
+
+	//! The outcome of a pair of materials, compiled from the rules by the InteractionTable
+	struct Interaction
+	{
+		Reaction reaction = Reaction::None;
+		MaterialId result = NO_MATERIAL;
+		float blend = 0.0f;//0 to 1
+		uint32_t padding = 0;
+	};
+
+	//! As authored, at runtime materials are MaterialRecords in a cooked library
+	struct Material 
+	{
+		std::string name;
+		glm::vec3 color;//0 to 255
+
+		std::string toString()
+		{
+			return name + ": " + std::to_string(color.r) + ", " + std::to_string(color.g) + ", " + std::to_string(color.b);
+		}
+	};
+}
@@ -0,0 +1,308 @@
+#include "MaterialCache.h"
+#include "MaterialParser.h"
+#include "Clever/Developer/Profiler.h"
+#include "OS-Dependant/Platform/CookedFile.h"
+
+#include <cstring>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
+
+namespace MaterialCache
+{
+	static_assert(sizeof(MaterialRecord) == 32, "records are written as they are in memory");
+	static_assert(sizeof(MaterialRule) == 24, "rules are written as they are in memory");
+	static_assert(sizeof(MaterialLibraryHeader) % CookedFile::SECTION_ALIGNMENT == 0, "the header has to keep the first section aligned");
+
+	static const char MAGIC[4] = { 'C', 'M', 'A', 'T' };
+
+	//! Every file parsed on a thread of its own, then merged in order: a material or interaction given again by a
+	//! later file replaces the earlier one and keeps its id, so a mod only has to list what it changes
+	static MaterialParser::Source parseSources(const std::vector<std::string>& sourcePaths)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		if (sourcePaths.empty())
+			return {};
+
+		std::vector<MaterialParser::Source> sources(sourcePaths.size());
+		std::vector<std::string> errors(sourcePaths.size());
+		{
+			std::vector<std::thread> threads;
+			for (size_t i = 1; i < sourcePaths.size(); i++)
+				threads.emplace_back([&, i]() { MaterialParser::parse(sourcePaths[i], sources[i], errors[i]); });
+			if (!sourcePaths.empty())
+				MaterialParser::parse(sourcePaths[0], sources[0], errors[0]);
+			for (std::thread& thread : threads)
+				thread.join();
+		}
+
+		std::string error;
+		for (const std::string& fileError : errors)
+		{
+			if (!fileError.empty())
+				error += (error.empty() ? "" : "\n") + fileError;
+		}
+		if (!error.empty())
+			throw std::runtime_error(error);
+
+		MaterialParser::Source merged = std::move(sources[0]);
+		std::unordered_map<std::string, size_t> materialIndices;
+		std::map<std::pair<std::string, std::string>, size_t> ruleIndices;
+		for (size_t i = 0; i < merged.materials.size(); i++)
+			materialIndices[merged.materials[i].name] = i;
+		for (size_t i = 0; i < merged.rules.size(); i++)
+			ruleIndices[{ std::min(merged.rules[i].a, merged.rules[i].b), std::max(merged.rules[i].a, merged.rules[i].b) }] = i;
+
+		for (size_t i = 1; i < sources.size(); i++)
+		{
+			for (Material::Material& material : sources[i].materials)
+			{
+				auto found = materialIndices.find(material.name);
+				if (found != materialIndices.end())
+					merged.materials[found->second] = std::move(material);
+				else
+				{
+					materialIndices[material.name] = merged.materials.size();
+					merged.materials.push_back(std::move(material));
+				}
+			}
+			for (MaterialParser::Rule& rule : sources[i].rules)
+			{
+				std::pair<std::string, std::string> pair = { std::min(rule.a, rule.b), std::max(rule.a, rule.b) };
+				auto found = ruleIndices.find(pair);
+				if (found != ruleIndices.end())
+					merged.rules[found->second] = std::move(rule);
+				else
+				{
+					ruleIndices[pair] = merged.rules.size();
+					merged.rules.push_back(std::move(rule));
+				}
+			}
+		}
+		return merged;
+	}
+
+	bool MaterialLibrary::open(const std::string& cachePath)
+	{
+		close();
+		if (!m_File.open(cachePath) || m_File.size() < sizeof(MaterialLibraryHeader))
+		{
+			m_File.close();
+			return false;
+		}
+
+		const MaterialLibraryHeader* header = reinterpret_cast<const MaterialLibraryHeader*>(m_File.data());
+		size_t size = m_File.size();
+		bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION
+			&& header->hashSlotCount > 0 && (header->hashSlotCount & (header->hashSlotCount - 1)) == 0 && header->hashSlotCount > header->materialCount
+			&& CookedFile::sectionFits(header->recordOffset, uint64_t(header->materialCount) * sizeof(MaterialRecord), size)
+			&& CookedFile::sectionFits(header->hashSlotOffset, uint64_t(header->hashSlotCount) * sizeof(uint32_t), size)
+			&& CookedFile::sectionFits(header->stringOffset, header->stringBytes, size)
+			&& CookedFile::sectionFits(header->ruleOffset, uint64_t(header->ruleCount) * sizeof(MaterialRule), size);
+		if (!valid)
+		{
+			m_File.close();
+			return false;
+		}
+
+		m_Header = header;
+		m_Records = reinterpret_cast<const MaterialRecord*>(m_File.data() + header->recordOffset);
+		m_HashSlots = reinterpret_cast<const uint32_t*>(m_File.data() + header->hashSlotOffset);
+		m_Strings = reinterpret_cast<const char*>(m_File.data() + header->stringOffset);
+		m_Rules = reinterpret_cast<const MaterialRule*>(m_File.data() + header->ruleOffset);
+
+		for (uint32_t i = 0; i < header->materialCount; i++)
+		{
+			const MaterialRecord& record = m_Records[i];
+			if (record.nameOffset > header->stringBytes || record.nameLength >= header->stringBytes - record.nameOffset)
+			{
+				close();
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < header->hashSlotCount; i++)
+		{
+			if (m_HashSlots[i] != Material::NO_MATERIAL && m_HashSlots[i] >= header->materialCount)
+			{
+				close();
+				return false;
+			}
+		}
+		for (uint32_t i = 0; i < header->ruleCount; i++)
+		{
+			const MaterialRule& rule = m_Rules[i];
+			if (rule.a >= header->materialCount || rule.b >= header->materialCount || rule.reaction >= static_cast<uint32_t>(Material::Reaction::Count)
+				|| (rule.result != Material::NO_MATERIAL && rule.result >= header->materialCount))
+			{
+				close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void MaterialLibrary::close()
+	{
+		m_File.close();
+		m_Header = nullptr;
+		m_Records = nullptr;
+		m_HashSlots = nullptr;
+		m_Strings = nullptr;
+		m_Rules = nullptr;
+	}
+
+	Material::MaterialId MaterialLibrary::find(std::string_view name) const
+	{
+		Material::MaterialId id = findByHash(hashName(name));
+		if (id == Material::NO_MATERIAL || getName(id) != name)
+			return Material::NO_MATERIAL;
+		return id;
+	}
+
+	Material::MaterialId MaterialLibrary::findByHash(uint64_t nameHash) const
+	{
+		if (!m_Header)
+			return Material::NO_MATERIAL;
+
+		//There is always an empty slot, so the probe ends
+		uint32_t mask = m_Header->hashSlotCount - 1;
+		for (uint32_t slot = static_cast<uint32_t>(nameHash) & mask; ; slot = (slot + 1) & mask)
+		{
+			Material::MaterialId id = m_HashSlots[slot];
+			if (id == Material::NO_MATERIAL || m_Records[id].nameHash == nameHash)
+				return id;
+		}
+	}
+
+	std::string getCachePath(const std::vector<std::string>& sourcePaths)
+	{
+		if (sourcePaths.size() == 1)
+			return sourcePaths[0] + ".cmat";
+
+		//Each set of files gets its own library, named after the first file. With the terminators so "a","bc" and "ab","c" differ
+		uint64_t hash = CookedFile::FNV_OFFSET;
+		for (const std::string& path : sourcePaths)
+			hash = CookedFile::hash(path.c_str(), path.size() + 1, hash);
+		return sourcePaths[0] + "." + std::to_string(hash) + ".cmat";
+	}
+
+	bool isUpToDate(const std::vector<std::string>& sourcePaths, const std::string& cachePath)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		MaterialLibraryHeader header;
+		{
+			MaterialLibrary cached;
+			if (!cached.open(cachePath))
+				return false;
+			header = cached.getHeader();
+		}
+		return CookedFile::isCurrent(cachePath, offsetof(MaterialLibraryHeader, sourceTime), header.sourceTime, header.sourceHash, sourcePaths);
+	}
+
+	void cook(const std::vector<std::string>& sourcePaths, const std::string& cachePath)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		MaterialParser::Source source = parseSources(sourcePaths);
+		std::vector<Material::Material>& materials = source.materials;
+
+		MaterialLibraryHeader header{};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.sourceHash = CookedFile::hashFiles(sourcePaths);
+		header.sourceTime = CookedFile::getFileTime(sourcePaths);
+
+		//! Interning, every name gets the next id
+		std::vector<MaterialRecord> records(materials.size());
+		std::string strings;
+		for (size_t i = 0; i < materials.size(); i++)
+		{
+			const Material::Material& material = materials[i];
+			MaterialRecord& record = records[i];
+			record.nameHash = hashName(material.name);
+			record.nameOffset = static_cast<uint32_t>(strings.size());
+			record.nameLength = static_cast<uint32_t>(material.name.size());
+			record.color = glm::vec4(material.color, 0.0f);
+			strings += material.name;
+			strings += '\0';
+		}
+
+		//! Hash slots, a name or hash seen twice can't be interned
+		uint32_t slotCount = 1;
+		while (slotCount < records.size() * 2)
+			slotCount *= 2;
+		std::vector<uint32_t> slots(slotCount, Material::NO_MATERIAL);
+		for (uint32_t id = 0; id < records.size(); id++)
+		{
+			uint32_t mask = slotCount - 1;
+			uint32_t slot = static_cast<uint32_t>(records[id].nameHash) & mask;
+			while (slots[slot] != Material::NO_MATERIAL)
+			{
+				if (records[slots[slot]].nameHash == records[id].nameHash)
+				{
+					if (materials[slots[slot]].name == materials[id].name)
+						throw std::runtime_error("material " + materials[id].name + " is defined twice!");
+					throw std::runtime_error("materials " + materials[slots[slot]].name + " and " + materials[id].name + " have the same name hash, rename one!");
+				}
+				slot = (slot + 1) & mask;
+			}
+			slots[slot] = id;
+		}
+
+		auto findId = [&](const std::string& name) -> Material::MaterialId
+		{
+			uint32_t mask = slotCount - 1;
+			for (uint32_t slot = static_cast<uint32_t>(hashName(name)) & mask; slots[slot] != Material::NO_MATERIAL; slot = (slot + 1) & mask)
+			{
+				if (materials[slots[slot]].name == name)
+					return slots[slot];
+			}
+			throw std::runtime_error("interaction names unknown material " + name + "!");
+		};
+
+		//! Rules, names resolved to ids
+		std::vector<MaterialRule> rules;
+		for (const MaterialParser::Rule& authored : source.rules)
+		{
+			MaterialRule rule{};
+			rule.a = findId(authored.a);
+			rule.b = findId(authored.b);
+			rule.reaction = static_cast<uint32_t>(authored.reaction);
+			rule.result = authored.reaction == Material::Reaction::Transform ? findId(authored.result) : Material::NO_MATERIAL;
+			rule.blend = authored.blend;
+			rules.push_back(rule);
+		}
+
+		header.materialCount = static_cast<uint32_t>(records.size());
+		header.hashSlotCount = slotCount;
+		header.stringBytes = static_cast<uint32_t>(strings.size());
+		header.ruleCount = static_cast<uint32_t>(rules.size());
+
+		CookedFile::Section sections[] =
+		{
+			{ &header.recordOffset, records.data(), records.size() * sizeof(MaterialRecord) },
+			{ &header.hashSlotOffset, slots.data(), slots.size() * sizeof(uint32_t) },
+			{ &header.stringOffset, strings.data(), strings.size() },
+			{ &header.ruleOffset, rules.data(), rules.size() * sizeof(MaterialRule) }
+		};
+
+		if (!CookedFile::write(cachePath, &header, sizeof(header), sections, std::size(sections)))
+			throw std::runtime_error("failed to write material library!");
+	}
+
+	void load(const std::vector<std::string>& sourcePaths, MaterialLibrary& library)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		if (sourcePaths.empty())
+			throw std::runtime_error("failed to load materials, no material file given!");
+
+		std::string cachePath = getCachePath(sourcePaths);
+		if (!isUpToDate(sourcePaths, cachePath))
+			cook(sourcePaths, cachePath);
+
+		if (!library.open(cachePath))
+			throw std::runtime_error("failed to open material library!");
+	}
+}
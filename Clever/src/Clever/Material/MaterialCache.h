@@ -0,0 +1,147 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "Clever/Material/Material.h"
+#include "OS-Dependant/Platform/MappedFile.h"
+#include "OS-Dependant/Platform/CookedFile.h"
+
+/*
+-------------Material Cache----------------
+
+JSON is the authoring format, at runtime materials come from a cooked library written next to the source as
+<source>.cmat. It is mapped and used as it is, nothing is parsed or copied. Several sources (a game and its mods) are
+parsed in parallel by the MaterialParser and merged into one library, later files replacing what earlier ones define.
+
+Layout, every section starts on CookedFile::SECTION_ALIGNMENT:
+	MaterialLibraryHeader
+	Records:	materialCount MaterialRecord, a material's id is its index
+	Hash slots:	hashSlotCount ids (NO_MATERIAL when empty), open addressing on the name hash with linear probing.
+				Always a power of two and at least twice materialCount, so a probe stays short
+	Strings:	every name, null terminated
+	Rules:		ruleCount MaterialRule, the interactions authored under "Interactions" with their names resolved.
+				At most one per pair, the InteractionTable compiles them when the library is loaded
+
+Names are interned when cooking: every name has one dense id, and no two names share a hash so a hash alone is
+enough to find a material. Hot loops hash their names once (hashName is constexpr) and use findByHash.
+
+A library is used when its version matches and the sources are the ones it was cooked from, see CookedFile. The stored
+time and hash combine those of every source.
+*/
+struct MaterialLibraryHeader
+{
+	char magic[4];//"CMAT"
+	uint32_t version;
+	uint64_t sourceHash;
+	int64_t sourceTime;
+
+	uint32_t materialCount;
+	uint32_t hashSlotCount;
+	uint32_t stringBytes;
+	uint32_t ruleCount;
+
+	//Byte offsets from the start of the file
+	uint64_t recordOffset;
+	uint64_t hashSlotOffset;
+	uint64_t stringOffset;
+	uint64_t ruleOffset;
+	uint64_t reserved;
+};
+
+struct MaterialRecord
+{
+	uint64_t nameHash;
+	uint32_t nameOffset;//Into the strings
+	uint32_t nameLength;//Without the null
+	glm::vec4 color;//0 to 255, a is unused
+};
+
+//! a meeting b, b meeting a is the same rule with the blend reversed
+struct MaterialRule
+{
+	Material::MaterialId a;
+	Material::MaterialId b;
+	uint32_t reaction;//Material::Reaction
+	Material::MaterialId result;//NO_MATERIAL unless the reaction is Transform
+	float blend;
+	uint32_t padding;
+};
+
+namespace MaterialCache
+{
+	static const uint32_t VERSION = 3;
+
+	constexpr uint64_t hashName(std::string_view name)
+	{
+		return CookedFile::hashText(name);
+	}
+
+	//! A mapped .cmat, records and names stay valid while it is open
+	class MaterialLibrary
+	{
+	public:
+		//! Checks the magic, version, that every section is inside the file and every id and name in range
+		bool open(const std::string& cachePath);
+		void close();
+
+		const MaterialLibraryHeader& getHeader() const
+		{
+			return *m_Header;
+		}
+
+		uint32_t getCount() const
+		{
+			return m_Header ? m_Header->materialCount : 0;
+		}
+
+		const MaterialRecord& getRecord(Material::MaterialId id) const
+		{
+			return m_Records[id];
+		}
+
+		std::string_view getName(Material::MaterialId id) const
+		{
+			return std::string_view(m_Strings + m_Records[id].nameOffset, m_Records[id].nameLength);
+		}
+
+		uint32_t getRuleCount() const
+		{
+			return m_Header ? m_Header->ruleCount : 0;
+		}
+
+		const MaterialRule& getRule(uint32_t rule) const
+		{
+			return m_Rules[rule];
+		}
+
+		//! NO_MATERIAL when no material has the name
+		Material::MaterialId find(std::string_view name) const;
+		//! nameHash from hashName, NO_MATERIAL when no material has it
+		Material::MaterialId findByHash(uint64_t nameHash) const;
+
+	private:
+		MappedFile m_File;
+		const MaterialLibraryHeader* m_Header = nullptr;
+		const MaterialRecord* m_Records = nullptr;
+		const uint32_t* m_HashSlots = nullptr;
+		const char* m_Strings = nullptr;
+		const MaterialRule* m_Rules = nullptr;
+	};
+
+	//! <source>.cmat for one source, named after the first source and a hash of all of them otherwise
+	std::string getCachePath(const std::vector<std::string>& sourcePaths);
+
+	//! Refreshes the stored time when only the sources' times changed
+	bool isUpToDate(const std::vector<std::string>& sourcePaths, const std::string& cachePath);
+
+	//! Parses and merges the sources and writes the library. Throws with "path:line: reason" of every file that doesn't
+	//! parse, if an interaction names a material no file defines, or if the library can't be written
+	void cook(const std::vector<std::string>& sourcePaths, const std::string& cachePath);
+
+	//! Cooks the sources first if their library is missing or stale, throws if the result can't be opened
+	void load(const std::vector<std::string>& sourcePaths, MaterialLibrary& library);
+}
@@ -1,21 +1,27 @@
 #pragma once
-#include <fstream>
 #include <iostream>
 #include <glm.hpp>
+#include <stdexcept>
+#include <vector>
+
+#include "Clever/Material/Material.h"
+#include "Clever/Material/MaterialCache.h"
+#include "Clever/Material/InteractionTable.h"
+#include "Clever/Developer/Profiler.h"
 
-#include "rapidjson/document.h"
-#include <rapidjson/istreamwrapper.h>
-#include "rapidjson/writer.h"
-#include "rapidjson/stringbuffer.h"
 /*
 -------------Material Stucture----------------
 
-File Format: Json, v0.1(Will be replaced with more effient file size in future, v0.?)
+File Format: Json, v0.1. Authored as Json (see MaterialParser.h for the layout), several files are merged and cooked
+	into a binary library that is mapped at runtime (see MaterialCache.h)
 
 Name: the name of the material, V0.1
 
 Color: Color of Material, v0.1(Will be replaced with procedurally created texture of compounds, v0.?)
 
+Interactions: What happens when two materials meet (None, Blend or Transform into a Result), v0.1. Compiled into the
+	InteractionTable when loaded, see InteractionTable.h
+
 Properties: Real world material properties, v0.2
 	Reflectiveness
 	Roughness
@@ -28,20 +34,9 @@ MagicStructure: Same as properties but with Magic, entirly our Creation and desi
 
 namespace Material
 {
-	struct Material 
-	{
-		std::string name;
-		glm::vec3 color;
-
-		std::string toString()
-		{
-			return name + ": " + std::to_string(color.r) + ", " + std::to_string(color.g) + ", " + std::to_string(color.b);
-		}
-	};
-
 	struct MaterialFlags
 	{
-		std::string materialFilePath;
+		std::vector<std::string> materialFiles;//Merged in order, a later file replaces the materials and interactions it redefines
 	};
 
 	class MaterialManager
@@ -49,54 +44,52 @@ namespace Material
 
 	public:
 
-		class MaterialManager()
+		MaterialManager()
 		{
 
 		}
 
 		void MaterialInit(MaterialFlags materialFlags)
 		{
-			loadMaterial(materialFlags.materialFilePath);
+			loadMaterial(materialFlags.materialFiles);
 		}
 
-		std::vector<Material> getMaterials()
+		//! Every material, a MaterialId indexes it
+		const MaterialCache::MaterialLibrary& getMaterials() const
 		{
-			return materialList;
+			return library;
 		}
+
+		//! name is the material's "Name", throws if no material has it. Hot loops should keep the id
+		MaterialId getMaterialId(std::string_view name) const
+		{
+			MaterialId id = library.find(name);
+			if (id == NO_MATERIAL)
+				throw std::runtime_error("failed to find material " + std::string(name) + "!");
+			return id;
+		}
+
+		const MaterialRecord& getMaterial(MaterialId id) const
+		{
+			return library.getRecord(id);
+		}
+
+		//! a meeting b, a single lookup into the precomputed table
+		const Interaction& getInteraction(MaterialId a, MaterialId b) const
+		{
+			return interactions.get(a, b);
+		}
+
 	private:
-		void loadMaterial(std::string filePath)
+		void loadMaterial(const std::vector<std::string>& filePaths)
 		{
-			using namespace rapidjson;
-			std::ifstream material_file(filePath);
-			IStreamWrapper streamWrapper(material_file);
-
-			Document materials;
-			materials.ParseStream(streamWrapper);
-
-			//Material m{ materials["Stone"].GetString(), {materials["Stone"]["Color"]["r"].GetInt(),materials["Stone"]["Color"]["g"].GetInt(),materials["Stone"]["Color"]["b"].GetInt()}};
-
-			//rapidjson::StringBuffer buffer;
-			//rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-			//materials.Accept(writer);
-			materialList.resize(materials.MemberCount());
-
-			int i = 0;
-			for (Value::ConstMemberIterator itr = materials.MemberBegin(); itr != materials.MemberEnd(); itr++)
-			{
-				const auto& name = itr->value["Name"];
-				const auto& color = itr->value["Color"];
-				materialList.at(i) = { name.GetString(), {color["r"].GetFloat(), color["g"].GetFloat(), color["b"].GetFloat()}};
-				i++;
-			}
-			std::cout << std::endl;
-			for (Material m : materialList)
-			{
-				std::cout << m.toString() << std::endl;
-			}
+			CLEVER_PROFILE_FUNCTION();
+			MaterialCache::load(filePaths, library);
+			interactions.build(library);
 		}
 
 	private:
-		std::vector<Material> materialList;
+		MaterialCache::MaterialLibrary library;
+		InteractionTable interactions;
 	};
 }
-
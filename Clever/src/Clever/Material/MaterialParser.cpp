@@ -0,0 +1,354 @@
+#include "MaterialParser.h"
+#include "OS-Dependant/Platform/MappedFile.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <set>
+#include <unordered_set>
+#include <algorithm>
+#include <cstring>
+
+#include "rapidjson/reader.h"
+#include "rapidjson/memorystream.h"
+#include "rapidjson/error/en.h"
+
+namespace MaterialParser
+{
+	static const char* REACTION_NAMES[] = { "None", "Blend", "Transform" };
+	static_assert(sizeof(REACTION_NAMES) / sizeof(REACTION_NAMES[0]) == static_cast<size_t>(Material::Reaction::Count), "every reaction needs its name");
+
+	//! Where the handler is, the value expected next is picked by m_Field
+	enum class Context
+	{
+		Start,
+		Root,
+		Material,
+		Color,
+		Interactions,
+		Rule,
+		RuleMaterials,
+		Done
+	};
+
+	//! The key whose value comes next, also the bit it sets in m_Seen
+	enum class Field : uint32_t
+	{
+		None,
+		Material,
+		Interactions,
+		Name,
+		Color,
+		R,
+		G,
+		B,
+		Materials,
+		Reaction,
+		Blend,
+		Result
+	};
+
+	class Handler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Handler>
+	{
+	public:
+		Handler(Source& source, rapidjson::MemoryStream& stream)
+			: m_Source(source), m_Stream(stream)
+		{
+
+		}
+
+		//Null, booleans and anything else without a handler of its own
+		bool Default()
+		{
+			return unexpected("value");
+		}
+
+		bool Int(int value) { return number(value); }
+		bool Uint(unsigned value) { return number(value); }
+		bool Int64(int64_t value) { return number(static_cast<double>(value)); }
+		bool Uint64(uint64_t value) { return number(static_cast<double>(value)); }
+		bool Double(double value) { return number(value); }
+
+		bool String(const char* text, rapidjson::SizeType length, bool)
+		{
+			std::string value(text, length);
+			if (m_Context == Context::Material && m_Field == Field::Name)
+			{
+				if (value.empty())
+					return fail("material " + m_Key + " has an empty Name");
+				m_Material.name = value;
+			}
+			else if (m_Context == Context::Rule && m_Field == Field::Reaction)
+			{
+				const char** reaction = std::find(std::begin(REACTION_NAMES), std::end(REACTION_NAMES), value);
+				if (reaction == std::end(REACTION_NAMES))
+					return fail("unknown Reaction " + value + ", it has to be None, Blend or Transform");
+				m_Reaction = static_cast<Material::Reaction>(reaction - std::begin(REACTION_NAMES));
+			}
+			else if (m_Context == Context::Rule && m_Field == Field::Result)
+				m_Rule.result = value;
+			else if (m_Context == Context::RuleMaterials)
+			{
+				if (m_RuleMaterials.size() == 2)
+					return fail("an interaction has exactly two Materials");
+				m_RuleMaterials.push_back(value);
+				return true;
+			}
+			else
+				return unexpected("string");
+
+			m_Field = Field::None;
+			return true;
+		}
+
+		bool StartObject()
+		{
+			if (m_Context == Context::Start)
+				m_Context = Context::Root;
+			else if (m_Context == Context::Root && m_Field == Field::Material)
+			{
+				m_Context = Context::Material;
+				m_Material = {};
+				m_Start = m_Stream.Tell();
+			}
+			else if (m_Context == Context::Material && m_Field == Field::Color)
+				m_Context = Context::Color;
+			else if (m_Context == Context::Interactions)
+			{
+				m_Context = Context::Rule;
+				m_Rule = {};
+				m_RuleMaterials.clear();
+				m_Reaction = Material::Reaction::Count;
+				m_Start = m_Stream.Tell();
+			}
+			else
+				return unexpected("object");
+
+			m_Field = Field::None;
+			m_Seen[static_cast<size_t>(m_Context)] = 0;
+			return true;
+		}
+
+		bool Key(const char* text, rapidjson::SizeType length, bool)
+		{
+			std::string key(text, length);
+			Field field = Field::None;
+			switch (m_Context)
+			{
+			case Context::Root:
+				if (key == INTERACTIONS_KEY)
+					field = Field::Interactions;
+				else
+				{
+					field = Field::Material;
+					m_Key = key;
+				}
+				break;
+			case Context::Material:
+				field = key == "Name" ? Field::Name : key == "Color" ? Field::Color : Field::None;
+				break;
+			case Context::Color:
+				field = key == "r" ? Field::R : key == "g" ? Field::G : key == "b" ? Field::B : Field::None;
+				break;
+			case Context::Rule:
+				field = key == "Materials" ? Field::Materials : key == "Reaction" ? Field::Reaction : key == "Blend" ? Field::Blend : key == "Result" ? Field::Result : Field::None;
+				break;
+			default:
+				break;
+			}
+			if (field == Field::None)
+				return fail("unknown field " + key);
+
+			//Materials are checked by name when they end, the same key twice is still a mistake
+			uint32_t& seen = m_Seen[static_cast<size_t>(m_Context)];
+			uint32_t bit = 1u << static_cast<uint32_t>(field);
+			if (field != Field::Material && (seen & bit))
+				return fail("field " + key + " is given twice");
+			seen |= bit;
+
+			m_Field = field;
+			return true;
+		}
+
+		bool EndObject(rapidjson::SizeType)
+		{
+			switch (m_Context)
+			{
+			case Context::Color:
+				if (!has(Context::Color, Field::R) || !has(Context::Color, Field::G) || !has(Context::Color, Field::B))
+					return fail("the Color of material " + m_Key + " needs r, g and b");
+				m_Context = Context::Material;
+				break;
+			case Context::Material:
+				if (!has(Context::Material, Field::Name) || !has(Context::Material, Field::Color))
+					return fail("material " + m_Key + " needs a Name and a Color", m_Start);
+				if (!m_Names.insert(m_Material.name).second)
+					return fail("material " + m_Material.name + " is defined twice", m_Start);
+				m_Source.materials.push_back(m_Material);
+				m_Context = Context::Root;
+				break;
+			case Context::Rule:
+			{
+				if (!has(Context::Rule, Field::Materials) || m_Reaction == Material::Reaction::Count)
+					return fail("an interaction needs Materials and a Reaction", m_Start);
+				if (m_Reaction == Material::Reaction::Transform && m_Rule.result.empty())
+					return fail("an interaction that transforms needs a Result", m_Start);
+
+				m_Rule.a = m_RuleMaterials[0];
+				m_Rule.b = m_RuleMaterials[1];
+				m_Rule.reaction = m_Reaction;
+				if (!m_Pairs.insert({ std::min(m_Rule.a, m_Rule.b), std::max(m_Rule.a, m_Rule.b) }).second)
+					return fail("the interaction of " + m_Rule.a + " and " + m_Rule.b + " is defined twice", m_Start);
+				m_Source.rules.push_back(m_Rule);
+				m_Context = Context::Interactions;
+				break;
+			}
+			case Context::Root:
+				m_Context = Context::Done;
+				break;
+			default:
+				return fail("unexpected end of object");
+			}
+			m_Field = Field::None;
+			return true;
+		}
+
+		bool StartArray()
+		{
+			if (m_Context == Context::Root && m_Field == Field::Interactions)
+				m_Context = Context::Interactions;
+			else if (m_Context == Context::Rule && m_Field == Field::Materials)
+				m_Context = Context::RuleMaterials;
+			else
+				return unexpected("array");
+
+			m_Field = Field::None;
+			return true;
+		}
+
+		bool EndArray(rapidjson::SizeType)
+		{
+			if (m_Context == Context::RuleMaterials)
+			{
+				if (m_RuleMaterials.size() != 2)
+					return fail("an interaction has exactly two Materials");
+				m_Context = Context::Rule;
+			}
+			else
+				m_Context = Context::Root;
+			return true;
+		}
+
+		const std::string& getError() const
+		{
+			return m_Error;
+		}
+
+		size_t getErrorOffset() const
+		{
+			return m_ErrorOffset;
+		}
+
+	private:
+		bool number(double value)
+		{
+			if (m_Context == Context::Color && (m_Field == Field::R || m_Field == Field::G || m_Field == Field::B))
+			{
+				if (!(value >= 0.0 && value <= 255.0))
+					return fail("the Color of material " + m_Key + " is outside 0 to 255");
+				m_Material.color[static_cast<uint32_t>(m_Field) - static_cast<uint32_t>(Field::R)] = static_cast<float>(value);
+			}
+			else if (m_Context == Context::Rule && m_Field == Field::Blend)
+			{
+				if (!(value >= 0.0 && value <= 1.0))
+					return fail("Blend is outside 0 to 1");
+				m_Rule.blend = static_cast<float>(value);
+			}
+			else
+				return unexpected("number");
+
+			m_Field = Field::None;
+			return true;
+		}
+
+		bool has(Context context, Field field) const
+		{
+			return (m_Seen[static_cast<size_t>(context)] & (1u << static_cast<uint32_t>(field))) != 0;
+		}
+
+		bool unexpected(const std::string& what)
+		{
+			if (m_Context == Context::Root && m_Field == Field::Material)
+				return fail("material " + m_Key + " has to be an object");
+			if (m_Context == Context::Root && m_Field == Field::Interactions)
+				return fail("Interactions has to be an array");
+			return fail("unexpected " + what);
+		}
+
+		//! Stops the parse, offset is where the problem is, the current position by default
+		bool fail(const std::string& error, size_t offset = SIZE_MAX)
+		{
+			m_Error = error;
+			m_ErrorOffset = offset == SIZE_MAX ? m_Stream.Tell() : offset;
+			return false;
+		}
+
+	private:
+		Source& m_Source;
+		rapidjson::MemoryStream& m_Stream;
+
+		Context m_Context = Context::Start;
+		Field m_Field = Field::None;
+		uint32_t m_Seen[static_cast<size_t>(Context::Done) + 1] = {};//Fields given so far in the open object of each context
+		size_t m_Start = 0;//Of the material or rule being read
+
+		std::string m_Key;//Of the material being read, for errors
+		Material::Material m_Material;
+		Rule m_Rule;
+		std::vector<std::string> m_RuleMaterials;
+		Material::Reaction m_Reaction = Material::Reaction::Count;//Count until it is given
+
+		std::unordered_set<std::string> m_Names;
+		std::set<std::pair<std::string, std::string>> m_Pairs;
+
+		std::string m_Error;
+		size_t m_ErrorOffset = 0;
+	};
+
+	static size_t getLine(const char* text, size_t offset)
+	{
+		return 1 + std::count(text, text + offset, '\n');
+	}
+
+	bool parse(const char* text, size_t size, Source& source, std::string& error, const std::string& name)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		source = Source{};
+
+		rapidjson::MemoryStream stream(text, size);
+		Handler handler(source, stream);
+		rapidjson::Reader reader;
+		rapidjson::ParseResult result = reader.Parse(stream, handler);
+		if (result)
+			return true;
+
+		size_t offset = result.Offset();
+		std::string reason = rapidjson::GetParseError_En(result.Code());
+		if (result.Code() == rapidjson::kParseErrorTermination)
+		{
+			offset = handler.getErrorOffset();
+			reason = handler.getError();
+		}
+		error = name + ":" + std::to_string(getLine(text, std::min(offset, size))) + ": " + reason;
+		return false;
+	}
+
+	bool parse(const std::string& path, Source& source, std::string& error)
+	{
+		MappedFile file;
+		if (!file.open(path))
+		{
+			error = path + ": can't be opened";
+			return false;
+		}
+		return parse(reinterpret_cast<const char*>(file.data()), file.size(), source, error, path);
+	}
+}
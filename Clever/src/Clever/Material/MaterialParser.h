@@ -0,0 +1,46 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "Clever/Material/Material.h"
+
+/*
+-------------Material Parser----------------
+
+Reads a material file straight out of a mapped file with rapidjson's SAX Reader, so no document is built and the
+memory used is what the materials themselves take:
+	{
+		"Stone": { "Name": "stone", "Color": { "r": 100, "g": 60, "b": 170 } },
+		"Interactions": [ { "Materials": [ "stone", "wood" ], "Reaction": "Blend", "Blend": 0.25, "Result": "wood" } ]
+	}
+Every field is checked as it is read: unknown or repeated keys, values of the wrong type, colors outside 0 to 255,
+missing fields and a name or pair defined twice in the file are errors. Names in interactions are resolved later,
+when every file has been merged (see MaterialCache::cook).
+*/
+namespace MaterialParser
+{
+	static const char* const INTERACTIONS_KEY = "Interactions";
+
+	//! An interaction as authored, by name
+	struct Rule
+	{
+		std::string a;
+		std::string b;
+		Material::Reaction reaction = Material::Reaction::None;
+		std::string result;//Empty unless the reaction is Transform
+		float blend = 0.5f;
+	};
+
+	struct Source
+	{
+		std::vector<Material::Material> materials;
+		std::vector<Rule> rules;
+	};
+
+	//! error gets "path:line: reason" for the first problem
+	bool parse(const std::string& path, Source& source, std::string& error);
+
+	//! Same as above on text already in memory
+	bool parse(const char* text, size_t size, Source& source, std::string& error, const std::string& name = "materials");
+}
@@ -0,0 +1,109 @@
+#include "Tests.h"
+#include "Clever/Material/InteractionTable.h"
+
+#include <filesystem>
+
+static const char* MATERIALS = R"({
+	"Stone": { "Name": "stone", "Color": { "r": 100, "g": 60, "b": 170 } },
+	"Wood": { "Name": "wood", "Color": { "r": 63, "g": 48, "b": 29 } },
+	"Skin": { "Name": "skin", "Color": { "r": 240, "g": 230, "b": 140 } },
+	"Water": { "Name": "water", "Color": { "r": 20, "g": 60, "b": 200 } },
+	"Interactions": [
+		{ "Materials": [ "stone", "wood" ], "Reaction": "Blend", "Blend": 0.25 },
+		{ "Materials": [ "skin", "wood" ], "Reaction": "Transform", "Result": "wood" },
+		{ "Materials": [ "water", "water" ], "Reaction": "Blend", "Blend": 0.3 },
+		{ "Materials": [ "wood", "water" ], "Reaction": "Blend", "Blend": 0.25 }
+	]
+})";
+
+//! Cooks MATERIALS and builds the table from it
+static void buildTable(const std::string& name, MaterialCache::MaterialLibrary& library, Material::InteractionTable& table)
+{
+	std::string path = Tests::writeTemporaryFile(name, MATERIALS);
+	std::string cachePath = MaterialCache::getCachePath({ path });
+	std::error_code error;
+	std::filesystem::remove(cachePath, error);
+
+	MaterialCache::load({ path }, library);
+	table.build(library);
+
+	std::filesystem::remove(path, error);
+}
+
+static void removeCache(const std::string& name)
+{
+	std::error_code error;
+	std::filesystem::remove(MaterialCache::getCachePath({ Tests::getTemporaryPath(name) }), error);
+}
+
+CLEVER_TEST(InteractionTableIsSymmetric)
+{
+	MaterialCache::MaterialLibrary library;
+	Material::InteractionTable table;
+	buildTable("symmetric.json", library, table);
+	CLEVER_CHECK(table.getMaterialCount() == 4);
+
+	//b meeting a is a meeting b with the blend reversed, the reaction and result are the same
+	bool symmetric = true;
+	for (Material::MaterialId a = 0; a < table.getMaterialCount(); a++)
+	{
+		for (Material::MaterialId b = 0; b < table.getMaterialCount(); b++)
+		{
+			if (a == b)
+				continue;
+			const Material::Interaction& ab = table.get(a, b);
+			const Material::Interaction& ba = table.get(b, a);
+			symmetric = symmetric && ab.reaction == ba.reaction && ab.result == ba.result;
+			if (ab.reaction == Material::Reaction::Blend)
+				symmetric = symmetric && ab.blend + ba.blend == 1.0f;
+		}
+	}
+	CLEVER_CHECK(symmetric);
+
+	Material::MaterialId stone = library.find("stone");
+	Material::MaterialId wood = library.find("wood");
+	Material::MaterialId skin = library.find("skin");
+	CLEVER_CHECK(table.get(stone, wood).reaction == Material::Reaction::Blend && table.get(stone, wood).blend == 0.25f);
+	CLEVER_CHECK(table.get(wood, stone).blend == 0.75f);
+	CLEVER_CHECK(table.get(wood, skin).reaction == Material::Reaction::Transform && table.get(wood, skin).result == wood);
+
+	library.close();
+	removeCache("symmetric.json");
+}
+
+CLEVER_TEST(InteractionTableKeepsSelfInteractions)
+{
+	MaterialCache::MaterialLibrary library;
+	Material::InteractionTable table;
+	buildTable("self.json", library, table);
+
+	Material::MaterialId water = library.find("water");
+	CLEVER_CHECK(table.get(water, water).reaction == Material::Reaction::Blend);
+	CLEVER_CHECK(table.get(water, water).blend == 0.3f);
+
+	//Without a rule of its own a material meeting itself does nothing
+	Material::MaterialId stone = library.find("stone");
+	CLEVER_CHECK(table.get(stone, stone).reaction == Material::Reaction::None);
+
+	library.close();
+	removeCache("self.json");
+}
+
+CLEVER_TEST(InteractionTableSharesOutcomes)
+{
+	MaterialCache::MaterialLibrary library;
+	Material::InteractionTable table;
+	buildTable("shared.json", library, table);
+
+	//None, blend 0.25 and 0.75 (stone and wood, wood and water), the transform and water's own blend
+	CLEVER_CHECK(table.getInteractionCount() == 5);
+
+	Material::MaterialId stone = library.find("stone");
+	Material::MaterialId skin = library.find("skin");
+	Material::MaterialId water = library.find("water");
+	CLEVER_CHECK(table.get(stone, skin).reaction == Material::Reaction::None);
+	CLEVER_CHECK(table.get(skin, water).reaction == Material::Reaction::None);
+
+	library.close();
+	removeCache("shared.json");
+}
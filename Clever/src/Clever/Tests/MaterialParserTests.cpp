@@ -0,0 +1,116 @@
+#include "Tests.h"
+#include "Clever/Material/MaterialParser.h"
+#include "Clever/Material/MaterialCache.h"
+
+#include <filesystem>
+#include <stdexcept>
+
+//! The error of text that has to fail, empty if it parsed
+static std::string getError(const std::string& text)
+{
+	MaterialParser::Source source;
+	std::string error;
+	if (MaterialParser::parse(text.data(), text.size(), source, error, "test.json"))
+		return "";
+	return error;
+}
+
+static const char* STONE = "\"Stone\": { \"Name\": \"stone\", \"Color\": { \"r\": 100, \"g\": 60, \"b\": 170 } }";
+static const char* WOOD = "\"Wood\": { \"Name\": \"wood\", \"Color\": { \"r\": 63, \"g\": 48, \"b\": 29 } }";
+
+CLEVER_TEST(MaterialParserReadsMaterialsAndRules)
+{
+	std::string text = std::string("{\n") + STONE + ",\n" + WOOD + ",\n"
+		+ "\"Interactions\": [ { \"Materials\": [ \"stone\", \"wood\" ], \"Reaction\": \"Blend\", \"Blend\": 0.25 } ]\n}";
+
+	MaterialParser::Source source;
+	std::string error;
+	CLEVER_CHECK(MaterialParser::parse(text.data(), text.size(), source, error, "test.json"));
+	CLEVER_CHECK(error.empty());
+	CLEVER_CHECK(source.materials.size() == 2);
+	CLEVER_CHECK(source.materials[0].name == "stone" && source.materials[0].color.b == 170.0f);
+	CLEVER_CHECK(source.rules.size() == 1);
+	CLEVER_CHECK(source.rules[0].a == "stone" && source.rules[0].b == "wood");
+	CLEVER_CHECK(source.rules[0].reaction == Material::Reaction::Blend && source.rules[0].blend == 0.25f);
+}
+
+CLEVER_TEST(MaterialParserReportsTheLine)
+{
+	std::string first = std::string("{\n") + STONE + ",\n";
+
+	CLEVER_CHECK(getError(first + "\"Wood\": { \"Name\": \"wood\", \"Colour\": 1 }\n}") == "test.json:3: unknown field Colour");
+	CLEVER_CHECK(getError(first + "\"Wood\": { \"Name\": \"wood\", \"Name\": \"oak\" }\n}") == "test.json:3: field Name is given twice");
+	CLEVER_CHECK(getError(first + "\"Wood\": { \"Name\": \"wood\", \"Color\": { \"r\": 1, \"g\": 2, \"b\": 300 } }\n}") == "test.json:3: the Color of material Wood is outside 0 to 255");
+	CLEVER_CHECK(getError(first + "\"Wood\": { \"Name\": \"wood\", \"Color\": { \"r\": 1, \"g\": 2 } }\n}") == "test.json:3: the Color of material Wood needs r, g and b");
+	CLEVER_CHECK(getError(first + "\"Wood\": { \"Name\": \"wood\" }\n}") == "test.json:3: material Wood needs a Name and a Color");
+	CLEVER_CHECK(getError(first + "\"Wood\": 5\n}") == "test.json:3: material Wood has to be an object");
+	CLEVER_CHECK(getError(first + "\"Other\": { \"Name\": \"stone\", \"Color\": { \"r\": 1, \"g\": 2, \"b\": 3 } }\n}") == "test.json:3: material stone is defined twice");
+}
+
+CLEVER_TEST(MaterialParserReportsBadInteractions)
+{
+	std::string first = std::string("{\n") + STONE + ",\n" + WOOD + ",\n\"Interactions\": [\n";
+
+	CLEVER_CHECK(getError(first + "{ \"Materials\": [ \"stone\" ], \"Reaction\": \"None\" } ]\n}") == "test.json:5: an interaction has exactly two Materials");
+	CLEVER_CHECK(getError(first + "{ \"Materials\": [ \"stone\", \"wood\" ], \"Reaction\": \"Boom\" } ]\n}") == "test.json:5: unknown Reaction Boom, it has to be None, Blend or Transform");
+	CLEVER_CHECK(getError(first + "{ \"Materials\": [ \"stone\", \"wood\" ], \"Reaction\": \"Transform\" } ]\n}") == "test.json:5: an interaction that transforms needs a Result");
+	CLEVER_CHECK(getError(first + "{ \"Materials\": [ \"stone\", \"wood\" ], \"Reaction\": \"Blend\", \"Blend\": 2 } ]\n}") == "test.json:5: Blend is outside 0 to 1");
+	CLEVER_CHECK(getError(first + "{ \"Materials\": [ \"stone\", \"wood\" ] } ]\n}") == "test.json:5: an interaction needs Materials and a Reaction");
+
+	//The same pair either way around
+	std::string twice = first + "{ \"Materials\": [ \"stone\", \"wood\" ], \"Reaction\": \"None\" },\n"
+		+ "{ \"Materials\": [ \"wood\", \"stone\" ], \"Reaction\": \"None\" } ]\n}";
+	CLEVER_CHECK(getError(twice) == "test.json:6: the interaction of wood and stone is defined twice");
+}
+
+CLEVER_TEST(MaterialParserReportsSyntaxErrors)
+{
+	std::string error = getError(std::string("{\n") + STONE + ",\n\"Wood\": { \"Name\": \"wood\" \"Color\": 1 }\n}");
+	CLEVER_CHECK(error.rfind("test.json:3: ", 0) == 0);
+	CLEVER_CHECK(getError("").rfind("test.json:1: ", 0) == 0);
+	CLEVER_CHECK(getError("[ 1 ]") == "test.json:1: unexpected array");
+}
+
+CLEVER_TEST(MaterialParserMergesLaterFilesOverEarlierOnes)
+{
+	std::string base = Tests::writeTemporaryFile("base.json", std::string("{\n") + STONE + ",\n" + WOOD + ",\n"
+		+ "\"Interactions\": [ { \"Materials\": [ \"stone\", \"wood\" ], \"Reaction\": \"Blend\", \"Blend\": 0.25 } ]\n}");
+	std::string mod = Tests::writeTemporaryFile("mod.json", "{\n"
+		"\"Wood\": { \"Name\": \"wood\", \"Color\": { \"r\": 1, \"g\": 2, \"b\": 3 } },\n"
+		"\"Iron\": { \"Name\": \"iron\", \"Color\": { \"r\": 9, \"g\": 9, \"b\": 9 } },\n"
+		"\"Interactions\": [ { \"Materials\": [ \"wood\", \"stone\" ], \"Reaction\": \"None\" } ]\n}");
+	std::string cachePath = MaterialCache::getCachePath({ base, mod });
+	std::error_code error;
+	std::filesystem::remove(cachePath, error);
+
+	{
+		MaterialCache::MaterialLibrary library;
+		MaterialCache::load({ base, mod }, library);
+		CLEVER_CHECK(library.getCount() == 3);
+		//A replaced material keeps its id, a new one goes after the rest
+		CLEVER_CHECK(library.find("stone") == 0 && library.find("wood") == 1 && library.find("iron") == 2);
+		CLEVER_CHECK(library.getRecord(library.find("wood")).color.r == 1.0f);
+		//The mod's rule for the pair replaces the base one
+		CLEVER_CHECK(library.getRuleCount() == 1 && library.getRule(0).reaction == static_cast<uint32_t>(Material::Reaction::None));
+	}
+
+	//Every file that fails is reported with its own path
+	std::string bad = Tests::writeTemporaryFile("bad.json", "{\n\n\"Wood\": 5\n}");
+	std::string message;
+	try
+	{
+		MaterialCache::MaterialLibrary library;
+		MaterialCache::load({ base, bad }, library);
+	}
+	catch (const std::runtime_error& exception)
+	{
+		message = exception.what();
+	}
+	CLEVER_CHECK(message == bad + ":3: material Wood has to be an object");
+
+	std::filesystem::remove(cachePath, error);
+	std::filesystem::remove(MaterialCache::getCachePath({ base, bad }), error);
+	std::filesystem::remove(base, error);
+	std::filesystem::remove(mod, error);
+	std::filesystem::remove(bad, error);
+}
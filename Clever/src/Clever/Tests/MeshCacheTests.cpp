@@ -0,0 +1,140 @@
+#include "Tests.h"
+#include "Clever/WorldManager/Object/MeshCache.h"
+#include "OS-Dependant/Platform/CookedFile.h"
+
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+//! A unit cube, 8 corners and 12 triangles, without a cache left over from an earlier run
+static std::string writeCube(const std::string& name)
+{
+	std::string path = Tests::getTemporaryPath(name);
+	std::error_code error;
+	std::filesystem::remove(MeshCache::getCachePath(path), error);
+
+	std::ofstream file(path, std::ios::trunc);
+	file << "v -1 -1 -1\nv 1 -1 -1\nv 1 1 -1\nv -1 1 -1\nv -1 -1 1\nv 1 -1 1\nv 1 1 1\nv -1 1 1\n";
+	file << "f 1 3 2\nf 1 4 3\nf 5 6 7\nf 5 7 8\nf 1 2 6\nf 1 6 5\nf 2 3 7\nf 2 7 6\nf 3 4 8\nf 3 8 7\nf 4 1 5\nf 4 5 8\n";
+	return path;
+}
+
+static void removeFiles(const std::string& sourcePath)
+{
+	std::error_code error;
+	std::filesystem::remove(sourcePath, error);
+	std::filesystem::remove(MeshCache::getCachePath(sourcePath), error);
+}
+
+static uint32_t getIndex(const MeshCache::CookedMesh& mesh, uint32_t index)
+{
+	if (mesh.getHeader().indexType == VK_INDEX_TYPE_UINT16)
+		return static_cast<const uint16_t*>(mesh.getIndices())[index];
+	return static_cast<const uint32_t*>(mesh.getIndices())[index];
+}
+
+CLEVER_TEST(MeshCacheRoundTrips)
+{
+	std::string sourcePath = writeCube("round_trip.obj");
+
+	{
+		MeshCache::CookedMesh mesh;
+		MeshCache::load(sourcePath, mesh);
+		const MeshCacheHeader& header = mesh.getHeader();
+		CLEVER_CHECK(header.version == MeshCache::VERSION);
+		CLEVER_CHECK(header.vertexCount > 0 && header.vertexCount <= 36);
+		CLEVER_CHECK(header.lodCount >= 1);
+		CLEVER_CHECK(mesh.getLod(0).firstIndex == 0 && mesh.getLod(0).indexCount == 36);
+		CLEVER_CHECK(header.sourceHash == CookedFile::hashFile(sourcePath));
+
+		bool inRange = true;
+		for (uint32_t i = 0; i < header.indexCount; i++)
+			inRange = inRange && getIndex(mesh, i) < header.vertexCount;
+		CLEVER_CHECK(inRange);
+	}
+
+	CLEVER_CHECK(MeshCache::isUpToDate(sourcePath, MeshCache::getCachePath(sourcePath)));
+
+	//Opened again straight from the file, it matches what was cooked
+	MeshCache::CookedMesh reopened;
+	CLEVER_CHECK(reopened.open(MeshCache::getCachePath(sourcePath)));
+	reopened.close();
+
+	removeFiles(sourcePath);
+}
+
+CLEVER_TEST(MeshCacheRejectsDamagedFiles)
+{
+	std::string sourcePath = writeCube("damaged.obj");
+	std::string cachePath = MeshCache::getCachePath(sourcePath);
+	{
+		MeshCache::CookedMesh mesh;
+		MeshCache::load(sourcePath, mesh);
+	}
+
+	MeshCacheHeader header;
+	{
+		std::ifstream file(cachePath, std::ios::binary);
+		file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	}
+	uintmax_t size = std::filesystem::file_size(cachePath);
+
+	//A header whose sections run past the end of the file
+	std::filesystem::resize_file(cachePath, size - 1);
+	MeshCache::CookedMesh mesh;
+	CLEVER_CHECK(!mesh.open(cachePath));
+	CLEVER_CHECK(!MeshCache::isUpToDate(sourcePath, cachePath));
+
+	//Another version
+	{
+		MeshCacheHeader stale = header;
+		stale.version = MeshCache::VERSION + 1;
+		std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&stale), sizeof(stale));
+	}
+	CLEVER_CHECK(!mesh.open(cachePath));
+
+	//A short file
+	{
+		std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+		file.write("CMSH", 4);
+	}
+	CLEVER_CHECK(!mesh.open(cachePath));
+
+	//load cooks it again
+	MeshCache::load(sourcePath, mesh);
+	CLEVER_CHECK(mesh.getHeader().vertexCount == header.vertexCount);
+	mesh.close();
+
+	removeFiles(sourcePath);
+}
+
+CLEVER_TEST(MeshCacheKeepsATouchedSource)
+{
+	std::string sourcePath = writeCube("touched.obj");
+	std::string cachePath = MeshCache::getCachePath(sourcePath);
+	{
+		MeshCache::CookedMesh mesh;
+		MeshCache::load(sourcePath, mesh);
+	}
+
+	//Same content with a new time, the cache is kept and takes the new time
+	auto time = std::filesystem::last_write_time(sourcePath) + std::chrono::hours(1);
+	std::filesystem::last_write_time(sourcePath, time);
+	CLEVER_CHECK(MeshCache::isUpToDate(sourcePath, cachePath));
+	{
+		MeshCache::CookedMesh mesh;
+		CLEVER_CHECK(mesh.open(cachePath));
+		CLEVER_CHECK(mesh.getHeader().sourceTime == static_cast<int64_t>(time.time_since_epoch().count()));
+	}
+
+	//Different content, it has to be cooked again
+	{
+		std::ofstream file(sourcePath, std::ios::app);
+		file << "v 2 2 2\n";
+	}
+	std::filesystem::last_write_time(sourcePath, time + std::chrono::hours(1));
+	CLEVER_CHECK(!MeshCache::isUpToDate(sourcePath, cachePath));
+
+	removeFiles(sourcePath);
+}
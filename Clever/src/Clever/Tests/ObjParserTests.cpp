@@ -0,0 +1,159 @@
+#include "Tests.h"
+#include "Clever/WorldManager/Object/ObjParser.h"
+
+#include <filesystem>
+
+//! The error of text that has to fail, empty if it parsed
+static std::string getError(const std::string& text, size_t chunkCount = 1)
+{
+	ObjParser::Mesh mesh;
+	std::string error;
+	if (ObjParser::parse(text.data(), text.size(), mesh, error, "test.obj", chunkCount))
+		return "";
+	return error;
+}
+
+static bool isCorner(const ObjParser::Corner& corner, uint32_t position, uint32_t normal)
+{
+	return corner.position == position && corner.normal == normal;
+}
+
+static bool isSame(const ObjParser::Mesh& a, const ObjParser::Mesh& b)
+{
+	if (a.positions != b.positions || a.normals != b.normals || a.corners.size() != b.corners.size())
+		return false;
+	for (size_t i = 0; i < a.corners.size(); i++)
+	{
+		if (!isCorner(a.corners[i], b.corners[i].position, b.corners[i].normal))
+			return false;
+	}
+	return true;
+}
+
+CLEVER_TEST(ObjParserReadsEveryCornerForm)
+{
+	std::string text =
+		"# a comment\n"
+		"o Quad\n"
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"vt 0 0\nvt 1 1\n"
+		"vn 0 0 1\nvn 0 0 -1\n"
+		"s off\n"
+		"f 1 2 3\n"
+		"f 1/1 2/2 3/1\n"
+		"f 1//2 2//2 3//1\n"
+		"f 1/1/1 2/2/2 3/1/1 # the rest is a comment\r\n";
+
+	ObjParser::Mesh mesh;
+	std::string error;
+	CLEVER_CHECK(ObjParser::parse(text.data(), text.size(), mesh, error));
+	CLEVER_CHECK(mesh.positions.size() == 4 && mesh.positions[2] == glm::vec3(1.0f, 1.0f, 0.0f));
+	CLEVER_CHECK(mesh.normals.size() == 2 && mesh.normals[1] == glm::vec3(0.0f, 0.0f, -1.0f));
+	CLEVER_CHECK(mesh.corners.size() == 12);
+
+	//v and v/vt have no normal, v//vn and v/vt/vn do
+	CLEVER_CHECK(isCorner(mesh.corners[0], 0, ObjParser::NO_NORMAL) && isCorner(mesh.corners[2], 2, ObjParser::NO_NORMAL));
+	CLEVER_CHECK(isCorner(mesh.corners[3], 0, ObjParser::NO_NORMAL) && isCorner(mesh.corners[4], 1, ObjParser::NO_NORMAL));
+	CLEVER_CHECK(isCorner(mesh.corners[6], 0, 1) && isCorner(mesh.corners[8], 2, 0));
+	CLEVER_CHECK(isCorner(mesh.corners[9], 0, 0) && isCorner(mesh.corners[10], 1, 1));
+}
+
+CLEVER_TEST(ObjParserFansPolygons)
+{
+	std::string text = "v 0 0 0\nv 1 0 0\nv 2 1 0\nv 1 2 0\nv 0 1 0\nf 1 2 3 4 5\nf 1 2 3 4";
+
+	ObjParser::Mesh mesh;
+	std::string error;
+	CLEVER_CHECK(ObjParser::parse(text.data(), text.size(), mesh, error));
+	CLEVER_CHECK(mesh.corners.size() == (3 + 2) * 3);
+
+	//Every triangle starts at the polygon's first corner
+	const uint32_t expected[] = { 0, 1, 2, 0, 2, 3, 0, 3, 4, 0, 1, 2, 0, 2, 3 };
+	bool fanned = mesh.corners.size() == 15;
+	for (size_t i = 0; i < mesh.corners.size() && fanned; i++)
+		fanned = mesh.corners[i].position == expected[i];
+	CLEVER_CHECK(fanned);
+}
+
+CLEVER_TEST(ObjParserResolvesRelativeIndices)
+{
+	//Negative indices count back from what is declared before the face, not from the end of the file
+	std::string text =
+		"v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\n"
+		"f -3//-1 -2//-1 -1//-1\n"
+		"v 5 5 5\nvn 1 0 0\n"
+		"f -4 -1 1/1/-2\n";
+
+	ObjParser::Mesh mesh;
+	std::string error;
+	CLEVER_CHECK(ObjParser::parse(text.data(), text.size(), mesh, error));
+	CLEVER_CHECK(mesh.corners.size() == 6);
+	CLEVER_CHECK(isCorner(mesh.corners[0], 0, 0) && isCorner(mesh.corners[1], 1, 0) && isCorner(mesh.corners[2], 2, 0));
+	CLEVER_CHECK(isCorner(mesh.corners[3], 0, ObjParser::NO_NORMAL) && isCorner(mesh.corners[4], 3, ObjParser::NO_NORMAL));
+	CLEVER_CHECK(isCorner(mesh.corners[5], 0, 0));
+
+	//A relative index past the first element declared so far
+	CLEVER_CHECK(getError("v 0 0 0\nv 1 0 0\nf -1 -2 -3\nv 0 1 0\n") == "test.obj:3: malformed or out of range face index");
+}
+
+CLEVER_TEST(ObjParserSplitsAcrossChunks)
+{
+	//Faces and relative indices on both sides of every boundary, the chunks end up mid file wherever the cuts land
+	std::string text;
+	for (int i = 0; i < 200; i++)
+	{
+		text += "v " + std::to_string(i) + " 0 0\nv " + std::to_string(i) + " 1 0\nv " + std::to_string(i) + " 0 1\n";
+		text += "vn 0 0 " + std::to_string(i) + "\n";
+		text += i % 2 == 0 ? "f -3//-1 -2//-1 -1//-1\n" : "f " + std::to_string(i * 3 + 1) + " " + std::to_string(i * 3 + 2) + " -1 -3\n";
+	}
+
+	ObjParser::Mesh whole;
+	std::string error;
+	CLEVER_CHECK(ObjParser::parse(text.data(), text.size(), whole, error, "test.obj", 1));
+	CLEVER_CHECK(whole.positions.size() == 600 && whole.normals.size() == 200);
+	CLEVER_CHECK(whole.corners.size() == (100 + 100 * 2) * 3);
+
+	bool same = true;
+	for (size_t chunkCount : { 2, 3, 7, 64, 1000 })
+	{
+		ObjParser::Mesh split;
+		same = same && ObjParser::parse(text.data(), text.size(), split, error, "test.obj", chunkCount) && isSame(whole, split);
+
+		//Without the last newline the last chunk ends on the file
+		same = same && ObjParser::parse(text.data(), text.size() - 1, split, error, "test.obj", chunkCount) && isSame(whole, split);
+	}
+	CLEVER_CHECK(same);
+
+	//Lines are counted from the start of the file whichever chunk fails
+	std::string broken = text + "v 1 2\n" + text;
+	CLEVER_CHECK(getError(broken, 1) == "test.obj:1001: malformed vertex position");
+	CLEVER_CHECK(getError(broken, 5) == "test.obj:1001: malformed vertex position");
+	CLEVER_CHECK(getError(broken, 100) == "test.obj:1001: malformed vertex position");
+}
+
+CLEVER_TEST(ObjParserReportsTheLine)
+{
+	std::string first = "v 0 0 0\nv 1 0 0\nv 0 1 0\n";
+
+	CLEVER_CHECK(getError(first + "v 1 x 0\n") == "test.obj:4: malformed vertex position");
+	CLEVER_CHECK(getError(first + "vn 0 0\n") == "test.obj:4: malformed vertex normal");
+	CLEVER_CHECK(getError(first + "f 1 2 4\n") == "test.obj:4: malformed or out of range face index");
+	CLEVER_CHECK(getError(first + "f 0 1 2\n") == "test.obj:4: malformed or out of range face index");
+	CLEVER_CHECK(getError(first + "f 1//1 2 3\n") == "test.obj:4: malformed or out of range face index");
+	CLEVER_CHECK(getError(first + "f 1 2a 3\n") == "test.obj:4: malformed or out of range face index");
+	CLEVER_CHECK(getError(first + "f 1 2\n") == "test.obj:4: face with fewer than three corners");
+	CLEVER_CHECK(getError(first + "f 1 2 3\nf 1 2 # 3") == "test.obj:5: face with fewer than three corners");
+
+	//Read from a file the error starts with its path
+	std::string path = Tests::writeTemporaryFile("broken.obj", first + "f 1 2\n");
+	ObjParser::Mesh mesh;
+	std::string error;
+	CLEVER_CHECK(!ObjParser::parse(path, mesh, error));
+	CLEVER_CHECK(error == path + ":4: face with fewer than three corners");
+	CLEVER_CHECK(mesh.corners.empty());
+
+	std::error_code removeError;
+	std::filesystem::remove(path, removeError);
+	CLEVER_CHECK(!ObjParser::parse(path, mesh, error));
+	CLEVER_CHECK(error == path + ": can't be opened");
+}
@@ -0,0 +1,57 @@
+#include "Tests.h"
+
+#include <iostream>
+#include <filesystem>
+#include <fstream>
+#include <exception>
+
+namespace Tests
+{
+	static uint32_t s_Failures = 0;//Of the test running
+
+	void check(bool passed, const char* condition, const char* file, int line)
+	{
+		if (passed)
+			return;
+		s_Failures++;
+		std::cout << "    " << file << ":" << line << ": " << condition << std::endl;
+	}
+
+	int runAll()
+	{
+		int failedTests = 0;
+		for (const Test& test : getTests())
+		{
+			s_Failures = 0;
+			std::cout << test.name << std::endl;
+			try
+			{
+				test.function();
+			}
+			catch (const std::exception& exception)
+			{
+				s_Failures++;
+				std::cout << "    threw: " << exception.what() << std::endl;
+			}
+
+			if (s_Failures > 0)
+				failedTests++;
+		}
+
+		std::cout << getTests().size() - failedTests << " of " << getTests().size() << " tests passed" << std::endl;
+		return failedTests;
+	}
+
+	std::string getTemporaryPath(const std::string& name)
+	{
+		return (std::filesystem::temp_directory_path() / ("clever_test_" + name)).string();
+	}
+
+	std::string writeTemporaryFile(const std::string& name, const std::string& text)
+	{
+		std::string path = getTemporaryPath(name);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file << text;
+		return path;
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/*
+-------------Self Tests----------------
+
+Small checks of the parts that work without a window or device (allocators, caches, parsers), run with
+Clever --test before anything else is created. The exit code is the number of tests that failed.
+
+Usage:
+	CLEVER_TEST(Name)				Defines a test, registered when the program starts
+	{
+		CLEVER_CHECK(condition);	Records a failure with its file and line, the test keeps going
+	}
+
+A test that throws fails with the exception's message.
+*/
+namespace Tests
+{
+	struct Test
+	{
+		const char* name;
+		void (*function)();
+	};
+
+	//! Function local so tests registered from any translation unit find it constructed
+	inline std::vector<Test>& getTests()
+	{
+		static std::vector<Test> tests;
+		return tests;
+	}
+
+	struct Registrar
+	{
+		Registrar(const char* name, void (*function)())
+		{
+			getTests().push_back({ name, function });
+		}
+	};
+
+	void check(bool passed, const char* condition, const char* file, int line);
+
+	//! Runs every registered test, prints the failures and returns how many tests failed
+	int runAll();
+
+	//! A file under the system's temporary directory, removed by the test that made it
+	std::string getTemporaryPath(const std::string& name);
+	//! Writes text to getTemporaryPath(name) and returns the path
+	std::string writeTemporaryFile(const std::string& name, const std::string& text);
+}
+
+#define CLEVER_TEST(name) \
+	static void name(); \
+	static Tests::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CLEVER_CHECK(condition) Tests::check(static_cast<bool>(condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,131 @@
+#include "Tests.h"
+#include "OS-Dependant/Vulkan/TlsfAllocator.h"
+
+#include <stdexcept>
+
+//! Every range in order, touching the next one, and no two free ranges next to each other
+static bool isConsistent(TlsfAllocator& allocator)
+{
+	std::vector<TlsfAllocator::Range> ranges = allocator.getRanges();
+	uint64_t offset = 0;
+	uint64_t freeBytes = 0;
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		if (ranges[i].offset != offset || (i > 0 && ranges[i].free && ranges[i - 1].free))
+			return false;
+		offset += ranges[i].size;
+		if (ranges[i].free)
+			freeBytes += ranges[i].size;
+	}
+	return offset == allocator.getCapacity() && freeBytes == allocator.getFreeBytes();
+}
+
+CLEVER_TEST(TlsfAllocatorSplitsTheFront)
+{
+	TlsfAllocator allocator;
+	allocator.init(1024);
+
+	uint64_t offset;
+	uint32_t node = allocator.allocate(100, 1, offset);
+	CLEVER_CHECK(node != TlsfAllocator::INVALID);
+	CLEVER_CHECK(offset == 0);
+	CLEVER_CHECK(allocator.getSize(node) == 100);
+	CLEVER_CHECK(allocator.getFreeBytes() == 924);
+	CLEVER_CHECK(allocator.getFreeRangeCount() == 1);
+	CLEVER_CHECK(isConsistent(allocator));
+}
+
+CLEVER_TEST(TlsfAllocatorMergesBothNeighbours)
+{
+	TlsfAllocator allocator;
+	allocator.init(1024);
+
+	uint64_t a, b, c;
+	uint32_t first = allocator.allocate(256, 1, a);
+	uint32_t second = allocator.allocate(256, 1, b);
+	uint32_t third = allocator.allocate(256, 1, c);
+	CLEVER_CHECK(a == 0 && b == 256 && c == 512);
+
+	allocator.free(first);
+	allocator.free(third);
+	CLEVER_CHECK(allocator.getFreeRangeCount() == 2);//third merged with the tail, first stays apart
+	CLEVER_CHECK(isConsistent(allocator));
+
+	allocator.free(second);
+	CLEVER_CHECK(allocator.getFreeRangeCount() == 1);
+	CLEVER_CHECK(allocator.getAllocationCount() == 0);
+	CLEVER_CHECK(allocator.getLargestFreeRange() == 1024);
+	CLEVER_CHECK(isConsistent(allocator));
+}
+
+CLEVER_TEST(TlsfAllocatorAlignsAndKeepsThePadding)
+{
+	TlsfAllocator allocator;
+	allocator.init(1024);
+
+	uint64_t offset;
+	allocator.allocate(3, 1, offset);
+	uint32_t aligned = allocator.allocate(64, 64, offset);
+	CLEVER_CHECK(aligned != TlsfAllocator::INVALID);
+	CLEVER_CHECK(offset == 64);
+	CLEVER_CHECK(allocator.getFreeBytes() == 1024 - 3 - 64);
+	CLEVER_CHECK(isConsistent(allocator));
+
+	//The padding in front is handed out again, the smallest range a search for the size lands on
+	uint32_t padding = allocator.allocate(32, 1, offset);
+	CLEVER_CHECK(padding != TlsfAllocator::INVALID);
+	CLEVER_CHECK(offset == 3);
+}
+
+CLEVER_TEST(TlsfAllocatorFailsWhenNothingFits)
+{
+	TlsfAllocator allocator;
+	allocator.init(512);
+
+	uint64_t offset;
+	CLEVER_CHECK(allocator.allocate(512, 1, offset) != TlsfAllocator::INVALID);
+	CLEVER_CHECK(allocator.allocate(1, 1, offset) == TlsfAllocator::INVALID);
+	CLEVER_CHECK(allocator.getFreeBytes() == 0);
+}
+
+CLEVER_TEST(TlsfAllocatorGrowsIntoTheFreeTail)
+{
+	TlsfAllocator allocator;
+	allocator.init(256);
+
+	uint64_t offset;
+	allocator.allocate(128, 1, offset);
+	allocator.grow(1024);
+	CLEVER_CHECK(allocator.getCapacity() == 1024);
+	CLEVER_CHECK(allocator.getFreeRangeCount() == 1);
+	CLEVER_CHECK(allocator.getLargestFreeRange() == 1024 - 128);
+	CLEVER_CHECK(isConsistent(allocator));
+
+	//With the tail in use the new space is a range of its own
+	allocator.allocate(1024 - 128, 1, offset);
+	allocator.grow(2048);
+	CLEVER_CHECK(allocator.getFreeRangeCount() == 1);
+	CLEVER_CHECK(allocator.getLargestFreeRange() == 1024);
+	CLEVER_CHECK(isConsistent(allocator));
+}
+
+CLEVER_TEST(TlsfAllocatorRejectsADoubleFree)
+{
+	TlsfAllocator allocator;
+	allocator.init(256);
+
+	uint64_t offset;
+	uint32_t node = allocator.allocate(64, 1, offset);
+	allocator.free(node);
+
+	bool threw = false;
+	try
+	{
+		allocator.free(node);
+	}
+	catch (const std::runtime_error&)
+	{
+		threw = true;
+	}
+	CLEVER_CHECK(threw);
+}
@@ -4,7 +4,9 @@
 #include "Clever/WorldManager/Components/Component/Renderable.h"
 #include "OS-Dependant/ImGui/ImGuiManager.h"
 #include "Clever/Developer/DockManager.h"
+#include "Clever/Developer/Profiler.h"
 #include <memory>
+#include <string>
 
 namespace Window
 {
@@ -18,6 +20,16 @@ namespace Window
 			int max_frames_in_flight;
 			bool DeveloperMode;
 			bool RTXEnable;
+
+			//! Headless renders offscreen with no window, for CI and perf runs. DeveloperMode is ignored.
+			bool Headless = false;
+			int HeadlessFrameCount = 0;//shouldClose after this many frames, 0 runs forever
+			std::string CaptureDirectory;//Empty disables readback
+			std::string CaptureExtension = ".ppm";//.ppm or .png
+			int CaptureInterval = 0;//Capture every n frames, 0 only captures the last frame
+
+			//! Scales the scene resolution to hold a GPU frame time, the UI stays at native resolution
+			bool DynamicResolution = false;
 		};
 
 	public:
@@ -33,15 +45,21 @@ namespace Window
 			DevTools::endDock();
 		}
 
-		void WindowInit(WindowFlags flags = {})
+		void WindowInit(WindowFlags flags)
 		{
 			m_Flags = flags;
-			m_VulkanInstance.reset(new VulkanInstance(flags.width, flags.height, flags.max_frames_in_flight, flags.RTXEnable));
+			if (m_Flags.Headless)
+				m_Flags.DeveloperMode = false;//ImGui needs a window
+
+			m_VulkanInstance.reset(new VulkanInstance(flags.width, flags.height, flags.max_frames_in_flight, flags.RTXEnable, flags.Headless, flags.DynamicResolution));
 			m_VulkanInstance->m_Camera->init();
 			if (m_Flags.DeveloperMode)
 			{
 				m_ImGuiManager = ImGuiManager();
 				m_ImGuiManager.bind(m_VulkanInstance, m_CurrentFrame);
+#ifdef CLEVER_PROFILE
+				Profiler::init();
+#endif
 			}
 			
 			DevTools::addDockFunction(testWindow, {this});
@@ -49,28 +67,32 @@ namespace Window
 
 		void render(Renderable* renderableStart, uint32_t count, float deltaTime)
 		{	
-			uint32_t imageIndex = -1;
-			VkCommandBuffer ImGuiCommandBuffer = VK_NULL_HANDLE;
+			CLEVER_PROFILE_FUNCTION();
+			ImDrawData* uiDrawData = nullptr;
+			m_VulkanInstance->beginFrame(m_CurrentFrame);
+
+			if (m_Flags.Headless && shouldCapture())
+			{
+				m_VulkanInstance->captureFrame(m_Flags.CaptureDirectory + "/frame_" + std::to_string(m_FrameNumber) + m_Flags.CaptureExtension);
+			}
+
 			if (m_Flags.DeveloperMode)
 			{
 				m_ImGuiManager.newFrame();
 
-				DevTools::BuildCustomUI();
+				{
+					CLEVER_PROFILE_SCOPE("DevTools::BuildCustomUI");
+					DevTools::BuildCustomUI();
+				}
 
-				imageIndex = m_ImGuiManager.render(m_VulkanInstance, m_CurrentFrame);
-				if (imageIndex != -1)
-					ImGuiCommandBuffer = m_ImGuiManager.getCommandBuffer(m_CurrentFrame);
-				else
-					m_ImGuiManager.endFrame();
-			}
-			bool recreate = m_VulkanInstance->render(deltaTime, renderableStart, ImGuiCommandBuffer, count, m_CurrentFrame, imageIndex);
-			if (recreate)
-			{
-				m_ImGuiManager.recreateFrameBuffer(m_VulkanInstance);
+				uiDrawData = m_ImGuiManager.render();
 			}
 
+			//The UI is recorded into the same command buffer as the scene, in the late pass' UI subpass
+			m_VulkanInstance->render(deltaTime, renderableStart, uiDrawData, count, m_CurrentFrame);
 
 			m_CurrentFrame = (m_CurrentFrame + 1) % m_VulkanInstance->m_max_frames_in_flight;
+			m_FrameNumber++;
 		}
 
 		void cleanup(Renderable* renderableStart, uint32_t count)
@@ -99,6 +121,8 @@ namespace Window
 
 		bool shouldClose()
 		{
+			if (m_Flags.Headless)
+				return m_Flags.HeadlessFrameCount > 0 && m_FrameNumber >= static_cast<uint64_t>(m_Flags.HeadlessFrameCount);
 			return m_VulkanInstance->shouldClose();
 		}
 
@@ -117,11 +141,22 @@ namespace Window
 			return *m_VulkanInstance->m_Camera;
 		}
 
+	private:
+		bool shouldCapture()
+		{
+			if (m_Flags.CaptureDirectory.empty())
+				return false;
+			if (m_Flags.CaptureInterval > 0 && m_FrameNumber % m_Flags.CaptureInterval == 0)
+				return true;
+			return m_Flags.HeadlessFrameCount > 0 && m_FrameNumber + 1 == static_cast<uint64_t>(m_Flags.HeadlessFrameCount);
+		}
+
 	private:
 		std::shared_ptr<VulkanInstance> m_VulkanInstance;
 		ImGuiManager m_ImGuiManager;
 		WindowFlags m_Flags;
 
 		uint32_t m_CurrentFrame = 0;
+		uint64_t m_FrameNumber = 0;
 	};
 }
\ No newline at end of file
@@ -1,36 +1,68 @@
 #pragma once
 #include "Component.h"
 #include "OS-Dependant/Vulkan/PipelineInfo.h"
+#include "OS-Dependant/Vulkan/ResourceCache.h"
 #include "Clever/WorldManager/MeshData.h"
+#include "Clever/Assets/AssetHandle.h"
 
 struct Renderable : Component
 {
-	MeshData meshData;// This contains the Vertex and Index Information
-	PipelineInfo pipelineInfo;// Graphics pipeline, pipelinelayout, descriptor set, push constant OBject and its list pf data called Instances, 
+	MeshData meshData;// This contains the Vertex and Index Information, a copy of what mesh refers to
+	PipelineInfo pipelineInfo;// Graphics pipeline and its list of data called Instances, descriptors are shared through the DescriptorManager
+	VertexFormat format = VertexFormat::Float;// How the mesh is stored on the GPU, the pipeline is built for it
+	AssetHandle<MeshData> meshAsset;// When valid the AssetManager swaps the loaded mesh in once it is resident
+
+	//Shared with every renderable made of the same content, released when the last copy is gone
+	std::shared_ptr<ResourceCache> resources;
+	ResourceRef<MeshData> mesh;
+	ResourceRef<VkPipeline> pipeline;
 
 	Renderable()
 	{
 
 	}
 
-	Renderable(VkDevice device, VkPhysicalDevice physicalDevice, VkRenderPass renderPass, VkCommandPool commandPool, VkQueue graphicsQueue, std::vector<VkBuffer>& uniformBuffer, int maxFramesInFlight, bool ray = false)
+	//! features picks the shader variant, optional ones draw with the generic variant until they are built
+	Renderable(std::shared_ptr<ResourceCache> resources, VkRenderPass renderPass, VkPipelineLayout pipelineLayout, ShaderFeatures features = {}, VertexFormat format = VertexFormat::Float)
+		: format(format), resources(resources)
 	{
-		meshData = MeshData(device, physicalDevice, commandPool, graphicsQueue);
-		pipelineInfo = PipelineInfo(device, renderPass, uniformBuffer, maxFramesInFlight, ray);
+		pipeline = resources->acquirePipeline(renderPass, pipelineLayout, features, format);
+		pipelineInfo = PipelineInfo(pipeline.get());
 		pipelineInfo.setInstanceCount(1);
 	}
 
-	void setComponentData(std::vector<Vertex> vertices, std::vector<uint16_t> indices)
+	//! The previous mesh is released, calling this again doesn't leak it
+	void setComponentData(const std::vector<Vertex>& vertices, const MeshIndices& indices)
+	{
+		setMesh(resources->acquireMesh(vertices, indices, format));
+	}
+	void setComponentData(const std::pair<std::vector<Vertex>, MeshIndices>& data)
+	{
+		setComponentData(data.first, data.second);
+	}
+	void setComponentData(const MeshCache::CookedMesh& cooked)
+	{
+		setMesh(resources->acquireMesh(cooked, format));
+	}
+	//! current is what the handle resolves to right now, usually the placeholder
+	void setComponentData(AssetHandle<MeshData> asset, ResourceRef<MeshData> current)
 	{
-		meshData.createVertexBuffer(vertices);
-		meshData.createIndexBuffer(indices);
+		meshAsset = asset;
+		setMesh(std::move(current));
 	}
-	void setComponentData(std::pair<std::vector<Vertex>, std::vector<uint16_t>> data)
+
+	void setMesh(ResourceRef<MeshData> newMesh)
 	{
-		meshData.createVertexBuffer(data.first);
-		meshData.createIndexBuffer(data.second);
+		mesh = std::move(newMesh);
+		meshData = mesh.isValid() ? mesh.get() : MeshData();
 	}
 	
+	//! Through the cache, a pipeline rebuilt by a shader reload is picked up without touching the renderable
+	VkPipeline getPipeline()
+	{
+		return pipeline.isValid() ? pipeline.get() : pipelineInfo.graphicsPipeline;
+	}
+
 	void setInstanceCount(int count)
 	{
 		pipelineInfo.setInstanceCount(count);
@@ -46,10 +78,19 @@ struct Renderable : Component
 		pipelineInfo.setPosition(pos, instance);
 	}
 
+	//! material is an id from the MaterialManager, the instance draws with its vertex color until it has one
+	void setMaterial(Material::MaterialId material, int instance = 0)
+	{
+		pipelineInfo.setMaterial(material, instance);
+	}
+
+	//! The GPU side is freed by the ResourceCache once no other renderable uses it and the frames using it are done
 	void destory()
 	{
-		meshData.cleanup();
-		pipelineInfo.cleanup();
+		mesh.reset();
+		pipeline.reset();
+		meshData = MeshData();
+		meshAsset = {};
 	}
 
 	virtual std::string toString() override
@@ -23,8 +23,7 @@ public:
 
 	void addComponent() override
 	{
-		T* comp = new T{};
-		m_Components.push_back(*comp);
+		m_Components.push_back(T{});
 	}
 
 	void setComponent(int index, void* component) override
@@ -2,20 +2,26 @@
 
 #include "Clever/WorldManager/Vertex.h"
 #include <vulkan/vulkan.h>
+#include "OS-Dependant/Vulkan/GeometryBuffer.h"
+#include "Clever/WorldManager/MeshIndices.h"
+#include "Clever/WorldManager/VertexFormats.h"
+#include "Clever/WorldManager/Object/MeshCache.h"
+#include "Clever/Developer/Profiler.h"
+#include <algorithm>
 
 class MeshData
 {
 public:
 	MeshData() = default;
 
-	MeshData(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue graphicsQueue)
-		: m_Device(device), m_PhysicalDevice(physicalDevice), m_CommandPool(commandPool), m_GraphicsQueue(graphicsQueue)
+	MeshData(VkDevice device, VkPhysicalDevice physicalDevice, GeometryBuffer* geometry)
+		: m_Device(device), m_PhysicalDevice(physicalDevice), m_Geometry(geometry)
 	{
 
 	}
 	~MeshData()
 	{
-		
+
 	}
 
 	int getIndexCount()
@@ -23,156 +29,112 @@ public:
 		return indicesSize;
 	}
 
-public:
-	void createVertexBuffer(std::vector<Vertex> vertices)
+	//! xyz = center, w = radius, in model space. Used for culling
+	glm::vec4 getBoundingSphere()
 	{
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size();
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-		void* data;
-		vkMapMemory(m_Device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, vertices.data(), (size_t)bufferSize);
-		vkUnmapMemory(m_Device, stagingBufferMemory);
-
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, m_VertexBufferMemory);
-
-		copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-		vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-		vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+		return m_BoundingSphere;
 	}
 
-	void createIndexBuffer(std::vector<uint16_t> indices)
+	//! Where the mesh is in the geometry buffer right now, compaction may move it between frames
+	GeometryBuffer::MeshRange getRange()
 	{
-		indicesSize = indices.size();
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size();
-
-		VkBuffer stagingBuffer;
-		VkDeviceMemory stagingBufferMemory;
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-		void* data;
-		vkMapMemory(m_Device, stagingBufferMemory, 0, bufferSize, 0, &data);
-		memcpy(data, indices.data(), (size_t)bufferSize);
-		vkUnmapMemory(m_Device, stagingBufferMemory);
-
-		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, m_IndexBufferMemory);
-
-		copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+		return m_Geometry->getRange(m_Mesh);
+	}
 
-		vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-		vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+	//! The ranges are streamed in by the TransferManager, nothing may be drawn with them before this is true
+	bool isResident()
+	{
+		return m_Mesh != GeometryBuffer::INVALID_MESH && m_Geometry->isResident(m_Mesh);
 	}
 
-	void cleanup()
+	//! Identity for Float meshes, the bounds the positions were quantized against otherwise
+	VertexFormats::Dequantization getDequantization()
 	{
+		return m_Dequantization;
+	}
 
-			vkDestroyBuffer(m_Device, vertexBuffer, nullptr);
-			vkFreeMemory(m_Device, m_VertexBufferMemory, nullptr);
-			vkDestroyBuffer(m_Device, indexBuffer, nullptr);
-			vkFreeMemory(m_Device, m_IndexBufferMemory, nullptr);
+	VertexFormat getFormat()
+	{
+		return m_Format;
 	}
 
-private:
-	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+public:
+	void create(const std::vector<Vertex>& vertices, const MeshIndices& indices, VertexFormat format = VertexFormat::Float)
 	{
-		VkPhysicalDeviceMemoryProperties memProperties;
-		vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memProperties);
+		CLEVER_PROFILE_FUNCTION();
+		calculateBoundingSphere(vertices);
+		indicesSize = indices.count();
+		m_Format = format;
 
-		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
-		{
-			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-				return i;
-			}
-		}
-		throw std::runtime_error("failed to find suitable memory type!");
+		std::vector<uint8_t> encoded = VertexFormats::encode(vertices.data(), vertices.size(), format, m_Dequantization);
+		m_Mesh = m_Geometry->addMesh(encoded.data(), static_cast<uint32_t>(vertices.size()), format, indices);
 	}
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
-	{
-		VkBufferCreateInfo bufferInfo{};
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = size;
-		bufferInfo.usage = usage;
-		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		if (vkCreateBuffer(m_Device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create vertex buffer!");
-		}
 
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(m_Device, buffer, &memRequirements);
+	//! Uploads LOD 0 straight from the mapped file, Float meshes are never copied on the CPU
+	void create(const MeshCache::CookedMesh& mesh, VertexFormat format = VertexFormat::Float)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		const MeshCacheHeader& header = mesh.getHeader();
+		const MeshLod& lod = mesh.getLod(0);
+		VkIndexType indexType = static_cast<VkIndexType>(header.indexType);
+		const uint8_t* indices = static_cast<const uint8_t*>(mesh.getIndices()) + static_cast<size_t>(lod.firstIndex) * MeshIndices::indexSize(indexType);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		m_BoundingSphere = header.boundingSphere;
+		indicesSize = lod.indexCount;
+		m_Format = format;
 
-		if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
+		if (format == VertexFormat::Float)
 		{
-			throw std::runtime_error("failed to allocate vertex buffer memory!");
+			m_Dequantization = VertexFormats::Dequantization{};
+			m_Mesh = m_Geometry->addMesh(mesh.getVertices(), header.vertexCount, format, indices, lod.indexCount, indexType);
+			return;
 		}
 
-		vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
+		std::vector<uint8_t> encoded = VertexFormats::encode(mesh.getVertices(), header.vertexCount, format, m_Dequantization);
+		m_Mesh = m_Geometry->addMesh(encoded.data(), header.vertexCount, format, indices, lod.indexCount, indexType);
 	}
-	VkCommandBuffer beginSingleTimeCommands() {
-		VkCommandBufferAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		allocInfo.commandPool = m_CommandPool;
-		allocInfo.commandBufferCount = 1;
-
-		VkCommandBuffer commandBuffer;
-		vkAllocateCommandBuffers(m_Device, &allocInfo, &commandBuffer);
-
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-		vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-		return commandBuffer;
+	void cleanup()
+	{
+		m_Geometry->removeMesh(m_Mesh);
+		m_Mesh = GeometryBuffer::INVALID_MESH;
 	}
-	void endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-		vkEndCommandBuffer(commandBuffer);
-
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &commandBuffer;
-
-		vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-		vkQueueWaitIdle(m_GraphicsQueue);
 
-		vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
-	}
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+private:
+	void calculateBoundingSphere(const std::vector<Vertex>& vertices)
 	{
-		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+		if (vertices.empty())
+		{
+			m_BoundingSphere = glm::vec4(0.0f);
+			return;
+		}
 
-		VkBufferCopy copyRegion{};
-		copyRegion.srcOffset = 0;
-		copyRegion.dstOffset = 0;
-		copyRegion.size = size;
-		vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+		glm::vec3 min = vertices[0].pos;
+		glm::vec3 max = vertices[0].pos;
+		for (const Vertex& vertex : vertices)
+		{
+			min = glm::min(min, vertex.pos);
+			max = glm::max(max, vertex.pos);
+		}
 
-		endSingleTimeCommands(commandBuffer);
+		glm::vec3 center = (min + max) * 0.5f;
+		float radius = 0.0f;
+		for (const Vertex& vertex : vertices)
+		{
+			radius = std::max(radius, glm::distance(center, vertex.pos));
+		}
+		m_BoundingSphere = glm::vec4(center, radius);
 	}
-public:
 
-	VkBuffer vertexBuffer;
-	VkBuffer indexBuffer;
 private:
-	
-	VkDeviceMemory m_VertexBufferMemory;
-	VkDeviceMemory m_IndexBufferMemory;
+	GeometryBuffer::MeshHandle m_Mesh = GeometryBuffer::INVALID_MESH;
 
 	int indicesSize = 0;
+	glm::vec4 m_BoundingSphere = glm::vec4(0.0f);
+	VertexFormat m_Format = VertexFormat::Float;
+	VertexFormats::Dequantization m_Dequantization;
 
 	VkDevice m_Device;
 	VkPhysicalDevice m_PhysicalDevice;
-	VkQueue m_GraphicsQueue;
-	VkCommandPool m_CommandPool;
-};
\ No newline at end of file
+	GeometryBuffer* m_Geometry = nullptr;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+//! Index buffer of one mesh, the width is picked once at import. 16 bit unless a vertex can't be reached with it,
+//! which halves the index bandwidth of every mesh that fits.
+struct MeshIndices
+{
+	VkIndexType type = VK_INDEX_TYPE_UINT16;
+	std::vector<uint16_t> indices16;
+	std::vector<uint32_t> indices32;
+
+	MeshIndices() = default;
+
+	MeshIndices(std::vector<uint16_t> indices)
+		: type(VK_INDEX_TYPE_UINT16), indices16(std::move(indices))
+	{
+
+	}
+
+	MeshIndices(std::vector<uint32_t> indices)
+		: type(VK_INDEX_TYPE_UINT32), indices32(std::move(indices))
+	{
+
+	}
+
+	//! 16 bit when all vertexCount vertices can be indexed with it
+	static MeshIndices narrowest(const std::vector<uint32_t>& indices, size_t vertexCount)
+	{
+		if (vertexCount > UINT16_MAX + 1)
+			return MeshIndices(indices);
+		return MeshIndices(std::vector<uint16_t>(indices.begin(), indices.end()));
+	}
+
+	uint32_t count() const
+	{
+		return static_cast<uint32_t>(type == VK_INDEX_TYPE_UINT16 ? indices16.size() : indices32.size());
+	}
+
+	const void* data() const
+	{
+		return type == VK_INDEX_TYPE_UINT16 ? static_cast<const void*>(indices16.data()) : static_cast<const void*>(indices32.data());
+	}
+
+	static uint32_t indexSize(VkIndexType type)
+	{
+		return type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+	}
+};
@@ -0,0 +1,233 @@
+#include "MeshCache.h"
+#include "ObjectManager.h"
+#include "Clever/Developer/Profiler.h"
+#include "OS-Dependant/Platform/CookedFile.h"
+
+#include <cstring>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+#include <map>
+
+namespace MeshCache
+{
+	static_assert(sizeof(Vertex) == 24, "cooked vertices are written as they are in memory");
+	static_assert(sizeof(MeshCacheHeader) % CookedFile::SECTION_ALIGNMENT == 0, "the header has to keep the first section aligned");
+
+	static const char MAGIC[4] = { 'C', 'M', 'S', 'H' };
+
+	bool CookedMesh::open(const std::string& cachePath)
+	{
+		close();
+		if (!m_File.open(cachePath) || m_File.size() < sizeof(MeshCacheHeader))
+		{
+			m_File.close();
+			return false;
+		}
+
+		const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(m_File.data());
+		size_t size = m_File.size();
+		bool valid = std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 && header->version == VERSION
+			&& (header->indexType == VK_INDEX_TYPE_UINT16 || header->indexType == VK_INDEX_TYPE_UINT32) && header->lodCount > 0
+			&& CookedFile::sectionFits(header->vertexOffset, uint64_t(header->vertexCount) * sizeof(Vertex), size)
+			&& CookedFile::sectionFits(header->indexOffset, uint64_t(header->indexCount) * MeshIndices::indexSize(static_cast<VkIndexType>(header->indexType)), size)
+			&& CookedFile::sectionFits(header->lodOffset, uint64_t(header->lodCount) * sizeof(MeshLod), size)
+			&& CookedFile::sectionFits(header->meshletOffset, uint64_t(header->meshletCount) * sizeof(MeshOptimizer::Meshlet), size)
+			&& CookedFile::sectionFits(header->meshletVertexOffset, uint64_t(header->meshletVertexCount) * sizeof(uint32_t), size)
+			&& CookedFile::sectionFits(header->meshletTriangleOffset, header->meshletTriangleBytes, size);
+		if (!valid)
+		{
+			m_File.close();
+			return false;
+		}
+
+		m_Header = header;
+		for (uint32_t lod = 0; lod < header->lodCount; lod++)
+		{
+			const MeshLod& entry = getLod(lod);
+			if (entry.firstIndex > header->indexCount || entry.indexCount > header->indexCount - entry.firstIndex)
+			{
+				close();
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void CookedMesh::close()
+	{
+		m_File.close();
+		m_Header = nullptr;
+	}
+
+	const Vertex* CookedMesh::getVertices() const
+	{
+		return reinterpret_cast<const Vertex*>(m_File.data() + m_Header->vertexOffset);
+	}
+
+	const void* CookedMesh::getIndices() const
+	{
+		return m_File.data() + m_Header->indexOffset;
+	}
+
+	const MeshLod& CookedMesh::getLod(uint32_t lod) const
+	{
+		return reinterpret_cast<const MeshLod*>(m_File.data() + m_Header->lodOffset)[lod];
+	}
+
+	const MeshOptimizer::Meshlet* CookedMesh::getMeshlets() const
+	{
+		return reinterpret_cast<const MeshOptimizer::Meshlet*>(m_File.data() + m_Header->meshletOffset);
+	}
+
+	const uint32_t* CookedMesh::getMeshletVertices() const
+	{
+		return reinterpret_cast<const uint32_t*>(m_File.data() + m_Header->meshletVertexOffset);
+	}
+
+	const uint8_t* CookedMesh::getMeshletTriangles() const
+	{
+		return m_File.data() + m_Header->meshletTriangleOffset;
+	}
+
+	std::string getCachePath(const std::string& sourcePath)
+	{
+		return sourcePath + ".cmesh";
+	}
+
+	bool isUpToDate(const std::string& sourcePath, const std::string& cachePath)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		MeshCacheHeader header;
+		{
+			CookedMesh cached;
+			if (!cached.open(cachePath))
+				return false;
+			header = cached.getHeader();
+		}
+		return CookedFile::isCurrent(cachePath, offsetof(MeshCacheHeader, sourceTime), header.sourceTime, header.sourceHash, { sourcePath });
+	}
+
+	void cook(const std::string& sourcePath, const std::string& cachePath)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		std::pair<std::vector<Vertex>, MeshIndices> model = loadModel(sourcePath);
+		std::vector<Vertex>& vertices = model.first;
+		std::vector<uint32_t> fullIndices = model.second.type == VK_INDEX_TYPE_UINT16
+			? std::vector<uint32_t>(model.second.indices16.begin(), model.second.indices16.end()) : model.second.indices32;
+
+		MeshCacheHeader header{};
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		header.version = VERSION;
+		header.sourceHash = CookedFile::hashFile(sourcePath);
+		header.sourceTime = CookedFile::getFileTime(sourcePath);
+
+		//! Bounds
+		{
+			glm::vec3 min(0.0f);
+			glm::vec3 max(0.0f);
+			if (!vertices.empty())
+			{
+				min = vertices[0].pos;
+				max = vertices[0].pos;
+				for (const Vertex& vertex : vertices)
+				{
+					min = glm::min(min, vertex.pos);
+					max = glm::max(max, vertex.pos);
+				}
+			}
+			glm::vec3 center = (min + max) * 0.5f;
+			float radius = 0.0f;
+			for (const Vertex& vertex : vertices)
+				radius = std::max(radius, glm::distance(center, vertex.pos));
+
+			header.boundingSphere = glm::vec4(center, radius);
+			header.boundsMin = glm::vec4(min, 0.0f);
+			header.boundsMax = glm::vec4(max, 0.0f);
+		}
+
+		//! LODs, each clustered from the full mesh on a coarser grid until nothing is left of it
+		std::vector<MeshLod> lods;
+		std::vector<uint32_t> allIndices = fullIndices;
+		lods.push_back({ 0, static_cast<uint32_t>(fullIndices.size()), 0.0f, 0 });
+		{
+			glm::vec3 extent = glm::vec3(header.boundsMax - header.boundsMin);
+			float longest = std::max(std::max(extent.x, extent.y), extent.z);
+			uint32_t resolution = LOD_GRID_RESOLUTION;
+			while (lods.size() < MAX_LODS && resolution > 1)
+			{
+				std::vector<uint32_t> lod = MeshOptimizer::simplifyClustered(fullIndices, vertices, resolution);
+				if (lod.empty())
+					break;
+
+				//Too close to the previous LOD to be worth its memory, a coarser grid may still be
+				if (float(lod.size()) > float(lods.back().indexCount) * (1.0f - LOD_MIN_REDUCTION))
+				{
+					resolution /= 2;
+					continue;
+				}
+
+				std::vector<uint32_t> clusterStarts;
+				MeshOptimizer::optimizeVertexCache(lod, static_cast<uint32_t>(vertices.size()), clusterStarts);
+				lods.push_back({ static_cast<uint32_t>(allIndices.size()), static_cast<uint32_t>(lod.size()), longest / float(resolution), 0 });
+				allIndices.insert(allIndices.end(), lod.begin(), lod.end());
+				resolution /= 2;
+			}
+		}
+
+		std::vector<MeshOptimizer::Meshlet> meshlets;
+		std::vector<uint32_t> meshletVertices;
+		std::vector<uint8_t> meshletTriangles;
+		MeshOptimizer::buildMeshlets(fullIndices, vertices, meshlets, meshletVertices, meshletTriangles);
+
+		MeshIndices indices = MeshIndices::narrowest(allIndices, vertices.size());
+
+		header.vertexCount = static_cast<uint32_t>(vertices.size());
+		header.indexCount = indices.count();
+		header.indexType = indices.type;
+		header.lodCount = static_cast<uint32_t>(lods.size());
+		header.meshletCount = static_cast<uint32_t>(meshlets.size());
+		header.meshletVertexCount = static_cast<uint32_t>(meshletVertices.size());
+		header.meshletTriangleBytes = static_cast<uint32_t>(meshletTriangles.size());
+
+		CookedFile::Section sections[] =
+		{
+			{ &header.vertexOffset, vertices.data(), vertices.size() * sizeof(Vertex) },
+			{ &header.indexOffset, indices.data(), uint64_t(indices.count()) * MeshIndices::indexSize(indices.type) },
+			{ &header.lodOffset, lods.data(), lods.size() * sizeof(MeshLod) },
+			{ &header.meshletOffset, meshlets.data(), meshlets.size() * sizeof(MeshOptimizer::Meshlet) },
+			{ &header.meshletVertexOffset, meshletVertices.data(), meshletVertices.size() * sizeof(uint32_t) },
+			{ &header.meshletTriangleOffset, meshletTriangles.data(), meshletTriangles.size() }
+		};
+
+		if (CookedFile::write(cachePath, &header, sizeof(header), sections, std::size(sections)))
+			return;
+
+		//Still mapped by a load from before the lock was taken, what it holds is as good as what was just cooked
+		if (!isUpToDate(sourcePath, cachePath))
+			throw std::runtime_error("failed to write mesh cache!");
+	}
+
+	void load(const std::string& sourcePath, CookedMesh& mesh)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		std::string cachePath = getCachePath(sourcePath);
+
+		//Two formats of the same source load on different workers. The second waits and finds the cache the first
+		//cooked, renaming over a cache another worker has mapped fails on Windows
+		static std::mutex pathsMutex;
+		static std::map<std::string, std::mutex> pathMutexes;
+		std::mutex* pathMutex;
+		{
+			std::lock_guard<std::mutex> lock(pathsMutex);
+			pathMutex = &pathMutexes[cachePath];
+		}
+		std::lock_guard<std::mutex> lock(*pathMutex);
+
+		if (!isUpToDate(sourcePath, cachePath))
+			cook(sourcePath, cachePath);
+
+		if (!mesh.open(cachePath))
+			throw std::runtime_error("failed to open mesh cache!");
+	}
+}
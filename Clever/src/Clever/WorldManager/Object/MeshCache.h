@@ -0,0 +1,112 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "Clever/WorldManager/Vertex.h"
+#include "Clever/WorldManager/MeshIndices.h"
+#include "Clever/WorldManager/Object/MeshOptimizer.h"
+#include "OS-Dependant/Platform/MappedFile.h"
+
+/*
+-------------Mesh Cache----------------
+
+Cooked meshes are the output of loadModel written next to the source as <source>.cmesh, so later launches skip the
+OBJ parser and the optimizer. At runtime the file is mapped and its streams are handed to the GeometryBuffer as they
+are, nothing is parsed.
+
+Layout, every section starts on CookedFile::SECTION_ALIGNMENT:
+	MeshCacheHeader
+	Vertices:			 vertexCount Vertex structs, normalized and in vertex fetch order
+	Indices:			 indexCount indices of indexType, every LOD back to back
+	LODs:				 lodCount MeshLod, LOD 0 is the full mesh
+	Meshlets:			 meshletCount MeshOptimizer::Meshlet of LOD 0
+	Meshlet vertices:	 meshletVertexCount uint32_t
+	Meshlet triangles:	 meshletTriangleBytes uint8_t
+
+A cache is used when its version matches and the source is the one it was cooked from, see CookedFile.
+*/
+struct MeshCacheHeader
+{
+	char magic[4];//"CMSH"
+	uint32_t version;
+	uint64_t sourceHash;
+	int64_t sourceTime;
+
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexType;//VkIndexType
+	uint32_t lodCount;
+	uint32_t meshletCount;
+	uint32_t meshletVertexCount;
+	uint32_t meshletTriangleBytes;
+	uint32_t padding;
+
+	glm::vec4 boundingSphere;//xyz = center in model space, w = radius
+	glm::vec4 boundsMin;
+	glm::vec4 boundsMax;
+
+	//Byte offsets from the start of the file
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+	uint64_t lodOffset;
+	uint64_t meshletOffset;
+	uint64_t meshletVertexOffset;
+	uint64_t meshletTriangleOffset;
+	uint64_t reserved;
+};
+
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;//Cell size the LOD was clustered with, in model space
+	uint32_t padding;
+};
+
+namespace MeshCache
+{
+	static const uint32_t VERSION = 1;
+	static const uint32_t MAX_LODS = 4;
+	static const uint32_t LOD_GRID_RESOLUTION = 64;//Cells along the longest side for LOD 1, halved for every LOD after it
+	static const float LOD_MIN_REDUCTION = 0.25f;//A LOD has to drop at least this fraction of the previous one's triangles
+
+	//! A mapped .cmesh, the pointers stay valid while it is open
+	class CookedMesh
+	{
+	public:
+		//! Checks the magic, version and that every section is inside the file
+		bool open(const std::string& cachePath);
+		void close();
+
+		const MeshCacheHeader& getHeader() const
+		{
+			return *m_Header;
+		}
+
+		const Vertex* getVertices() const;
+		//! indexType indices, LOD i starts at getLod(i).firstIndex
+		const void* getIndices() const;
+		const MeshLod& getLod(uint32_t lod) const;
+		const MeshOptimizer::Meshlet* getMeshlets() const;
+		const uint32_t* getMeshletVertices() const;
+		const uint8_t* getMeshletTriangles() const;
+
+	private:
+		MappedFile m_File;
+		const MeshCacheHeader* m_Header = nullptr;
+	};
+
+	std::string getCachePath(const std::string& sourcePath);
+
+	//! Refreshes the stored time when only the source's time changed
+	bool isUpToDate(const std::string& sourcePath, const std::string& cachePath);
+
+	//! Runs loadModel on the source and writes the result, throws if the cache can't be written
+	void cook(const std::string& sourcePath, const std::string& cachePath);
+
+	//! Cooks the source first if its cache is missing or stale, throws if the result can't be opened. Safe to call for the same source from several threads
+	void load(const std::string& sourcePath, CookedMesh& mesh);
+}
@@ -0,0 +1,475 @@
+#include "MeshOptimizer.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+
+namespace MeshOptimizer
+{
+	static const uint32_t INVALID = UINT32_MAX;
+
+	//Bit exact, -0.0 is folded into 0.0 so the two compare equal like they do as floats
+	struct VertexKey
+	{
+		uint32_t bits[6];
+
+		VertexKey(const Vertex& vertex)
+		{
+			float values[6] = { vertex.pos.x, vertex.pos.y, vertex.pos.z, vertex.color.x, vertex.color.y, vertex.color.z };
+			for (int i = 0; i < 6; i++)
+			{
+				float value = values[i] + 0.0f;
+				std::memcpy(&bits[i], &value, sizeof(float));
+			}
+		}
+
+		bool operator==(const VertexKey& other) const
+		{
+			return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+		}
+	};
+
+	struct VertexKeyHash
+	{
+		size_t operator()(const VertexKey& key) const
+		{
+			//FNV-1a over the words
+			uint64_t hash = 14695981039346656037ull;
+			for (uint32_t word : key.bits)
+			{
+				hash ^= word;
+				hash *= 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	//! FIFO cache made of timestamps, a vertex is cached while fewer than cacheSize misses happened since it was loaded
+	struct CacheSimulator
+	{
+		std::vector<uint32_t> loadedAt;
+		uint32_t time;
+		uint32_t cacheSize;
+
+		CacheSimulator(uint32_t vertexCount, uint32_t size)
+			: loadedAt(vertexCount, 0), time(size + 1), cacheSize(size)
+		{
+
+		}
+
+		uint32_t triangle(const uint32_t* corners)
+		{
+			uint32_t misses = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				if (time - loadedAt[corners[i]] > cacheSize)
+				{
+					loadedAt[corners[i]] = time++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+
+		void reset()
+		{
+			time += cacheSize + 1;
+		}
+	};
+
+	void weldVertices(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique;
+		unique.reserve(corners.size() / 2);
+
+		vertices.clear();
+		indices.clear();
+		indices.reserve(corners.size());
+
+		for (const Vertex& corner : corners)
+		{
+			auto result = unique.emplace(VertexKey(corner), static_cast<uint32_t>(vertices.size()));
+			if (result.second)
+				vertices.push_back(corner);
+			indices.push_back(result.first->second);
+		}
+	}
+
+	void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>& clusterStarts)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		clusterStarts.clear();
+
+		//! Triangles around each vertex
+		std::vector<uint32_t> live(vertexCount, 0);
+		std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+		std::vector<uint32_t> adjacency(triangleCount * 3);
+		{
+			for (uint32_t i = 0; i < triangleCount * 3; i++)
+				live[indices[i]]++;
+			for (uint32_t v = 0; v < vertexCount; v++)
+				adjacencyStart[v + 1] = adjacencyStart[v] + live[v];
+
+			std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+			for (uint32_t i = 0; i < triangleCount * 3; i++)
+				adjacency[fill[indices[i]]++] = i / 3;
+		}
+
+		std::vector<uint32_t> cacheTime(vertexCount, 0);
+		std::vector<bool> emitted(triangleCount, false);
+		std::vector<uint32_t> deadEnd;
+		std::vector<uint32_t> candidates;
+		std::vector<uint32_t> result;
+		result.reserve(triangleCount * 3);
+
+		uint32_t timestamp = CACHE_SIZE + 1;
+		uint32_t cursor = 0;
+
+		//Most recently used vertex that still has triangles left, then the next one in input order
+		auto skipDeadEnd = [&]() -> uint32_t
+		{
+			while (!deadEnd.empty())
+			{
+				uint32_t vertex = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[vertex] > 0)
+					return vertex;
+			}
+			while (cursor < vertexCount)
+			{
+				if (live[cursor] > 0)
+					return cursor;
+				cursor++;
+			}
+			return INVALID;
+		};
+
+		uint32_t fanning = skipDeadEnd();
+		bool restarted = true;
+		while (fanning != INVALID)
+		{
+			if (restarted)
+				clusterStarts.push_back(static_cast<uint32_t>(result.size() / 3));
+
+			//! Emitting every triangle left around the fanning vertex
+			candidates.clear();
+			for (uint32_t i = adjacencyStart[fanning]; i < adjacencyStart[fanning + 1]; i++)
+			{
+				uint32_t triangle = adjacency[i];
+				if (emitted[triangle])
+					continue;
+
+				for (int corner = 0; corner < 3; corner++)
+				{
+					uint32_t vertex = indices[triangle * 3 + corner];
+					result.push_back(vertex);
+					deadEnd.push_back(vertex);
+					candidates.push_back(vertex);
+					live[vertex]--;
+					if (timestamp - cacheTime[vertex] > CACHE_SIZE)
+						cacheTime[vertex] = timestamp++;
+				}
+				emitted[triangle] = true;
+			}
+
+			//! Next fanning vertex, the oldest one that will still be in the cache after its triangles are emitted
+			uint32_t next = INVALID;
+			int bestPriority = -1;
+			for (uint32_t vertex : candidates)
+			{
+				if (live[vertex] == 0)
+					continue;
+
+				int priority = 0;
+				if (timestamp - cacheTime[vertex] + 2 * live[vertex] <= CACHE_SIZE)
+					priority = static_cast<int>(timestamp - cacheTime[vertex]);
+				if (priority > bestPriority)
+				{
+					bestPriority = priority;
+					next = vertex;
+				}
+			}
+
+			restarted = next == INVALID;
+			fanning = restarted ? skipDeadEnd() : next;
+		}
+
+		indices.swap(result);
+	}
+
+	void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& clusterStarts, float threshold)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount == 0 || clusterStarts.empty())
+			return;
+
+		//! Cutting the hard clusters further, wherever a piece on its own is within threshold of the cluster's ACMR
+		std::vector<uint32_t> clusters;
+		{
+			CacheSimulator cache(static_cast<uint32_t>(vertices.size()), CACHE_SIZE);
+			for (size_t c = 0; c < clusterStarts.size(); c++)
+			{
+				uint32_t start = clusterStarts[c];
+				uint32_t end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+
+				cache.reset();
+				uint32_t clusterMisses = 0;
+				for (uint32_t t = start; t < end; t++)
+					clusterMisses += cache.triangle(&indices[t * 3]);
+				float clusterACMR = float(clusterMisses) / float(end - start);
+
+				cache.reset();
+				clusters.push_back(start);
+				uint32_t pieceStart = start;
+				uint32_t pieceMisses = 0;
+				for (uint32_t t = start; t < end; t++)
+				{
+					pieceMisses += cache.triangle(&indices[t * 3]);
+					if (t + 1 < end && float(pieceMisses) <= threshold * clusterACMR * float(t + 1 - pieceStart))
+					{
+						clusters.push_back(t + 1);
+						pieceStart = t + 1;
+						pieceMisses = 0;
+						cache.reset();
+					}
+				}
+			}
+		}
+
+		//! Sorting by how far each cluster faces away from the mesh center, those occlude the rest
+		struct ClusterSort
+		{
+			uint32_t cluster;
+			float key;
+		};
+		std::vector<ClusterSort> order(clusters.size());
+		{
+			glm::vec3 meshCentroid(0.0f);
+			float meshArea = 0.0f;
+			std::vector<glm::vec3> centroids(clusters.size());
+			std::vector<glm::vec3> normals(clusters.size());
+
+			for (size_t c = 0; c < clusters.size(); c++)
+			{
+				uint32_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+				glm::vec3 centroid(0.0f);
+				glm::vec3 normal(0.0f);
+				float area = 0.0f;
+				for (uint32_t t = clusters[c]; t < end; t++)
+				{
+					const glm::vec3& a = vertices[indices[t * 3 + 0]].pos;
+					const glm::vec3& b = vertices[indices[t * 3 + 1]].pos;
+					const glm::vec3& d = vertices[indices[t * 3 + 2]].pos;
+
+					glm::vec3 cross = glm::cross(b - a, d - a);
+					float triangleArea = glm::length(cross);
+					centroid += (a + b + d) * (triangleArea / 3.0f);
+					normal += cross;
+					area += triangleArea;
+				}
+
+				meshCentroid += centroid;
+				meshArea += area;
+				centroids[c] = area > 0.0f ? centroid / area : vertices[indices[clusters[c] * 3]].pos;
+				normals[c] = glm::length(normal) > 0.0f ? glm::normalize(normal) : glm::vec3(0.0f);
+			}
+			if (meshArea > 0.0f)
+				meshCentroid /= meshArea;
+
+			for (size_t c = 0; c < clusters.size(); c++)
+				order[c] = { static_cast<uint32_t>(c), glm::dot(centroids[c] - meshCentroid, normals[c]) };
+		}
+		std::stable_sort(order.begin(), order.end(), [](const ClusterSort& a, const ClusterSort& b)
+			{
+				return a.key > b.key;
+			});
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (const ClusterSort& entry : order)
+		{
+			uint32_t start = clusters[entry.cluster];
+			uint32_t end = entry.cluster + 1 < clusters.size() ? clusters[entry.cluster + 1] : triangleCount;
+			result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+		}
+		indices.swap(result);
+	}
+
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		std::vector<uint32_t> remap(vertices.size(), INVALID);
+		std::vector<Vertex> result;
+		result.reserve(vertices.size());
+
+		for (uint32_t& index : indices)
+		{
+			if (remap[index] == INVALID)
+			{
+				remap[index] = static_cast<uint32_t>(result.size());
+				result.push_back(vertices[index]);
+			}
+			index = remap[index];
+		}
+		vertices.swap(result);
+	}
+
+	float computeACMR(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+	{
+		uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+		if (triangleCount == 0)
+			return 0.0f;
+
+		CacheSimulator cache(vertexCount, cacheSize);
+		uint32_t misses = 0;
+		for (uint32_t t = 0; t < triangleCount; t++)
+			misses += cache.triangle(&indices[t * 3]);
+		return float(misses) / float(triangleCount);
+	}
+
+	std::vector<uint32_t> simplifyClustered(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t gridResolution)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		if (vertices.empty() || gridResolution == 0)
+			return indices;
+
+		glm::vec3 min = vertices[0].pos;
+		glm::vec3 max = vertices[0].pos;
+		for (const Vertex& vertex : vertices)
+		{
+			min = glm::min(min, vertex.pos);
+			max = glm::max(max, vertex.pos);
+		}
+		glm::vec3 extent = max - min;
+		float cellSize = std::max(std::max(extent.x, extent.y), extent.z) / float(gridResolution);
+		if (cellSize <= 0.0f)
+			return indices;
+
+		//! Only vertices the index buffer uses get a cell, so their averages aren't pulled by unused ones
+		std::vector<uint32_t> cellOf(vertices.size(), INVALID);
+		std::unordered_map<uint64_t, uint32_t> cellIds;
+		std::vector<glm::vec3> cellSums;
+		std::vector<uint32_t> cellCounts;
+		for (uint32_t index : indices)
+		{
+			if (cellOf[index] != INVALID)
+				continue;
+
+			glm::vec3 cell = glm::min(glm::floor((vertices[index].pos - min) / cellSize), glm::vec3(float(gridResolution - 1)));
+			uint64_t key = uint64_t(cell.x) | (uint64_t(cell.y) << 21) | (uint64_t(cell.z) << 42);
+			auto inserted = cellIds.emplace(key, static_cast<uint32_t>(cellSums.size()));
+			if (inserted.second)
+			{
+				cellSums.push_back(glm::vec3(0.0f));
+				cellCounts.push_back(0);
+			}
+			cellOf[index] = inserted.first->second;
+			cellSums[cellOf[index]] += vertices[index].pos;
+			cellCounts[cellOf[index]]++;
+		}
+
+		std::vector<uint32_t> representative(cellSums.size(), INVALID);
+		std::vector<float> closest(cellSums.size(), 0.0f);
+		for (uint32_t vertex = 0; vertex < vertices.size(); vertex++)
+		{
+			uint32_t cell = cellOf[vertex];
+			if (cell == INVALID)
+				continue;
+
+			float distance = glm::distance(vertices[vertex].pos, cellSums[cell] / float(cellCounts[cell]));
+			if (representative[cell] == INVALID || distance < closest[cell])
+			{
+				representative[cell] = vertex;
+				closest[cell] = distance;
+			}
+		}
+
+		std::vector<uint32_t> result;
+		result.reserve(indices.size());
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			uint32_t a = representative[cellOf[indices[t + 0]]];
+			uint32_t b = representative[cellOf[indices[t + 1]]];
+			uint32_t c = representative[cellOf[indices[t + 2]]];
+			if (a == b || b == c || a == c)
+				continue;
+
+			result.push_back(a);
+			result.push_back(b);
+			result.push_back(c);
+		}
+		return result;
+	}
+
+	static glm::vec4 meshletSphere(const uint32_t* meshletVertices, uint32_t count, const std::vector<Vertex>& vertices)
+	{
+		glm::vec3 min = vertices[meshletVertices[0]].pos;
+		glm::vec3 max = min;
+		for (uint32_t i = 1; i < count; i++)
+		{
+			min = glm::min(min, vertices[meshletVertices[i]].pos);
+			max = glm::max(max, vertices[meshletVertices[i]].pos);
+		}
+
+		glm::vec3 center = (min + max) * 0.5f;
+		float radius = 0.0f;
+		for (uint32_t i = 0; i < count; i++)
+			radius = std::max(radius, glm::distance(center, vertices[meshletVertices[i]].pos));
+		return glm::vec4(center, radius);
+	}
+
+	void buildMeshlets(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, std::vector<Meshlet>& meshlets,
+		std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		meshlets.clear();
+		meshletVertices.clear();
+		meshletTriangles.clear();
+
+		//Position of each vertex in the meshlet being built, reset through meshletVertices when it is closed
+		std::vector<uint32_t> local(vertices.size(), INVALID);
+		Meshlet current{};
+
+		auto close = [&]()
+		{
+			if (current.triangleCount == 0)
+				return;
+
+			current.boundingSphere = meshletSphere(&meshletVertices[current.vertexOffset], current.vertexCount, vertices);
+			for (uint32_t i = 0; i < current.vertexCount; i++)
+				local[meshletVertices[current.vertexOffset + i]] = INVALID;
+
+			meshlets.push_back(current);
+			current = Meshlet{};
+			current.vertexOffset = static_cast<uint32_t>(meshletVertices.size());
+			current.triangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+		};
+
+		for (size_t t = 0; t + 2 < indices.size(); t += 3)
+		{
+			uint32_t newVertices = 0;
+			for (int corner = 0; corner < 3; corner++)
+				newVertices += local[indices[t + corner]] == INVALID ? 1 : 0;
+
+			if (current.vertexCount + newVertices > MESHLET_MAX_VERTICES || current.triangleCount + 1 > MESHLET_MAX_TRIANGLES)
+				close();
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				uint32_t vertex = indices[t + corner];
+				if (local[vertex] == INVALID)
+				{
+					local[vertex] = current.vertexCount++;
+					meshletVertices.push_back(vertex);
+				}
+				meshletTriangles.push_back(static_cast<uint8_t>(local[vertex]));
+			}
+			current.triangleCount++;
+		}
+		close();
+	}
+}
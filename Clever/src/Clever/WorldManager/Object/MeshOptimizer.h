@@ -0,0 +1,61 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+#include "Clever/WorldManager/Vertex.h"
+#include <glm.hpp>
+
+/*
+-------------Mesh Optimizer----------------
+
+Turns the one vertex per face corner that comes out of an OBJ into an indexed mesh the GPU can work with, in this order:
+	Welding: corners with the exact same attributes become one vertex.
+	Vertex cache: triangles are reordered with Tipsify so the post transform cache hits as often as possible.
+	Overdraw: the cache ordered triangles are cut into clusters that are sorted to draw outward facing parts first.
+	Vertex fetch: vertices are renumbered in the order the index buffer first uses them.
+
+Every step keeps the mesh the same, only the order of triangles and vertices changes.
+
+After those, for the mesh cache:
+	LODs: vertex clustering on a grid, every vertex in a cell collapses onto the one closest to the cell's average and
+		  triangles that lose a corner are dropped. The LOD indexes the same vertices as the full mesh.
+	Meshlets: the optimized triangle order is cut greedily into groups of at most MESHLET_MAX_VERTICES vertices and
+			  MESHLET_MAX_TRIANGLES triangles, each with its own bounding sphere.
+*/
+namespace MeshOptimizer
+{
+	static const uint32_t CACHE_SIZE = 16;//Post transform cache entries assumed by the cache and overdraw steps
+	static const float OVERDRAW_THRESHOLD = 1.05f;//How much worse the ACMR may get to cut the mesh into more clusters
+	static const uint32_t MESHLET_MAX_VERTICES = 64;
+	static const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+	struct Meshlet
+	{
+		uint32_t vertexOffset;//Into the meshlet vertex list, which indexes the mesh's vertices
+		uint32_t triangleOffset;//Into the meshlet triangle list, three bytes per triangle indexing the meshlet's vertices
+		uint32_t vertexCount;
+		uint32_t triangleCount;
+		glm::vec4 boundingSphere;//xyz = center in model space, w = radius
+	};
+
+	//! corners holds three vertices per triangle, outputs the unique vertices and the indices into them
+	void weldVertices(const std::vector<Vertex>& corners, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	//! Tipsify, clusterStarts gets the first triangle of each run that had to restart at a new vertex
+	void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount, std::vector<uint32_t>& clusterStarts);
+
+	//! indices has to be cache optimized with clusterStarts from optimizeVertexCache
+	void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& clusterStarts, float threshold = OVERDRAW_THRESHOLD);
+
+	//! Unused vertices are dropped
+	void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+	//! Average cache miss ratio, transformed vertices per triangle with a FIFO cache of cacheSize
+	float computeACMR(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize = CACHE_SIZE);
+
+	//! gridResolution cells along the longest side of the bounds, returns the indices of the remaining triangles
+	std::vector<uint32_t> simplifyClustered(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, uint32_t gridResolution);
+
+	void buildMeshlets(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, std::vector<Meshlet>& meshlets,
+		std::vector<uint32_t>& meshletVertices, std::vector<uint8_t>& meshletTriangles);
+}
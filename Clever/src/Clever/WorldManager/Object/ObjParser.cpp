@@ -0,0 +1,340 @@
+#include "ObjParser.h"
+#include "OS-Dependant/Platform/MappedFile.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+
+namespace ObjParser
+{
+	struct Chunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		//Filled by counting
+		size_t lines = 0;
+		size_t positions = 0;
+		size_t normals = 0;
+		size_t triangles = 0;
+
+		//Where the chunk's lines and output start in the whole file
+		size_t firstLine = 0;
+		size_t firstPosition = 0;
+		size_t firstNormal = 0;
+		size_t firstTriangle = 0;
+
+		std::string error;
+	};
+
+	static bool isSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	static const char* skipSpace(const char* p, const char* end)
+	{
+		while (p < end && isSpace(*p))
+			p++;
+		return p;
+	}
+
+	static const char* findLineEnd(const char* p, const char* end)
+	{
+		const char* newline = static_cast<const char*>(std::memchr(p, '\n', end - p));
+		return newline ? newline : end;
+	}
+
+	enum class LineType
+	{
+		Other,
+		Position,
+		Normal,
+		Face
+	};
+
+	//! p is moved past the keyword
+	static LineType getLineType(const char*& p, const char* end)
+	{
+		p = skipSpace(p, end);
+		if (p + 1 < end && p[0] == 'v' && isSpace(p[1]))
+		{
+			p += 2;
+			return LineType::Position;
+		}
+		if (p + 2 < end && p[0] == 'v' && p[1] == 'n' && isSpace(p[2]))
+		{
+			p += 3;
+			return LineType::Normal;
+		}
+		if (p + 1 < end && p[0] == 'f' && isSpace(p[1]))
+		{
+			p += 2;
+			return LineType::Face;
+		}
+		return LineType::Other;
+	}
+
+	//! Corners of a face line, a comment ends the line
+	static size_t countCorners(const char* p, const char* end)
+	{
+		size_t corners = 0;
+		while (true)
+		{
+			p = skipSpace(p, end);
+			if (p == end || *p == '#')
+				return corners;
+
+			corners++;
+			while (p < end && !isSpace(*p))
+				p++;
+		}
+	}
+
+	static void countChunk(Chunk& chunk)
+	{
+		const char* p = chunk.begin;
+		while (p < chunk.end)
+		{
+			const char* lineEnd = findLineEnd(p, chunk.end);
+			chunk.lines++;
+
+			switch (getLineType(p, lineEnd))
+			{
+			case LineType::Position: chunk.positions++; break;
+			case LineType::Normal: chunk.normals++; break;
+			case LineType::Face:
+			{
+				size_t corners = countCorners(p, lineEnd);
+				if (corners >= 3)
+					chunk.triangles += corners - 2;
+				break;
+			}
+			default: break;
+			}
+			p = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+		}
+	}
+
+	static bool parseFloat(const char*& p, const char* end, float& value)
+	{
+		p = skipSpace(p, end);
+		if (p < end && *p == '+')
+			p++;
+
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc())
+			return false;
+		p = result.ptr;
+		return true;
+	}
+
+	static bool parseVector(const char*& p, const char* end, glm::vec3& vector)
+	{
+		return parseFloat(p, end, vector.x) && parseFloat(p, end, vector.y) && parseFloat(p, end, vector.z);
+	}
+
+	//! OBJ indices start at 1, negative ones count back from the last declared element
+	static bool resolveIndex(const char*& p, const char* end, size_t declared, size_t total, uint32_t& index)
+	{
+		long long value = 0;
+		std::from_chars_result result = std::from_chars(p, end, value);
+		if (result.ec != std::errc())
+			return false;
+		p = result.ptr;
+
+		if (value > 0 && static_cast<size_t>(value) <= total)
+		{
+			index = static_cast<uint32_t>(value - 1);
+			return true;
+		}
+		if (value < 0 && static_cast<size_t>(-value) <= declared)
+		{
+			index = static_cast<uint32_t>(declared + value);
+			return true;
+		}
+		return false;
+	}
+
+	//! v, v/vt, v//vn or v/vt/vn
+	static bool parseCorner(const char*& p, const char* end, size_t positions, size_t normals, const Mesh& mesh, Corner& corner)
+	{
+		corner.normal = NO_NORMAL;
+		if (!resolveIndex(p, end, positions, mesh.positions.size(), corner.position))
+			return false;
+		if (p == end || *p != '/')
+			return true;
+
+		//Texture coordinates aren't used
+		p++;
+		while (p < end && *p != '/' && !isSpace(*p))
+			p++;
+		if (p == end || *p != '/')
+			return true;
+
+		p++;
+		return resolveIndex(p, end, normals, mesh.normals.size(), corner.normal);
+	}
+
+	static void parseChunk(Chunk& chunk, Mesh& mesh)
+	{
+		size_t line = chunk.firstLine;
+		size_t position = chunk.firstPosition;
+		size_t normal = chunk.firstNormal;
+		Corner* corners = mesh.corners.data() + chunk.firstTriangle * 3;
+		std::vector<Corner> polygon;
+
+		const char* p = chunk.begin;
+		while (p < chunk.end)
+		{
+			const char* lineEnd = findLineEnd(p, chunk.end);
+			line++;
+
+			switch (getLineType(p, lineEnd))
+			{
+			case LineType::Position:
+				if (!parseVector(p, lineEnd, mesh.positions[position++]))
+				{
+					chunk.error = std::to_string(line) + ": malformed vertex position";
+					return;
+				}
+				break;
+			case LineType::Normal:
+				if (!parseVector(p, lineEnd, mesh.normals[normal++]))
+				{
+					chunk.error = std::to_string(line) + ": malformed vertex normal";
+					return;
+				}
+				break;
+			case LineType::Face:
+			{
+				polygon.clear();
+				while (true)
+				{
+					p = skipSpace(p, lineEnd);
+					if (p == lineEnd || *p == '#')
+						break;
+
+					Corner corner;
+					if (!parseCorner(p, lineEnd, position, normal, mesh, corner) || (p < lineEnd && !isSpace(*p)))
+					{
+						chunk.error = std::to_string(line) + ": malformed or out of range face index";
+						return;
+					}
+					polygon.push_back(corner);
+				}
+				if (polygon.size() < 3)
+				{
+					chunk.error = std::to_string(line) + ": face with fewer than three corners";
+					return;
+				}
+
+				for (size_t i = 1; i + 1 < polygon.size(); i++)
+				{
+					*corners++ = polygon[0];
+					*corners++ = polygon[i];
+					*corners++ = polygon[i + 1];
+				}
+				break;
+			}
+			default: break;
+			}
+			p = lineEnd < chunk.end ? lineEnd + 1 : chunk.end;
+		}
+	}
+
+	//! The calling thread takes the first chunk
+	template<typename Function>
+	static void forEachChunk(std::vector<Chunk>& chunks, Function function)
+	{
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < chunks.size(); i++)
+			threads.emplace_back(function, std::ref(chunks[i]));
+		function(chunks[0]);
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+
+	bool parse(const char* text, size_t size, Mesh& mesh, std::string& error, const std::string& name, size_t chunkCount)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		mesh = Mesh{};
+		if (size == 0)
+			return true;
+
+		//! Chunks, every one but the last ends just after a newline
+		std::vector<Chunk> chunks;
+		{
+			if (chunkCount == 0)
+			{
+				size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+				chunkCount = std::max<size_t>(1, std::min(threads, size / MIN_CHUNK_BYTES));
+			}
+			const char* end = text + size;
+			const char* begin = text;
+			for (size_t i = 1; i <= chunkCount && begin < end; i++)
+			{
+				const char* split = i == chunkCount ? end : std::max(begin, text + size / chunkCount * i);
+				if (split < end)
+				{
+					const char* lineEnd = findLineEnd(split, end);
+					split = lineEnd < end ? lineEnd + 1 : end;
+				}
+
+				Chunk chunk;
+				chunk.begin = begin;
+				chunk.end = split;
+				chunks.push_back(chunk);
+				begin = split;
+			}
+		}
+
+		forEachChunk(chunks, countChunk);
+
+		size_t lines = 0;
+		size_t positions = 0;
+		size_t normals = 0;
+		size_t triangles = 0;
+		for (Chunk& chunk : chunks)
+		{
+			chunk.firstLine = lines;
+			chunk.firstPosition = positions;
+			chunk.firstNormal = normals;
+			chunk.firstTriangle = triangles;
+			lines += chunk.lines;
+			positions += chunk.positions;
+			normals += chunk.normals;
+			triangles += chunk.triangles;
+		}
+
+		mesh.positions.resize(positions);
+		mesh.normals.resize(normals);
+		mesh.corners.resize(triangles * 3);
+
+		forEachChunk(chunks, [&mesh](Chunk& chunk) { parseChunk(chunk, mesh); });
+
+		for (const Chunk& chunk : chunks)
+		{
+			if (!chunk.error.empty())
+			{
+				error = name + ":" + chunk.error;
+				mesh = Mesh{};
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool parse(const std::string& path, Mesh& mesh, std::string& error)
+	{
+		MappedFile file;
+		if (!file.open(path))
+		{
+			error = path + ": can't be opened";
+			return false;
+		}
+		return parse(reinterpret_cast<const char*>(file.data()), file.size(), mesh, error, path);
+	}
+}
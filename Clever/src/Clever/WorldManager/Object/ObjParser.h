@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <glm.hpp>
+
+/*
+-------------OBJ Parser----------------
+
+Reads the geometry of an OBJ straight out of a mapped file:
+	Chunks: the file is cut into about one piece per hardware thread, each boundary moved to just after a newline.
+	Counting: every chunk counts its lines, positions, normals and the triangles its faces fan into.
+	Parsing: with the counts summed up front each chunk knows where its output starts, so it parses its numbers with
+			 std::from_chars and writes them straight into arrays sized once for the whole file.
+
+Only v, vn and f lines are read, texture coordinates and everything else are skipped. Negative face indices are
+resolved against the positions and normals declared before the line, like every OBJ reader does.
+*/
+namespace ObjParser
+{
+	static const size_t MIN_CHUNK_BYTES = 1 << 20;//Smaller files aren't worth a thread
+	static const uint32_t NO_NORMAL = UINT32_MAX;
+
+	struct Corner
+	{
+		uint32_t position;
+		uint32_t normal;//NO_NORMAL when the face didn't give one
+	};
+
+	struct Mesh
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<Corner> corners;//Three per triangle, polygons are fanned from their first corner
+	};
+
+	//! error gets "path:line: reason" for the first malformed line
+	bool parse(const std::string& path, Mesh& mesh, std::string& error);
+
+	//! Same as above on text already in memory. chunkCount 0 picks about one chunk per hardware thread for text over
+	//! MIN_CHUNK_BYTES, anything else cuts the text into that many chunks whatever its size
+	bool parse(const char* text, size_t size, Mesh& mesh, std::string& error, const std::string& name = "obj", size_t chunkCount = 0);
+}
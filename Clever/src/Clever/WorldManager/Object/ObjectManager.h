@@ -8,4 +8,5 @@
 #include "Clever/WorldManager/MeshData.h"
 
 
-std::pair<std::vector<Vertex>, std::vector<uint16_t>> loadModel(std::string modelFilePath);
\ No newline at end of file
+//! Index width is picked per mesh, 16 bit when the welded mesh fits. Throws if the file can't be parsed
+std::pair<std::vector<Vertex>, MeshIndices> loadModel(std::string modelFilePath);
\ No newline at end of file
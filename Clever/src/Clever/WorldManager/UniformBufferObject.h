@@ -1,5 +1,10 @@
 #pragma once
+#include <glm.hpp>
+#include <cstdint>
 
 struct UniformBufferObject {
 	glm::mat4 viewproj;
-};
\ No newline at end of file
+	uint32_t materialBuffer;//Bindless slot of the MaterialBuffer
+	uint32_t materialCount;//Material indices at or past it are treated as no material
+	uint32_t padding[2];
+};
@@ -0,0 +1,189 @@
+#include "VertexFormats.h"
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace VertexFormats
+{
+	struct AttributeLayout
+	{
+		uint32_t location;
+		VkFormat format;
+		uint32_t offset;
+	};
+
+	struct FormatLayout
+	{
+		const char* name;
+		const char* vertexShader;
+		const char* vertexDefine;//Picks the shader's variant for the layout, empty for none
+		uint32_t stride;
+		std::vector<AttributeLayout> attributes;
+	};
+
+	//Indexed by VertexFormat. Both quantized layouts share a shader, the unorm/snorm conversion happens in vertex input
+	static const FormatLayout s_Layouts[] =
+	{
+		{ "Float", "shader.vert", "", sizeof(Vertex),
+			{
+				{ 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, pos) },
+				{ 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color) }
+			}
+		},
+		{ "Quantized16", "shader.vert", "VERTEX_QUANTIZED", sizeof(QuantizedVertex16),
+			{
+				{ 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(QuantizedVertex16, position) },
+				{ 1, VK_FORMAT_R16G16_SNORM, offsetof(QuantizedVertex16, normal) }
+			}
+		},
+		//The position attribute reads the normal as its w, the shader ignores it
+		{ "Quantized8", "shader.vert", "VERTEX_QUANTIZED", sizeof(QuantizedVertex8),
+			{
+				{ 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(QuantizedVertex8, position) },
+				{ 1, VK_FORMAT_R8G8_SNORM, offsetof(QuantizedVertex8, normal) }
+			}
+		}
+	};
+
+	static_assert(sizeof(QuantizedVertex16) == 12, "QuantizedVertex16 must stay tightly packed");
+	static_assert(sizeof(QuantizedVertex8) == 8, "QuantizedVertex8 must stay tightly packed");
+
+	static const FormatLayout& getLayout(VertexFormat format)
+	{
+		return s_Layouts[static_cast<uint32_t>(format)];
+	}
+
+	uint32_t getStride(VertexFormat format)
+	{
+		return getLayout(format).stride;
+	}
+
+	VkVertexInputBindingDescription getBindingDescription(VertexFormat format)
+	{
+		VkVertexInputBindingDescription bindingDescription{};
+		bindingDescription.binding = 0;
+		bindingDescription.stride = getLayout(format).stride;
+		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		return bindingDescription;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format)
+	{
+		std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
+		for (const AttributeLayout& attribute : getLayout(format).attributes)
+		{
+			VkVertexInputAttributeDescription description{};
+			description.binding = 0;
+			description.location = attribute.location;
+			description.format = attribute.format;
+			description.offset = attribute.offset;
+			attributeDescriptions.push_back(description);
+		}
+		return attributeDescriptions;
+	}
+
+	std::string getVertexShader(VertexFormat format)
+	{
+		return getLayout(format).vertexShader;
+	}
+
+	std::vector<std::string> getVertexDefines(VertexFormat format)
+	{
+		const char* define = getLayout(format).vertexDefine;
+		if (define[0] == '\0')
+			return {};
+		return { define };
+	}
+
+	std::string getName(VertexFormat format)
+	{
+		return getLayout(format).name;
+	}
+
+	glm::vec2 encodeOctahedral(glm::vec3 normal)
+	{
+		float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+		if (length == 0.0f)
+			return glm::vec2(0.0f);
+		normal /= length;
+
+		glm::vec2 encoded(normal.x, normal.y);
+		if (normal.z < 0.0f)
+		{
+			encoded.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+			encoded.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		return encoded;
+	}
+
+	static uint16_t quantizeUnorm16(float value)
+	{
+		return static_cast<uint16_t>(std::lround(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f));
+	}
+
+	template<typename T>
+	static T quantizeSnorm(float value, float maximum)
+	{
+		return static_cast<T>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * maximum));
+	}
+
+	std::vector<uint8_t> encode(const Vertex* vertices, size_t vertexCount, VertexFormat format, Dequantization& dequantization)
+	{
+		std::vector<uint8_t> data(vertexCount * getStride(format));
+		dequantization = Dequantization{};
+
+		if (format == VertexFormat::Float)
+		{
+			if (vertexCount > 0)
+				std::memcpy(data.data(), vertices, data.size());
+			return data;
+		}
+
+		//! Mesh bounds, every position is stored relative to them
+		glm::vec3 min(0.0f);
+		glm::vec3 max(0.0f);
+		if (vertexCount > 0)
+		{
+			min = vertices[0].pos;
+			max = vertices[0].pos;
+			for (size_t i = 1; i < vertexCount; i++)
+			{
+				min = glm::min(min, vertices[i].pos);
+				max = glm::max(max, vertices[i].pos);
+			}
+		}
+		dequantization.offset = min;
+		dequantization.scale = max - min;
+
+		for (size_t i = 0; i < vertexCount; i++)
+		{
+			glm::vec3 extent = dequantization.scale;
+			glm::vec3 relative = vertices[i].pos - min;
+			uint16_t position[3];
+			for (int axis = 0; axis < 3; axis++)
+				position[axis] = extent[axis] > 0.0f ? quantizeUnorm16(relative[axis] / extent[axis]) : 0;
+
+			glm::vec2 normal = encodeOctahedral(vertices[i].color * 2.0f - 1.0f);
+
+			if (format == VertexFormat::Quantized16)
+			{
+				QuantizedVertex16 packed{};
+				std::memcpy(packed.position, position, sizeof(position));
+				packed.normal[0] = quantizeSnorm<int16_t>(normal.x, 32767.0f);
+				packed.normal[1] = quantizeSnorm<int16_t>(normal.y, 32767.0f);
+				std::memcpy(&data[i * sizeof(packed)], &packed, sizeof(packed));
+			}
+			else
+			{
+				QuantizedVertex8 packed{};
+				std::memcpy(packed.position, position, sizeof(position));
+				packed.normal[0] = quantizeSnorm<int8_t>(normal.x, 127.0f);
+				packed.normal[1] = quantizeSnorm<int8_t>(normal.y, 127.0f);
+				std::memcpy(&data[i * sizeof(packed)], &packed, sizeof(packed));
+			}
+		}
+		return data;
+	}
+}
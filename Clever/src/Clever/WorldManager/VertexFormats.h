@@ -0,0 +1,68 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "Clever/WorldManager/Vertex.h"
+
+/*
+-------------Vertex Formats----------------
+
+Layouts a mesh can be stored in on the GPU, picked per mesh at import:
+	Float:		 vec3 position, vec3 color (24 bytes), the Vertex struct as is.
+	Quantized16: position as unorm16 relative to the mesh bounds, octahedral normal in 2x snorm16 (12 bytes).
+	Quantized8:	 position as unorm16, octahedral normal in 2x snorm8 packed into the position's unused fourth
+				 component (8 bytes). Only formats every device supports for vertex input are used.
+
+The quantized layouts take the normal from Vertex::color, remapped to [0,1] the way loadModel writes it, and the vertex
+shader variant of the layout decodes it back. Positions are dequantized with the mesh's scale and offset.
+Binding and attribute descriptions are generated from one attribute table per layout.
+*/
+enum class VertexFormat
+{
+	Float,
+	Quantized16,
+	Quantized8
+};
+
+struct QuantizedVertex16
+{
+	uint16_t position[4];//w unused
+	int16_t normal[2];
+};
+
+struct QuantizedVertex8
+{
+	uint16_t position[3];
+	int8_t normal[2];
+};
+
+namespace VertexFormats
+{
+	//! Maps a quantized position back to model space, position = offset + unorm * scale
+	struct Dequantization
+	{
+		glm::vec3 scale = glm::vec3(1.0f);
+		glm::vec3 offset = glm::vec3(0.0f);
+	};
+
+	uint32_t getStride(VertexFormat format);
+	VkVertexInputBindingDescription getBindingDescription(VertexFormat format);
+	std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(VertexFormat format);
+
+	//! Vertex shader source that reads the layout, relative to the shader directory
+	std::string getVertexShader(VertexFormat format);
+	//! Defines the vertex shader is compiled with for the layout
+	std::vector<std::string> getVertexDefines(VertexFormat format);
+
+	std::string getName(VertexFormat format);
+
+	//! getStride(format) bytes per vertex. Float copies the vertices and leaves dequantization as identity
+	std::vector<uint8_t> encode(const Vertex* vertices, size_t vertexCount, VertexFormat format, Dequantization& dequantization);
+
+	//! Octahedral mapping of a unit vector onto [-1,1]^2
+	glm::vec2 encodeOctahedral(glm::vec3 normal);
+}
@@ -2,7 +2,10 @@
 #include "Components/ComponentManager.h"
 #include "OS-Dependant/Vulkan/VulkanInstance.h"
 #include "Object/ObjectManager.h"
+#include "Clever/Assets/AssetManager.h"
+#include "Clever/Material/MaterialManager.h"
 #include "Clever/Developer/DevTools.h"
+#include "Clever/Developer/Profiler.h"
 #include "Clever/EventSystem/EventManager.h"
 #include <iostream>
 #include <string>
@@ -13,6 +16,7 @@ namespace World
 	struct WorldFlags
 	{
 		std::string WorldFileLocation;
+		std::string AssetDirectory = "Clever/Resource/";//Asset paths are relative to it
 	};
 
 	class WorldManager
@@ -60,7 +64,8 @@ namespace World
 		{
 
 		}
-		void worldInit(std::shared_ptr<VulkanInstance> vulkanInstance, WorldFlags flags = {})
+		//! materials must already be uploaded to vulkanInstance, objects are given their ids
+		void worldInit(std::shared_ptr<VulkanInstance> vulkanInstance, Material::MaterialManager& materials, WorldFlags flags = {})
 		{
 
 			//Registering INGUI window dock function
@@ -75,19 +80,23 @@ namespace World
 				componentManager.RegisterComponent<Renderable>();
 
 			}
-			ray = { vulkanInstance->m_Device, vulkanInstance->m_PhysicalDevice, vulkanInstance->m_RenderPass, vulkanInstance->m_CommandPool, vulkanInstance->m_GraphicsQueue, vulkanInstance->m_UniformBuffers, vulkanInstance->m_max_frames_in_flight, true };
-			loadedObject = { vulkanInstance->m_Device, vulkanInstance->m_PhysicalDevice, vulkanInstance->m_RenderPass, vulkanInstance->m_CommandPool, vulkanInstance->m_GraphicsQueue, vulkanInstance->m_UniformBuffers, vulkanInstance->m_max_frames_in_flight, false };
+			ray = { vulkanInstance->m_Resources, vulkanInstance->m_RenderPass, vulkanInstance->m_Descriptors.getPipelineLayout(), ShaderFeature::Wireframe };
+			loadedObject = { vulkanInstance->m_Resources, vulkanInstance->m_RenderPass, vulkanInstance->m_Descriptors.getPipelineLayout(), ShaderFeature::Lit, VertexFormat::Quantized16 };
+
+			assets.init(vulkanInstance->m_Resources, flags.AssetDirectory);
 
 			{
-				std::pair<std::vector<Vertex>, std::vector<uint16_t>> teapotModel = loadModel("D:/Clever-Personal/Clever/Clever/Resource/Models/Teapot.obj");
+				//Drawn as a placeholder cube until it has streamed in
+				AssetHandle<MeshData> teapotModel = assets.loadMesh("Models/Teapot.obj", loadedObject.format, { 0, 0, 0 });
 
-				std::pair<std::vector<Vertex>, std::vector<uint16_t>> rayModel = {vertices, indices };
+				std::pair<std::vector<Vertex>, MeshIndices> rayModel = {vertices, indices };
 
 				componentManager.AddEntity();
 				componentManager.AddEntity();
 
-				loadedObject.setComponentData(teapotModel);
+				loadedObject.setComponentData(teapotModel, assets.getMesh(teapotModel));
 				loadedObject.setLocation({ 0, 0, 0 });
+				loadedObject.setMaterial(materials.getMaterialId("stone"));
 
 				ray.setComponentData(rayModel);
 				ray.setLocation({ 2,2,2 });
@@ -103,10 +112,13 @@ namespace World
 
 		void update()
 		{
+			CLEVER_PROFILE_FUNCTION();
 			if (Event::EventManager::isKeyPressed(KEY_R))
 			{
 				addRay();
 			}
+
+			assets.update(camera->GetPosition(), getRenderables(), getRenderablesSize());
 		}
 
 		Renderable* getRenderables()
@@ -119,13 +131,17 @@ namespace World
 			return componentManager.getComponentArraySize<Renderable>();
 		}
 
+		//! Before the VulkanInstance is cleaned up, the meshes of loaded assets are released through its GeometryBuffer
 		void cleanup()
 		{
-			
+			assets.cleanup();
+			ray.destory();
+			loadedObject.destory();
 		}
 
 	private:
 		ComponentManager componentManager{};
+		AssetManager assets;
 
 		std::shared_ptr<Camera> camera;
 
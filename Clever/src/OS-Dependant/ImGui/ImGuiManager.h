@@ -12,11 +12,6 @@ public:
 
 	void bind(std::shared_ptr<VulkanInstance> p_VulkanInstance, uint32_t m_CurrentFrame);
 
-	VkCommandBuffer getCommandBuffer(uint32_t m_CurrentFrame)
-	{
-		return m_ImGuiCommandBuffers[m_CurrentFrame];
-	}
-
 	void newFrame()
 	{
 		ImGui_ImplVulkan_NewFrame();
@@ -35,23 +30,12 @@ public:
 		ImGui::ShowDemoWindow();
 	}
 
-	uint32_t render(std::shared_ptr<VulkanInstance> p_VulkanInstance, uint32_t m_CurrentFrame);
+	//! Finishes the UI frame, the returned draw data is recorded by VulkanInstance in the UI subpass
+	ImDrawData* render();
 
 	void cleanup(std::shared_ptr<VulkanInstance> p_VulkanInstance);
 
-	void recreateFrameBuffer(std::shared_ptr<VulkanInstance> p_VulkanInstance);
-
-private:
-
-	void createFrameBuffer(std::shared_ptr<VulkanInstance> p_VulkanInstance);
-
 private:
 	VkDescriptorPool m_ImGuiDesciptorPool;
-	VkRenderPass m_ImGuiRenderPass;
-
-	VkCommandPool m_ImGuiCommandPool;
-	std::vector<VkCommandBuffer> m_ImGuiCommandBuffers;
-
-	std::vector<VkFramebuffer> m_ImGuiFrameBuffers;
 
 };
\ No newline at end of file
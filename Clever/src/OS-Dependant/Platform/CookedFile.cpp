@@ -0,0 +1,132 @@
+#include "CookedFile.h"
+#include "MappedFile.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+namespace CookedFile
+{
+	uint64_t hash(const void* data, size_t size, uint64_t seed)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint64_t hash = seed;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	uint64_t hashFile(const std::string& path, uint64_t seed)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		MappedFile file;
+		if (!file.open(path))
+			return seed;
+		return hash(file.data(), file.size(), seed);
+	}
+
+	uint64_t hashFiles(const std::vector<std::string>& paths)
+	{
+		uint64_t combined = FNV_OFFSET;
+		for (const std::string& path : paths)
+			combined = hashFile(path, combined);
+		return combined;
+	}
+
+	int64_t getFileTime(const std::string& path)
+	{
+		std::error_code error;
+		auto time = std::filesystem::last_write_time(path, error);
+		if (error)
+			return 0;
+		return static_cast<int64_t>(time.time_since_epoch().count());
+	}
+
+	int64_t getFileTime(const std::vector<std::string>& paths)
+	{
+		if (paths.size() == 1)
+			return getFileTime(paths[0]);
+
+		uint64_t combined = FNV_OFFSET;
+		for (const std::string& path : paths)
+		{
+			int64_t time = getFileTime(path);
+			if (time == 0)
+				return 0;
+			combined = hash(&time, sizeof(time), combined);
+		}
+		return static_cast<int64_t>(combined);
+	}
+
+	uint64_t alignSection(uint64_t offset)
+	{
+		return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+	}
+
+	bool sectionFits(uint64_t offset, uint64_t bytes, size_t fileSize)
+	{
+		return offset <= fileSize && bytes <= fileSize - offset;
+	}
+
+	bool write(const std::string& path, const void* header, size_t headerBytes, Section* sections, size_t sectionCount)
+	{
+		uint64_t offset = headerBytes;
+		for (size_t i = 0; i < sectionCount; i++)
+		{
+			offset = alignSection(offset);
+			*sections[i].offset = offset;
+			offset += sections[i].bytes;
+		}
+
+		//Named after the thread, two threads cooking the same file never write into each other's
+		std::string temporaryPath = path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+		bool written;
+		{
+			std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+			file.write(static_cast<const char*>(header), headerBytes);
+			uint64_t end = headerBytes;
+			for (size_t i = 0; i < sectionCount && file; i++)
+			{
+				static const char zeros[SECTION_ALIGNMENT] = {};
+				file.write(zeros, *sections[i].offset - end);
+				if (sections[i].bytes > 0)
+					file.write(static_cast<const char*>(sections[i].data), sections[i].bytes);
+				end = *sections[i].offset + sections[i].bytes;
+			}
+			written = static_cast<bool>(file);
+		}
+
+		std::error_code error;
+		if (written)
+			std::filesystem::rename(temporaryPath, path, error);
+		if (!written || error)
+		{
+			std::filesystem::remove(temporaryPath, error);
+			return false;
+		}
+		return true;
+	}
+
+	bool isCurrent(const std::string& path, size_t timeOffset, int64_t storedTime, uint64_t storedHash, const std::vector<std::string>& sourcePaths)
+	{
+		int64_t sourceTime = getFileTime(sourcePaths);
+		if (sourceTime != 0 && storedTime == sourceTime)
+			return true;
+
+		//Touched but maybe not changed, a checkout or copy does this to every file
+		if (hashFiles(sourcePaths) != storedHash)
+			return false;
+
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		if (file)
+		{
+			file.seekp(timeOffset);
+			file.write(reinterpret_cast<const char*>(&sourceTime), sizeof(sourceTime));
+		}
+		return true;
+	}
+}
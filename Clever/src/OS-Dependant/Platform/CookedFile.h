@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/*
+-------------Cooked File----------------
+
+What every cooked cache (.cmesh, .cmat, the shader cache) has in common, read back with a MappedFile:
+	Hashing: FNV-1a over bytes, text and whole files.
+	Sections: blocks laid out one after another behind a header, each on SECTION_ALIGNMENT, their offsets stored in
+			  the header.
+	Writing: to a file beside the cache renamed over it, so an interrupted cook never leaves a truncated file behind.
+	Freshness: a header stores the modification time and the hash of its sources. The time alone decides when it
+			   matches, when only the time changed the sources are hashed and the new time is written into the header
+			   instead of cooking again.
+*/
+namespace CookedFile
+{
+	static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+	static const uint64_t FNV_PRIME = 1099511628211ull;
+	static const uint64_t SECTION_ALIGNMENT = 16;
+
+	//! FNV-1a, seed chains several pieces into one hash
+	uint64_t hash(const void* data, size_t size, uint64_t seed = FNV_OFFSET);
+
+	//! Same as hash over the characters, usable in constant expressions
+	constexpr uint64_t hashText(std::string_view text, uint64_t seed = FNV_OFFSET)
+	{
+		uint64_t hash = seed;
+		for (char character : text)
+		{
+			hash ^= static_cast<uint8_t>(character);
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	//! hash of the file's content, seed when it can't be read
+	uint64_t hashFile(const std::string& path, uint64_t seed = FNV_OFFSET);
+	//! Every file's content chained in order, the same as hashFile for one file
+	uint64_t hashFiles(const std::vector<std::string>& paths);
+
+	//! 0 when the file can't be read, a stored time of 0 is never treated as current
+	int64_t getFileTime(const std::string& path);
+	//! The time of one file, or the times of several combined. 0 when one of them can't be read
+	int64_t getFileTime(const std::vector<std::string>& paths);
+
+	struct Section
+	{
+		uint64_t* offset;//Where the section's offset from the start of the file is stored, usually in the header
+		const void* data;
+		uint64_t bytes;
+	};
+
+	uint64_t alignSection(uint64_t offset);
+	bool sectionFits(uint64_t offset, uint64_t bytes, size_t fileSize);
+
+	//! Lays the sections out behind headerBytes of header, storing their offsets before the header is written, then
+	//! writes everything beside path and renames it over path. False if it couldn't be written or replaced, path is
+	//! left as it was then.
+	bool write(const std::string& path, const void* header, size_t headerBytes, Section* sections = nullptr, size_t sectionCount = 0);
+
+	//! Whether a cooked file with storedTime and storedHash in its header is current for sourcePaths, writing their new
+	//! time at timeOffset in the header when only the time changed. The cooked file must not be mapped.
+	bool isCurrent(const std::string& path, size_t timeOffset, int64_t storedTime, uint64_t storedHash, const std::vector<std::string>& sourcePaths);
+}
@@ -0,0 +1,140 @@
+#include "MappedFile.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		close();
+		m_Data = std::exchange(other.m_Data, nullptr);
+		m_Size = std::exchange(other.m_Size, 0);
+		m_Open = std::exchange(other.m_Open, false);
+		m_File = std::exchange(other.m_File, nullptr);
+		m_Mapping = std::exchange(other.m_Mapping, nullptr);
+		m_Descriptor = std::exchange(other.m_Descriptor, -1);
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	m_File = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		close();
+		return false;
+	}
+	m_Size = static_cast<size_t>(size.QuadPart);
+	m_Open = true;
+
+	//Mapping an empty file fails, there is nothing to view anyway
+	if (m_Size == 0)
+		return true;
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping)
+	{
+		close();
+		return false;
+	}
+	m_Mapping = mapping;
+
+	m_Data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_Data)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_Mapping)
+		CloseHandle(m_Mapping);
+	if (m_File)
+		CloseHandle(m_File);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Open = false;
+	m_File = nullptr;
+	m_Mapping = nullptr;
+}
+#else
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	m_Descriptor = ::open(path.c_str(), O_RDONLY);
+	if (m_Descriptor < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(m_Descriptor, &status) != 0)
+	{
+		close();
+		return false;
+	}
+	m_Size = static_cast<size_t>(status.st_size);
+	m_Open = true;
+
+	if (m_Size == 0)
+		return true;
+
+	void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_Descriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	madvise(data, m_Size, MADV_SEQUENTIAL);
+	m_Data = static_cast<const uint8_t*>(data);
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_Data)
+		munmap(const_cast<uint8_t*>(m_Data), m_Size);
+	if (m_Descriptor >= 0)
+		::close(m_Descriptor);
+
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Open = false;
+	m_Descriptor = -1;
+}
+#endif
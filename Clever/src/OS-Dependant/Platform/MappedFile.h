@@ -0,0 +1,52 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/*
+-------------Mapped File----------------
+
+Read only view of a whole file mapped into the address space, pages are loaded by the OS as they are touched so
+nothing is copied until the data is used. The view stays valid until the MappedFile is closed or destroyed.
+Empty files open successfully with a null data pointer.
+*/
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	//! Returns false if the file can't be opened or mapped, any previous mapping is closed first
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const
+	{
+		return m_Open;
+	}
+
+	const uint8_t* data() const
+	{
+		return m_Data;
+	}
+
+	size_t size() const
+	{
+		return m_Size;
+	}
+
+private:
+	const uint8_t* m_Data = nullptr;
+	size_t m_Size = 0;
+	bool m_Open = false;
+
+	//HANDLEs on Windows, the file descriptor on everything else
+	void* m_File = nullptr;
+	void* m_Mapping = nullptr;
+	int m_Descriptor = -1;
+};
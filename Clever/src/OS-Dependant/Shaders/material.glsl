@@ -0,0 +1,23 @@
+//Included after #version by every shader that reads materials, matches GPUMaterial in MaterialBuffer.h
+#extension GL_EXT_nonuniform_qualifier : require
+
+struct Material
+{
+    vec4 color;//rgb in [0,1], a unused
+};
+
+//Binding 0 of the bindless table, the UniformBufferObject has the MaterialBuffer's slot and material count
+layout(std430, set = 1, binding = 0) readonly buffer MaterialBuffer {
+    Material materials[];
+} bindlessBuffers[];
+
+//Material::NO_MATERIAL and anything else past the uploaded materials has none
+bool hasMaterial(uint materialIndex, uint materialCount)
+{
+    return materialIndex < materialCount;
+}
+
+Material getMaterial(uint materialBuffer, uint materialIndex)
+{
+    return bindlessBuffers[materialBuffer].materials[materialIndex];
+}
@@ -1,8 +1,30 @@
 #version 450
+#include "material.glsl"
+
+layout(set = 0, binding = 0) uniform UniformBufferObject {
+    mat4 viewproj;
+    uint materialBuffer;
+    uint materialCount;
+} ubo;
+
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) flat in uint fragMaterial;
 
 layout(location = 0) out vec4 outColor;
 
+//ShaderFeature::Lit, see ShaderVariants.h. Off by default so every pipeline without it shares the unlit code
+layout(constant_id = 0) const bool LIT = false;
+
 void main() {  
-    outColor = vec4(fragColor, 1.0f);
-}
\ No newline at end of file
+    bool useMaterial = hasMaterial(fragMaterial, ubo.materialCount);
+    vec3 albedo = useMaterial ? getMaterial(ubo.materialBuffer, fragMaterial).color.rgb : vec3(1.0);
+    if (LIT)
+    {
+        //fragColor is the normal remapped to [0,1] (see VertexFormats.h)
+        vec3 normal = normalize(fragColor * 2.0 - 1.0);
+        float diffuse = max(dot(normal, normalize(vec3(0.4, 0.8, 0.6))), 0.0);
+        outColor = vec4(albedo * (0.15 + 0.85 * diffuse), 1.0f);
+        return;
+    }
+    outColor = vec4(useMaterial ? albedo : fragColor, 1.0f);
+}
@@ -1,20 +1,57 @@
 #version 450
 
-layout(binding = 0) uniform UniformBufferObject {
+layout(set = 0, binding = 0) uniform UniformBufferObject {
     mat4 viewproj;
+    uint materialBuffer;
+    uint materialCount;
 } ubo;
 
-layout(push_constant) uniform constants
+struct Instance
 {
     mat4 model;
-} pushConstants;
+    vec4 boundingSphere;
+    uint indexCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint materialIndex;//Into the material buffer, see material.glsl
+    vec4 positionScale;//Dequantization of the mesh, xyz only
+    vec4 positionOffset;
+};
 
+layout(std430, set = 0, binding = 1) readonly buffer InstanceBuffer {
+    Instance instances[];
+};
+
+//Compiled twice, with VERTEX_QUANTIZED for the Quantized16 and Quantized8 formats (see VertexFormats.h)
+#ifdef VERTEX_QUANTIZED
+layout(location = 0) in vec4 inPosition;//unorm, relative to the mesh bounds
+layout(location = 1) in vec2 inNormal;//Octahedral
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-normal.z, 0.0);
+    normal.x += normal.x >= 0.0 ? -fold : fold;
+    normal.y += normal.y >= 0.0 ? -fold : fold;
+    return normalize(normal);
+}
+#else
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
+#endif
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) flat out uint fragMaterial;
 
 void main() {
-    gl_Position = ubo.viewproj * pushConstants.model * vec4(inPosition, 1.0);
+    Instance instance = instances[gl_InstanceIndex];
+#ifdef VERTEX_QUANTIZED
+    vec3 position = instance.positionOffset.xyz + inPosition.xyz * instance.positionScale.xyz;
+    fragColor = decodeOctahedral(inNormal) * 0.5 + 0.5;
+#else
+    vec3 position = inPosition;
     fragColor = inColor;
+#endif
+    fragMaterial = instance.materialIndex;
+    gl_Position = ubo.viewproj * instance.model * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+/*
+-------------Deferred Deletion----------------
+
+Resources that may still be referenced by submitted command buffers are pushed here instead of being destroyed.
+Every queue submit takes a serial from submit(), once the fence of a submit has signaled flush(serial) destroys
+everything that was pushed before it. Submits to one queue finish in order so a single serial is enough.
+*/
+class DeletionQueue
+{
+public:
+	DeletionQueue() = default;
+
+	//! deleter runs once every submit made before this call has finished
+	void push(std::function<void()>&& deleter)
+	{
+		m_Entries.push_back({ m_SubmitSerial, std::move(deleter) });
+	}
+
+	//! deleter runs once the next submit has finished too, for resources read by the command buffer still being recorded.
+	//! Entries pushed after it wait behind it, one frame at most
+	void pushAfterNextSubmit(std::function<void()>&& deleter)
+	{
+		m_Entries.push_back({ m_SubmitSerial + 1, std::move(deleter) });
+	}
+
+	//! Serial of the submit being made, store it with the fence that guards it
+	uint64_t submit()
+	{
+		return ++m_SubmitSerial;
+	}
+
+	void flush(uint64_t completedSerial)
+	{
+		while (!m_Entries.empty() && m_Entries.front().serial <= completedSerial)
+		{
+			m_Entries.front().deleter();
+			m_Entries.pop_front();
+		}
+	}
+
+	//! Only after the device is idle
+	void flushAll()
+	{
+		flush(UINT64_MAX);
+	}
+
+	size_t size()
+	{
+		return m_Entries.size();
+	}
+
+private:
+	struct Entry
+	{
+		uint64_t serial;
+		std::function<void()> deleter;
+	};
+
+	std::deque<Entry> m_Entries;
+	uint64_t m_SubmitSerial = 0;
+};
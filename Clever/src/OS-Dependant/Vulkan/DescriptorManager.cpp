@@ -0,0 +1,287 @@
+#include "DescriptorManager.h"
+#include "Clever/WorldManager/UniformBufferObject.h"
+
+#include <array>
+#include <stdexcept>
+
+void DescriptorManager::init(VkDevice device, std::vector<VkBuffer>& uniformBuffers, std::vector<VkBuffer>& instanceBuffers, int maxFramesInFlight)
+{
+	m_Device = device;
+	m_MaxFramesInFlight = maxFramesInFlight;
+
+	createLayouts();
+	createFrameSets(uniformBuffers, instanceBuffers);
+	createBindlessSet();
+}
+
+void DescriptorManager::cleanup()
+{
+	vkDestroyDescriptorPool(m_Device, m_BindlessPool, nullptr);
+	vkDestroyDescriptorPool(m_Device, m_FramePool, nullptr);
+	vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_Device, m_BindlessSetLayout, nullptr);
+	vkDestroyDescriptorSetLayout(m_Device, m_FrameSetLayout, nullptr);
+}
+
+void DescriptorManager::bind(VkCommandBuffer commandBuffer, uint32_t currentFrame, VkPipelineBindPoint bindPoint)
+{
+	std::array<VkDescriptorSet, 2> sets = { m_FrameSets[currentFrame], m_BindlessSet };
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, m_PipelineLayout, 0, static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+}
+
+uint32_t DescriptorManager::registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	uint32_t slot = allocateSlot(m_FreeBufferSlots, m_NextBufferSlot, MAX_BINDLESS_BUFFERS);
+	updateStorageBuffer(slot, buffer, offset, range);
+	return slot;
+}
+
+void DescriptorManager::updateStorageBuffer(uint32_t slot, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_BindlessSet;
+	write.dstBinding = 0;
+	write.dstArrayElement = slot;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+}
+
+void DescriptorManager::releaseStorageBuffer(uint32_t slot)
+{
+	//The slot is partially bound so it can stay stale until it gets reused
+	m_FreeBufferSlots.push_back(slot);
+}
+
+uint32_t DescriptorManager::registerImage(VkImageView imageView, VkSampler sampler, VkImageLayout layout)
+{
+	uint32_t slot = allocateSlot(m_FreeImageSlots, m_NextImageSlot, MAX_BINDLESS_IMAGES);
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = layout;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_BindlessSet;
+	write.dstBinding = 1;
+	write.dstArrayElement = slot;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+	return slot;
+}
+
+void DescriptorManager::releaseImage(uint32_t slot)
+{
+	m_FreeImageSlots.push_back(slot);
+}
+
+void DescriptorManager::createLayouts()
+{
+	//Frame Set Layout
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		bindings[0].descriptorCount = 1;
+		bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[1].descriptorCount = 1;
+		bindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+		VkDescriptorSetLayoutCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		info.bindingCount = static_cast<uint32_t>(bindings.size());
+		info.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(m_Device, &info, nullptr, &m_FrameSetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Frame DescriptorSetLayout!");
+		}
+	}
+
+	//Bindless Set Layout
+	{
+		std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+		bindings[0].binding = 0;
+		bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[0].descriptorCount = MAX_BINDLESS_BUFFERS;
+		bindings[0].stageFlags = VK_SHADER_STAGE_ALL;
+		bindings[1].binding = 1;
+		bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		bindings[1].descriptorCount = MAX_BINDLESS_IMAGES;
+		bindings[1].stageFlags = VK_SHADER_STAGE_ALL;
+
+		//Slots get written while older frames are still in flight and most of them are never written at all
+		std::vector<VkDescriptorBindingFlags> bindingFlags(2, VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT);
+
+		VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+		flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+		flagsInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+		flagsInfo.pBindingFlags = bindingFlags.data();
+
+		VkDescriptorSetLayoutCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		info.pNext = &flagsInfo;
+		info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+		info.bindingCount = static_cast<uint32_t>(bindings.size());
+		info.pBindings = bindings.data();
+
+		if (vkCreateDescriptorSetLayout(m_Device, &info, nullptr, &m_BindlessSetLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Bindless DescriptorSetLayout!");
+		}
+	}
+
+	//Shared Pipeline Layout
+	{
+		std::array<VkDescriptorSetLayout, 2> setLayouts = { m_FrameSetLayout, m_BindlessSetLayout };
+
+		VkPipelineLayoutCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+		info.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+		info.pSetLayouts = setLayouts.data();
+
+		if (vkCreatePipelineLayout(m_Device, &info, nullptr, &m_PipelineLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create shared Pipeline Layout!");
+		}
+	}
+}
+
+void DescriptorManager::createFrameSets(std::vector<VkBuffer>& uniformBuffers, std::vector<VkBuffer>& instanceBuffers)
+{
+	//Descriptor Pool
+	{
+		std::vector<VkDescriptorPoolSize> sizeInfos(2);
+		sizeInfos[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		sizeInfos[0].descriptorCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+		sizeInfos[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		sizeInfos[1].descriptorCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+
+		VkDescriptorPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		info.poolSizeCount = static_cast<uint32_t>(sizeInfos.size());
+		info.pPoolSizes = sizeInfos.data();
+		info.maxSets = static_cast<uint32_t>(m_MaxFramesInFlight);
+
+		if (vkCreateDescriptorPool(m_Device, &info, nullptr, &m_FramePool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Frame descriptor pool");
+		}
+	}
+
+	//Descriptor Sets
+	{
+		std::vector<VkDescriptorSetLayout> layouts(m_MaxFramesInFlight, m_FrameSetLayout);
+		VkDescriptorSetAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		info.descriptorPool = m_FramePool;
+		info.descriptorSetCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+		info.pSetLayouts = layouts.data();
+
+		m_FrameSets.resize(m_MaxFramesInFlight);
+
+		if (vkAllocateDescriptorSets(m_Device, &info, m_FrameSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Frame descriptor sets");
+		}
+	}
+
+	for (int i = 0; i < m_MaxFramesInFlight; i++)
+	{
+		VkDescriptorBufferInfo uniformInfo{};
+		uniformInfo.buffer = uniformBuffers[i];
+		uniformInfo.offset = 0;
+		uniformInfo.range = sizeof(UniformBufferObject);
+
+		VkDescriptorBufferInfo instanceInfo{};
+		instanceInfo.buffer = instanceBuffers[i];
+		instanceInfo.offset = 0;
+		instanceInfo.range = VK_WHOLE_SIZE;
+
+		std::vector<VkWriteDescriptorSet> writeInfos(2);
+		writeInfos[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeInfos[0].dstSet = m_FrameSets[i];
+		writeInfos[0].dstBinding = 0;
+		writeInfos[0].descriptorCount = 1;
+		writeInfos[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writeInfos[0].pBufferInfo = &uniformInfo;
+
+		writeInfos[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		writeInfos[1].dstSet = m_FrameSets[i];
+		writeInfos[1].dstBinding = 1;
+		writeInfos[1].descriptorCount = 1;
+		writeInfos[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writeInfos[1].pBufferInfo = &instanceInfo;
+
+		vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(writeInfos.size()), writeInfos.data(), 0, nullptr);
+	}
+}
+
+void DescriptorManager::createBindlessSet()
+{
+	//Descriptor Pool
+	{
+		std::vector<VkDescriptorPoolSize> sizeInfos(2);
+		sizeInfos[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		sizeInfos[0].descriptorCount = MAX_BINDLESS_BUFFERS;
+		sizeInfos[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		sizeInfos[1].descriptorCount = MAX_BINDLESS_IMAGES;
+
+		VkDescriptorPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		info.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+		info.poolSizeCount = static_cast<uint32_t>(sizeInfos.size());
+		info.pPoolSizes = sizeInfos.data();
+		info.maxSets = 1;
+
+		if (vkCreateDescriptorPool(m_Device, &info, nullptr, &m_BindlessPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Bindless descriptor pool");
+		}
+	}
+
+	//Descriptor Set
+	{
+		VkDescriptorSetAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		info.descriptorPool = m_BindlessPool;
+		info.descriptorSetCount = 1;
+		info.pSetLayouts = &m_BindlessSetLayout;
+
+		if (vkAllocateDescriptorSets(m_Device, &info, &m_BindlessSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Bindless descriptor set");
+		}
+	}
+}
+
+uint32_t DescriptorManager::allocateSlot(std::vector<uint32_t>& freeSlots, uint32_t& nextSlot, uint32_t maxSlots)
+{
+	if (!freeSlots.empty())
+	{
+		uint32_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		return slot;
+	}
+
+	if (nextSlot >= maxSlots)
+	{
+		throw std::runtime_error("Bindless descriptor table is full!");
+	}
+	return nextSlot++;
+}
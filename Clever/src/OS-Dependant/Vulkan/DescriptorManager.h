@@ -0,0 +1,96 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+/*
+-------------Global Descriptor Management----------------
+
+Every pipeline shares one layout made of two sets:
+	Set 0, Frame: Per frame constants, one set per frame in flight.
+		binding 0 = UniformBufferObject
+		binding 1 = GPU instance buffer written by the HiZCuller
+	Set 1, Bindless: One update-after-bind table for per object resources, indexed in shaders with the slot
+		returned by register*.
+		binding 0 = storage buffers (materials, per object data)
+		binding 1 = combined image samplers (textures)
+
+Both sets are bound once at the start of the frame, draws only bind pipelines and buffers.
+*/
+class DescriptorManager
+{
+public:
+	static const uint32_t MAX_BINDLESS_BUFFERS = 1024;
+	static const uint32_t MAX_BINDLESS_IMAGES = 1024;
+	static const uint32_t INVALID_SLOT = UINT32_MAX;
+	static const uint32_t BINDLESS_SET = 1;
+
+public:
+	DescriptorManager() = default;
+
+	void init(VkDevice device, std::vector<VkBuffer>& uniformBuffers, std::vector<VkBuffer>& instanceBuffers, int maxFramesInFlight);
+
+	void cleanup();
+
+	//! Binds the frame set and the bindless table, stays bound across render passes for every pipeline using getPipelineLayout()
+	void bind(VkCommandBuffer commandBuffer, uint32_t currentFrame, VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+	//! Returns the slot the buffer can be read from in shaders, freed slots are reused
+	uint32_t registerStorageBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	void updateStorageBuffer(uint32_t slot, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	void releaseStorageBuffer(uint32_t slot);
+
+	uint32_t registerImage(VkImageView imageView, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	void releaseImage(uint32_t slot);
+
+	VkPipelineLayout getPipelineLayout()
+	{
+		return m_PipelineLayout;
+	}
+
+	VkDescriptorSetLayout getFrameSetLayout()
+	{
+		return m_FrameSetLayout;
+	}
+
+	VkDescriptorSetLayout getBindlessSetLayout()
+	{
+		return m_BindlessSetLayout;
+	}
+
+	uint32_t getStorageBufferCount()
+	{
+		return m_NextBufferSlot - static_cast<uint32_t>(m_FreeBufferSlots.size());
+	}
+
+	uint32_t getImageCount()
+	{
+		return m_NextImageSlot - static_cast<uint32_t>(m_FreeImageSlots.size());
+	}
+
+private:
+	void createLayouts();
+	void createFrameSets(std::vector<VkBuffer>& uniformBuffers, std::vector<VkBuffer>& instanceBuffers);
+	void createBindlessSet();
+
+	uint32_t allocateSlot(std::vector<uint32_t>& freeSlots, uint32_t& nextSlot, uint32_t maxSlots);
+
+private:
+	VkDevice m_Device = VK_NULL_HANDLE;
+	int m_MaxFramesInFlight = 0;
+
+	VkDescriptorSetLayout m_FrameSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_BindlessSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+
+	VkDescriptorPool m_FramePool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> m_FrameSets;
+
+	VkDescriptorPool m_BindlessPool = VK_NULL_HANDLE;
+	VkDescriptorSet m_BindlessSet = VK_NULL_HANDLE;
+
+	std::vector<uint32_t> m_FreeBufferSlots;
+	uint32_t m_NextBufferSlot = 0;
+
+	std::vector<uint32_t> m_FreeImageSlots;
+	uint32_t m_NextImageSlot = 0;
+};
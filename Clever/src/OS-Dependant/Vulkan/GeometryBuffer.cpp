@@ -0,0 +1,456 @@
+#include "GeometryBuffer.h"
+#include "Clever/Developer/DevTools.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+void GeometryBuffer::init(VkDevice device, MemoryAllocator& allocator, TransferManager& transferManager, DeletionQueue& deletionQueue)
+{
+	m_Device = device;
+	m_Allocator = &allocator;
+	m_TransferManager = &transferManager;
+	m_DeletionQueue = &deletionQueue;
+
+	//Made up front, the other formats get theirs with their first mesh
+	createArena(VertexFormat::Float, VERTEX_ARENA_SIZE, INDEX_ARENA_SIZE);
+
+	DevTools::addDockFunction(geometryGui, { this });
+}
+
+void GeometryBuffer::cleanup()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (auto& arena : m_Arenas)
+	{
+		if (!arena)
+			continue;
+		m_Allocator->destroyBuffer(arena->vertexBuffer, arena->vertexMemory);
+		m_Allocator->destroyBuffer(arena->indexBuffer, arena->indexMemory);
+	}
+	m_Arenas.clear();
+	m_Meshes.clear();
+	m_FreeHandles.clear();
+}
+
+GeometryBuffer::MeshHandle GeometryBuffer::addMesh(const void* vertices, uint32_t vertexCount, VertexFormat format, const MeshIndices& indices)
+{
+	return addMesh(vertices, vertexCount, format, indices.data(), indices.count(), indices.type);
+}
+
+GeometryBuffer::MeshHandle GeometryBuffer::addMesh(const void* vertices, uint32_t vertexCount, VertexFormat format, const void* indices, uint32_t indexCount, VkIndexType indexType)
+{
+	CLEVER_PROFILE_FUNCTION();
+	VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(vertexCount) * VertexFormats::getStride(format);
+	VkDeviceSize indexBytes = static_cast<VkDeviceSize>(indexCount) * MeshIndices::indexSize(indexType);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	Mesh mesh;
+	mesh.alive = true;
+	mesh.vertexCount = vertexCount;
+	mesh.indexCount = indexCount;
+	mesh.indexType = indexType;
+
+	if (!reserve(format, vertexCount, indexBytes, UINT32_MAX, mesh.arena, mesh.vertexNode, mesh.vertexOffset, mesh.indexNode, mesh.indexByteOffset))
+	{
+		mesh.arena = createArena(format, std::max(VERTEX_ARENA_SIZE, vertexBytes), std::max(INDEX_ARENA_SIZE, indexBytes));
+		if (!reserveIn(mesh.arena, vertexCount, indexBytes, mesh.vertexNode, mesh.vertexOffset, mesh.indexNode, mesh.indexByteOffset))
+			throw std::runtime_error("failed to reserve geometry buffer ranges!");
+	}
+
+	MeshHandle handle;
+	if (!m_FreeHandles.empty())
+	{
+		handle = m_FreeHandles.back();
+		m_FreeHandles.pop_back();
+	}
+	else
+	{
+		handle = static_cast<MeshHandle>(m_Meshes.size());
+		m_Meshes.emplace_back();
+	}
+
+	Arena& arena = *m_Arenas[mesh.arena];
+	arena.meshCount++;
+	arena.vertexOwners.resize(std::max<size_t>(arena.vertexOwners.size(), mesh.vertexNode + 1), INVALID_MESH);
+	arena.indexOwners.resize(std::max<size_t>(arena.indexOwners.size(), mesh.indexNode + 1), INVALID_MESH);
+	arena.vertexOwners[mesh.vertexNode] = handle;
+	arena.indexOwners[mesh.indexNode] = handle;
+
+	if (vertexBytes > 0)
+		mesh.vertexUpload = m_TransferManager->uploadBuffer(arena.vertexBuffer, vertices, vertexBytes, TransferManager::Usage::Vertex, mesh.vertexOffset * arena.stride);
+	if (indexBytes > 0)
+		mesh.indexUpload = m_TransferManager->uploadBuffer(arena.indexBuffer, indices, indexBytes, TransferManager::Usage::Index, mesh.indexByteOffset);
+
+	m_Meshes[handle] = std::move(mesh);
+	return handle;
+}
+
+void GeometryBuffer::removeMesh(MeshHandle mesh)
+{
+	if (mesh == INVALID_MESH)
+		return;
+
+	//A copy may still be writing to the ranges
+	if (!isResident(mesh))
+		m_TransferManager->waitIdle();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	Mesh& entry = m_Meshes[mesh];
+	if (!entry.alive)
+		return;
+
+	Arena& arena = *m_Arenas[entry.arena];
+	arena.meshCount--;
+	arena.vertexOwners[entry.vertexNode] = INVALID_MESH;
+	arena.indexOwners[entry.indexNode] = INVALID_MESH;
+	releaseDeferred(entry.arena, entry.vertexNode, entry.indexNode);
+
+	entry = Mesh{};
+	m_FreeHandles.push_back(mesh);
+}
+
+GeometryBuffer::MeshRange GeometryBuffer::getRange(MeshHandle mesh)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	Mesh& entry = m_Meshes[mesh];
+
+	MeshRange range;
+	range.arena = entry.arena;
+	range.firstIndex = static_cast<uint32_t>(entry.indexByteOffset / MeshIndices::indexSize(entry.indexType));
+	range.indexCount = entry.indexCount;
+	range.vertexOffset = static_cast<int32_t>(entry.vertexOffset);
+	range.vertexCount = entry.vertexCount;
+	range.indexType = entry.indexType;
+	return range;
+}
+
+bool GeometryBuffer::isResident(MeshHandle mesh)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	Mesh& entry = m_Meshes[mesh];
+	return isReady(entry.vertexUpload) && isReady(entry.indexUpload);
+}
+
+void GeometryBuffer::bind(VkCommandBuffer commandBuffer, uint32_t arena, VkIndexType indexType)
+{
+	VkBuffer vertexBuffer;
+	VkBuffer indexBuffer;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		vertexBuffer = m_Arenas[arena]->vertexBuffer;
+		indexBuffer = m_Arenas[arena]->indexBuffer;
+	}
+
+	VkDeviceSize offsets[] = { 0 };
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, &vertexBuffer, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType);
+}
+
+void GeometryBuffer::compact(VkCommandBuffer commandBuffer)
+{
+	CLEVER_PROFILE_FUNCTION();
+	m_MovesLastFrame = 0;
+	if (!m_CompactionEnabled)
+		return;
+
+	struct CopyCommand
+	{
+		VkBuffer src;
+		VkBuffer dst;
+		VkBufferCopy region;
+	};
+	std::vector<CopyCommand> copies;
+	VkDeviceSize budget = m_CompactionBudget;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	//Meshes moved between arenas this frame, their new ranges are still being written by those copies
+	std::vector<bool> movedArenas(m_Meshes.size(), false);
+
+	//! Emptying the least used arena of each vertex format, only when everything in it fits in the others of that format
+	for (uint32_t format = 0; format < VERTEX_FORMAT_COUNT; format++)
+	{
+		uint32_t emptiest = UINT32_MAX;
+		VkDeviceSize emptiestUsed = 0;
+		VkDeviceSize freeElsewhere = 0;
+		uint32_t liveArenas = 0;
+		for (uint32_t i = 0; i < m_Arenas.size(); i++)
+		{
+			if (!m_Arenas[i] || m_Arenas[i]->retired || m_Arenas[i]->format != static_cast<VertexFormat>(format))
+				continue;
+			liveArenas++;
+
+			Arena& arena = *m_Arenas[i];
+			VkDeviceSize used = (arena.vertices.getCapacity() - arena.vertices.getFreeBytes()) * arena.stride + arena.indices.getCapacity() - arena.indices.getFreeBytes();
+			VkDeviceSize free = arena.vertices.getFreeBytes() * arena.stride + arena.indices.getFreeBytes();
+			freeElsewhere += free;
+			if (emptiest == UINT32_MAX || used < emptiestUsed)
+			{
+				emptiest = i;
+				emptiestUsed = used;
+			}
+		}
+
+		if (liveArenas > 1)
+		{
+			Arena& source = *m_Arenas[emptiest];
+			freeElsewhere -= source.vertices.getFreeBytes() * source.stride + source.indices.getFreeBytes();
+
+			if (source.meshCount == 0)
+			{
+				//Its last ranges may still be waiting in the deletion queue, the arena goes after them
+				source.retired = true;
+				m_ArenasReleased++;
+				m_DeletionQueue->push([this, emptiest]()
+					{
+						std::lock_guard<std::mutex> lock(m_Mutex);
+						Arena& arena = *m_Arenas[emptiest];
+						m_Allocator->destroyBuffer(arena.vertexBuffer, arena.vertexMemory);
+						m_Allocator->destroyBuffer(arena.indexBuffer, arena.indexMemory);
+						m_Arenas[emptiest].reset();
+					});
+			}
+			else if (emptiestUsed <= freeElsewhere)
+			{
+				for (MeshHandle handle = 0; handle < m_Meshes.size() && budget > 0; handle++)
+				{
+					Mesh& mesh = m_Meshes[handle];
+					if (!mesh.alive || mesh.arena != emptiest || !isReady(mesh.vertexUpload) || !isReady(mesh.indexUpload))
+						continue;
+
+					VkDeviceSize vertexBytes = static_cast<VkDeviceSize>(mesh.vertexCount) * source.stride;
+					VkDeviceSize indexBytes = static_cast<VkDeviceSize>(mesh.indexCount) * MeshIndices::indexSize(mesh.indexType);
+					if (vertexBytes + indexBytes > budget)
+						break;
+
+					uint32_t arenaIndex, vertexNode, indexNode;
+					uint64_t vertexOffset, indexByteOffset;
+					if (!reserve(source.format, mesh.vertexCount, indexBytes, emptiest, arenaIndex, vertexNode, vertexOffset, indexNode, indexByteOffset))
+						continue;
+
+					Arena& destination = *m_Arenas[arenaIndex];
+					copies.push_back({ source.vertexBuffer, destination.vertexBuffer, { mesh.vertexOffset * source.stride, vertexOffset * source.stride, vertexBytes } });
+					copies.push_back({ source.indexBuffer, destination.indexBuffer, { mesh.indexByteOffset, indexByteOffset, indexBytes } });
+
+					source.vertexOwners[mesh.vertexNode] = INVALID_MESH;
+					source.indexOwners[mesh.indexNode] = INVALID_MESH;
+					source.meshCount--;
+					releaseDeferred(mesh.arena, mesh.vertexNode, mesh.indexNode);
+
+					destination.vertexOwners.resize(std::max<size_t>(destination.vertexOwners.size(), vertexNode + 1), INVALID_MESH);
+					destination.indexOwners.resize(std::max<size_t>(destination.indexOwners.size(), indexNode + 1), INVALID_MESH);
+					destination.vertexOwners[vertexNode] = handle;
+					destination.indexOwners[indexNode] = handle;
+					destination.meshCount++;
+
+					mesh.arena = arenaIndex;
+					mesh.vertexNode = vertexNode;
+					mesh.vertexOffset = vertexOffset;
+					mesh.indexNode = indexNode;
+					mesh.indexByteOffset = indexByteOffset;
+					movedArenas[handle] = true;
+					budget -= vertexBytes + indexBytes;
+				}
+			}
+		}
+	}
+
+	//! Moving the highest ranges of each arena down into free ranges below them
+	for (uint32_t arenaIndex = 0; arenaIndex < m_Arenas.size() && budget > 0; arenaIndex++)
+	{
+		if (!m_Arenas[arenaIndex] || m_Arenas[arenaIndex]->retired)
+			continue;
+		Arena& arena = *m_Arenas[arenaIndex];
+
+		//Vertex and index ranges move on their own, each stream stops at the first range that has nowhere lower to go
+		for (int stream = 0; stream < 2 && budget > 0; stream++)
+		{
+			bool vertices = stream == 0;
+			TlsfAllocator& ranges = vertices ? arena.vertices : arena.indices;
+			std::vector<MeshHandle>& owners = vertices ? arena.vertexOwners : arena.indexOwners;
+
+			//A single free range is all the free space in one piece already
+			if (ranges.getFreeRangeCount() < 2)
+				continue;
+
+			for (uint32_t node : ranges.getAllocatedNodes(true))
+			{
+				MeshHandle handle = node < owners.size() ? owners[node] : INVALID_MESH;
+				//Freed but still waiting in the deletion queue, it is released where it is
+				if (handle == INVALID_MESH || movedArenas[handle])
+					continue;
+
+				Mesh& mesh = m_Meshes[handle];
+				if (!isReady(mesh.vertexUpload) || !isReady(mesh.indexUpload))
+					break;
+
+				uint64_t size = ranges.getSize(node);
+				VkDeviceSize bytes = vertices ? size * arena.stride : size;
+				if (bytes > budget)
+					break;
+
+				uint64_t offset;
+				uint32_t moved = ranges.allocate(size, vertices ? 1 : INDEX_ALIGNMENT, offset);
+				if (moved == TlsfAllocator::INVALID)
+					break;
+				if (offset >= ranges.getOffset(node))
+				{
+					ranges.free(moved);
+					break;
+				}
+
+				owners.resize(std::max<size_t>(owners.size(), moved + 1), INVALID_MESH);
+				owners[moved] = handle;
+				owners[node] = INVALID_MESH;
+
+				if (vertices)
+				{
+					copies.push_back({ arena.vertexBuffer, arena.vertexBuffer, { mesh.vertexOffset * arena.stride, offset * arena.stride, bytes } });
+					releaseDeferred(arenaIndex, mesh.vertexNode, TlsfAllocator::INVALID);
+					mesh.vertexNode = moved;
+					mesh.vertexOffset = offset;
+				}
+				else
+				{
+					copies.push_back({ arena.indexBuffer, arena.indexBuffer, { mesh.indexByteOffset, offset, bytes } });
+					releaseDeferred(arenaIndex, TlsfAllocator::INVALID, mesh.indexNode);
+					mesh.indexNode = moved;
+					mesh.indexByteOffset = offset;
+				}
+				budget -= bytes;
+			}
+		}
+	}
+
+	if (copies.empty())
+		return;
+
+	//Sources were last written by uploads or earlier moves, which are only visible to vertex input so far
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	for (CopyCommand& copy : copies)
+	{
+		if (copy.region.size == 0)
+			continue;
+		vkCmdCopyBuffer(commandBuffer, copy.src, copy.dst, 1, &copy.region);
+		m_BytesCompacted += copy.region.size;
+	}
+	m_MovesLastFrame = copies.size();
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+bool GeometryBuffer::reserve(VertexFormat format, uint32_t vertexCount, VkDeviceSize indexBytes, uint32_t skipArena, uint32_t& arena, uint32_t& vertexNode, uint64_t& vertexOffset, uint32_t& indexNode, uint64_t& indexByteOffset)
+{
+	for (uint32_t i = 0; i < m_Arenas.size(); i++)
+	{
+		if (i == skipArena || !m_Arenas[i] || m_Arenas[i]->retired || m_Arenas[i]->format != format)
+			continue;
+		if (reserveIn(i, vertexCount, indexBytes, vertexNode, vertexOffset, indexNode, indexByteOffset))
+		{
+			arena = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool GeometryBuffer::reserveIn(uint32_t arena, uint32_t vertexCount, VkDeviceSize indexBytes, uint32_t& vertexNode, uint64_t& vertexOffset, uint32_t& indexNode, uint64_t& indexByteOffset)
+{
+	Arena& entry = *m_Arenas[arena];
+
+	vertexNode = entry.vertices.allocate(vertexCount, 1, vertexOffset);
+	if (vertexNode == TlsfAllocator::INVALID)
+		return false;
+
+	//Rounded up so the next range never needs padding in front of it
+	indexNode = entry.indices.allocate((indexBytes + INDEX_ALIGNMENT - 1) & ~(INDEX_ALIGNMENT - 1), INDEX_ALIGNMENT, indexByteOffset);
+	if (indexNode == TlsfAllocator::INVALID)
+	{
+		entry.vertices.free(vertexNode);
+		return false;
+	}
+	return true;
+}
+
+uint32_t GeometryBuffer::createArena(VertexFormat format, VkDeviceSize vertexBytes, VkDeviceSize indexBytes)
+{
+	std::unique_ptr<Arena> arena(new Arena());
+	arena->format = format;
+	arena->stride = VertexFormats::getStride(format);
+
+	uint64_t vertexCapacity = vertexBytes / arena->stride;
+	arena->vertexMemory = m_Allocator->createBuffer(vertexCapacity * arena->stride, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, arena->vertexBuffer);
+	arena->indexMemory = m_Allocator->createBuffer(indexBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, arena->indexBuffer);
+	arena->vertices.init(vertexCapacity);
+	arena->indices.init(indexBytes);
+
+	//Slots of released arenas are reused, nothing refers to them anymore
+	for (uint32_t i = 0; i < m_Arenas.size(); i++)
+	{
+		if (!m_Arenas[i])
+		{
+			m_Arenas[i] = std::move(arena);
+			return i;
+		}
+	}
+	m_Arenas.push_back(std::move(arena));
+	return static_cast<uint32_t>(m_Arenas.size() - 1);
+}
+
+void GeometryBuffer::releaseDeferred(uint32_t arena, uint32_t vertexNode, uint32_t indexNode)
+{
+	//The copies moving these ranges are in the frame being recorded, they are read until its submit finishes
+	m_DeletionQueue->pushAfterNextSubmit([this, arena, vertexNode, indexNode]()
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			Arena& entry = *m_Arenas[arena];
+			if (vertexNode != TlsfAllocator::INVALID)
+				entry.vertices.free(vertexNode);
+			if (indexNode != TlsfAllocator::INVALID)
+				entry.indices.free(indexNode);
+		});
+}
+
+void GeometryBuffer::geometryGui(std::vector<void*> classInstances)
+{
+	GeometryBuffer* geometry = (GeometryBuffer*)classInstances.at(0);
+	DevTools::newDock("Geometry");
+
+	uint32_t meshCount = 0;
+	{
+		std::lock_guard<std::mutex> lock(geometry->m_Mutex);
+		for (uint32_t i = 0; i < geometry->m_Arenas.size(); i++)
+		{
+			if (!geometry->m_Arenas[i])
+				continue;
+			Arena& arena = *geometry->m_Arenas[i];
+			meshCount += arena.meshCount;
+
+			uint64_t vertexUsed = arena.vertices.getCapacity() - arena.vertices.getFreeBytes();
+			uint64_t indexUsed = arena.indices.getCapacity() - arena.indices.getFreeBytes();
+			DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Arena " + std::to_string(i) + " (" + VertexFormats::getName(arena.format) + (arena.retired ? ", released" : "") + "): " + std::to_string(arena.meshCount) + " meshes");
+			DevTools::coloredText({ 0.8, 0.8, 0.8 }, "  Vertices: " + std::to_string(vertexUsed * arena.stride >> 10) + " / " + std::to_string(arena.vertices.getCapacity() * arena.stride >> 10) +
+				" KB, " + std::to_string(arena.vertices.getFreeRangeCount()) + " free ranges");
+			DevTools::coloredText({ 0.8, 0.8, 0.8 }, "  Indices: " + std::to_string(indexUsed >> 10) + " / " + std::to_string(arena.indices.getCapacity() >> 10) +
+				" KB, " + std::to_string(arena.indices.getFreeRangeCount()) + " free ranges");
+		}
+	}
+
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Meshes: " + std::to_string(meshCount));
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Compacted: " + std::to_string(geometry->m_BytesCompacted >> 10) + " KB, " + std::to_string(geometry->m_MovesLastFrame) +
+		" copies last frame, " + std::to_string(geometry->m_ArenasReleased) + " arenas released");
+	DevTools::checkbox("Compaction", &geometry->m_CompactionEnabled);
+	DevTools::endDock();
+}
@@ -0,0 +1,148 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <future>
+#include <mutex>
+#include <memory>
+
+#include "TlsfAllocator.h"
+#include "MemoryAllocator.h"
+#include "TransferManager.h"
+#include "DeletionQueue.h"
+#include "Clever/WorldManager/MeshIndices.h"
+#include "Clever/WorldManager/VertexFormats.h"
+
+/*
+-------------Geometry Buffer----------------
+
+Every static mesh lives in a few big device local vertex and index buffers instead of a buffer pair of its own, so draws
+only rebind when the arena changes and use firstIndex/vertexOffset to find their mesh.
+
+	Arenas: a vertex buffer and an index buffer each sub-allocated with a TlsfAllocator, the vertex arena counts in vertices
+			and the index arena in bytes so 16 and 32 bit meshes can share it. Each arena holds one vertex format, since
+			vertexOffset counts in the stride of the bound layout. A new arena is only created when a mesh fits in none
+			of the existing ones of its format.
+	Uploads: go straight into the arena ranges through the TransferManager, a mesh can't be drawn before it is resident.
+	Freeing: the ranges of a removed mesh are released through the deletion queue, frames in flight may still draw it.
+	Compaction: once per frame, up to a byte budget of resident meshes are copied out of the emptiest arena (so it can be
+				released) or down into lower free ranges of their own arena, which keeps the free space in one piece.
+
+Meshes are referred to by handle, the ranges behind a handle change when compaction moves them.
+*/
+class GeometryBuffer
+{
+public:
+	typedef uint32_t MeshHandle;
+	static const MeshHandle INVALID_MESH = UINT32_MAX;
+
+	static const VkDeviceSize VERTEX_ARENA_SIZE = 64ull << 20;
+	static const VkDeviceSize INDEX_ARENA_SIZE = 32ull << 20;
+	static const VkDeviceSize INDEX_ALIGNMENT = 4;//Index ranges start on a whole index whether it is 16 or 32 bit
+	static const uint32_t VERTEX_FORMAT_COUNT = 3;
+
+	//! Everything a draw needs, firstIndex and vertexOffset are relative to the arena's buffers
+	struct MeshRange
+	{
+		uint32_t arena;
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		int32_t vertexOffset;
+		uint32_t vertexCount;
+		VkIndexType indexType;
+	};
+
+public:
+	GeometryBuffer() = default;
+
+	void init(VkDevice device, MemoryAllocator& allocator, TransferManager& transferManager, DeletionQueue& deletionQueue);
+
+	//! Device has to be idle and the deletion queue flushed
+	void cleanup();
+
+	//! Thread safe, the data is copied before this returns. vertices are already encoded in format
+	MeshHandle addMesh(const void* vertices, uint32_t vertexCount, VertexFormat format, const MeshIndices& indices);
+	//! Same as above for index data that isn't owned by a MeshIndices, like a mapped mesh cache
+	MeshHandle addMesh(const void* vertices, uint32_t vertexCount, VertexFormat format, const void* indices, uint32_t indexCount, VkIndexType indexType);
+
+	//! Main thread, the ranges are reused once the frames submitted so far are done
+	void removeMesh(MeshHandle mesh);
+
+	MeshRange getRange(MeshHandle mesh);
+
+	//! The uploads of the mesh are done, nothing may draw it before this is true
+	bool isResident(MeshHandle mesh);
+
+	//! Binds the vertex and index buffer of an arena, the index buffer is read as indexType
+	void bind(VkCommandBuffer commandBuffer, uint32_t arena, VkIndexType indexType);
+
+	//! Records the copies of this frame's compaction moves, followed by a barrier that makes them visible to vertex input.
+	//! Ranges read by earlier frames are only released once this submit is done.
+	void compact(VkCommandBuffer commandBuffer);
+
+	static void geometryGui(std::vector<void*> classInstances);
+
+public:
+	bool m_CompactionEnabled = true;
+	VkDeviceSize m_CompactionBudget = 4ull << 20;//Bytes copied per frame at most
+
+private:
+	struct Arena
+	{
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		MemoryAllocator::Allocation* vertexMemory = nullptr;
+		MemoryAllocator::Allocation* indexMemory = nullptr;
+		VertexFormat format = VertexFormat::Float;
+		uint32_t stride = 0;
+		TlsfAllocator vertices;//In vertices
+		TlsfAllocator indices;//In bytes
+		std::vector<MeshHandle> vertexOwners;//Indexed by TLSF node, for compaction
+		std::vector<MeshHandle> indexOwners;
+		uint32_t meshCount = 0;
+		bool retired = false;//Emptied by compaction, destroyed once its ranges are released
+	};
+
+	struct Mesh
+	{
+		bool alive = false;
+		uint32_t arena = 0;
+		uint32_t vertexNode = TlsfAllocator::INVALID;
+		uint32_t indexNode = TlsfAllocator::INVALID;
+		uint64_t vertexOffset = 0;
+		uint64_t indexByteOffset = 0;
+		uint32_t vertexCount = 0;
+		uint32_t indexCount = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT16;
+		std::shared_future<void> vertexUpload;
+		std::shared_future<void> indexUpload;
+	};
+
+	//! Reserves both ranges in the first arena of format other than skipArena they fit in. m_Mutex must be held
+	bool reserve(VertexFormat format, uint32_t vertexCount, VkDeviceSize indexBytes, uint32_t skipArena, uint32_t& arena, uint32_t& vertexNode, uint64_t& vertexOffset, uint32_t& indexNode, uint64_t& indexByteOffset);
+	bool reserveIn(uint32_t arena, uint32_t vertexCount, VkDeviceSize indexBytes, uint32_t& vertexNode, uint64_t& vertexOffset, uint32_t& indexNode, uint64_t& indexByteOffset);
+	uint32_t createArena(VertexFormat format, VkDeviceSize vertexBytes, VkDeviceSize indexBytes);
+
+	//! Both ranges of the arena go back once the frames submitted so far and the one being recorded are done
+	void releaseDeferred(uint32_t arena, uint32_t vertexNode, uint32_t indexNode);
+
+	static bool isReady(const std::shared_future<void>& upload)
+	{
+		return !upload.valid() || upload.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+private:
+	VkDevice m_Device = VK_NULL_HANDLE;
+	MemoryAllocator* m_Allocator = nullptr;
+	TransferManager* m_TransferManager = nullptr;
+	DeletionQueue* m_DeletionQueue = nullptr;
+
+	std::mutex m_Mutex;//Guards the arenas and the meshes
+	std::vector<std::unique_ptr<Arena>> m_Arenas;//Released arenas stay as null so indices don't shift
+	std::vector<Mesh> m_Meshes;
+	std::vector<MeshHandle> m_FreeHandles;
+
+	//Stats for the dock
+	uint64_t m_BytesCompacted = 0;
+	uint64_t m_MovesLastFrame = 0;
+	uint32_t m_ArenasReleased = 0;
+};
@@ -0,0 +1,355 @@
+#include "GpuProfiler.h"
+#include "Clever/Developer/DevTools.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+void GpuProfiler::init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, int maxFramesInFlight)
+{
+	m_Device = device;
+	s_Instance = this;
+
+	DevTools::addDockFunction(profilerGui, { this });
+
+	//Checking Support
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		m_TimestampPeriod = properties.limits.timestampPeriod;
+
+		uint32_t queueFamilyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+		uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+		if (validBits == 0)
+		{
+			//Nothing to measure with, every call becomes a no-op
+			return;
+		}
+		m_TimestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+		VkPhysicalDeviceFeatures features;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+		m_StatisticsSupported = features.pipelineStatisticsQuery == VK_TRUE;
+	}
+
+	//Query Pools
+	{
+		m_Frames.resize(maxFramesInFlight);
+		for (FrameQueries& frame : m_Frames)
+		{
+			VkQueryPoolCreateInfo info{};
+			info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			info.queryCount = MAX_SCOPES * 2;
+
+			if (vkCreateQueryPool(m_Device, &info, nullptr, &frame.timestampPool) != VK_SUCCESS)
+			{
+				throw std::runtime_error("Failed to create timestamp Query Pool!");
+			}
+
+			if (m_StatisticsSupported)
+			{
+				info.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+				info.queryCount = MAX_SCOPES;
+				info.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+				if (vkCreateQueryPool(m_Device, &info, nullptr, &frame.statisticsPool) != VK_SUCCESS)
+				{
+					throw std::runtime_error("Failed to create pipeline statistics Query Pool!");
+				}
+			}
+		}
+
+		VkQueryPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		info.queryCount = 2;
+
+		if (vkCreateQueryPool(m_Device, &info, nullptr, &m_ImmediatePool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create immediate Query Pool!");
+		}
+	}
+
+	m_Enabled = true;
+}
+
+void GpuProfiler::cleanup()
+{
+	for (FrameQueries& frame : m_Frames)
+	{
+		vkDestroyQueryPool(m_Device, frame.timestampPool, nullptr);
+		if (frame.statisticsPool != VK_NULL_HANDLE)
+			vkDestroyQueryPool(m_Device, frame.statisticsPool, nullptr);
+	}
+	m_Frames.clear();
+
+	if (m_ImmediatePool != VK_NULL_HANDLE)
+		vkDestroyQueryPool(m_Device, m_ImmediatePool, nullptr);
+
+	if (s_Instance == this)
+		s_Instance = nullptr;
+	m_Enabled = false;
+}
+
+void GpuProfiler::newFrame(uint32_t currentFrame)
+{
+	if (!m_Enabled)
+		return;
+
+	FrameQueries& frame = m_Frames[currentFrame];
+
+	for (const std::string& name : m_ScopeOrder)
+	{
+		ScopeHistory& history = m_History[name];
+		history.milliseconds[m_HistoryOffset] = 0.0f;
+		history.vertexInvocations[m_HistoryOffset] = 0;
+		history.fragmentInvocations[m_HistoryOffset] = 0;
+	}
+
+	m_LastFrameMilliseconds = 0.0f;
+
+	//Timestamps, no wait flag since the fence of this frame has already signaled. Anything not written is just skipped.
+	if (frame.timestampCount > 0)
+	{
+		std::vector<uint64_t> timestamps(frame.timestampCount);
+		VkResult result = vkGetQueryPoolResults(m_Device, frame.timestampPool, 0, frame.timestampCount, timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+		if (result == VK_SUCCESS)
+		{
+			for (const Scope& scope : frame.scopes)
+			{
+				uint64_t ticks = (timestamps[scope.endQuery] & m_TimestampMask) - (timestamps[scope.startQuery] & m_TimestampMask);
+				float milliseconds = static_cast<float>(ticks * m_TimestampPeriod / 1000000.0);
+				findOrAddHistory(scope.name).milliseconds[m_HistoryOffset] += milliseconds;
+				m_LastFrameMilliseconds += milliseconds;
+			}
+		}
+	}
+
+	//Pipeline Statistics, vertex then fragment invocations per query
+	if (frame.statisticsCount > 0)
+	{
+		std::vector<uint64_t> statistics(frame.statisticsCount * 2);
+		VkResult result = vkGetQueryPoolResults(m_Device, frame.statisticsPool, 0, frame.statisticsCount, statistics.size() * sizeof(uint64_t), statistics.data(), sizeof(uint64_t) * 2, VK_QUERY_RESULT_64_BIT);
+
+		if (result == VK_SUCCESS)
+		{
+			for (const Scope& scope : frame.scopes)
+			{
+				if (scope.statisticsQuery < 0)
+					continue;
+
+				ScopeHistory& history = findOrAddHistory(scope.name);
+				history.vertexInvocations[m_HistoryOffset] += statistics[scope.statisticsQuery * 2 + 0];
+				history.fragmentInvocations[m_HistoryOffset] += statistics[scope.statisticsQuery * 2 + 1];
+			}
+		}
+	}
+
+	for (const auto& [name, milliseconds] : m_ImmediateTotals)
+	{
+		findOrAddHistory(name).milliseconds[m_HistoryOffset] += milliseconds;
+	}
+	m_ImmediateTotals.clear();
+
+	for (const std::string& name : m_ScopeOrder)
+	{
+		ScopeHistory& history = m_History[name];
+		history.average = history.average * 0.95f + history.milliseconds[m_HistoryOffset] * 0.05f;
+	}
+
+	m_HistoryOffset = (m_HistoryOffset + 1) % HISTORY_SIZE;
+	m_FrameNumber++;
+
+	frame.scopes.clear();
+	frame.openScopes.clear();
+	frame.timestampCount = 0;
+	frame.statisticsCount = 0;
+}
+
+void GpuProfiler::resetQueries(VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	if (!m_Enabled)
+		return;
+
+	FrameQueries& frame = m_Frames[currentFrame];
+	vkCmdResetQueryPool(commandBuffer, frame.timestampPool, 0, MAX_SCOPES * 2);
+	if (frame.statisticsPool != VK_NULL_HANDLE)
+		vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, MAX_SCOPES);
+}
+
+void GpuProfiler::beginScope(VkCommandBuffer commandBuffer, uint32_t currentFrame, const std::string& name)
+{
+	if (!m_Enabled)
+		return;
+
+	FrameQueries& frame = m_Frames[currentFrame];
+	if (frame.scopes.size() >= MAX_SCOPES)
+	{
+		//Keeps endScope balanced
+		frame.openScopes.push_back(UINT32_MAX);
+		return;
+	}
+
+	Scope scope{};
+	scope.name = name;
+	scope.startQuery = frame.timestampCount++;
+	scope.endQuery = frame.timestampCount++;
+	scope.statisticsQuery = -1;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.timestampPool, scope.startQuery);
+
+	//Statistics queries can't nest, only the outermost scope gets one
+	if (m_CollectPipelineStatistics && m_StatisticsSupported && frame.openScopes.empty())
+	{
+		scope.statisticsQuery = static_cast<int32_t>(frame.statisticsCount++);
+		vkCmdBeginQuery(commandBuffer, frame.statisticsPool, scope.statisticsQuery, 0);
+	}
+
+	frame.openScopes.push_back(static_cast<uint32_t>(frame.scopes.size()));
+	frame.scopes.push_back(scope);
+}
+
+void GpuProfiler::endScope(VkCommandBuffer commandBuffer, uint32_t currentFrame)
+{
+	if (!m_Enabled)
+		return;
+
+	FrameQueries& frame = m_Frames[currentFrame];
+	if (frame.openScopes.empty())
+		return;
+
+	uint32_t index = frame.openScopes.back();
+	frame.openScopes.pop_back();
+	if (index == UINT32_MAX)
+		return;
+
+	const Scope& scope = frame.scopes[index];
+	if (scope.statisticsQuery >= 0)
+		vkCmdEndQuery(commandBuffer, frame.statisticsPool, scope.statisticsQuery);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.timestampPool, scope.endQuery);
+}
+
+void GpuProfiler::beginImmediateScope(VkCommandBuffer commandBuffer)
+{
+	if (!m_Enabled)
+		return;
+
+	vkCmdResetQueryPool(commandBuffer, m_ImmediatePool, 0, 2);
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_ImmediatePool, 0);
+}
+
+void GpuProfiler::endImmediateScope(VkCommandBuffer commandBuffer)
+{
+	if (!m_Enabled)
+		return;
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_ImmediatePool, 1);
+}
+
+void GpuProfiler::resolveImmediateScope(const std::string& name)
+{
+	if (!m_Enabled)
+		return;
+
+	uint64_t timestamps[2];
+	if (vkGetQueryPoolResults(m_Device, m_ImmediatePool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS)
+		return;
+
+	uint64_t ticks = (timestamps[1] & m_TimestampMask) - (timestamps[0] & m_TimestampMask);
+	m_ImmediateTotals[name] += static_cast<float>(ticks * m_TimestampPeriod / 1000000.0);
+}
+
+bool GpuProfiler::exportCsv(const std::string& filename)
+{
+	std::ofstream file(filename);
+	if (!file.is_open())
+		return false;
+
+	file << "frame";
+	for (const std::string& name : m_ScopeOrder)
+	{
+		file << "," << name << " (ms)";
+		if (m_StatisticsSupported)
+			file << "," << name << " vertex invocations," << name << " fragment invocations";
+	}
+	file << "\n";
+
+	uint32_t rowCount = static_cast<uint32_t>(std::min<uint64_t>(m_FrameNumber, HISTORY_SIZE));
+	for (uint32_t row = 0; row < rowCount; row++)
+	{
+		uint32_t index = (m_HistoryOffset + HISTORY_SIZE - rowCount + row) % HISTORY_SIZE;
+		file << (m_FrameNumber - rowCount + row);
+		for (const std::string& name : m_ScopeOrder)
+		{
+			ScopeHistory& history = m_History[name];
+			file << "," << history.milliseconds[index];
+			if (m_StatisticsSupported)
+				file << "," << history.vertexInvocations[index] << "," << history.fragmentInvocations[index];
+		}
+		file << "\n";
+	}
+	return file.good();
+}
+
+float GpuProfiler::getLatestMilliseconds(const std::string& name)
+{
+	auto itr = m_History.find(name);
+	if (itr == m_History.end())
+		return 0.0f;
+
+	return itr->second.milliseconds[(m_HistoryOffset + HISTORY_SIZE - 1) % HISTORY_SIZE];
+}
+
+GpuProfiler::ScopeHistory& GpuProfiler::findOrAddHistory(const std::string& name)
+{
+	auto itr = m_History.find(name);
+	if (itr != m_History.end())
+		return itr->second;
+
+	m_ScopeOrder.push_back(name);
+	return m_History[name];
+}
+
+void GpuProfiler::profilerGui(std::vector<void*> classInstances)
+{
+	GpuProfiler* profiler = (GpuProfiler*)classInstances.at(0);
+	DevTools::newDock("GPU-Profiler");
+
+	if (!profiler->m_Enabled)
+	{
+		DevTools::coloredText(glm::vec3(0.9, 0.3, 0.3), "Timestamp queries are not supported on this queue");
+		DevTools::endDock();
+		return;
+	}
+
+	if (profiler->m_StatisticsSupported)
+		DevTools::checkbox("Pipeline Statistics", &profiler->m_CollectPipelineStatistics);
+
+	uint32_t newest = (profiler->m_HistoryOffset + HISTORY_SIZE - 1) % HISTORY_SIZE;
+	for (const std::string& name : profiler->m_ScopeOrder)
+	{
+		ScopeHistory& history = profiler->m_History[name];
+		DevTools::plotLines(name, history.milliseconds, profiler->m_HistoryOffset, name + ": " + std::to_string(history.average) + " ms");
+
+		if (profiler->m_CollectPipelineStatistics && history.vertexInvocations[newest] > 0)
+		{
+			DevTools::text("  Vertex invocations: " + std::to_string(history.vertexInvocations[newest]));
+			DevTools::text("  Fragment invocations: " + std::to_string(history.fragmentInvocations[newest]));
+		}
+	}
+
+	if (DevTools::button("Export CSV"))
+	{
+		if (profiler->exportCsv("gpu_profile.csv"))
+			std::cout << "GPU profile written to gpu_profile.csv" << std::endl;
+	}
+	DevTools::endDock();
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+/*
+-------------GPU Profiler----------------
+
+Timestamp (and optionally pipeline statistics) queries around named scopes.
+Every frame in flight has its own query pools, results are read back when that frame's fence has signaled,
+so they are max_frames_in_flight frames late and never stall the CPU.
+
+Per frame usage:
+	newFrame(frame)			After the in flight fence wait, before any scope of that frame is recorded
+	resetQueries(cmd, frame)	First thing in the first command buffer submitted for the frame
+	beginScope / endScope		Anywhere outside a render pass, or inside one as long as both are in the same subpass
+
+Work submitted outside of the frame (uploads) uses the immediate scopes, resolved by the caller after its queue wait.
+*/
+class GpuProfiler
+{
+public:
+	static const uint32_t MAX_SCOPES = 32;
+	static const uint32_t HISTORY_SIZE = 240;
+
+	//! Ring buffers indexed with getHistoryOffset(), the oldest entry is at the offset
+	struct ScopeHistory
+	{
+		std::vector<float> milliseconds = std::vector<float>(HISTORY_SIZE, 0.0f);
+		std::vector<uint64_t> vertexInvocations = std::vector<uint64_t>(HISTORY_SIZE, 0);
+		std::vector<uint64_t> fragmentInvocations = std::vector<uint64_t>(HISTORY_SIZE, 0);
+		float average = 0.0f;
+	};
+
+public:
+	GpuProfiler() = default;
+
+	//! Pipeline statistics need the pipelineStatisticsQuery device feature to be enabled
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, int maxFramesInFlight);
+
+	void cleanup();
+
+	void newFrame(uint32_t currentFrame);
+	void resetQueries(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+	void beginScope(VkCommandBuffer commandBuffer, uint32_t currentFrame, const std::string& name);
+	void endScope(VkCommandBuffer commandBuffer, uint32_t currentFrame);
+
+	//! For single time command buffers, resolveImmediateScope must be called after the queue has finished them
+	void beginImmediateScope(VkCommandBuffer commandBuffer);
+	void endImmediateScope(VkCommandBuffer commandBuffer);
+	void resolveImmediateScope(const std::string& name);
+
+	bool exportCsv(const std::string& filename);
+
+	const std::vector<std::string>& getScopeNames()
+	{
+		return m_ScopeOrder;
+	}
+
+	ScopeHistory& getHistory(const std::string& name)
+	{
+		return m_History[name];
+	}
+
+	uint32_t getHistoryOffset()
+	{
+		return m_HistoryOffset;
+	}
+
+	//! Of the frame read back by the last newFrame, 0 when the scope didn't run
+	float getLatestMilliseconds(const std::string& name);
+
+	//! Sum of every scope of the frame read back by the last newFrame, immediate scopes excluded. Nested scopes count twice, the renderer has none
+	float getFrameMilliseconds()
+	{
+		return m_LastFrameMilliseconds;
+	}
+
+	bool isEnabled()
+	{
+		return m_Enabled;
+	}
+
+	//! Null until a profiler is initialized, lets upload code outside the frame report its timings
+	static GpuProfiler* get()
+	{
+		return s_Instance;
+	}
+
+	static void profilerGui(std::vector<void*> classInstances);
+
+public:
+	bool m_CollectPipelineStatistics = false;
+
+private:
+	struct Scope
+	{
+		std::string name;
+		uint32_t startQuery;
+		uint32_t endQuery;
+		int32_t statisticsQuery;//-1 when not collected
+	};
+
+	struct FrameQueries
+	{
+		VkQueryPool timestampPool = VK_NULL_HANDLE;
+		VkQueryPool statisticsPool = VK_NULL_HANDLE;
+		std::vector<Scope> scopes;
+		std::vector<uint32_t> openScopes;
+		uint32_t timestampCount = 0;
+		uint32_t statisticsCount = 0;
+	};
+
+	ScopeHistory& findOrAddHistory(const std::string& name);
+
+private:
+	static inline GpuProfiler* s_Instance = nullptr;
+
+	VkDevice m_Device = VK_NULL_HANDLE;
+	bool m_Enabled = false;
+	bool m_StatisticsSupported = false;
+	float m_TimestampPeriod = 1.0f;//Nanoseconds per tick
+	uint64_t m_TimestampMask = ~0ull;
+
+	std::vector<FrameQueries> m_Frames;
+
+	VkQueryPool m_ImmediatePool = VK_NULL_HANDLE;
+	std::unordered_map<std::string, float> m_ImmediateTotals;//Summed into the next frame's history
+
+	std::vector<std::string> m_ScopeOrder;
+	std::unordered_map<std::string, ScopeHistory> m_History;
+	uint32_t m_HistoryOffset = 0;
+	float m_LastFrameMilliseconds = 0.0f;
+	uint64_t m_FrameNumber = 0;
+};
@@ -0,0 +1,562 @@
+#include "HiZCuller.h"
+#include "Clever/WorldManager/Components/Component/Renderable.h"
+#include "Clever/Developer/DevTools.h"
+
+#include <fstream>
+#include <array>
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+
+void HiZCuller::init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator& allocator, ShaderManager& shaders, VkImageView depthImageView, VkExtent2D extent, std::vector<VkBuffer>& uniformBuffers, int maxFramesInFlight)
+{
+	m_Device = device;
+	m_PhysicalDevice = physicalDevice;
+	m_Allocator = &allocator;
+	m_Shaders = &shaders;
+	m_DepthImageView = depthImageView;
+	m_Extent = extent;
+	m_UniformBuffers = uniformBuffers;
+	m_MaxFramesInFlight = maxFramesInFlight;
+
+	createLayouts();
+	createPipelines();
+	createBuffers();
+	createPyramid();
+	createCullDescriptors();
+
+	DevTools::addDockFunction(cullingGui, { this });
+}
+
+void HiZCuller::recreate(VkImageView depthImageView, VkExtent2D extent, DeletionQueue& deletionQueue)
+{
+	m_DepthImageView = depthImageView;
+	m_Extent = extent;
+
+	//Frames still in flight sample the old pyramid
+	{
+		VkDevice device = m_Device;
+		VkDescriptorPool descriptorPool = m_PyramidDescriptorPool;
+		std::vector<VkImageView> mipViews = m_PyramidMipViews;
+		VkImageView view = m_PyramidView;
+		VkImage image = m_PyramidImage;
+		MemoryAllocator* allocator = m_Allocator;
+		MemoryAllocator::Allocation* memory = m_PyramidImageMemory;
+
+		deletionQueue.push([=]()
+			{
+				vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+				for (auto mipView : mipViews)
+					vkDestroyImageView(device, mipView, nullptr);
+				vkDestroyImageView(device, view, nullptr);
+				allocator->destroyImage(image, memory);
+			});
+
+		m_PyramidMipViews.clear();
+		m_PyramidMipExtents.clear();
+		m_PyramidDescriptorSets.clear();
+	}
+
+	createPyramid();
+
+	m_CullSetsStale.assign(m_MaxFramesInFlight, true);
+}
+
+void HiZCuller::updatePyramidBinding(uint32_t currentFrame)
+{
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = m_Sampler;
+	imageInfo.imageView = m_PyramidView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+	VkWriteDescriptorSet write{};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = m_CullDescriptorSets[currentFrame];
+	write.dstBinding = 4;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+}
+
+void HiZCuller::cleanup()
+{
+	destroyPyramid();
+
+	vkDestroyDescriptorPool(m_Device, m_CullDescriptorPool, nullptr);
+
+	for (int i = 0; i < m_MaxFramesInFlight; i++)
+	{
+		m_Allocator->destroyBuffer(m_InstanceBuffers[i], m_InstanceBuffersMemory[i]);
+		m_Allocator->destroyBuffer(m_DrawBuffers[i], m_DrawBuffersMemory[i]);
+	}
+	m_Allocator->destroyBuffer(m_VisibilityBuffer, m_VisibilityBufferMemory);
+
+	vkDestroySampler(m_Device, m_Sampler, nullptr);
+	vkDestroyPipeline(m_Device, m_CullPipeline, nullptr);
+	vkDestroyPipeline(m_Device, m_PyramidPipeline, nullptr);
+}
+
+void HiZCuller::updateInstances(uint32_t currentFrame, Renderable* renderStart, uint32_t count)
+{
+	GPUInstance* gpuInstances = static_cast<GPUInstance*>(m_InstanceBuffersMapped[currentFrame]);
+
+	m_DrawOffsets.resize(count);
+	m_DrawCounts.resize(count);
+	m_DrawRanges.resize(count);
+
+	uint32_t instanceCount = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Renderable* renderData = (renderStart + (int)i);
+		std::vector<PushConstants>& instances = renderData->pipelineInfo.instances;
+
+		uint32_t drawCount = std::min(static_cast<uint32_t>(instances.size()), MAX_INSTANCES - instanceCount);
+		if (drawCount < instances.size())
+			std::cerr << "HiZCuller: instance limit reached, " << instances.size() - drawCount << " instances will not be drawn" << std::endl;
+
+		GeometryBuffer::MeshRange range = renderData->meshData.getRange();
+		m_DrawOffsets[i] = instanceCount;
+		m_DrawCounts[i] = drawCount;
+		m_DrawRanges[i] = range;
+		VertexFormats::Dequantization dequantization = renderData->meshData.getDequantization();
+
+		for (uint32_t x = 0; x < drawCount; x++)
+		{
+			GPUInstance& instance = gpuInstances[instanceCount + x];
+			instance.model = instances[x].model;
+			instance.boundingSphere = renderData->meshData.getBoundingSphere();
+			instance.indexCount = range.indexCount;
+			instance.firstIndex = range.firstIndex;
+			instance.vertexOffset = range.vertexOffset;
+			instance.materialIndex = instances[x].material;
+			instance.positionScale = glm::vec4(dequantization.scale, 0.0f);
+			instance.positionOffset = glm::vec4(dequantization.offset, 0.0f);
+		}
+		instanceCount += drawCount;
+	}
+	m_InstanceCount = instanceCount;
+}
+
+void HiZCuller::cull(VkCommandBuffer commandBuffer, uint32_t currentFrame, Phase phase)
+{
+	//This frame's fence has signaled so its set is no longer in use
+	if (currentFrame < m_CullSetsStale.size() && m_CullSetsStale[currentFrame])
+	{
+		updatePyramidBinding(currentFrame);
+		m_CullSetsStale[currentFrame] = false;
+	}
+
+	if (!m_VisibilityCleared)
+	{
+		//Nothing was visible before the first frame, the late phase will pick everything up
+		vkCmdFillBuffer(commandBuffer, m_VisibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+		m_VisibilityCleared = true;
+
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	if (m_InstanceCount > 0)
+	{
+		CullConstants constants{};
+		constants.instanceCount = m_InstanceCount;
+		constants.phase = static_cast<uint32_t>(phase);
+		constants.occlusionEnabled = m_OcclusionEnabled ? 1 : 0;
+		constants.hiZLevels = m_PyramidLevels;
+		constants.hiZSize = glm::vec2(m_Extent.width, m_Extent.height);
+		constants.drawOffset = static_cast<uint32_t>(phase) * MAX_INSTANCES;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineLayout, 0, 1, &m_CullDescriptorSets[currentFrame], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_CullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+		vkCmdDispatch(commandBuffer, (m_InstanceCount + 63) / 64, 1, 1);
+	}
+}
+
+void HiZCuller::buildPyramid(VkCommandBuffer commandBuffer)
+{
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PyramidPipeline);
+
+	for (uint32_t level = 0; level < m_PyramidLevels; level++)
+	{
+		VkExtent2D srcExtent = level == 0 ? m_Extent : m_PyramidMipExtents[level - 1];
+		VkExtent2D dstExtent = m_PyramidMipExtents[level];
+
+		PyramidConstants constants{};
+		constants.srcSize = glm::ivec2(srcExtent.width, srcExtent.height);
+		constants.dstSize = glm::ivec2(dstExtent.width, dstExtent.height);
+
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PyramidPipelineLayout, 0, 1, &m_PyramidDescriptorSets[level], 0, nullptr);
+		vkCmdPushConstants(commandBuffer, m_PyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidConstants), &constants);
+		vkCmdDispatch(commandBuffer, (dstExtent.width + 7) / 8, (dstExtent.height + 7) / 8, 1);
+
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = m_PyramidImage;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.baseMipLevel = level;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+
+		vkCmdPipelineBarrier(commandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+	}
+}
+
+void HiZCuller::cullingGui(std::vector<void*> classInstances)
+{
+	HiZCuller* culler = (HiZCuller*)classInstances.at(0);
+	DevTools::newDock("Culling");
+	DevTools::checkbox("Occlusion Culling", &culler->m_OcclusionEnabled);
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Instances: " + std::to_string(culler->m_InstanceCount));
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Pyramid: " + std::to_string(culler->m_Extent.width) + "x" + std::to_string(culler->m_Extent.height) + ", " + std::to_string(culler->m_PyramidLevels) + " levels");
+	DevTools::endDock();
+}
+
+void HiZCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocator::Allocation*& bufferMemory)
+{
+	bufferMemory = m_Allocator->createBuffer(size, usage, properties, buffer);
+}
+
+VkPipeline HiZCuller::createComputePipeline(const std::string& file, VkPipelineLayout layout)
+{
+	VkShaderModule shaderModule = m_Shaders->getModule(file);
+
+	VkComputePipelineCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	info.stage.module = shaderModule;
+	info.stage.pName = "main";
+	info.layout = layout;
+
+	VkPipeline pipeline;
+	if (vkCreateComputePipelines(m_Device, VK_NULL_HANDLE, 1, &info, nullptr, &pipeline) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create Compute Pipeline: " + file);
+	}
+	return pipeline;
+}
+
+void HiZCuller::createLayouts()
+{
+	//Set and Pipeline Layouts, reflected from the shaders and owned by the ShaderManager
+	{
+		ShaderManager::PipelineLayout cull = m_Shaders->getPipelineLayout({ "cull.comp" });
+		m_CullSetLayout = cull.setLayouts.at(0);
+		m_CullPipelineLayout = cull.layout;
+
+		ShaderManager::PipelineLayout pyramid = m_Shaders->getPipelineLayout({ "hiz.comp" });
+		m_PyramidSetLayout = pyramid.setLayouts.at(0);
+		m_PyramidPipelineLayout = pyramid.layout;
+
+		//The structs are pushed whole, a shader that declares less would make every push overrun its range
+		if (m_Shaders->getReflection("cull.comp").pushConstantSize != sizeof(CullConstants))
+			throw std::runtime_error("cull.comp's push constants don't match CullConstants!");
+		if (m_Shaders->getReflection("hiz.comp").pushConstantSize != sizeof(PyramidConstants))
+			throw std::runtime_error("hiz.comp's push constants don't match PyramidConstants!");
+	}
+
+	//Sampler, only texelFetch is used but combined image samplers still need one
+	{
+		VkSamplerCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+		info.magFilter = VK_FILTER_NEAREST;
+		info.minFilter = VK_FILTER_NEAREST;
+		info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+		info.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		info.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		info.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+		info.minLod = 0.0f;
+		info.maxLod = VK_LOD_CLAMP_NONE;
+
+		if (vkCreateSampler(m_Device, &info, nullptr, &m_Sampler) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Pyramid Sampler!");
+		}
+	}
+}
+
+void HiZCuller::createPipelines()
+{
+	m_CullPipeline = createComputePipeline("cull.comp", m_CullPipelineLayout);
+	m_PyramidPipeline = createComputePipeline("hiz.comp", m_PyramidPipelineLayout);
+}
+
+void HiZCuller::reloadPipelines(const std::vector<std::string>& files, DeletionQueue& deletionQueue)
+{
+	auto reload = [&](const std::string& file, VkPipelineLayout layout, VkPipeline& pipeline)
+		{
+			if (std::find(files.begin(), files.end(), file) == files.end())
+				return;
+
+			try
+			{
+				VkPipeline rebuilt = createComputePipeline(file, layout);
+				VkDevice device = m_Device;
+				VkPipeline old = pipeline;
+				deletionQueue.push([=]()
+					{
+						vkDestroyPipeline(device, old, nullptr);
+					});
+				pipeline = rebuilt;
+			}
+			catch (const std::exception& exception)
+			{
+				std::cerr << "HiZCuller: " << exception.what() << std::endl;
+			}
+		};
+
+	reload("cull.comp", m_CullPipelineLayout, m_CullPipeline);
+	reload("hiz.comp", m_PyramidPipelineLayout, m_PyramidPipeline);
+}
+
+void HiZCuller::createBuffers()
+{
+	m_InstanceBuffers.resize(m_MaxFramesInFlight);
+	m_InstanceBuffersMemory.resize(m_MaxFramesInFlight);
+	m_InstanceBuffersMapped.resize(m_MaxFramesInFlight);
+	m_DrawBuffers.resize(m_MaxFramesInFlight);
+	m_DrawBuffersMemory.resize(m_MaxFramesInFlight);
+
+	VkDeviceSize instanceSize = sizeof(GPUInstance) * MAX_INSTANCES;
+	VkDeviceSize drawSize = sizeof(VkDrawIndexedIndirectCommand) * MAX_INSTANCES * 2;
+
+	for (int i = 0; i < m_MaxFramesInFlight; i++)
+	{
+		createBuffer(instanceSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_InstanceBuffers[i], m_InstanceBuffersMemory[i]);
+		m_InstanceBuffersMapped[i] = m_InstanceBuffersMemory[i]->mapped;
+
+		createBuffer(drawSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DrawBuffers[i], m_DrawBuffersMemory[i]);
+	}
+
+	createBuffer(sizeof(uint32_t) * MAX_INSTANCES, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_VisibilityBuffer, m_VisibilityBufferMemory);
+}
+
+void HiZCuller::createCullDescriptors()
+{
+	//Descriptor Pool
+	{
+		std::array<VkDescriptorPoolSize, 3> sizes{};
+		sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		sizes[0].descriptorCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+		sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		sizes[1].descriptorCount = static_cast<uint32_t>(m_MaxFramesInFlight) * 3;
+		sizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		sizes[2].descriptorCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+
+		VkDescriptorPoolCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		info.poolSizeCount = static_cast<uint32_t>(sizes.size());
+		info.pPoolSizes = sizes.data();
+		info.maxSets = static_cast<uint32_t>(m_MaxFramesInFlight);
+
+		if (vkCreateDescriptorPool(m_Device, &info, nullptr, &m_CullDescriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Cull Descriptor Pool");
+		}
+	}
+
+	//Descriptor Sets
+	{
+		std::vector<VkDescriptorSetLayout> layouts(m_MaxFramesInFlight, m_CullSetLayout);
+		VkDescriptorSetAllocateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		info.descriptorPool = m_CullDescriptorPool;
+		info.descriptorSetCount = static_cast<uint32_t>(m_MaxFramesInFlight);
+		info.pSetLayouts = layouts.data();
+
+		m_CullDescriptorSets.resize(m_MaxFramesInFlight);
+
+		if (vkAllocateDescriptorSets(m_Device, &info, m_CullDescriptorSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Cull Descriptor Sets");
+		}
+	}
+
+	for (int i = 0; i < m_MaxFramesInFlight; i++)
+	{
+		std::array<VkDescriptorBufferInfo, 4> bufferInfos{};
+		bufferInfos[0] = { m_UniformBuffers[i], 0, VK_WHOLE_SIZE };
+		bufferInfos[1] = { m_InstanceBuffers[i], 0, VK_WHOLE_SIZE };
+		bufferInfos[2] = { m_VisibilityBuffer, 0, VK_WHOLE_SIZE };
+		bufferInfos[3] = { m_DrawBuffers[i], 0, VK_WHOLE_SIZE };
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.sampler = m_Sampler;
+		imageInfo.imageView = m_PyramidView;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 5> writes{};
+		for (uint32_t binding = 0; binding < writes.size(); binding++)
+		{
+			writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[binding].dstSet = m_CullDescriptorSets[i];
+			writes[binding].dstBinding = binding;
+			writes[binding].descriptorCount = 1;
+		}
+		writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		writes[0].pBufferInfo = &bufferInfos[0];
+		for (uint32_t binding = 1; binding < 4; binding++)
+		{
+			writes[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[binding].pBufferInfo = &bufferInfos[binding];
+		}
+		writes[4].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writes[4].pImageInfo = &imageInfo;
+
+		vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void HiZCuller::createPyramid()
+{
+	m_PyramidLevels = 1;
+	{
+		uint32_t size = std::max(m_Extent.width, m_Extent.height);
+		while (size > 1)
+		{
+			size >>= 1;
+			m_PyramidLevels++;
+		}
+	}
+
+	//Image
+	{
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent.width = m_Extent.width;
+		imageInfo.extent.height = m_Extent.height;
+		imageInfo.extent.depth = 1;
+		imageInfo.mipLevels = m_PyramidLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = VK_FORMAT_R32_SFLOAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		m_PyramidImageMemory = m_Allocator->createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_PyramidImage);
+	}
+
+	//Views, one for the whole chain that culling samples and one per level for building
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_PyramidImage;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = m_PyramidLevels;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if (vkCreateImageView(m_Device, &viewInfo, nullptr, &m_PyramidView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create Hi-Z image view!");
+		}
+
+		m_PyramidMipViews.resize(m_PyramidLevels);
+		m_PyramidMipExtents.resize(m_PyramidLevels);
+		for (uint32_t level = 0; level < m_PyramidLevels; level++)
+		{
+			viewInfo.subresourceRange.baseMipLevel = level;
+			viewInfo.subresourceRange.levelCount = 1;
+
+			if (vkCreateImageView(m_Device, &viewInfo, nullptr, &m_PyramidMipViews[level]) != VK_SUCCESS) {
+				throw std::runtime_error("failed to create Hi-Z mip view!");
+			}
+			m_PyramidMipExtents[level] = { std::max(1u, m_Extent.width >> level), std::max(1u, m_Extent.height >> level) };
+		}
+	}
+
+	//Descriptors, level 0 reads the depth buffer, every other level reads the one above it
+	{
+		std::array<VkDescriptorPoolSize, 2> sizes{};
+		sizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		sizes[0].descriptorCount = m_PyramidLevels;
+		sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		sizes[1].descriptorCount = m_PyramidLevels;
+
+		VkDescriptorPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+		poolInfo.poolSizeCount = static_cast<uint32_t>(sizes.size());
+		poolInfo.pPoolSizes = sizes.data();
+		poolInfo.maxSets = m_PyramidLevels;
+
+		if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_PyramidDescriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Pyramid Descriptor Pool");
+		}
+
+		std::vector<VkDescriptorSetLayout> layouts(m_PyramidLevels, m_PyramidSetLayout);
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_PyramidDescriptorPool;
+		allocInfo.descriptorSetCount = m_PyramidLevels;
+		allocInfo.pSetLayouts = layouts.data();
+
+		m_PyramidDescriptorSets.resize(m_PyramidLevels);
+		if (vkAllocateDescriptorSets(m_Device, &allocInfo, m_PyramidDescriptorSets.data()) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate Pyramid Descriptor Sets");
+		}
+
+		for (uint32_t level = 0; level < m_PyramidLevels; level++)
+		{
+			VkDescriptorImageInfo srcInfo{};
+			srcInfo.sampler = m_Sampler;
+			srcInfo.imageView = level == 0 ? m_DepthImageView : m_PyramidMipViews[level - 1];
+			srcInfo.imageLayout = level == 0 ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+			VkDescriptorImageInfo dstInfo{};
+			dstInfo.imageView = m_PyramidMipViews[level];
+			dstInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+			std::array<VkWriteDescriptorSet, 2> writes{};
+			writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[0].dstSet = m_PyramidDescriptorSets[level];
+			writes[0].dstBinding = 0;
+			writes[0].descriptorCount = 1;
+			writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			writes[0].pImageInfo = &srcInfo;
+			writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[1].dstSet = m_PyramidDescriptorSets[level];
+			writes[1].dstBinding = 1;
+			writes[1].descriptorCount = 1;
+			writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+			writes[1].pImageInfo = &dstInfo;
+
+			vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		}
+	}
+}
+
+void HiZCuller::destroyPyramid()
+{
+	vkDestroyDescriptorPool(m_Device, m_PyramidDescriptorPool, nullptr);
+	for (auto view : m_PyramidMipViews)
+		vkDestroyImageView(m_Device, view, nullptr);
+	vkDestroyImageView(m_Device, m_PyramidView, nullptr);
+	m_Allocator->destroyImage(m_PyramidImage, m_PyramidImageMemory);
+
+	m_PyramidMipViews.clear();
+	m_PyramidMipExtents.clear();
+	m_PyramidDescriptorSets.clear();
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+
+#include <glm.hpp>
+
+#include "Initilizers/HelperFunctions.h"
+#include "DeletionQueue.h"
+#include "MemoryAllocator.h"
+#include "GeometryBuffer.h"
+#include "ShaderManager.h"
+
+struct Renderable;
+
+//! Matches the Instance struct in cull.comp and shader.vert (std430)
+struct GPUInstance
+{
+	glm::mat4 model;
+	glm::vec4 boundingSphere;//xyz = center in model space, w = radius
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t materialIndex;//Into the MaterialBuffer, Material::NO_MATERIAL for none
+	glm::vec4 positionScale;//Dequantization of the mesh's vertex format, identity for Float
+	glm::vec4 positionOffset;
+};
+
+/*
+-------------Hierarchical-Z Occlusion Culling----------------
+
+Two phase GPU culling, every instance gets one indirect draw command:
+	Early: Draws what was visible last frame (frustum tested).
+	Pyramid: The depth of the early draw is reduced into a max depth mip chain.
+	Late: Every instance is tested against the pyramid, anything visible that was not drawn in the early pass is drawn now.
+		  The result becomes the visible set for the next frame.
+*/
+class HiZCuller
+{
+public:
+	enum class Phase
+	{
+		Early = 0,
+		Late = 1
+	};
+
+	//! Instance and draw buffers are never reallocated so descriptor sets that point at them stay valid
+	static const uint32_t MAX_INSTANCES = 1 << 16;
+
+public:
+	HiZCuller() = default;
+
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator& allocator, ShaderManager& shaders, VkImageView depthImageView, VkExtent2D extent, std::vector<VkBuffer>& uniformBuffers, int maxFramesInFlight);
+
+	//! The old pyramid is retired through the deletion queue, each frame's cull set is repointed the next time that frame culls
+	void recreate(VkImageView depthImageView, VkExtent2D extent, DeletionQueue& deletionQueue);
+
+	//! files are what ShaderManager::update() returned, the replaced pipelines are retired through the deletion queue
+	void reloadPipelines(const std::vector<std::string>& files, DeletionQueue& deletionQueue);
+
+	void cleanup();
+
+	//! Gathers every instance of every renderable into this frames instance buffer, must be called before cull
+	void updateInstances(uint32_t currentFrame, Renderable* renderStart, uint32_t count);
+
+	//! Barriers against other passes come from the render graph. Reads the visibility buffer and pyramid (GENERAL),
+	//! writes this frame's draw buffer, the late phase also writes the visibility buffer.
+	void cull(VkCommandBuffer commandBuffer, uint32_t currentFrame, Phase phase);
+
+	//! Depth has to be in VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, the pyramid in GENERAL (its contents are discarded)
+	void buildPyramid(VkCommandBuffer commandBuffer);
+
+	std::vector<VkBuffer>& getInstanceBuffers()
+	{
+		return m_InstanceBuffers;
+	}
+
+	VkBuffer getDrawBuffer(uint32_t currentFrame)
+	{
+		return m_DrawBuffers[currentFrame];
+	}
+
+	VkBuffer getVisibilityBuffer()
+	{
+		return m_VisibilityBuffer;
+	}
+
+	VkImage getPyramidImage()
+	{
+		return m_PyramidImage;
+	}
+
+	//! Byte offset of the first draw command of a renderable in the given phase
+	VkDeviceSize getDrawOffset(uint32_t renderableIndex, Phase phase)
+	{
+		return (static_cast<VkDeviceSize>(phase) * MAX_INSTANCES + m_DrawOffsets[renderableIndex]) * sizeof(VkDrawIndexedIndirectCommand);
+	}
+
+	//! Number of instances of a renderable that got a draw command this frame
+	uint32_t getDrawCount(uint32_t renderableIndex)
+	{
+		return m_DrawCounts[renderableIndex];
+	}
+
+	//! Geometry ranges the renderable's draw commands were built from, a compaction later in the frame doesn't change them
+	GeometryBuffer::MeshRange& getDrawRange(uint32_t renderableIndex)
+	{
+		return m_DrawRanges[renderableIndex];
+	}
+
+	static void cullingGui(std::vector<void*> classInstances);
+
+public:
+	bool m_OcclusionEnabled = true;
+
+private:
+	struct CullConstants
+	{
+		uint32_t instanceCount;
+		uint32_t phase;
+		uint32_t occlusionEnabled;
+		uint32_t hiZLevels;
+		glm::vec2 hiZSize;
+		uint32_t drawOffset;
+		uint32_t padding;
+	};
+
+	struct PyramidConstants
+	{
+		glm::ivec2 srcSize;
+		glm::ivec2 dstSize;
+	};
+
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocator::Allocation*& bufferMemory);
+	//! file is relative to the shader directory
+	VkPipeline createComputePipeline(const std::string& file, VkPipelineLayout layout);
+
+	void createLayouts();
+	void createPipelines();
+	void createBuffers();
+	void createCullDescriptors();
+
+	void createPyramid();
+	void destroyPyramid();
+	void updatePyramidBinding(uint32_t currentFrame);
+
+private:
+	VkDevice m_Device = VK_NULL_HANDLE;
+	VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+	MemoryAllocator* m_Allocator = nullptr;
+	ShaderManager* m_Shaders = nullptr;
+	std::vector<VkBuffer> m_UniformBuffers;
+	int m_MaxFramesInFlight = 0;
+
+	VkImageView m_DepthImageView = VK_NULL_HANDLE;
+	VkExtent2D m_Extent = {};
+
+	//Pipelines
+	//Reflected from the shaders, owned by the ShaderManager
+	VkDescriptorSetLayout m_CullSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout m_PyramidSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_CullPipelineLayout = VK_NULL_HANDLE;
+	VkPipelineLayout m_PyramidPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline m_CullPipeline = VK_NULL_HANDLE;
+	VkPipeline m_PyramidPipeline = VK_NULL_HANDLE;
+	VkSampler m_Sampler = VK_NULL_HANDLE;
+
+	//Buffers
+	std::vector<VkBuffer> m_InstanceBuffers;
+	std::vector<MemoryAllocator::Allocation*> m_InstanceBuffersMemory;
+	std::vector<void*> m_InstanceBuffersMapped;
+
+	std::vector<VkBuffer> m_DrawBuffers;
+	std::vector<MemoryAllocator::Allocation*> m_DrawBuffersMemory;
+
+	VkBuffer m_VisibilityBuffer = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation* m_VisibilityBufferMemory = nullptr;
+	bool m_VisibilityCleared = false;
+
+	VkDescriptorPool m_CullDescriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> m_CullDescriptorSets;
+	std::vector<bool> m_CullSetsStale;//Still point at a retired pyramid
+
+	//Pyramid, recreated with the swapchain
+	VkImage m_PyramidImage = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation* m_PyramidImageMemory = nullptr;
+	VkImageView m_PyramidView = VK_NULL_HANDLE;
+	std::vector<VkImageView> m_PyramidMipViews;
+	std::vector<VkExtent2D> m_PyramidMipExtents;
+	uint32_t m_PyramidLevels = 0;
+
+	VkDescriptorPool m_PyramidDescriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> m_PyramidDescriptorSets;
+
+	//Per frame bookkeeping, indexed by renderable
+	uint32_t m_InstanceCount = 0;
+	std::vector<uint32_t> m_DrawOffsets;
+	std::vector<uint32_t> m_DrawCounts;
+	std::vector<GeometryBuffer::MeshRange> m_DrawRanges;
+};
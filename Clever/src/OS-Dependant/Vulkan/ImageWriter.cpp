@@ -0,0 +1,153 @@
+#include "ImageWriter.h"
+
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+namespace ImageWriter
+{
+	static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0)
+	{
+		static uint32_t table[256];
+		static bool tableReady = false;
+		if (!tableReady)
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				table[i] = c;
+			}
+			tableReady = true;
+		}
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return ~crc;
+	}
+
+	static void pushBigEndian(std::vector<uint8_t>& out, uint32_t value)
+	{
+		out.push_back(static_cast<uint8_t>(value >> 24));
+		out.push_back(static_cast<uint8_t>(value >> 16));
+		out.push_back(static_cast<uint8_t>(value >> 8));
+		out.push_back(static_cast<uint8_t>(value));
+	}
+
+	static void writeChunk(std::ofstream& file, const char type[4], const std::vector<uint8_t>& data)
+	{
+		std::vector<uint8_t> chunk;
+		chunk.reserve(data.size() + 12);
+		pushBigEndian(chunk, static_cast<uint32_t>(data.size()));
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		pushBigEndian(chunk, crc32(chunk.data() + 4, data.size() + 4));
+
+		file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+	}
+
+	bool writeImage(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* pixels)
+	{
+		if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".png") == 0)
+			return writePNG(filename, width, height, pixels);
+		return writePPM(filename, width, height, pixels);
+	}
+
+	bool writePPM(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* pixels)
+	{
+		std::ofstream file(filename, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		file << "P6\n" << width << " " << height << "\n255\n";
+
+		std::vector<uint8_t> row(width * 3);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const uint8_t* src = pixels + static_cast<size_t>(y) * width * 4;
+			for (uint32_t x = 0; x < width; x++)
+			{
+				row[x * 3 + 0] = src[x * 4 + 2];
+				row[x * 3 + 1] = src[x * 4 + 1];
+				row[x * 3 + 2] = src[x * 4 + 0];
+			}
+			file.write(reinterpret_cast<const char*>(row.data()), row.size());
+		}
+		return file.good();
+	}
+
+	bool writePNG(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* pixels)
+	{
+		std::ofstream file(filename, std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+		//IHDR, 8 bit RGB
+		{
+			std::vector<uint8_t> header;
+			pushBigEndian(header, width);
+			pushBigEndian(header, height);
+			header.push_back(8);
+			header.push_back(2);
+			header.push_back(0);
+			header.push_back(0);
+			header.push_back(0);
+			writeChunk(file, "IHDR", header);
+		}
+
+		//Raw scanlines, each starts with filter type 0
+		std::vector<uint8_t> raw;
+		raw.reserve(static_cast<size_t>(height) * (width * 3 + 1));
+		for (uint32_t y = 0; y < height; y++)
+		{
+			const uint8_t* src = pixels + static_cast<size_t>(y) * width * 4;
+			raw.push_back(0);
+			for (uint32_t x = 0; x < width; x++)
+			{
+				raw.push_back(src[x * 4 + 2]);
+				raw.push_back(src[x * 4 + 1]);
+				raw.push_back(src[x * 4 + 0]);
+			}
+		}
+
+		//IDAT, zlib stream made of stored deflate blocks
+		{
+			std::vector<uint8_t> zlib;
+			zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+			zlib.push_back(0x78);
+			zlib.push_back(0x01);
+
+			size_t offset = 0;
+			do
+			{
+				uint16_t blockSize = static_cast<uint16_t>(std::min<size_t>(raw.size() - offset, 65535));
+				bool last = offset + blockSize == raw.size();
+				zlib.push_back(last ? 1 : 0);
+				zlib.push_back(static_cast<uint8_t>(blockSize));
+				zlib.push_back(static_cast<uint8_t>(blockSize >> 8));
+				zlib.push_back(static_cast<uint8_t>(~blockSize));
+				zlib.push_back(static_cast<uint8_t>(~blockSize >> 8));
+				zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+				offset += blockSize;
+			} while (offset < raw.size());
+
+			uint32_t a = 1, b = 0;
+			for (uint8_t byte : raw)
+			{
+				a = (a + byte) % 65521;
+				b = (b + a) % 65521;
+			}
+			pushBigEndian(zlib, (b << 16) | a);
+
+			writeChunk(file, "IDAT", zlib);
+		}
+
+		writeChunk(file, "IEND", {});
+		return file.good();
+	}
+}
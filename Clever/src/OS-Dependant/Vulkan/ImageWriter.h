@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+namespace ImageWriter
+{
+	//! pixels are tightly packed 8 bit BGRA rows, alpha is dropped
+	//! Picks the format from the extension, .png or .ppm
+	bool writeImage(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* pixels);
+
+	bool writePPM(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* pixels);
+
+	//! Uncompressed (stored deflate blocks), meant for regression captures not for size
+	bool writePNG(const std::string& filename, uint32_t width, uint32_t height, const uint8_t* pixels);
+}
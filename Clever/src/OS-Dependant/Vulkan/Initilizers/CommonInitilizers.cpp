@@ -10,7 +10,7 @@ namespace CVulkan
 		appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 		appInfo.pEngineName = "Clever";
 		appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-		appInfo.apiVersion = VK_API_VERSION_1_0;
+		appInfo.apiVersion = VK_API_VERSION_1_2;//1.2 for descriptor indexing
 
 		VkInstanceCreateInfo createInstanceInfo{};//Struct for creation of Instance, need to fill with required extensions when neccessary
 		createInstanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -39,7 +39,7 @@ namespace CVulkan
 		}
 	}
 	
-	void createPhysicalDevice(VkPhysicalDevice& physicalDevice, Helper::QueueFamilyIndicies& queueFamilyIndicies, VkInstance instance)
+	void createPhysicalDevice(VkPhysicalDevice& physicalDevice, Helper::QueueFamilyIndicies& queueFamilyIndicies, VkInstance instance, VkSurfaceKHR surface)
 	{
 		uint32_t physicalDeviceCount = 0;
 
@@ -60,7 +60,7 @@ namespace CVulkan
 		for (auto pDevice : possiblePhysicalDevices)
 		{
 			//! This fills queueFamilyProperties with Queue Family Properties. which each contain a queue type(s) and count.
-			Helper::QueueFamilyIndicies qfi = Helper::getPhysicalDeviceProperties(pDevice);
+			Helper::QueueFamilyIndicies qfi = Helper::getPhysicalDeviceProperties(pDevice, surface);
 			if (qfi.isComplete())
 			{
 				physicalDevice = pDevice;
@@ -75,7 +75,7 @@ namespace CVulkan
 		}
 	}
 
-	void createDevice(VkDevice* deviceHandle, VkPhysicalDevice physicalDevice, std::vector<const char*> desiredExtensions)
+	void createDevice(VkDevice* deviceHandle, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, std::vector<const char*> desiredExtensions)
 	{
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfo;
 
@@ -91,10 +91,14 @@ namespace CVulkan
 		bool graphicsQueue = false;
 		bool presentQueue = false;
 
-		Helper::QueueFamilyIndicies QFI = Helper::getPhysicalDeviceProperties(physicalDevice);
+		Helper::QueueFamilyIndicies QFI = Helper::getPhysicalDeviceProperties(physicalDevice, surface);
 
 		float queuePriority = 1.0f;
 		std::set<uint32_t> uniqueIndicies = { QFI.graphicsIndex.value(), QFI.presentIndex.value() };
+		if (QFI.computeIndex.has_value())
+			uniqueIndicies.insert(QFI.computeIndex.value());
+		if (QFI.transferIndex.has_value())
+			uniqueIndicies.insert(QFI.transferIndex.value());
 		for (auto index : uniqueIndicies)
 		{
 			VkDeviceQueueCreateInfo info{};
@@ -110,13 +114,62 @@ namespace CVulkan
 		deviceFeatures.fillModeNonSolid = true;
 		deviceFeatures.wideLines = true;
 
+		//Needed by the indirect draws the HiZCuller writes, firstInstance indexes the instance buffer so there is no fallback for it
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		if (!supportedFeatures.drawIndirectFirstInstance)
+		{
+			throw std::runtime_error("GPU does not support drawIndirectFirstInstance!");
+		}
+		deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+		deviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+
+		//Vertex/fragment invocation counts in the GpuProfiler
+		deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+
+		//Descriptor indexing for the bindless table in the DescriptorManager, timeline semaphores for the TransferManager
+		VkPhysicalDeviceVulkan12Features supported12Features{};
+		supported12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 supportedFeatures2{};
+		supportedFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		supportedFeatures2.pNext = &supported12Features;
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures2);
+
+		if (!supported12Features.descriptorIndexing || !supported12Features.runtimeDescriptorArray || !supported12Features.descriptorBindingPartiallyBound ||
+			!supported12Features.descriptorBindingStorageBufferUpdateAfterBind || !supported12Features.descriptorBindingSampledImageUpdateAfterBind)
+		{
+			throw std::runtime_error("GPU does not support descriptor indexing!");
+		}
+		if (!supported12Features.timelineSemaphore)
+		{
+			throw std::runtime_error("GPU does not support timeline semaphores!");
+		}
+
+		VkPhysicalDeviceVulkan12Features vulkan12Features{};
+		vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		vulkan12Features.descriptorIndexing = VK_TRUE;
+		vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+		vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+		vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+		vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+		vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = supported12Features.shaderStorageBufferArrayNonUniformIndexing;
+		vulkan12Features.shaderSampledImageArrayNonUniformIndexing = supported12Features.shaderSampledImageArrayNonUniformIndexing;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+
+		VkPhysicalDeviceFeatures2 deviceFeatures2{};
+		deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		deviceFeatures2.pNext = &vulkan12Features;
+		deviceFeatures2.features = deviceFeatures;
+
 		VkDeviceCreateInfo deviceCreateInfo{};
 		deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 		deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfo.size());
 		deviceCreateInfo.pQueueCreateInfos = queueCreateInfo.data();
-		deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
-		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(Constants::deviceExtensions.size());
-		deviceCreateInfo.ppEnabledExtensionNames = Constants::deviceExtensions.data();
+		deviceCreateInfo.pNext = &deviceFeatures2;
+		deviceCreateInfo.pEnabledFeatures = nullptr;
+		deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(desiredExtensions.size());
+		deviceCreateInfo.ppEnabledExtensionNames = desiredExtensions.data();
 		deviceCreateInfo.enabledLayerCount = static_cast<uint32_t>(Constants::validationLayers.size());
 		deviceCreateInfo.ppEnabledLayerNames = Constants::validationLayers.data();
 
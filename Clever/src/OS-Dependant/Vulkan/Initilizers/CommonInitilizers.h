@@ -11,7 +11,8 @@ namespace CVulkan
 
 	void createInstance(VkInstance* instanceHandle, const char** glfwExtensions, uint32_t glfwExtensionCount, std::vector<const char*> desiredExtensions = {});
 
-	void createPhysicalDevice(VkPhysicalDevice& physicalDevice, Helper::QueueFamilyIndicies& queueFamilyIndicies, VkInstance instance);
+	//! surface decides the present family, VK_NULL_HANDLE when headless
+	void createPhysicalDevice(VkPhysicalDevice& physicalDevice, Helper::QueueFamilyIndicies& queueFamilyIndicies, VkInstance instance, VkSurfaceKHR surface);
 
-	void createDevice(VkDevice* deviceHandle, VkPhysicalDevice physicalDevice, std::vector<const char*> desiredExtensions = {});
+	void createDevice(VkDevice* deviceHandle, VkPhysicalDevice physicalDevice, VkSurfaceKHR surface, std::vector<const char*> desiredExtensions = {});
 }
\ No newline at end of file
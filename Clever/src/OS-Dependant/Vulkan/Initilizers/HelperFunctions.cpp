@@ -2,7 +2,7 @@
 
 namespace Helper
 {
-	Helper::QueueFamilyIndicies getPhysicalDeviceProperties(VkPhysicalDevice physicalDevice)
+	Helper::QueueFamilyIndicies getPhysicalDeviceProperties(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface)
 	{
 		uint32_t queueFamilyPropertyCount = 0;
 		std::vector<VkQueueFamilyProperties> queueFamilyProperties;
@@ -26,12 +26,38 @@ namespace Helper
 			{
 				queueFamilyIndicies.graphicsIndex = i;
 			}
-			if (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)
+			if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !queueFamilyIndicies.computeIndex.has_value())
 			{
-				queueFamilyIndicies.presentIndex = i;
+				queueFamilyIndicies.computeIndex = i;
+			}
+			//Graphics and compute families can transfer too, only a family that does nothing else is worth a queue of its own
+			if ((queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) && !queueFamilyIndicies.transferIndex.has_value())
+			{
+				queueFamilyIndicies.transferIndex = i;
 			}
 			i++;
 		}
+
+		//! Finding Present Family
+		if (surface == VK_NULL_HANDLE)
+		{
+			//Headless, nothing is presented so the graphics queue stands in
+			queueFamilyIndicies.presentIndex = queueFamilyIndicies.graphicsIndex;
+		}
+		else
+		{
+			//The graphics family is preferred so the swapchain images don't need to be shared
+			for (uint32_t family = 0; family < queueFamilyPropertyCount; family++)
+			{
+				VkBool32 presentSupport = VK_FALSE;
+				vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, family, surface, &presentSupport);
+				if (!presentSupport)
+					continue;
+
+				if (!queueFamilyIndicies.presentIndex.has_value() || family == queueFamilyIndicies.graphicsIndex)
+					queueFamilyIndicies.presentIndex = family;
+			}
+		}
 		return queueFamilyIndicies;
 	}
 
@@ -42,4 +68,18 @@ namespace Helper
 		createInfo.messageType = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
 		createInfo.pfnUserCallback = debugCallback;
 	}
+
+	uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+	{
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+		for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+				return i;
+			}
+		}
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
 }
\ No newline at end of file
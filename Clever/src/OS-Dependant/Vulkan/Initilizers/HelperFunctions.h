@@ -19,7 +19,10 @@ namespace Helper
 		return false;
 	}
 
-	Helper::QueueFamilyIndicies getPhysicalDeviceProperties(VkPhysicalDevice physicalDevice);
+	//! Without a surface (headless) the present family is the graphics family
+	Helper::QueueFamilyIndicies getPhysicalDeviceProperties(VkPhysicalDevice physicalDevice, VkSurfaceKHR surface = VK_NULL_HANDLE);
 
 	void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
+
+	uint32_t findMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 }
\ No newline at end of file
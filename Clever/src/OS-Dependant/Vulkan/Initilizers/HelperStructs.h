@@ -7,6 +7,8 @@ namespace Helper
 	{
 		std::optional<uint32_t> graphicsIndex;
 		std::optional<uint32_t> presentIndex;
+		std::optional<uint32_t> computeIndex;//Compute without graphics, for async compute. Empty when the GPU has none
+		std::optional<uint32_t> transferIndex;//Transfer only family, for uploads next to rendering. Empty when the GPU has none
 
 		bool isComplete()
 		{
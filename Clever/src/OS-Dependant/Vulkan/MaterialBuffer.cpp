@@ -0,0 +1,52 @@
+#include "MaterialBuffer.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <algorithm>
+
+void MaterialBuffer::init(MemoryAllocator& allocator, DescriptorManager& descriptors, DeletionQueue& deletionQueue)
+{
+	m_Allocator = &allocator;
+	m_Descriptors = &descriptors;
+	m_DeletionQueue = &deletionQueue;
+}
+
+void MaterialBuffer::cleanup()
+{
+	if (m_Buffer != VK_NULL_HANDLE)
+	{
+		m_Allocator->destroyBuffer(m_Buffer, m_Memory);
+		m_Descriptors->releaseStorageBuffer(m_Slot);
+	}
+	m_Buffer = VK_NULL_HANDLE;
+	m_Memory = nullptr;
+	m_Slot = DescriptorManager::INVALID_SLOT;
+	m_Count = 0;
+}
+
+void MaterialBuffer::upload(const MaterialCache::MaterialLibrary& materials)
+{
+	CLEVER_PROFILE_FUNCTION();
+
+	//Frames in flight keep reading the old buffer through the old slot until they are done
+	if (m_Buffer != VK_NULL_HANDLE)
+	{
+		m_Allocator->destroyBuffer(m_Buffer, m_Memory, *m_DeletionQueue);
+		DescriptorManager* descriptors = m_Descriptors;
+		uint32_t slot = m_Slot;
+		m_DeletionQueue->push([=]()
+			{
+				descriptors->releaseStorageBuffer(slot);
+			});
+	}
+
+	//Never empty, the slot always has a buffer behind it
+	VkDeviceSize size = sizeof(GPUMaterial) * std::max(materials.getCount(), 1u);
+	m_Memory = m_Allocator->createBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Buffer);
+
+	GPUMaterial* gpuMaterials = reinterpret_cast<GPUMaterial*>(m_Memory->mapped);
+	for (Material::MaterialId id = 0; id < materials.getCount(); id++)
+		gpuMaterials[id].color = glm::vec4(glm::vec3(materials.getRecord(id).color) / 255.0f, 1.0f);
+
+	m_Slot = m_Descriptors->registerStorageBuffer(m_Buffer);
+	m_Count = materials.getCount();
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+#include <glm.hpp>
+
+#include "MemoryAllocator.h"
+#include "DescriptorManager.h"
+#include "DeletionQueue.h"
+#include "Clever/Material/MaterialCache.h"
+
+//! std430, matches Material in material.glsl
+struct GPUMaterial
+{
+	glm::vec4 color;//rgb in [0,1], a is unused
+};
+
+/*
+-------------Material Buffer----------------
+
+Every material lives in one storage buffer in the bindless table. Instances carry the index of their material
+(GPUInstance::materialIndex) and the shaders fetch it from here, so changing an object's material only changes that
+index, draws don't bind anything per material and objects can be batched no matter what they are made of.
+
+upload() writes a new buffer instead of the one frames in flight are reading, the old buffer and its slot are freed
+through the deletion queue. The slot and the material count reach the shaders through the UniformBufferObject.
+*/
+class MaterialBuffer
+{
+public:
+	MaterialBuffer() = default;
+
+	void init(MemoryAllocator& allocator, DescriptorManager& descriptors, DeletionQueue& deletionQueue);
+	//! The device must be idle
+	void cleanup();
+
+	//! Main thread. Replaces every material, indices are the library's ids
+	void upload(const MaterialCache::MaterialLibrary& materials);
+
+	//! DescriptorManager::INVALID_SLOT until the first upload
+	uint32_t getSlot()
+	{
+		return m_Slot;
+	}
+
+	uint32_t getCount()
+	{
+		return m_Count;
+	}
+
+private:
+	MemoryAllocator* m_Allocator = nullptr;
+	DescriptorManager* m_Descriptors = nullptr;
+	DeletionQueue* m_DeletionQueue = nullptr;
+
+	VkBuffer m_Buffer = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation* m_Memory = nullptr;
+	uint32_t m_Slot = DescriptorManager::INVALID_SLOT;
+	uint32_t m_Count = 0;
+};
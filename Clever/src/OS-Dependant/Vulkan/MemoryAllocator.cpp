@@ -0,0 +1,426 @@
+#include "MemoryAllocator.h"
+#include "Clever/Developer/DevTools.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <iostream>
+
+void MemoryAllocator::init(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+	m_Device = device;
+	m_PhysicalDevice = physicalDevice;
+
+	vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &m_MemoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+	m_MaxAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+	m_Blocks.resize(m_MemoryProperties.memoryTypeCount * 2);
+
+	DevTools::addDockFunction(memoryGui, { this });
+}
+
+void MemoryAllocator::cleanup()
+{
+	std::lock_guard<std::recursive_mutex> lock(m_Mutex);
+
+	for (auto& blocks : m_Blocks)
+	{
+		for (auto& block : blocks)
+		{
+			if (block->ranges.getAllocationCount() != 0)
+				std::cerr << "MemoryAllocator: " << block->ranges.getAllocationCount() << " allocations leaked in memory type " << block->memoryType << std::endl;
+			freeDeviceMemory(block->memory, block->mapped != nullptr);
+		}
+		blocks.clear();
+	}
+
+	for (Allocation* allocation : m_Dedicated)
+	{
+		freeDeviceMemory(allocation->memory, allocation->mapped != nullptr);
+		delete allocation;
+	}
+	m_Dedicated.clear();
+}
+
+MemoryAllocator::Allocation* MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, uint32_t flags)
+{
+	return allocateInternal(requirements, properties, kind, flags, nullptr);
+}
+
+void MemoryAllocator::free(Allocation* allocation)
+{
+	if (allocation == nullptr)
+		return;
+
+	std::lock_guard<std::recursive_mutex> lock(m_Mutex);
+	if (allocation->block != nullptr)
+	{
+		releaseRange(allocation->block, allocation->node);
+	}
+	else
+	{
+		auto it = std::find(m_Dedicated.begin(), m_Dedicated.end(), allocation);
+		if (it == m_Dedicated.end())
+			throw std::runtime_error("failed to free allocation, it does not belong to this allocator!");
+		m_Dedicated.erase(it);
+		freeDeviceMemory(allocation->memory, allocation->mapped != nullptr);
+	}
+	delete allocation;
+}
+
+MemoryAllocator::Allocation* MemoryAllocator::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, uint32_t flags)
+{
+	VkBufferCreateInfo bufferInfo{};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(m_Device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to create buffer!");
+
+	VkBufferMemoryRequirementsInfo2 requirementsInfo{};
+	requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+	requirementsInfo.buffer = buffer;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements{};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicatedRequirements;
+	vkGetBufferMemoryRequirements2(m_Device, &requirementsInfo, &requirements);
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.buffer = buffer;
+
+	if (dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation)
+		flags |= ALLOCATION_DEDICATED;
+
+	Allocation* allocation = allocateInternal(requirements.memoryRequirements, properties, ResourceKind::Buffer, flags, &dedicatedInfo);
+	vkBindBufferMemory(m_Device, buffer, allocation->memory, allocation->offset);
+	return allocation;
+}
+
+MemoryAllocator::Allocation* MemoryAllocator::createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, uint32_t flags)
+{
+	if (vkCreateImage(m_Device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+		throw std::runtime_error("failed to create image!");
+
+	VkImageMemoryRequirementsInfo2 requirementsInfo{};
+	requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+	requirementsInfo.image = image;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements{};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements{};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicatedRequirements;
+	vkGetImageMemoryRequirements2(m_Device, &requirementsInfo, &requirements);
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.image = image;
+
+	if (dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation)
+		flags |= ALLOCATION_DEDICATED;
+
+	ResourceKind kind = imageInfo.tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceKind::Image : ResourceKind::Buffer;
+	Allocation* allocation = allocateInternal(requirements.memoryRequirements, properties, kind, flags, &dedicatedInfo);
+	vkBindImageMemory(m_Device, image, allocation->memory, allocation->offset);
+	return allocation;
+}
+
+void MemoryAllocator::destroyBuffer(VkBuffer buffer, Allocation* allocation)
+{
+	vkDestroyBuffer(m_Device, buffer, nullptr);
+	free(allocation);
+}
+
+void MemoryAllocator::destroyImage(VkImage image, Allocation* allocation)
+{
+	vkDestroyImage(m_Device, image, nullptr);
+	free(allocation);
+}
+
+void MemoryAllocator::destroyBuffer(VkBuffer buffer, Allocation* allocation, DeletionQueue& deletionQueue)
+{
+	deletionQueue.push([=]()
+		{
+			destroyBuffer(buffer, allocation);
+		});
+}
+
+void MemoryAllocator::destroyImage(VkImage image, Allocation* allocation, DeletionQueue& deletionQueue)
+{
+	deletionQueue.push([=]()
+		{
+			destroyImage(image, allocation);
+		});
+}
+
+MemoryAllocator::Stats MemoryAllocator::getStats()
+{
+	Stats total;
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+	{
+		Stats stats = getStats(i);
+		total.blockCount += stats.blockCount;
+		total.allocationCount += stats.allocationCount;
+		total.dedicatedCount += stats.dedicatedCount;
+		total.freeRangeCount += stats.freeRangeCount;
+		total.blockBytes += stats.blockBytes;
+		total.allocatedBytes += stats.allocatedBytes;
+		total.largestFreeRange = std::max(total.largestFreeRange, stats.largestFreeRange);
+	}
+	return total;
+}
+
+MemoryAllocator::Stats MemoryAllocator::getStats(uint32_t memoryType)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_Mutex);
+	Stats stats;
+	for (uint32_t kind = 0; kind < 2; kind++)
+	{
+		for (auto& block : getBlocks(memoryType, static_cast<ResourceKind>(kind)))
+		{
+			stats.blockCount++;
+			stats.blockBytes += block->size;
+			stats.allocationCount += block->ranges.getAllocationCount();
+			stats.allocatedBytes += block->ranges.getCapacity() - block->ranges.getFreeBytes();
+			stats.freeRangeCount += block->ranges.getFreeRangeCount();
+			stats.largestFreeRange = std::max(stats.largestFreeRange, block->ranges.getLargestFreeRange());
+		}
+	}
+
+	for (Allocation* allocation : m_Dedicated)
+	{
+		if (allocation->memoryType != memoryType)
+			continue;
+		stats.dedicatedCount++;
+		stats.allocationCount++;
+		stats.blockBytes += allocation->size;
+		stats.allocatedBytes += allocation->size;
+	}
+	return stats;
+}
+
+uint32_t MemoryAllocator::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties)
+{
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeBits & (1u << i)) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+	throw std::runtime_error("failed to find suitable memory type!");
+}
+
+VkDeviceSize MemoryAllocator::getPreferredBlockSize(uint32_t memoryType)
+{
+	VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[memoryType].heapIndex].size;
+	if (heapSize <= SMALL_HEAP_SIZE)
+		return (heapSize / 8 + 255) & ~VkDeviceSize(255);
+	return DEFAULT_BLOCK_SIZE;
+}
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext, uint8_t*& mapped)
+{
+	if (m_DeviceAllocationCount >= m_MaxAllocationCount)
+		throw std::runtime_error("failed to allocate device memory, maxMemoryAllocationCount reached!");
+
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.pNext = pNext;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory;
+	VkResult result = vkAllocateMemory(m_Device, &allocInfo, nullptr, &memory);
+	if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY)
+		return VK_NULL_HANDLE;
+	if (result != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate device memory!");
+
+	mapped = nullptr;
+	if (m_MemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		void* data;
+		if (vkMapMemory(m_Device, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+			throw std::runtime_error("failed to map device memory!");
+		mapped = static_cast<uint8_t*>(data);
+	}
+
+	m_DeviceAllocationCount++;
+	return memory;
+}
+
+void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, bool mapped)
+{
+	if (mapped)
+		vkUnmapMemory(m_Device, memory);
+	vkFreeMemory(m_Device, memory, nullptr);
+	m_DeviceAllocationCount--;
+}
+
+MemoryAllocator::Allocation* MemoryAllocator::allocateInternal(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, uint32_t flags, const void* dedicatedInfo)
+{
+	std::lock_guard<std::recursive_mutex> lock(m_Mutex);
+
+	uint32_t typeBits = requirements.memoryTypeBits;
+	while (true)
+	{
+		uint32_t memoryType = findMemoryType(typeBits, properties);
+
+		//Half a block or more would waste the rest of it
+		bool dedicated = (flags & ALLOCATION_DEDICATED) || requirements.size > getPreferredBlockSize(memoryType) / 2;
+		if (dedicated)
+		{
+			Allocation* allocation = allocateDedicated(requirements.size, memoryType, flags, dedicatedInfo);
+			if (allocation)
+				return allocation;
+		}
+		else
+		{
+			Allocation* allocation = new Allocation();
+			allocation->flags = flags;
+			if (allocateFromBlocks(requirements.size, requirements.alignment, memoryType, kind, allocation))
+				return allocation;
+			delete allocation;
+		}
+
+		//That heap is full, the next type with the same properties may be on another one
+		typeBits &= ~(1u << memoryType);
+		if (typeBits == 0)
+			throw std::runtime_error("failed to allocate device memory, out of memory!");
+	}
+}
+
+MemoryAllocator::Allocation* MemoryAllocator::allocateDedicated(VkDeviceSize size, uint32_t memoryType, uint32_t flags, const void* dedicatedInfo)
+{
+	uint8_t* mapped;
+	VkDeviceMemory memory = allocateDeviceMemory(size, memoryType, dedicatedInfo, mapped);
+	if (memory == VK_NULL_HANDLE)
+		return nullptr;
+
+	Allocation* allocation = new Allocation();
+	allocation->memory = memory;
+	allocation->offset = 0;
+	allocation->size = size;
+	allocation->mapped = mapped;
+	allocation->memoryType = memoryType;
+	allocation->flags = flags | ALLOCATION_DEDICATED;
+
+	m_Dedicated.push_back(allocation);
+	m_TotalAllocations++;
+	return allocation;
+}
+
+bool MemoryAllocator::allocateFromBlocks(VkDeviceSize size, VkDeviceSize alignment, uint32_t memoryType, ResourceKind kind, Allocation* allocation)
+{
+	auto& blocks = getBlocks(memoryType, kind);
+	for (auto& block : blocks)
+	{
+		if (allocateFromBlock(block.get(), size, alignment, allocation))
+			return true;
+	}
+
+	Block* block = createBlock(memoryType, kind, size + alignment);
+	return block != nullptr && allocateFromBlock(block, size, alignment, allocation);
+}
+
+bool MemoryAllocator::allocateFromBlock(Block* block, VkDeviceSize size, VkDeviceSize alignment, Allocation* allocation)
+{
+	VkDeviceSize offset;
+	uint32_t node = block->ranges.allocate(size, alignment, offset);
+	if (node == TlsfAllocator::INVALID)
+		return false;
+
+	allocation->memory = block->memory;
+	allocation->offset = offset;
+	allocation->size = size;
+	allocation->mapped = block->mapped ? block->mapped + offset : nullptr;
+	allocation->memoryType = block->memoryType;
+	allocation->block = block;
+	allocation->node = node;
+
+	m_TotalAllocations++;
+	return true;
+}
+
+MemoryAllocator::Block* MemoryAllocator::createBlock(uint32_t memoryType, ResourceKind kind, VkDeviceSize minimumSize)
+{
+	//Smaller blocks are tried when the heap is too full for a whole one
+	VkDeviceSize size = std::max(getPreferredBlockSize(memoryType), minimumSize);
+	for (uint32_t attempt = 0; attempt < 3 && size >= minimumSize; attempt++, size /= 2)
+	{
+		uint8_t* mapped;
+		VkDeviceMemory memory = allocateDeviceMemory(size, memoryType, nullptr, mapped);
+		if (memory == VK_NULL_HANDLE)
+			continue;
+
+		std::unique_ptr<Block> block = std::make_unique<Block>();
+		block->memory = memory;
+		block->size = size;
+		block->mapped = mapped;
+		block->memoryType = memoryType;
+		block->kind = kind;
+		block->ranges.init(size);
+
+		auto& blocks = getBlocks(memoryType, kind);
+		blocks.push_back(std::move(block));
+		return blocks.back().get();
+	}
+	return nullptr;
+}
+
+void MemoryAllocator::releaseRange(Block* block, uint32_t node)
+{
+	block->ranges.free(node);
+	if (block->ranges.getAllocationCount() != 0)
+		return;
+
+	//One empty block is kept so an allocation going back and forth doesn't allocate device memory every time
+	auto& blocks = getBlocks(block->memoryType, block->kind);
+	bool otherEmpty = std::any_of(blocks.begin(), blocks.end(), [&](const std::unique_ptr<Block>& other) { return other.get() != block && other->ranges.getAllocationCount() == 0; });
+	if (!otherEmpty)
+		return;
+
+	freeDeviceMemory(block->memory, block->mapped != nullptr);
+	blocks.erase(std::find_if(blocks.begin(), blocks.end(), [&](const std::unique_ptr<Block>& other) { return other.get() == block; }));
+}
+
+void MemoryAllocator::memoryGui(std::vector<void*> classInstances)
+{
+	MemoryAllocator* allocator = (MemoryAllocator*)classInstances.at(0);
+	DevTools::newDock("GPU-Memory");
+
+	Stats total = allocator->getStats();
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "vkAllocateMemory: " + std::to_string(allocator->m_DeviceAllocationCount) + " / " + std::to_string(allocator->m_MaxAllocationCount));
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Total: " + std::to_string(total.allocatedBytes >> 20) + " / " + std::to_string(total.blockBytes >> 20) + " MB, " + std::to_string(total.allocationCount) + " allocations");
+
+	for (uint32_t i = 0; i < allocator->m_MemoryProperties.memoryTypeCount; i++)
+	{
+		Stats stats = allocator->getStats(i);
+		if (stats.blockBytes == 0)
+			continue;
+
+		VkMemoryPropertyFlags flags = allocator->m_MemoryProperties.memoryTypes[i].propertyFlags;
+		std::string properties;
+		if (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+			properties += " Device";
+		if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+			properties += " Host";
+		if (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+			properties += " Cached";
+
+		DevTools::coloredText({ 0.6, 0.8, 1.0 }, "Type " + std::to_string(i) + properties);
+		DevTools::coloredText({ 0.8, 0.8, 0.8 }, "  " + std::to_string(stats.allocatedBytes >> 10) + " / " + std::to_string(stats.blockBytes >> 10) + " KB in " + std::to_string(stats.blockCount) + " blocks, " + std::to_string(stats.dedicatedCount) + " dedicated");
+		DevTools::coloredText({ 0.8, 0.8, 0.8 }, "  " + std::to_string(stats.allocationCount) + " allocations, " + std::to_string(stats.freeRangeCount) + " free ranges, largest " + std::to_string(stats.largestFreeRange >> 10) + " KB");
+	}
+	DevTools::endDock();
+}
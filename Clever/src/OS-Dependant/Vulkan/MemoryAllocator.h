@@ -0,0 +1,140 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <mutex>
+#include <memory>
+
+#include "TlsfAllocator.h"
+#include "DeletionQueue.h"
+
+/*
+-------------GPU Memory Allocator----------------
+
+Hands out pieces of a few big VkDeviceMemory blocks instead of one vkAllocateMemory per resource, drivers only allow
+maxMemoryAllocationCount (often 4096) of those and each one costs far more than a sub-allocation.
+
+	Blocks: one list per memory type, and per kind since buffers and optimal images can't share a bufferImageGranularity
+			page. Each block is sub-allocated with a TlsfAllocator. Host visible blocks are mapped for their whole life.
+	Dedicated: resources the driver prefers or requires on their own, ALLOCATION_DEDICATED and anything over half a block
+			   get a VkDeviceMemory of their own.
+
+Transient attachments are aliased by the RenderGraph in one allocation, and mesh data is compacted inside the
+GeometryBuffer's arenas, so blocks themselves are never moved. Allocations are owned by the allocator and stay at the
+same address until they are freed. Everything is thread safe.
+*/
+class MemoryAllocator
+{
+public:
+	static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+	static const VkDeviceSize SMALL_HEAP_SIZE = 1ull << 30;//Heaps up to this size get blocks of an eighth of the heap
+
+	enum class ResourceKind
+	{
+		Buffer,//Buffers and linear images
+		Image//Optimal tiling images
+	};
+
+	enum AllocationFlags : uint32_t
+	{
+		ALLOCATION_DEDICATED = 1 << 0
+	};
+
+	struct Block;
+
+	struct Allocation
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		uint8_t* mapped = nullptr;//Already offset, null unless the memory is host visible
+		uint32_t memoryType = 0;
+		uint32_t flags = 0;
+
+		Block* block = nullptr;//Null for dedicated allocations
+		uint32_t node = TlsfAllocator::INVALID;
+	};
+
+	struct Block
+	{
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkDeviceSize size = 0;
+		uint8_t* mapped = nullptr;
+		uint32_t memoryType = 0;
+		ResourceKind kind = ResourceKind::Buffer;
+		TlsfAllocator ranges;
+	};
+
+	struct Stats
+	{
+		uint32_t blockCount = 0;
+		uint32_t allocationCount = 0;
+		uint32_t dedicatedCount = 0;
+		uint32_t freeRangeCount = 0;
+		VkDeviceSize blockBytes = 0;//Reserved from the driver, dedicated included
+		VkDeviceSize allocatedBytes = 0;
+		VkDeviceSize largestFreeRange = 0;
+	};
+
+public:
+	MemoryAllocator() = default;
+
+	void init(VkDevice device, VkPhysicalDevice physicalDevice);
+
+	//! Every allocation has to be freed, the device has to be idle
+	void cleanup();
+
+	//! Memory type from requirements.memoryTypeBits with all of properties, the next matching type is tried when one is out of memory
+	Allocation* allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, uint32_t flags = 0);
+	void free(Allocation* allocation);
+
+	//! Creates the resource, allocates and binds its memory
+	Allocation* createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, uint32_t flags = 0);
+	Allocation* createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, uint32_t flags = 0);
+	void destroyBuffer(VkBuffer buffer, Allocation* allocation);
+	void destroyImage(VkImage image, Allocation* allocation);
+
+	//! For resources the GPU may still use, destroyed once the submits made before this call are done
+	void destroyBuffer(VkBuffer buffer, Allocation* allocation, DeletionQueue& deletionQueue);
+	void destroyImage(VkImage image, Allocation* allocation, DeletionQueue& deletionQueue);
+
+	Stats getStats();
+	Stats getStats(uint32_t memoryType);
+
+	static void memoryGui(std::vector<void*> classInstances);
+
+private:
+	uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties);
+	VkDeviceSize getPreferredBlockSize(uint32_t memoryType);
+
+	//! Counts towards maxMemoryAllocationCount, null when the heap is out of memory
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, const void* pNext, uint8_t*& mapped);
+	void freeDeviceMemory(VkDeviceMemory memory, bool mapped);
+
+	//! dedicatedInfo is chained into the allocation when the resource gets memory of its own
+	Allocation* allocateInternal(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, ResourceKind kind, uint32_t flags, const void* dedicatedInfo);
+	Allocation* allocateDedicated(VkDeviceSize size, uint32_t memoryType, uint32_t flags, const void* dedicatedInfo);
+	bool allocateFromBlocks(VkDeviceSize size, VkDeviceSize alignment, uint32_t memoryType, ResourceKind kind, Allocation* allocation);
+	bool allocateFromBlock(Block* block, VkDeviceSize size, VkDeviceSize alignment, Allocation* allocation);
+	Block* createBlock(uint32_t memoryType, ResourceKind kind, VkDeviceSize minimumSize);
+
+	//! m_Mutex must be held
+	void releaseRange(Block* block, uint32_t node);
+
+	std::vector<std::unique_ptr<Block>>& getBlocks(uint32_t memoryType, ResourceKind kind)
+	{
+		return m_Blocks[memoryType * 2 + static_cast<uint32_t>(kind)];
+	}
+
+private:
+	VkDevice m_Device = VK_NULL_HANDLE;
+	VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties m_MemoryProperties{};
+	uint32_t m_MaxAllocationCount = 4096;
+
+	std::recursive_mutex m_Mutex;
+	std::vector<std::vector<std::unique_ptr<Block>>> m_Blocks;//memoryType * 2 + kind
+	std::vector<Allocation*> m_Dedicated;
+
+	uint32_t m_DeviceAllocationCount = 0;
+	uint64_t m_TotalAllocations = 0;
+};
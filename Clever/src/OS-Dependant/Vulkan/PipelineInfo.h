@@ -1,7 +1,11 @@
 #pragma once
 #include "Clever/WorldManager/Vertex.h"
+#include "Clever/WorldManager/VertexFormats.h"
 #include <vulkan/vulkan.h>
 #include "Clever/WorldManager/UniformBufferObject.h"
+#include "ShaderManager.h"
+#include "ShaderVariants.h"
+#include "Clever/Material/Material.h"
 #include <fstream>
 #include <vector>
 
@@ -10,6 +14,7 @@
 
 struct PushConstants {
 	glm::mat4 model;
+	Material::MaterialId material = Material::NO_MATERIAL;
 };
 
 //template<typename T>
@@ -21,12 +26,17 @@ public:
 	{
 
 	}
-	PipelineInfo(VkDevice device, VkRenderPass renderPass, std::vector<VkBuffer> uniformBuffer, int maxFramesInFlight, bool ray)
-		: m_Device(device), m_RenderPass(renderPass), m_UniformBuffers(uniformBuffer), m_MaxFramesInFlight(maxFramesInFlight)
+	//! Uses a pipeline owned by someone else, the ResourceCache, cleanup() must not be called
+	PipelineInfo(VkPipeline sharedPipeline)
+		: graphicsPipeline(sharedPipeline)
 	{
-		createPipelineLayout();
-		createGraphicsPipeline(ray);
-		createDesciptor();
+
+	}
+	//! sharedPipelineLayout is owned by the DescriptorManager, format picks the vertex input layout and features the shader variant
+	PipelineInfo(VkDevice device, ShaderManager& shaders, VkRenderPass renderPass, VkPipelineLayout sharedPipelineLayout, ShaderFeatures features, VertexFormat format = VertexFormat::Float)
+		: m_Device(device), m_RenderPass(renderPass), pipelineLayout(sharedPipelineLayout)
+	{
+		createGraphicsPipeline(shaders, features, format);
 		createPushConstants();
 	}
 	~PipelineInfo()
@@ -37,6 +47,7 @@ public:
 	void setInstanceCount(int count)
 	{
 		positions.resize(count);
+		materials.resize(count, Material::NO_MATERIAL);
 	}
 
 	void setPosition(glm::vec3 pos, int instance)
@@ -48,6 +59,17 @@ public:
 		createPushConstants();
 	}
 
+	//! Only the instance's index changes, nothing is rebuilt or rebound
+	void setMaterial(Material::MaterialId material, int instance)
+	{
+		if (instance < 0 || static_cast<size_t>(instance) >= materials.size())
+			return;
+
+		materials.at(instance) = material;
+		if (static_cast<size_t>(instance) < instances.size())
+			instances.at(instance).material = material;
+	}
+
 	int getInstanceCount()
 	{
 		return static_cast<int>(positions.size());
@@ -55,74 +77,43 @@ public:
 
 	void cleanup()
 	{
-		vkDestroyDescriptorSetLayout(m_Device, descriptorSetLayout, nullptr);
-		vkDestroyDescriptorPool(m_Device, descriptorPool, nullptr);
-		vkDestroyPipelineLayout(m_Device, pipelineLayout, nullptr);
 		vkDestroyPipeline(m_Device, graphicsPipeline, nullptr);
 
 	}
 
 private:
-	void createPipelineLayout()
+	void createGraphicsPipeline(ShaderManager& shaders, ShaderFeatures features, VertexFormat format)
 	{
-		std::vector< VkDescriptorSetLayoutBinding> bindingInfos(1);
-		bindingInfos[0].binding = 0;
-		bindingInfos[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		bindingInfos[0].descriptorCount = 1;
-		bindingInfos[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-		VkDescriptorSetLayoutCreateInfo desciptorInfo{};
-		desciptorInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-		desciptorInfo.bindingCount = static_cast<uint32_t>(bindingInfos.size());
-		desciptorInfo.pBindings = bindingInfos.data();
-
-		if (vkCreateDescriptorSetLayout(m_Device, &desciptorInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
-		{
-			std::runtime_error("DesctiptorSetLayout failed to be created!");
-		}
-
-		VkPushConstantRange push_constant;
-		push_constant.offset = 0;
-		push_constant.size = sizeof(PushConstants);
-		push_constant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-
-		VkPipelineLayoutCreateInfo info{};
-		info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		info.setLayoutCount = 1;
-		info.pSetLayouts = &descriptorSetLayout;
-		info.pushConstantRangeCount = 1;
-		info.pPushConstantRanges = &push_constant;
-
-		if (vkCreatePipelineLayout(m_Device, &info, nullptr, &pipelineLayout) != VK_SUCCESS)
-		{
-			std::runtime_error("Pipeline Layout failed to be created!");
-		}
-	}
-
-	void createGraphicsPipeline(bool ray)
-	{
-		auto vertShaderCode = readFile("Clever/src/OS-Dependant/Shaders/vert.spv");
-		auto fragShaderCode = readFile("Clever/src/OS-Dependant/Shaders/frag.spv");
-
-		VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-		VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+		//Owned by the ShaderManager, compiled once and shared by every pipeline built from them
+		shaderFiles = { VertexFormats::getVertexShader(format), "shader.frag" };
+		std::vector<std::string> vertexDefines = VertexFormats::getVertexDefines(format);
+		std::vector<std::string> featureDefines = ShaderVariants::getDefines(features);
+		vertexDefines.insert(vertexDefines.end(), featureDefines.begin(), featureDefines.end());
+		VkShaderModule vertShaderModule = shaders.getModule(shaderFiles[0], vertexDefines);
+		VkShaderModule fragShaderModule = shaders.getModule(shaderFiles[1], featureDefines);
+
+		//Constants a stage doesn't declare are ignored, so both get all of them
+		ShaderVariants::Specialization specialization = ShaderVariants::getSpecialization(features);
+		VkSpecializationInfo specializationInfo = specialization.getInfo();
 
 		VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
 		vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
 		vertShaderStageInfo.module = vertShaderModule;
 		vertShaderStageInfo.pName = "main";
+		vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
 		VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
 		fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 		fragShaderStageInfo.module = fragShaderModule;
 		fragShaderStageInfo.pName = "main";
+		fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
 
 		VkPipelineShaderStageCreateInfo shaderStageCreateInfo[] = { vertShaderStageInfo, fragShaderStageInfo };
 
-		auto bindingDescription = Vertex::getBindingDescription();
-		auto attributeDescriptions = Vertex::getAttributeDescriptions();
+		auto bindingDescription = VertexFormats::getBindingDescription(format);
+		auto attributeDescriptions = VertexFormats::getAttributeDescriptions(format);
 
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -146,7 +137,7 @@ private:
 		rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
 		rasterizer.depthClampEnable = VK_FALSE;
 		rasterizer.rasterizerDiscardEnable = VK_FALSE;
-		if (ray)
+		if (features.has(ShaderFeature::Wireframe))
 		{
 			rasterizer.polygonMode = VK_POLYGON_MODE_LINE;
 			rasterizer.lineWidth = 4.0f;
@@ -216,75 +207,12 @@ private:
 
 		if (vkCreateGraphicsPipelines(m_Device, VK_NULL_HANDLE, 1, &createInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
 		{
-			std::runtime_error("Failed to create Graphics Pipeline");
-		}
-
-		vkDestroyShaderModule(m_Device, fragShaderModule, nullptr);
-		vkDestroyShaderModule(m_Device, vertShaderModule, nullptr);
-	}
-
-	void createDesciptor()
-	{
-		//Descriptor Pool
-		{
-			VkDescriptorPoolSize sizeInfo{};
-			sizeInfo.descriptorCount = static_cast<uint32_t>(m_MaxFramesInFlight);
-			sizeInfo.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-
-			VkDescriptorPoolCreateInfo info{};
-			info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-			info.poolSizeCount = 1;
-			info.pPoolSizes = &sizeInfo;
-			info.maxSets = static_cast<uint32_t>(m_MaxFramesInFlight);
-
-			if (vkCreateDescriptorPool(m_Device, &info, nullptr, &descriptorPool) != VK_SUCCESS)
-			{
-				std::runtime_error("Failed to create descriptor pool");
-			}
-		}
-
-		//Desciptor Sets
-		{
-			std::vector<VkDescriptorSetLayout> layouts(m_MaxFramesInFlight, descriptorSetLayout);
-			VkDescriptorSetAllocateInfo info{};
-			info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-			info.descriptorPool = descriptorPool;
-			info.descriptorSetCount = static_cast<uint32_t>(m_MaxFramesInFlight);
-			info.pSetLayouts = layouts.data();
-
-			descriptorSets.resize(m_MaxFramesInFlight);
-
-			if (vkAllocateDescriptorSets(m_Device, &info, descriptorSets.data()) != VK_SUCCESS)
-			{
-				std::runtime_error("Falied to allocate Descriptor sets");
-			}
-		}
-
-		for (size_t i = 0; i < m_MaxFramesInFlight; i++) {
-			VkDescriptorBufferInfo bufferInfo{};
-			bufferInfo.buffer = m_UniformBuffers[i];
-			bufferInfo.offset = 0;
-			bufferInfo.range = sizeof(UniformBufferObject);
-
-			VkWriteDescriptorSet writeInfo{};
-			writeInfo.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-			writeInfo.dstSet = descriptorSets[i];
-			writeInfo.dstBinding = 0;
-			writeInfo.dstArrayElement = 0;
-			writeInfo.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			writeInfo.descriptorCount = 1;
-			writeInfo.pBufferInfo = &bufferInfo;
-
-			vkUpdateDescriptorSets(m_Device, 1, &writeInfo, 0, nullptr);
+			throw std::runtime_error("Failed to create Graphics Pipeline");
 		}
 	}
 
 	void createPushConstants()
 	{
-		VkPushConstantRange push_constant;
-		push_constant.offset = 0;
-		push_constant.size = sizeof(PushConstants);
-		push_constant.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
 		instances.clear();
 		instances.resize(positions.size());
 
@@ -292,58 +220,21 @@ private:
 		{
 			PushConstants push = {};
 			push.model = glm::translate(glm::mat4(1.0f), positions.at(i));
+			push.material = materials.at(i);
 			instances[i] = push;
 		}
 	}
 
 private:
-	std::vector<char> readFile(const std::string& filename)
-	{
-		std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-		if (!file.is_open())
-		{
-			throw std::runtime_error("failed to open file!");
-		}
-
-		size_t fileSize = (size_t)file.tellg();
-		std::vector<char> buffer(fileSize);
-
-		file.seekg(0);
-		file.read(buffer.data(), fileSize);
-		file.close();
-
-		return buffer;
-	}
-	VkShaderModule createShaderModule(const std::vector<char>& code)
-	{
-		VkShaderModuleCreateInfo createInfo{};
-		createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-		createInfo.codeSize = code.size();
-		createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-		VkShaderModule shaderModule;
-		if (vkCreateShaderModule(m_Device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-		{
-			throw std::runtime_error("Failed to create Shader Module");
-		}
-
-		return shaderModule;
-	}
-
-private:
-	VkDescriptorSetLayout descriptorSetLayout;//
-	VkDescriptorPool descriptorPool;//
-
 	VkDevice m_Device;
 	VkRenderPass m_RenderPass;
-	std::vector<VkBuffer> m_UniformBuffers;
-	int m_MaxFramesInFlight;
 
 	std::vector<glm::vec3> positions;
+	std::vector<Material::MaterialId> materials;
 
 public:
 	VkPipeline graphicsPipeline;//
-	VkPipelineLayout pipelineLayout;//
-	std::vector<VkDescriptorSet> descriptorSets;//
-	std::vector<PushConstants> instances;//! Replace with T when template is added back
+	VkPipelineLayout pipelineLayout;//Not owned
+	std::vector<std::string> shaderFiles;//Sources it was built from, it is rebuilt when one of them is reloaded
+	std::vector<PushConstants> instances;//! CPU side transforms, gathered into the GPU instance buffer by the HiZCuller
 };
\ No newline at end of file
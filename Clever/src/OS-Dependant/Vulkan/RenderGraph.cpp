@@ -0,0 +1,1102 @@
+#include "RenderGraph.h"
+#include "Initilizers/HelperFunctions.h"
+#include "Clever/Developer/DevTools.h"
+
+#include <map>
+#include <stdexcept>
+#include <algorithm>
+
+static const VkAccessFlags WRITE_ACCESS =
+	VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+static const VkPipelineStageFlags COMPUTE_QUEUE_STAGES =
+	VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+void RenderGraph::init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator& allocator, uint32_t graphicsFamily, VkQueue graphicsQueue, std::optional<uint32_t> computeFamily, VkQueue computeQueue, int maxFramesInFlight, DeletionQueue& deletionQueue)
+{
+	m_Device = device;
+	m_PhysicalDevice = physicalDevice;
+	m_Allocator = &allocator;
+	m_GraphicsFamily = graphicsFamily;
+	m_GraphicsQueue = graphicsQueue;
+	m_ComputeQueue = computeFamily.has_value() ? computeQueue : VK_NULL_HANDLE;
+	m_ComputeFamily = computeFamily.value_or(graphicsFamily);
+	m_MaxFramesInFlight = maxFramesInFlight;
+	m_DeletionQueue = &deletionQueue;
+
+	m_FrameCommands.resize(maxFramesInFlight);
+	for (FrameCommands& frame : m_FrameCommands)
+	{
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = m_GraphicsFamily;
+
+		if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &frame.graphicsPool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create render graph command pool!");
+
+		if (m_ComputeQueue != VK_NULL_HANDLE)
+		{
+			poolInfo.queueFamilyIndex = m_ComputeFamily;
+			if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &frame.computePool) != VK_SUCCESS)
+				throw std::runtime_error("failed to create render graph compute command pool!");
+		}
+	}
+
+	DevTools::addDockFunction(renderGraphGui, { this });
+}
+
+void RenderGraph::cleanup()
+{
+	//Only called once the device is idle, so the retired transients can go right away
+	destroyTransients();
+	for (auto& semaphores : m_EdgeSemaphores)
+	{
+		for (VkSemaphore semaphore : semaphores)
+			vkDestroySemaphore(m_Device, semaphore, nullptr);
+	}
+	m_EdgeSemaphores.clear();
+	m_DeletionQueue->flushAll();
+
+	for (FrameCommands& frame : m_FrameCommands)
+	{
+		vkDestroyCommandPool(m_Device, frame.graphicsPool, nullptr);
+		if (frame.computePool != VK_NULL_HANDLE)
+			vkDestroyCommandPool(m_Device, frame.computePool, nullptr);
+	}
+	m_FrameCommands.clear();
+}
+
+RenderGraph::ResourceHandle RenderGraph::importBuffer(const std::string& name)
+{
+	Resource resource;
+	resource.name = name;
+	m_Resources.push_back(resource);
+	return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::importImage(const std::string& name, VkImageAspectFlags aspect)
+{
+	Resource resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.aspect = aspect;
+	m_Resources.push_back(resource);
+	return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::createImage(const std::string& name, const ImageDesc& desc)
+{
+	Resource resource;
+	resource.name = name;
+	resource.isImage = true;
+	resource.transient = true;
+	resource.aspect = desc.aspect;
+	resource.desc = desc;
+	m_Resources.push_back(resource);
+	return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+void RenderGraph::setImageDesc(ResourceHandle resource, const ImageDesc& desc)
+{
+	Resource& image = m_Resources[checkResource(resource)];
+	if (!image.transient)
+		throw std::runtime_error("render graph image " + image.name + " is not transient!");
+
+	image.desc = desc;
+	image.aspect = desc.aspect;
+}
+
+RenderGraph::PassHandle RenderGraph::addPass(const std::string& name, Queue queue, ExecuteFunction execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.queue = queue;
+	pass.execute = std::move(execute);
+	m_Passes.push_back(std::move(pass));
+	m_Compiled = false;
+	return static_cast<PassHandle>(m_Passes.size() - 1);
+}
+
+void RenderGraph::read(PassHandle pass, ResourceHandle resource, Access access, VkImageLayout layout)
+{
+	addUse(checkPass(pass), checkResource(resource), access, layout, false, false);
+}
+
+void RenderGraph::write(PassHandle pass, ResourceHandle resource, Access access, bool discard, VkImageLayout layout)
+{
+	if (!getAccessInfo(access).write)
+		throw std::runtime_error("render graph pass " + m_Passes[checkPass(pass)].name + " writes with a read only access!");
+
+	addUse(checkPass(pass), checkResource(resource), access, layout, true, discard);
+}
+
+void RenderGraph::setSideEffect(PassHandle pass)
+{
+	m_Passes[checkPass(pass)].sideEffect = true;
+	m_Compiled = false;
+}
+
+void RenderGraph::markOutput(ResourceHandle resource)
+{
+	m_Resources[checkResource(resource)].output = true;
+	m_Compiled = false;
+}
+
+void RenderGraph::markOutput(ResourceHandle resource, Access finalAccess)
+{
+	markOutput(resource);
+	m_Resources[resource].finalAccess = finalAccess;
+}
+
+RenderGraph::PassHandle RenderGraph::checkPass(PassHandle pass)
+{
+	if (pass >= m_Passes.size())
+		throw std::runtime_error("invalid render graph pass!");
+	return pass;
+}
+
+RenderGraph::ResourceHandle RenderGraph::checkResource(ResourceHandle resource)
+{
+	if (resource >= m_Resources.size())
+		throw std::runtime_error("invalid render graph resource!");
+	return resource;
+}
+
+void RenderGraph::addUse(PassHandle passHandle, ResourceHandle resourceHandle, Access access, VkImageLayout layout, bool write, bool discard)
+{
+	Pass& pass = m_Passes[passHandle];
+	Resource& resource = m_Resources[resourceHandle];
+	AccessInfo info = getAccessInfo(access, resource.aspect);
+
+	Use use{};
+	use.resource = resourceHandle;
+	use.stage = info.stage;
+	use.access = write ? info.access : info.access & ~WRITE_ACCESS;
+	use.layout = resource.isImage ? (layout != VK_IMAGE_LAYOUT_UNDEFINED ? layout : info.layout) : VK_IMAGE_LAYOUT_UNDEFINED;
+	use.write = write;
+	use.discard = discard;
+
+	if (resource.isImage && use.layout == VK_IMAGE_LAYOUT_UNDEFINED)
+		throw std::runtime_error("render graph pass " + pass.name + " uses image " + resource.name + " with a buffer access!");
+
+	m_Compiled = false;
+
+	//A pass touching the same resource twice is one use, one layout
+	for (Use& existing : pass.uses)
+	{
+		if (existing.resource != resourceHandle)
+			continue;
+
+		if (existing.layout != use.layout)
+			throw std::runtime_error("render graph pass " + pass.name + " uses " + resource.name + " in two layouts!");
+
+		existing.stage |= use.stage;
+		existing.access |= use.access;
+		existing.discard = existing.discard && use.discard && existing.write && use.write;
+		existing.write = existing.write || use.write;
+		return;
+	}
+	pass.uses.push_back(use);
+}
+
+void RenderGraph::compile()
+{
+	for (const Pass& pass : m_Passes)
+	{
+		if (pass.queue != Queue::AsyncCompute)
+			continue;
+
+		for (const Use& use : pass.uses)
+		{
+			if (use.stage & ~COMPUTE_QUEUE_STAGES)
+				throw std::runtime_error("async compute pass " + pass.name + " uses " + m_Resources[use.resource].name + " outside of compute or transfer!");
+		}
+	}
+
+	cullPasses();
+	buildBatches();
+	allocateTransients();
+	createSemaphores();
+
+	m_Compiled = true;
+}
+
+void RenderGraph::cullPasses()
+{
+	//Walks backwards from the outputs, a pass is kept if something later needs what it wrote
+	std::vector<bool> needed(m_Resources.size());
+	for (size_t i = 0; i < m_Resources.size(); i++)
+		needed[i] = m_Resources[i].output;
+
+	for (size_t i = m_Passes.size(); i-- > 0;)
+	{
+		Pass& pass = m_Passes[i];
+
+		bool alive = pass.sideEffect;
+		for (const Use& use : pass.uses)
+			alive = alive || (use.write && needed[use.resource]);
+
+		pass.culled = !alive;
+		if (!alive)
+			continue;
+
+		//A discarding write ends the need for older contents, anything else reads them
+		for (const Use& use : pass.uses)
+		{
+			if (use.discard)
+				needed[use.resource] = false;
+		}
+		for (const Use& use : pass.uses)
+		{
+			if (!use.discard)
+				needed[use.resource] = true;
+		}
+	}
+}
+
+void RenderGraph::buildBatches()
+{
+	m_Batches.clear();
+	m_Edges.clear();
+	m_Transfers.clear();
+
+	//The prologue releases resources the compute queue needs before the graphics queue has touched them this frame
+	m_Batches.push_back({ Queue::Graphics, {}, false });
+
+	for (PassHandle i = 0; i < m_Passes.size(); i++)
+	{
+		Pass& pass = m_Passes[i];
+		if (pass.culled)
+			continue;
+
+		Queue queue = pass.queue == Queue::AsyncCompute && m_ComputeQueue != VK_NULL_HANDLE ? Queue::AsyncCompute : Queue::Graphics;
+		if (m_Batches.size() == 1 || m_Batches.back().queue != queue)
+			m_Batches.push_back({ queue, {}, true });
+
+		pass.batch = static_cast<uint32_t>(m_Batches.size() - 1);
+		m_Batches.back().passes.push_back(i);
+	}
+
+	auto addEdge = [&](uint32_t srcBatch, uint32_t dstBatch, VkPipelineStageFlags waitStage)
+		{
+			m_Batches[srcBatch].used = true;
+			for (Edge& edge : m_Edges)
+			{
+				if (edge.srcBatch == srcBatch && edge.dstBatch == dstBatch)
+				{
+					edge.waitStage |= waitStage;
+					return;
+				}
+			}
+			m_Edges.push_back({ srcBatch, dstBatch, waitStage });
+		};
+
+	//Every resource starts the frame owned by the graphics queue, resources are exclusive so each queue change is a transfer
+	std::vector<Queue> owner(m_Resources.size(), Queue::Graphics);
+	std::vector<uint32_t> lastBatch(m_Resources.size(), 0);
+
+	for (uint32_t batchIndex = 1; batchIndex < m_Batches.size(); batchIndex++)
+	{
+		Batch& batch = m_Batches[batchIndex];
+		for (PassHandle passHandle : batch.passes)
+		{
+			for (const Use& use : m_Passes[passHandle].uses)
+			{
+				if (owner[use.resource] != batch.queue)
+				{
+					addEdge(lastBatch[use.resource], batchIndex, use.stage);
+
+					//Discarded contents don't have to change hands, waiting on the other queue is enough
+					if (!use.discard)
+						m_Transfers.push_back({ use.resource, lastBatch[use.resource], batchIndex, passHandle, use.layout, use.stage, use.access });
+
+					owner[use.resource] = batch.queue;
+				}
+				lastBatch[use.resource] = batchIndex;
+			}
+		}
+	}
+
+	//Anything still on the compute queue is handed back, and every compute batch has to finish before the frame's fence
+	bool needsEpilogue = m_Batches.back().queue != Queue::Graphics;
+	for (size_t i = 0; i < m_Resources.size(); i++)
+		needsEpilogue = needsEpilogue || owner[i] != Queue::Graphics;
+
+	std::vector<uint32_t> leafBatches;
+	for (uint32_t batchIndex = 1; batchIndex < m_Batches.size(); batchIndex++)
+	{
+		if (m_Batches[batchIndex].queue != Queue::AsyncCompute)
+			continue;
+
+		bool waitedOn = std::any_of(m_Edges.begin(), m_Edges.end(), [&](const Edge& edge) { return edge.srcBatch == batchIndex; });
+		if (!waitedOn)
+		{
+			leafBatches.push_back(batchIndex);
+			needsEpilogue = true;
+		}
+	}
+
+	if (needsEpilogue)
+	{
+		m_Batches.push_back({ Queue::Graphics, {}, true });
+		uint32_t epilogue = static_cast<uint32_t>(m_Batches.size() - 1);
+
+		for (ResourceHandle i = 0; i < m_Resources.size(); i++)
+		{
+			if (owner[i] == Queue::Graphics)
+				continue;
+
+			m_Transfers.push_back({ i, lastBatch[i], epilogue, std::nullopt, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT });
+			addEdge(lastBatch[i], epilogue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		}
+		for (uint32_t batchIndex : leafBatches)
+			addEdge(batchIndex, epilogue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+	}
+
+	//The last batch signals the fence, it is submitted even when it is an empty prologue
+	m_Batches.back().used = true;
+}
+
+void RenderGraph::allocateTransients()
+{
+	destroyTransients();
+
+	m_TransientBytes = 0;
+	m_TransientMemoryBytes = 0;
+
+	//Lifetimes in pass order
+	for (Resource& resource : m_Resources)
+	{
+		resource.firstPass = UINT32_MAX;
+		resource.lastPass = 0;
+		resource.aliasWaits.clear();
+		resource.aliased = false;
+	}
+
+	for (PassHandle i = 0; i < m_Passes.size(); i++)
+	{
+		if (m_Passes[i].culled)
+			continue;
+
+		for (const Use& use : m_Passes[i].uses)
+		{
+			Resource& resource = m_Resources[use.resource];
+			if (!resource.transient)
+				continue;
+
+			if (resource.firstPass == UINT32_MAX)
+			{
+				//Aliased memory has no defined contents, the first use has to overwrite it
+				if (!use.discard)
+					throw std::runtime_error("transient image " + resource.name + " is read by " + m_Passes[i].name + " before anything wrote it!");
+				resource.firstPass = i;
+			}
+			resource.lastPass = i;
+		}
+	}
+
+	//Images are grouped by memory type, each group is one allocation
+	std::map<uint32_t, std::vector<ResourceHandle>> memoryGroups;
+	std::vector<VkMemoryRequirements> requirements(m_Resources.size());
+
+	for (ResourceHandle i = 0; i < m_Resources.size(); i++)
+	{
+		Resource& resource = m_Resources[i];
+		if (!resource.transient || resource.firstPass == UINT32_MAX)
+			continue;
+
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = resource.desc.format;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = resource.desc.usage;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(m_Device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+			throw std::runtime_error("failed to create transient image " + resource.name + "!");
+
+		vkGetImageMemoryRequirements(m_Device, resource.image, &requirements[i]);
+		resource.memorySize = requirements[i].size;
+		resource.state = {};
+		m_TransientBytes += requirements[i].size;
+
+		uint32_t memoryType = Helper::findMemoryType(m_PhysicalDevice, requirements[i].memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		memoryGroups[memoryType].push_back(i);
+	}
+
+	for (auto& [memoryType, group] : memoryGroups)
+	{
+		//Biggest first, each image goes at the lowest offset that no image alive at the same time occupies
+		std::sort(group.begin(), group.end(), [&](ResourceHandle a, ResourceHandle b) { return m_Resources[a].memorySize > m_Resources[b].memorySize; });
+
+		VkDeviceSize blockSize = 0;
+		VkDeviceSize blockAlignment = 1;
+		std::vector<ResourceHandle> placed;
+		for (ResourceHandle handle : group)
+		{
+			Resource& resource = m_Resources[handle];
+			VkDeviceSize alignment = requirements[handle].alignment;
+			blockAlignment = std::max(blockAlignment, alignment);
+
+			std::vector<std::pair<VkDeviceSize, VkDeviceSize>> occupied;
+			for (ResourceHandle other : placed)
+			{
+				const Resource& placedResource = m_Resources[other];
+				if (placedResource.lastPass < resource.firstPass || resource.lastPass < placedResource.firstPass)
+					continue;
+				occupied.push_back({ placedResource.memoryOffset, placedResource.memoryOffset + placedResource.memorySize });
+			}
+			std::sort(occupied.begin(), occupied.end());
+
+			VkDeviceSize offset = 0;
+			for (auto& range : occupied)
+			{
+				VkDeviceSize aligned = (offset + alignment - 1) / alignment * alignment;
+				if (aligned + resource.memorySize <= range.first)
+					break;
+				offset = std::max(offset, range.second);
+			}
+			offset = (offset + alignment - 1) / alignment * alignment;
+
+			resource.memoryOffset = offset;
+			resource.memoryBlock = static_cast<uint32_t>(m_TransientMemory.size());
+			blockSize = std::max(blockSize, offset + resource.memorySize);
+			placed.push_back(handle);
+		}
+
+		//Offsets in the group are aligned to the biggest alignment in it, so is the allocation
+		VkMemoryRequirements groupRequirements{};
+		groupRequirements.size = blockSize;
+		groupRequirements.alignment = blockAlignment;
+		groupRequirements.memoryTypeBits = 1u << memoryType;
+
+		MemoryAllocator::Allocation* memory = m_Allocator->allocate(groupRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryAllocator::ResourceKind::Image);
+		m_TransientMemory.push_back(memory);
+		m_TransientMemoryBytes += blockSize;
+
+		for (ResourceHandle handle : group)
+		{
+			Resource& resource = m_Resources[handle];
+			vkBindImageMemory(m_Device, resource.image, memory->memory, memory->offset + resource.memoryOffset);
+
+			VkImageViewCreateInfo viewInfo{};
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewInfo.image = resource.image;
+			viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewInfo.format = resource.desc.format;
+			viewInfo.subresourceRange = subresourceRange(resource, false);
+
+			if (vkCreateImageView(m_Device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS)
+				throw std::runtime_error("failed to create transient image view " + resource.name + "!");
+
+			//The first use of the frame waits for whoever last used the same memory
+			std::vector<ResourceHandle> earlier;
+			std::vector<ResourceHandle> overlapping;
+			for (ResourceHandle other : group)
+			{
+				const Resource& otherResource = m_Resources[other];
+				if (other == handle || otherResource.memoryOffset >= resource.memoryOffset + resource.memorySize ||
+					resource.memoryOffset >= otherResource.memoryOffset + otherResource.memorySize)
+					continue;
+
+				overlapping.push_back(other);
+				if (otherResource.lastPass < resource.firstPass)
+					earlier.push_back(other);
+			}
+
+			//Without an earlier user this frame, the previous frame's users of the memory (itself included) are the ones to wait for
+			resource.aliased = !overlapping.empty();
+			resource.aliasWaits = earlier.empty() ? overlapping : earlier;
+			if (earlier.empty())
+				resource.aliasWaits.push_back(handle);
+		}
+	}
+}
+
+void RenderGraph::destroyTransients()
+{
+	VkDevice device = m_Device;
+	std::vector<VkImage> images;
+	std::vector<VkImageView> views;
+	for (Resource& resource : m_Resources)
+	{
+		if (!resource.transient || resource.image == VK_NULL_HANDLE)
+			continue;
+
+		images.push_back(resource.image);
+		views.push_back(resource.view);
+		resource.image = VK_NULL_HANDLE;
+		resource.view = VK_NULL_HANDLE;
+	}
+	MemoryAllocator* allocator = m_Allocator;
+	std::vector<MemoryAllocator::Allocation*> memory = m_TransientMemory;
+	m_TransientMemory.clear();
+
+	if (images.empty() && memory.empty())
+		return;
+
+	//Frames in flight may still use them
+	m_DeletionQueue->push([=]()
+		{
+			for (VkImageView view : views)
+				vkDestroyImageView(device, view, nullptr);
+			for (VkImage image : images)
+				vkDestroyImage(device, image, nullptr);
+			for (MemoryAllocator::Allocation* block : memory)
+				allocator->free(block);
+		});
+}
+
+void RenderGraph::createSemaphores()
+{
+	if (!m_EdgeSemaphores.empty())
+	{
+		VkDevice device = m_Device;
+		std::vector<std::vector<VkSemaphore>> semaphores = m_EdgeSemaphores;
+		m_DeletionQueue->push([=]()
+			{
+				for (auto& frame : semaphores)
+				{
+					for (VkSemaphore semaphore : frame)
+						vkDestroySemaphore(device, semaphore, nullptr);
+				}
+			});
+	}
+
+	m_EdgeSemaphores.assign(m_MaxFramesInFlight, std::vector<VkSemaphore>(m_Edges.size(), VK_NULL_HANDLE));
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	for (auto& frame : m_EdgeSemaphores)
+	{
+		for (VkSemaphore& semaphore : frame)
+		{
+			if (vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+				throw std::runtime_error("failed to create render graph semaphore!");
+		}
+	}
+}
+
+void RenderGraph::setBuffer(ResourceHandle resource, VkBuffer buffer)
+{
+	Resource& imported = m_Resources[checkResource(resource)];
+	if (imported.buffer != buffer)
+		imported.state = {};
+	imported.buffer = buffer;
+}
+
+void RenderGraph::setImage(ResourceHandle resource, VkImage image)
+{
+	Resource& imported = m_Resources[checkResource(resource)];
+	if (imported.image != image)
+		imported.state = {};
+	imported.image = image;
+}
+
+void RenderGraph::setExternalImage(ResourceHandle resource, VkImage image, VkImageLayout currentLayout, VkPipelineStageFlags readyStage)
+{
+	Resource& imported = m_Resources[checkResource(resource)];
+	imported.image = image;
+	imported.state = {};
+	imported.state.layout = currentLayout;
+	imported.state.writeStages = readyStage;
+}
+
+VkCommandBuffer RenderGraph::getCommandBuffer(uint32_t currentFrame, Queue queue)
+{
+	FrameCommands& frame = m_FrameCommands[currentFrame];
+	bool compute = queue == Queue::AsyncCompute;
+
+	std::vector<VkCommandBuffer>& buffers = compute ? frame.computeBuffers : frame.graphicsBuffers;
+	uint32_t& used = compute ? frame.computeUsed : frame.graphicsUsed;
+
+	if (used == buffers.size())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = compute ? frame.computePool : frame.graphicsPool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		if (vkAllocateCommandBuffers(m_Device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("failed to allocate render graph command buffer!");
+		buffers.push_back(commandBuffer);
+	}
+	return buffers[used++];
+}
+
+VkImageSubresourceRange RenderGraph::subresourceRange(const Resource& resource, bool barrier)
+{
+	VkImageSubresourceRange range{};
+	range.aspectMask = resource.aspect;
+	if (barrier && (resource.desc.format == VK_FORMAT_D32_SFLOAT_S8_UINT || resource.desc.format == VK_FORMAT_D24_UNORM_S8_UINT))
+		range.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	range.baseMipLevel = 0;
+	range.levelCount = VK_REMAINING_MIP_LEVELS;
+	range.baseArrayLayer = 0;
+	range.layerCount = VK_REMAINING_ARRAY_LAYERS;
+	return range;
+}
+
+void RenderGraph::applyUse(Resource& resource, const Use& use, bool transition)
+{
+	ResourceState& state = resource.state;
+	if (resource.isImage)
+		state.layout = use.layout;
+
+	if (use.write)
+	{
+		state.writeStages = use.stage;
+		state.writeAccess = use.access & WRITE_ACCESS;
+		state.readStages = 0;
+		state.visibleStages = 0;
+		state.visibleAccess = 0;
+	}
+	else if (transition)
+	{
+		//The transition is the last write, it is already visible to this use
+		state.writeStages = use.stage;
+		state.writeAccess = 0;
+		state.readStages = use.stage;
+		state.visibleStages = use.stage;
+		state.visibleAccess = use.access;
+	}
+	else
+	{
+		state.readStages |= use.stage;
+		if (state.writeStages != 0)
+		{
+			state.visibleStages |= use.stage;
+			state.visibleAccess |= use.access;
+		}
+	}
+}
+
+void RenderGraph::addUseBarrier(Barriers& barriers, Resource& resource, const Use& use, bool forceDiscard)
+{
+	ResourceState& state = resource.state;
+
+	bool discard = use.discard || forceDiscard;
+	bool transition = resource.isImage && (use.layout != state.layout || forceDiscard);
+	VkPipelineStageFlags pending = state.writeStages | state.readStages;
+
+	if (transition)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = state.writeAccess;
+		barrier.dstAccessMask = use.access;
+		barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+		barrier.newLayout = use.layout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.image;
+		barrier.subresourceRange = subresourceRange(resource);
+		barriers.images.push_back(barrier);
+
+		barriers.srcStages |= pending != 0 ? pending : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		barriers.dstStages |= use.stage;
+	}
+	else if (use.write)
+	{
+		//Write after write needs the old write flushed, write after read only has to wait for the reads
+		if (pending != 0)
+		{
+			barriers.srcStages |= pending;
+			barriers.dstStages |= use.stage;
+			if (state.writeAccess != 0)
+			{
+				barriers.memory.srcAccessMask |= state.writeAccess;
+				barriers.memory.dstAccessMask |= use.access;
+			}
+		}
+	}
+	else if (state.writeStages != 0 && ((use.stage & ~state.visibleStages) != 0 || (use.access & ~state.visibleAccess) != 0))
+	{
+		barriers.srcStages |= state.writeStages;
+		barriers.dstStages |= use.stage;
+		if (state.writeAccess != 0)
+		{
+			barriers.memory.srcAccessMask |= state.writeAccess;
+			barriers.memory.dstAccessMask |= use.access;
+		}
+	}
+
+	applyUse(resource, use, transition);
+}
+
+void RenderGraph::addReleaseBarrier(Barriers& barriers, Transfer& transfer)
+{
+	Resource& resource = m_Resources[transfer.resource];
+	ResourceState& state = resource.state;
+
+	VkPipelineStageFlags pending = state.writeStages | state.readStages;
+	uint32_t srcFamily = queueFamily(m_Batches[transfer.srcBatch].queue);
+	uint32_t dstFamily = queueFamily(m_Batches[transfer.dstBatch].queue);
+
+	transfer.releasedLayout = state.layout;
+	VkImageLayout newLayout = transfer.dstLayout != VK_IMAGE_LAYOUT_UNDEFINED ? transfer.dstLayout : state.layout;
+
+	//The semaphore between the batches does the rest of the synchronization
+	if (resource.isImage)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = state.writeAccess;
+		barrier.dstAccessMask = 0;
+		barrier.oldLayout = state.layout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = srcFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		barrier.image = resource.image;
+		barrier.subresourceRange = subresourceRange(resource);
+		barriers.images.push_back(barrier);
+	}
+	else
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = state.writeAccess;
+		barrier.dstAccessMask = 0;
+		barrier.srcQueueFamilyIndex = srcFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		barrier.buffer = resource.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		barriers.buffers.push_back(barrier);
+	}
+
+	barriers.srcStages |= pending != 0 ? pending : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	barriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+}
+
+void RenderGraph::addAcquireBarrier(Barriers& barriers, Transfer& transfer)
+{
+	Resource& resource = m_Resources[transfer.resource];
+	uint32_t srcFamily = queueFamily(m_Batches[transfer.srcBatch].queue);
+	uint32_t dstFamily = queueFamily(m_Batches[transfer.dstBatch].queue);
+	VkImageLayout newLayout = transfer.dstLayout != VK_IMAGE_LAYOUT_UNDEFINED ? transfer.dstLayout : transfer.releasedLayout;
+
+	if (resource.isImage)
+	{
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = transfer.dstAccess;
+		barrier.oldLayout = transfer.releasedLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = srcFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		barrier.image = resource.image;
+		barrier.subresourceRange = subresourceRange(resource);
+		barriers.images.push_back(barrier);
+	}
+	else
+	{
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = transfer.dstAccess;
+		barrier.srcQueueFamilyIndex = srcFamily;
+		barrier.dstQueueFamilyIndex = dstFamily;
+		barrier.buffer = resource.buffer;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		barriers.buffers.push_back(barrier);
+	}
+
+	barriers.srcStages |= VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	barriers.dstStages |= transfer.dstStage;
+
+	//Nothing is pending on this queue, the acquire counts as a transition for whatever comes next
+	resource.state = {};
+	resource.state.layout = newLayout;
+	resource.state.writeStages = transfer.dstStage;
+	resource.state.visibleStages = transfer.dstStage;
+	resource.state.visibleAccess = transfer.dstAccess;
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer commandBuffer, Barriers& barriers)
+{
+	if (barriers.count() == 0 && barriers.srcStages == 0)
+		return;
+
+	barriers.memory.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	bool memoryBarrier = barriers.memory.srcAccessMask != 0 || barriers.memory.dstAccessMask != 0;
+
+	vkCmdPipelineBarrier(commandBuffer,
+		barriers.srcStages != 0 ? barriers.srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT),
+		barriers.dstStages != 0 ? barriers.dstStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT),
+		0,
+		memoryBarrier ? 1 : 0, memoryBarrier ? &barriers.memory : nullptr,
+		static_cast<uint32_t>(barriers.buffers.size()), barriers.buffers.data(),
+		static_cast<uint32_t>(barriers.images.size()), barriers.images.data());
+}
+
+void RenderGraph::execute(uint32_t currentFrame, VkSemaphore waitSemaphore, VkPipelineStageFlags waitStage, VkSemaphore signalSemaphore, VkFence fence)
+{
+	if (!m_Compiled)
+		throw std::runtime_error("render graph executed before it was compiled!");
+
+	//The frame's fence has signaled, nothing recorded from these pools is pending
+	FrameCommands& frameCommands = m_FrameCommands[currentFrame];
+	vkResetCommandPool(m_Device, frameCommands.graphicsPool, 0);
+	frameCommands.graphicsUsed = 0;
+	if (frameCommands.computePool != VK_NULL_HANDLE)
+	{
+		vkResetCommandPool(m_Device, frameCommands.computePool, 0);
+		frameCommands.computeUsed = 0;
+	}
+
+	uint32_t lastBatch = static_cast<uint32_t>(m_Batches.size() - 1);
+	std::vector<VkCommandBuffer> commandBuffers(m_Batches.size(), VK_NULL_HANDLE);
+
+	for (uint32_t batchIndex = 0; batchIndex < m_Batches.size(); batchIndex++)
+	{
+		Batch& batch = m_Batches[batchIndex];
+		if (!batch.used)
+			continue;
+
+		VkCommandBuffer commandBuffer = getCommandBuffer(currentFrame, batch.queue);
+		commandBuffers[batchIndex] = commandBuffer;
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+			throw std::runtime_error("failed to begin recording render graph command buffer!");
+
+		for (PassHandle passHandle : batch.passes)
+		{
+			Pass& pass = m_Passes[passHandle];
+
+			Barriers barriers;
+			for (const Use& use : pass.uses)
+			{
+				Resource& resource = m_Resources[use.resource];
+				if (resource.isImage ? resource.image == VK_NULL_HANDLE : resource.buffer == VK_NULL_HANDLE)
+					throw std::runtime_error("render graph resource " + resource.name + " used by " + pass.name + " was never set!");
+
+				auto transfer = std::find_if(m_Transfers.begin(), m_Transfers.end(), [&](const Transfer& t) { return t.dstPass == passHandle && t.resource == use.resource; });
+				if (transfer != m_Transfers.end())
+				{
+					addAcquireBarrier(barriers, *transfer);
+					applyUse(resource, use, true);
+					continue;
+				}
+
+				//The first use of a transient takes over its memory from whoever had it last
+				bool forceDiscard = false;
+				if (resource.transient && resource.firstPass == passHandle)
+				{
+					ResourceState waits{};
+					for (ResourceHandle other : resource.aliasWaits)
+					{
+						const ResourceState& otherState = m_Resources[other].state;
+						waits.writeStages |= otherState.writeStages | otherState.readStages;
+						waits.writeAccess |= otherState.writeAccess;
+					}
+					waits.layout = resource.state.layout;
+					resource.state = waits;
+					forceDiscard = resource.aliased;
+				}
+
+				addUseBarrier(barriers, resource, use, forceDiscard);
+			}
+
+			pass.barrierCount = static_cast<uint32_t>(barriers.count());
+			recordBarriers(commandBuffer, barriers);
+
+			pass.execute(commandBuffer, currentFrame);
+		}
+
+		Barriers releases;
+		for (Transfer& transfer : m_Transfers)
+		{
+			if (transfer.srcBatch == batchIndex)
+				addReleaseBarrier(releases, transfer);
+		}
+		recordBarriers(commandBuffer, releases);
+
+		//Everything comes back to the graphics queue and outputs are left ready for whoever reads them after the frame
+		if (batchIndex == lastBatch)
+		{
+			Barriers acquires;
+			for (Transfer& transfer : m_Transfers)
+			{
+				if (transfer.dstBatch == batchIndex && !transfer.dstPass.has_value())
+					addAcquireBarrier(acquires, transfer);
+			}
+			recordBarriers(commandBuffer, acquires);
+
+			Barriers finals;
+			for (Resource& resource : m_Resources)
+			{
+				if (!resource.finalAccess.has_value())
+					continue;
+
+				AccessInfo info = getAccessInfo(resource.finalAccess.value(), resource.aspect);
+				Use use{};
+				use.stage = info.stage;
+				use.access = info.access & ~WRITE_ACCESS;
+				use.layout = resource.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+				use.write = false;
+				use.discard = false;
+				addUseBarrier(finals, resource, use, false);
+			}
+			recordBarriers(commandBuffer, finals);
+		}
+
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+			throw std::runtime_error("failed to record render graph command buffer!");
+	}
+
+	//Batches are submitted in order, so every binary semaphore is signaled before its wait is submitted
+	bool waited = false;
+	for (uint32_t batchIndex = 0; batchIndex < m_Batches.size(); batchIndex++)
+	{
+		Batch& batch = m_Batches[batchIndex];
+		if (!batch.used)
+			continue;
+
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStages;
+		std::vector<VkSemaphore> signalSemaphores;
+
+		for (size_t i = 0; i < m_Edges.size(); i++)
+		{
+			if (m_Edges[i].dstBatch == batchIndex)
+			{
+				waitSemaphores.push_back(m_EdgeSemaphores[currentFrame][i]);
+				waitStages.push_back(m_Edges[i].waitStage);
+			}
+			if (m_Edges[i].srcBatch == batchIndex)
+				signalSemaphores.push_back(m_EdgeSemaphores[currentFrame][i]);
+		}
+
+		if (!waited && batch.queue == Queue::Graphics && waitSemaphore != VK_NULL_HANDLE)
+		{
+			waitSemaphores.push_back(waitSemaphore);
+			waitStages.push_back(waitStage);
+			waited = true;
+		}
+
+		if (batchIndex == lastBatch && signalSemaphore != VK_NULL_HANDLE)
+			signalSemaphores.push_back(signalSemaphore);
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+		submitInfo.pWaitSemaphores = waitSemaphores.data();
+		submitInfo.pWaitDstStageMask = waitStages.data();
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffers[batchIndex];
+		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
+		submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+		VkQueue queue = batch.queue == Queue::AsyncCompute ? m_ComputeQueue : m_GraphicsQueue;
+		if (vkQueueSubmit(queue, 1, &submitInfo, batchIndex == lastBatch ? fence : VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("failed to submit render graph batch!");
+	}
+}
+
+RenderGraph::AccessInfo RenderGraph::getAccessInfo(Access access, VkImageAspectFlags aspect)
+{
+	bool depth = (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+	VkImageLayout sampledLayout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	switch (access)
+	{
+	case Access::IndirectRead:
+		return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case Access::VertexRead:
+		return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case Access::UniformRead:
+		return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false };
+	case Access::ComputeRead:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case Access::ComputeWrite:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
+	case Access::ComputeReadWrite:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true };
+	case Access::ComputeSampled:
+		return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, sampledLayout, false };
+	case Access::FragmentSampled:
+		return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, sampledLayout, false };
+	case Access::ColorAttachment:
+		return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true };
+	case Access::DepthAttachment:
+		return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true };
+	case Access::DepthRead:
+		return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false };
+	case Access::TransferRead:
+		return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false };
+	case Access::TransferWrite:
+		return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true };
+	case Access::HostRead:
+		return { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false };
+	case Access::Present:
+		return { VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false };
+	}
+	throw std::invalid_argument("unknown render graph access!");
+}
+
+RenderGraph::AccessInfo RenderGraph::getLayoutInfo(VkImageLayout layout)
+{
+	switch (layout)
+	{
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+		return { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, layout, false };
+	case VK_IMAGE_LAYOUT_PREINITIALIZED:
+		return { VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_WRITE_BIT, layout, true };
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		return getAccessInfo(Access::ColorAttachment);
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		return getAccessInfo(Access::DepthAttachment, VK_IMAGE_ASPECT_DEPTH_BIT);
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+		return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT, layout, false };
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		return { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, layout, false };
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		return getAccessInfo(Access::TransferRead);
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		return getAccessInfo(Access::TransferWrite);
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		return getAccessInfo(Access::Present);
+	default:
+		return { VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT, layout, true };
+	}
+}
+
+void RenderGraph::renderGraphGui(std::vector<void*> classInstances)
+{
+	RenderGraph* graph = (RenderGraph*)classInstances.at(0);
+	DevTools::newDock("Render-Graph");
+
+	for (const Pass& pass : graph->m_Passes)
+	{
+		if (pass.culled)
+		{
+			DevTools::coloredText({ 0.5, 0.5, 0.5 }, pass.name + " (culled)");
+			continue;
+		}
+
+		std::string queue = graph->m_Batches[pass.batch].queue == Queue::AsyncCompute ? "compute" : "graphics";
+		DevTools::coloredText({ 0.8, 0.8, 0.8 }, pass.name + ": " + queue + " batch " + std::to_string(pass.batch) + ", " + std::to_string(pass.barrierCount) + " barriers");
+	}
+
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Queue transfers: " + std::to_string(graph->m_Transfers.size()) + ", semaphores: " + std::to_string(graph->m_Edges.size()));
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Transient images: " + std::to_string(graph->m_TransientBytes / 1024) + " KB in " + std::to_string(graph->m_TransientMemoryBytes / 1024) + " KB");
+	DevTools::endDock();
+}
@@ -0,0 +1,320 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <functional>
+#include <optional>
+
+#include "DeletionQueue.h"
+#include "MemoryAllocator.h"
+
+/*
+-------------Render Graph----------------
+
+Passes declare the resources they read and write and how, the graph works out everything in between:
+	Barriers: each pass gets a single vkCmdPipelineBarrier holding only the hazards it has with earlier work.
+			  Reads after reads in the same layout need nothing, image layouts follow from the declared access.
+	Culling: passes whose writes never reach an output or a side effect pass are not recorded.
+	Aliasing: transient images that are never alive at the same time share memory.
+	Queues: AsyncCompute passes are submitted to the dedicated compute family when the device has one, with semaphores
+			and queue family ownership transfers where resources cross queues. Without one they run on the graphics queue.
+
+Passes run in the order they were added. Passes and resources are declared once, compile() has to be called again
+whenever a transient image changes size. Imported resources get their Vulkan handle every frame with setBuffer/setImage.
+
+Render passes used by graph passes must not transition their attachments, initialLayout and finalLayout should both be
+the layout of the attachment's access (getAccessInfo(Access::ColorAttachment).layout). The barriers around the pass
+cover the load and store ops.
+*/
+class RenderGraph
+{
+public:
+	typedef uint32_t ResourceHandle;
+	typedef uint32_t PassHandle;
+
+	enum class Queue
+	{
+		Graphics,
+		AsyncCompute
+	};
+
+	//! How a pass touches a resource
+	enum class Access
+	{
+		IndirectRead,		//Indirect draw or dispatch arguments
+		VertexRead,			//Vertex and index buffers
+		UniformRead,		//Uniform buffers in the vertex or fragment shader
+		ComputeRead,		//Storage buffers and images in a compute shader
+		ComputeWrite,
+		ComputeReadWrite,
+		ComputeSampled,		//Sampled images in a compute shader
+		FragmentSampled,
+		ColorAttachment,
+		DepthAttachment,
+		DepthRead,			//Read only depth attachment
+		TransferRead,
+		TransferWrite,
+		HostRead,
+		Present
+	};
+
+	struct AccessInfo
+	{
+		VkPipelineStageFlags stage;
+		VkAccessFlags access;
+		VkImageLayout layout;//VK_IMAGE_LAYOUT_UNDEFINED for buffer only accesses
+		bool write;
+	};
+
+	struct ImageDesc
+	{
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		VkExtent2D extent = {};
+		VkImageUsageFlags usage = 0;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	};
+
+	typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t currentFrame)> ExecuteFunction;
+
+public:
+	RenderGraph() = default;
+
+	//! computeQueue is VK_NULL_HANDLE when the device has no separate compute family
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator& allocator, uint32_t graphicsFamily, VkQueue graphicsQueue, std::optional<uint32_t> computeFamily, VkQueue computeQueue, int maxFramesInFlight, DeletionQueue& deletionQueue);
+
+	void cleanup();
+
+	ResourceHandle importBuffer(const std::string& name);
+	ResourceHandle importImage(const std::string& name, VkImageAspectFlags aspect);
+
+	//! Created and owned by the graph, memory is only reserved for the passes between its first and last use
+	ResourceHandle createImage(const std::string& name, const ImageDesc& desc);
+
+	//! Takes effect on the next compile
+	void setImageDesc(ResourceHandle resource, const ImageDesc& desc);
+
+	PassHandle addPass(const std::string& name, Queue queue, ExecuteFunction execute);
+
+	//! layout overrides the one implied by the access, e.g. VK_IMAGE_LAYOUT_GENERAL for an image that is sampled and stored to
+	void read(PassHandle pass, ResourceHandle resource, Access access, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	//! discard when the pass overwrites all of it, images then transition from VK_IMAGE_LAYOUT_UNDEFINED
+	void write(PassHandle pass, ResourceHandle resource, Access access, bool discard = false, VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED);
+
+	//! Never culled, for passes whose work leaves the graph in some other way (queries, host writes)
+	void setSideEffect(PassHandle pass);
+
+	//! Used after the graph finishes (presented, read by the host or the next frame)
+	void markOutput(ResourceHandle resource);
+	//! Same, and the last batch of the frame leaves it ready for finalAccess
+	void markOutput(ResourceHandle resource, Access finalAccess);
+
+	//! Culls passes, splits them into queue batches and (re)allocates transient images, old ones go through the deletion queue
+	void compile();
+
+	//! A different buffer than last frame starts with nothing pending, the same one keeps the state the graph left it in
+	void setBuffer(ResourceHandle resource, VkBuffer buffer);
+
+	//! Same as setBuffer, a new image starts out in VK_IMAGE_LAYOUT_UNDEFINED
+	void setImage(ResourceHandle resource, VkImage image);
+
+	//! For images handed over from outside every frame (swapchain), always starts over in currentLayout.
+	//! readyStage is where the image becomes usable, the wait stage of the acquire semaphore for swapchain images.
+	void setExternalImage(ResourceHandle resource, VkImage image, VkImageLayout currentLayout, VkPipelineStageFlags readyStage);
+
+	VkImage getImage(ResourceHandle resource)
+	{
+		return m_Resources[resource].image;
+	}
+
+	//! Transient images only
+	VkImageView getImageView(ResourceHandle resource)
+	{
+		return m_Resources[resource].view;
+	}
+
+	bool isCulled(PassHandle pass)
+	{
+		return m_Passes[pass].culled;
+	}
+
+	//! Records and submits every batch of the frame. The first graphics batch waits on waitSemaphore,
+	//! the last one signals signalSemaphore and fence. Both semaphores may be VK_NULL_HANDLE.
+	void execute(uint32_t currentFrame, VkSemaphore waitSemaphore, VkPipelineStageFlags waitStage, VkSemaphore signalSemaphore, VkFence fence);
+
+	//! image aspect decides the read only layout of sampled depth images
+	static AccessInfo getAccessInfo(Access access, VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+
+	//! Stages and accesses an image in this layout is usually used with, for one off transitions outside the graph
+	static AccessInfo getLayoutInfo(VkImageLayout layout);
+
+	static void renderGraphGui(std::vector<void*> classInstances);
+
+private:
+	struct Use
+	{
+		ResourceHandle resource;
+		VkPipelineStageFlags stage;
+		VkAccessFlags access;
+		VkImageLayout layout;
+		bool write;
+		bool discard;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		Queue queue;
+		ExecuteFunction execute;
+		std::vector<Use> uses;//One per resource
+		bool sideEffect = false;
+
+		//Compiled
+		bool culled = false;
+		uint32_t batch = 0;
+		uint32_t barrierCount = 0;//Last frame, for the dock
+	};
+
+	//! Pipeline state a resource was last left in by the recorded commands
+	struct ResourceState
+	{
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags writeStages = 0;//Last write, or last layout transition
+		VkAccessFlags writeAccess = 0;
+		VkPipelineStageFlags readStages = 0;//Reads since the last write
+		VkPipelineStageFlags visibleStages = 0;//Stages the last write was already made visible to
+		VkAccessFlags visibleAccess = 0;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		bool isImage = false;
+		bool transient = false;
+		bool output = false;
+		std::optional<Access> finalAccess;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		ImageDesc desc;
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		ResourceState state;
+
+		//Compiled, transient only
+		uint32_t firstPass = UINT32_MAX;
+		uint32_t lastPass = 0;
+		uint32_t memoryBlock = 0;
+		VkDeviceSize memoryOffset = 0;
+		VkDeviceSize memorySize = 0;
+		std::vector<ResourceHandle> aliasWaits;//Whose last use the first use of the frame has to wait for, includes itself
+		bool aliased = false;
+	};
+
+	//! One vkQueueSubmit, a run of passes on the same queue
+	struct Batch
+	{
+		Queue queue;
+		std::vector<PassHandle> passes;
+		bool used = false;//The prologue is only submitted when something waits on it
+	};
+
+	//! Cross queue dependency, signaled by the source batch and waited on by the destination
+	struct Edge
+	{
+		uint32_t srcBatch;
+		uint32_t dstBatch;
+		VkPipelineStageFlags waitStage;
+	};
+
+	//! Queue family ownership transfer, released at the end of srcBatch and acquired before dstPass (or at the end of the frame)
+	struct Transfer
+	{
+		ResourceHandle resource;
+		uint32_t srcBatch;
+		uint32_t dstBatch;
+		std::optional<PassHandle> dstPass;
+		VkImageLayout dstLayout;//VK_IMAGE_LAYOUT_UNDEFINED keeps the layout it is released in
+		VkPipelineStageFlags dstStage;
+		VkAccessFlags dstAccess;
+		VkImageLayout releasedLayout = VK_IMAGE_LAYOUT_UNDEFINED;//Recorded by the release so the acquire matches it
+	};
+
+	struct Barriers
+	{
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		VkMemoryBarrier memory{};
+		std::vector<VkImageMemoryBarrier> images;
+		std::vector<VkBufferMemoryBarrier> buffers;
+
+		size_t count()
+		{
+			return (memory.srcAccessMask != 0 || memory.dstAccessMask != 0 ? 1 : 0) + images.size() + buffers.size();
+		}
+	};
+
+	PassHandle checkPass(PassHandle pass);
+	ResourceHandle checkResource(ResourceHandle resource);
+	void addUse(PassHandle pass, ResourceHandle resource, Access access, VkImageLayout layout, bool write, bool discard);
+
+	void cullPasses();
+	void buildBatches();
+	void allocateTransients();
+	void destroyTransients();
+	void createSemaphores();
+
+	uint32_t queueFamily(Queue queue)
+	{
+		return queue == Queue::AsyncCompute && m_ComputeQueue != VK_NULL_HANDLE ? m_ComputeFamily : m_GraphicsFamily;
+	}
+
+	VkCommandBuffer getCommandBuffer(uint32_t currentFrame, Queue queue);
+
+	void addUseBarrier(Barriers& barriers, Resource& resource, const Use& use, bool forceDiscard);
+	void addReleaseBarrier(Barriers& barriers, Transfer& transfer);
+	void addAcquireBarrier(Barriers& barriers, Transfer& transfer);
+	static void applyUse(Resource& resource, const Use& use, bool transition);
+	void recordBarriers(VkCommandBuffer commandBuffer, Barriers& barriers);
+
+	//! Views only see the declared aspect, barriers on a combined depth stencil format must name both
+	VkImageSubresourceRange subresourceRange(const Resource& resource, bool barrier = true);
+
+private:
+	VkDevice m_Device = VK_NULL_HANDLE;
+	VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+	MemoryAllocator* m_Allocator = nullptr;
+	DeletionQueue* m_DeletionQueue = nullptr;
+	int m_MaxFramesInFlight = 0;
+
+	uint32_t m_GraphicsFamily = 0;
+	uint32_t m_ComputeFamily = 0;
+	VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
+	VkQueue m_ComputeQueue = VK_NULL_HANDLE;
+
+	std::vector<Pass> m_Passes;
+	std::vector<Resource> m_Resources;
+
+	//Compiled
+	bool m_Compiled = false;
+	std::vector<Batch> m_Batches;//[0] is the prologue, the last one is always on the graphics queue
+	std::vector<Edge> m_Edges;
+	std::vector<Transfer> m_Transfers;
+	std::vector<std::vector<VkSemaphore>> m_EdgeSemaphores;//[frame][edge]
+
+	std::vector<MemoryAllocator::Allocation*> m_TransientMemory;
+	VkDeviceSize m_TransientBytes = 0;//Sum of every transient image
+	VkDeviceSize m_TransientMemoryBytes = 0;//Actually allocated after aliasing
+
+	//Per frame command pools, reset once the frame's fence has signaled
+	struct FrameCommands
+	{
+		VkCommandPool graphicsPool = VK_NULL_HANDLE;
+		VkCommandPool computePool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> graphicsBuffers;
+		std::vector<VkCommandBuffer> computeBuffers;
+		uint32_t graphicsUsed = 0;
+		uint32_t computeUsed = 0;
+	};
+	std::vector<FrameCommands> m_FrameCommands;
+};
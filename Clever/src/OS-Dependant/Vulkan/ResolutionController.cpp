@@ -0,0 +1,119 @@
+#include "ResolutionController.h"
+#include "Clever/Developer/DevTools.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+void ResolutionController::init(int maxFramesInFlight)
+{
+	m_MaxFramesInFlight = maxFramesInFlight;
+	m_FrameScales.assign(maxFramesInFlight, 0.0f);
+
+	m_Scale = quantize(m_MaxScale);
+	m_RequestedScale = m_Scale;
+
+	DevTools::addDockFunction(resolutionGui, { this });
+}
+
+bool ResolutionController::update(uint32_t currentFrame, float frameMilliseconds, float scaledMilliseconds)
+{
+	float measuredScale = m_FrameScales[currentFrame];
+	float previousScale = m_Scale;
+
+	if (!m_Enabled)
+	{
+		setScale(m_RequestedScale);
+	}
+	else if (measuredScale > 0.0f && frameMilliseconds > 0.0f)
+	{
+		//Converts the measurement to what it would cost at the current scale
+		float pixelRatio = (m_Scale * m_Scale) / (measuredScale * measuredScale);
+		float scaled = std::min(scaledMilliseconds, frameMilliseconds) * pixelRatio;
+		float fixed = frameMilliseconds - std::min(scaledMilliseconds, frameMilliseconds);
+
+		if (!m_HasEstimate)
+		{
+			m_FixedMilliseconds = fixed;
+			m_ScaledMilliseconds = scaled;
+			m_HasEstimate = true;
+		}
+		else
+		{
+			m_FixedMilliseconds = m_FixedMilliseconds * 0.9f + fixed * 0.1f;
+			m_ScaledMilliseconds = m_ScaledMilliseconds * 0.9f + scaled * 0.1f;
+		}
+
+		if (m_Cooldown > 0)
+		{
+			m_Cooldown--;
+		}
+		else if (m_ScaledMilliseconds > 0.0f)
+		{
+			//Scale at which fixed + scaled * (scale / m_Scale)^2 hits the target
+			float budget = m_TargetMilliseconds - m_FixedMilliseconds;
+			float ideal = budget > 0.0f ? m_Scale * std::sqrt(budget / m_ScaledMilliseconds) : m_MinScale;
+
+			if (ideal < m_Scale)
+			{
+				//Floor, so the new scale is under the target
+				setScale(std::floor(ideal / SCALE_STEP + 0.001f) * SCALE_STEP);
+			}
+			else
+			{
+				float next = m_Scale + SCALE_STEP;
+				float nextCost = m_FixedMilliseconds + m_ScaledMilliseconds * (next * next) / (m_Scale * m_Scale);
+				if (nextCost < m_TargetMilliseconds * RAISE_HEADROOM)
+					setScale(next);
+			}
+		}
+	}
+
+	m_FrameScales[currentFrame] = m_Scale;
+	if (m_Scale == previousScale)
+		return false;
+
+	//The estimate follows the scale so the next measurements aren't compared against the old one
+	m_ScaledMilliseconds *= (m_Scale * m_Scale) / (previousScale * previousScale);
+	m_RequestedScale = m_Scale;
+	m_Cooldown = static_cast<uint32_t>(m_MaxFramesInFlight) + COOLDOWN_FRAMES;
+	m_ChangeCount++;
+	return true;
+}
+
+VkExtent2D ResolutionController::getRenderExtent(VkExtent2D extent)
+{
+	VkExtent2D renderExtent;
+	renderExtent.width = std::max(static_cast<uint32_t>(std::lround(extent.width * m_Scale)), 1u);
+	renderExtent.height = std::max(static_cast<uint32_t>(std::lround(extent.height * m_Scale)), 1u);
+	return renderExtent;
+}
+
+float ResolutionController::quantize(float scale)
+{
+	float step = std::round(scale / SCALE_STEP) * SCALE_STEP;
+	return std::clamp(step, std::max(m_MinScale, SCALE_STEP), std::max(m_MaxScale, m_MinScale));
+}
+
+void ResolutionController::setScale(float scale)
+{
+	m_Scale = quantize(scale);
+}
+
+void ResolutionController::resolutionGui(std::vector<void*> classInstances)
+{
+	ResolutionController* controller = (ResolutionController*)classInstances.at(0);
+	DevTools::newDock("Dynamic-Resolution");
+
+	DevTools::checkbox("Follow GPU Time", &controller->m_Enabled);
+	DevTools::floatSlider("Target (ms)", &controller->m_TargetMilliseconds, 4.0f, 50.0f);
+	DevTools::floatSlider("Min Scale", &controller->m_MinScale, SCALE_STEP, 1.0f);
+	DevTools::floatSlider("Max Scale", &controller->m_MaxScale, SCALE_STEP, 1.0f);
+	if (!controller->m_Enabled)
+		DevTools::floatSlider("Scale", &controller->m_RequestedScale, controller->m_MinScale, controller->m_MaxScale);
+
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Scale: " + std::to_string(static_cast<int>(std::lround(controller->m_Scale * 100.0f))) + "%");
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Estimate: " + std::to_string(controller->m_FixedMilliseconds) + " ms fixed, " + std::to_string(controller->m_ScaledMilliseconds) + " ms scaled");
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Changes: " + std::to_string(controller->m_ChangeCount));
+	DevTools::endDock();
+}
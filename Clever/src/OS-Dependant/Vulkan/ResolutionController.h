@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+/*
+-------------Dynamic Resolution----------------
+
+Picks the fraction of the swapchain extent the scene is rendered at so the GPU frame time stays under a target.
+Fed with GPU timestamps, which arrive max_frames_in_flight frames late. Every frame in flight remembers the scale it was
+recorded with so a late measurement is converted to the current scale instead of being mistaken for the new cost.
+
+Cost model: frame = fixed + scaled * scale^2, where scaled is the part of the frame that grows with the pixel count
+(culling and the scene passes) and fixed is everything else (upscale, UI).
+
+The scale moves in steps so the render targets are only recreated now and then. It drops as far as it needs to at once,
+and only ever rises one step at a time with some headroom, so it doesn't oscillate around the target.
+*/
+class ResolutionController
+{
+public:
+	static constexpr float SCALE_STEP = 0.05f;
+	static constexpr float RAISE_HEADROOM = 0.85f;//Only raise when the next step would still be this far under the target
+	static const uint32_t COOLDOWN_FRAMES = 8;//Frames to wait after a change, on top of max_frames_in_flight
+
+public:
+	ResolutionController() = default;
+
+	void init(int maxFramesInFlight);
+
+	//! Call once the frame's fence has signaled, with the timings of the last frame recorded into this frame in flight.
+	//! Returns true when the scale changed and the scene targets have to be resized.
+	bool update(uint32_t currentFrame, float frameMilliseconds, float scaledMilliseconds);
+
+	float getScale()
+	{
+		return m_Scale;
+	}
+
+	//! Never below 1x1
+	VkExtent2D getRenderExtent(VkExtent2D extent);
+
+	static void resolutionGui(std::vector<void*> classInstances);
+
+public:
+	bool m_Enabled = true;//Off keeps the manually chosen scale
+	float m_TargetMilliseconds = 16.6f;
+	float m_MinScale = 0.5f;
+	float m_MaxScale = 1.0f;
+
+private:
+	float quantize(float scale);
+	void setScale(float scale);
+
+private:
+	int m_MaxFramesInFlight = 0;
+
+	float m_Scale = 1.0f;
+	float m_RequestedScale = 1.0f;//Set from the dock, applied on the next update
+	std::vector<float> m_FrameScales;//Scale each frame in flight was recorded with, 0 before its first frame
+
+	//Smoothed, already converted to the current scale
+	float m_FixedMilliseconds = 0.0f;
+	float m_ScaledMilliseconds = 0.0f;
+	bool m_HasEstimate = false;
+
+	uint32_t m_Cooldown = 0;
+	uint32_t m_ChangeCount = 0;
+};
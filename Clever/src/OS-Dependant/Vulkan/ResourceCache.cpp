@@ -0,0 +1,350 @@
+#include "ResourceCache.h"
+#include "PipelineInfo.h"
+#include "Clever/Developer/DevTools.h"
+#include "Clever/Developer/Profiler.h"
+#include "OS-Dependant/Platform/CookedFile.h"
+
+#include <iostream>
+#include <algorithm>
+
+void ResourceCache::init(VkDevice device, VkPhysicalDevice physicalDevice, GeometryBuffer& geometry, DeletionQueue& deletionQueue, ShaderManager& shaders)
+{
+	m_Device = device;
+	m_PhysicalDevice = physicalDevice;
+	m_Geometry = &geometry;
+	m_DeletionQueue = &deletionQueue;
+	m_Shaders = &shaders;
+	m_Cleaned = false;
+	m_Stopping = false;
+	m_Builder = std::thread(&ResourceCache::builderLoop, this);
+
+	DevTools::addDockFunction(resourceGui, { this });
+}
+
+void ResourceCache::cleanup()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stopping = true;
+		m_BuildQueue.clear();
+	}
+	m_BuildWake.notify_all();
+	if (m_Builder.joinable())
+		m_Builder.join();
+
+	update();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	uint32_t leaked = 0;
+	for (auto& entry : m_Meshes.entries)
+	{
+		if (!entry.alive)
+			continue;
+		destroy(entry.resource);
+		leaked++;
+	}
+	for (auto& entry : m_Pipelines.entries)
+	{
+		if (!entry.alive)
+			continue;
+		destroy(entry.resource);
+		leaked++;
+	}
+	if (leaked > 0)
+		std::cerr << "ResourceCache: " << leaked << " resources were still referenced at cleanup" << std::endl;
+
+	m_Meshes = Pool<MeshData>{};
+	m_Pipelines = Pool<VkPipeline>{};
+	m_PipelineDescs.clear();
+	m_Cleaned = true;
+}
+
+template<typename T>
+bool ResourceCache::find(uint64_t key, uint32_t& id)
+{
+	Pool<T>& pool = getPool<T>();
+	auto found = pool.lookup.find(key);
+	if (found == pool.lookup.end())
+		return false;
+
+	id = found->second;
+	pool.entries[id].refCount++;
+	pool.hits++;
+	return true;
+}
+
+template<typename T>
+uint32_t ResourceCache::insert(uint64_t key, const T& resource)
+{
+	uint32_t id;
+	if (find<T>(key, id))
+	{
+		getPool<T>().pendingDestroy.push_back(resource);
+		return id;
+	}
+
+	Pool<T>& pool = getPool<T>();
+	if (!pool.freeIds.empty())
+	{
+		id = pool.freeIds.back();
+		pool.freeIds.pop_back();
+	}
+	else
+	{
+		id = static_cast<uint32_t>(pool.entries.size());
+		pool.entries.emplace_back();
+	}
+
+	typename Pool<T>::Entry& entry = pool.entries[id];
+	entry.resource = resource;
+	entry.key = key;
+	entry.refCount = 1;
+	entry.alive = true;
+	pool.lookup[key] = id;
+	return id;
+}
+
+ResourceRef<MeshData> ResourceCache::acquireMesh(uint64_t key, const std::function<void(MeshData&)>& create)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		uint32_t id;
+		if (find<MeshData>(key, id))
+			return ResourceRef<MeshData>(shared_from_this(), id);
+	}
+
+	//Created without the lock so other threads can keep acquiring, a duplicate made meanwhile is thrown away by insert
+	MeshData mesh(m_Device, m_PhysicalDevice, m_Geometry);
+	create(mesh);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return ResourceRef<MeshData>(shared_from_this(), insert(key, mesh));
+}
+
+ResourceRef<MeshData> ResourceCache::acquireMesh(const std::vector<Vertex>& vertices, const MeshIndices& indices, VertexFormat format)
+{
+	CLEVER_PROFILE_FUNCTION();
+	uint64_t key = CookedFile::hash(vertices.data(), vertices.size() * sizeof(Vertex));
+	key = CookedFile::hash(indices.data(), static_cast<size_t>(indices.count()) * MeshIndices::indexSize(indices.type), key);
+	key = CookedFile::hash(&indices.type, sizeof(indices.type), key);
+	key = CookedFile::hash(&format, sizeof(format), key);
+
+	return acquireMesh(key, [&](MeshData& mesh) { mesh.create(vertices, indices, format); });
+}
+
+ResourceRef<MeshData> ResourceCache::acquireMesh(const MeshCache::CookedMesh& cooked, VertexFormat format)
+{
+	//The cooked streams are a function of the source's content, hashing them again would only cost time
+	const MeshCacheHeader& header = cooked.getHeader();
+	uint64_t key = CookedFile::hash(&header.sourceHash, sizeof(header.sourceHash));
+	key = CookedFile::hash(&header.version, sizeof(header.version), key);
+	key = CookedFile::hash(&format, sizeof(format), key);
+
+	return acquireMesh(key, [&](MeshData& mesh) { mesh.create(cooked, format); });
+}
+
+ResourceRef<VkPipeline> ResourceCache::acquirePipeline(VkRenderPass renderPass, VkPipelineLayout pipelineLayout, ShaderFeatures features, VertexFormat format)
+{
+	uint64_t key = CookedFile::hash(&renderPass, sizeof(renderPass));
+	key = CookedFile::hash(&pipelineLayout, sizeof(pipelineLayout), key);
+	key = CookedFile::hash(&features.bits, sizeof(features.bits), key);
+	key = CookedFile::hash(&format, sizeof(format), key);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		uint32_t id;
+		if (find<VkPipeline>(key, id))
+			return ResourceRef<VkPipeline>(shared_from_this(), id);
+	}
+
+	//The generic variant is built right away, everything that isn't built yet draws with it
+	ShaderFeatures generic = ShaderVariants::getGeneric(features);
+	if (generic == features)
+	{
+		CLEVER_PROFILE_FUNCTION();
+		PipelineInfo pipeline(m_Device, *m_Shaders, renderPass, pipelineLayout, features, format);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_PipelineDescs[key] = { renderPass, pipelineLayout, features, format, pipeline.shaderFiles };
+		return ResourceRef<VkPipeline>(shared_from_this(), insert(key, pipeline.graphicsPipeline));
+	}
+
+	ResourceRef<VkPipeline> fallback = acquirePipeline(renderPass, pipelineLayout, generic, format);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	//The variant holds its own count on the generic one until it is built, fallback's is given back after the lock
+	m_Pipelines.entries[fallback.getId()].refCount++;
+	m_PipelineDescs[key] = { renderPass, pipelineLayout, features, format, {}, fallback.getId() };
+	uint32_t id = insert<VkPipeline>(key, VK_NULL_HANDLE);
+
+	m_BuildQueue.push_back(key);
+	m_BuildWake.notify_one();
+	return ResourceRef<VkPipeline>(shared_from_this(), id);
+}
+
+void ResourceCache::builderLoop()
+{
+	CLEVER_PROFILE_THREAD("Pipeline Builder");
+	while (true)
+	{
+		BuiltPipeline built;
+		PipelineDesc desc;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_BuildWake.wait(lock, [this]() { return m_Stopping || !m_BuildQueue.empty(); });
+			if (m_Stopping)
+				return;
+
+			built.key = m_BuildQueue.front();
+			m_BuildQueue.pop_front();
+			desc = m_PipelineDescs.at(built.key);
+		}
+
+		//Compiling its shader variants and the pipeline is what would have hitched the main thread
+		try
+		{
+			CLEVER_PROFILE_SCOPE("Build Pipeline Variant");
+			PipelineInfo pipeline(m_Device, *m_Shaders, desc.renderPass, desc.pipelineLayout, desc.features, desc.format);
+			built.pipeline = pipeline.graphicsPipeline;
+			built.shaderFiles = pipeline.shaderFiles;
+		}
+		catch (const std::exception& exception)
+		{
+			built.error = exception.what();
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Built.push_back(std::move(built));
+	}
+}
+
+void ResourceCache::finishBuilds()
+{
+	for (BuiltPipeline& built : m_Built)
+	{
+		auto found = m_Pipelines.lookup.find(built.key);
+		bool waiting = found != m_Pipelines.lookup.end() && m_Pipelines.entries[found->second].resource == VK_NULL_HANDLE;
+		if (!built.error.empty())
+		{
+			//Stays on the generic variant, it is queued again by the next shader reload
+			m_PipelineDescs.at(built.key).failed = true;
+			std::cerr << "ResourceCache: failed to build " << ShaderVariants::getName(m_PipelineDescs.at(built.key).features) << " variant, " << built.error << std::endl;
+			continue;
+		}
+		if (!waiting)
+		{
+			//Released before it was done
+			m_Pipelines.pendingDestroy.push_back(built.pipeline);
+			continue;
+		}
+
+		PipelineDesc& desc = m_PipelineDescs.at(built.key);
+		m_Pipelines.entries[found->second].resource = built.pipeline;
+		desc.shaderFiles = built.shaderFiles;
+
+		uint32_t fallback = desc.fallback;
+		desc.fallback = ResourceRef<VkPipeline>::INVALID;
+		releaseLocked<VkPipeline>(fallback);
+	}
+	m_Built.clear();
+}
+
+void ResourceCache::reloadPipelines(const std::vector<std::string>& files)
+{
+	CLEVER_PROFILE_FUNCTION();
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& entry : m_Pipelines.entries)
+	{
+		if (!entry.alive)
+			continue;
+
+		PipelineDesc& desc = m_PipelineDescs.at(entry.key);
+		if (desc.failed)
+		{
+			desc.failed = false;
+			m_BuildQueue.push_back(entry.key);
+			m_BuildWake.notify_one();
+			continue;
+		}
+
+		//A variant still being built has no shader files yet, it may finish with the old modules until the next save
+		bool affected = std::any_of(desc.shaderFiles.begin(), desc.shaderFiles.end(), [&](const std::string& file)
+			{
+				return std::find(files.begin(), files.end(), file) != files.end();
+			});
+		if (!affected)
+			continue;
+
+		try
+		{
+			PipelineInfo pipeline(m_Device, *m_Shaders, desc.renderPass, desc.pipelineLayout, desc.features, desc.format);
+			destroy(entry.resource);
+			entry.resource = pipeline.graphicsPipeline;
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << "ResourceCache: failed to rebuild a pipeline, " << exception.what() << std::endl;
+		}
+	}
+}
+
+void ResourceCache::update()
+{
+	std::vector<MeshData> meshes;
+	std::vector<VkPipeline> pipelines;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		finishBuilds();
+		meshes.swap(m_Meshes.pendingDestroy);
+		pipelines.swap(m_Pipelines.pendingDestroy);
+	}
+
+	for (MeshData& mesh : meshes)
+		destroy(mesh);
+	for (VkPipeline pipeline : pipelines)
+		destroy(pipeline);
+}
+
+void ResourceCache::destroy(MeshData& mesh)
+{
+	//The GeometryBuffer only reuses the ranges once the frames submitted so far are done
+	mesh.cleanup();
+}
+
+void ResourceCache::destroy(VkPipeline pipeline)
+{
+	//A variant released before it was built never had one
+	if (pipeline == VK_NULL_HANDLE)
+		return;
+
+	VkDevice device = m_Device;
+	m_DeletionQueue->push([=]()
+		{
+			vkDestroyPipeline(device, pipeline, nullptr);
+		});
+}
+
+void ResourceCache::resourceGui(std::vector<void*> classInstances)
+{
+	ResourceCache* cache = (ResourceCache*)classInstances.at(0);
+	DevTools::newDock("Resources");
+
+	std::lock_guard<std::mutex> lock(cache->m_Mutex);
+	auto poolLine = [](const std::string& name, size_t alive, uint32_t references, uint64_t hits)
+		{
+			return name + ": " + std::to_string(alive) + " cached, " + std::to_string(references) + " references, " + std::to_string(hits) + " shared acquires";
+		};
+
+	uint32_t meshReferences = 0;
+	for (auto& entry : cache->m_Meshes.entries)
+		meshReferences += entry.refCount;
+	uint32_t pipelineReferences = 0;
+	for (auto& entry : cache->m_Pipelines.entries)
+		pipelineReferences += entry.refCount;
+
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, poolLine("Meshes", cache->m_Meshes.lookup.size(), meshReferences, cache->m_Meshes.hits));
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, poolLine("Pipelines", cache->m_Pipelines.lookup.size(), pipelineReferences, cache->m_Pipelines.hits));
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, std::to_string(cache->m_BuildQueue.size()) + " variants waiting to be built");
+
+	DevTools::endDock();
+}
@@ -0,0 +1,345 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <functional>
+#include <deque>
+#include <thread>
+#include <condition_variable>
+#include <type_traits>
+
+#include "DeletionQueue.h"
+#include "GeometryBuffer.h"
+#include "ShaderManager.h"
+#include "ShaderVariants.h"
+#include "Clever/WorldManager/MeshData.h"
+#include "Clever/WorldManager/MeshIndices.h"
+#include "Clever/WorldManager/VertexFormats.h"
+#include "Clever/WorldManager/Object/MeshCache.h"
+
+class ResourceCache;
+
+//! Counted reference to a cached resource, copies share it and the last one to go releases it
+template<typename T>
+class ResourceRef
+{
+public:
+	static const uint32_t INVALID = UINT32_MAX;
+
+	ResourceRef() = default;
+
+	//! Takes over a reference the cache already counted
+	ResourceRef(std::shared_ptr<ResourceCache> cache, uint32_t id)
+		: m_Cache(std::move(cache)), m_Id(id)
+	{
+
+	}
+
+	ResourceRef(const ResourceRef& other);
+
+	ResourceRef(ResourceRef&& other) noexcept
+		: m_Cache(std::move(other.m_Cache)), m_Id(other.m_Id)
+	{
+		other.m_Id = INVALID;
+	}
+
+	ResourceRef& operator=(const ResourceRef& other);
+
+	ResourceRef& operator=(ResourceRef&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			m_Cache = std::move(other.m_Cache);
+			m_Id = other.m_Id;
+			other.m_Id = INVALID;
+		}
+		return *this;
+	}
+
+	~ResourceRef()
+	{
+		reset();
+	}
+
+	void reset();
+
+	bool isValid() const
+	{
+		return m_Cache != nullptr;
+	}
+
+	T get() const;
+
+	uint32_t getId() const
+	{
+		return m_Id;
+	}
+
+	bool operator==(const ResourceRef& other) const
+	{
+		return m_Cache == other.m_Cache && m_Id == other.m_Id;
+	}
+
+	bool operator!=(const ResourceRef& other) const
+	{
+		return !(*this == other);
+	}
+
+private:
+	std::shared_ptr<ResourceCache> m_Cache;
+	uint32_t m_Id = INVALID;
+};
+
+/*
+-------------Resource Cache----------------
+
+Shares GPU resources between everything that asks for the same content:
+	Keys: meshes are keyed by a hash of their vertex and index bytes, cooked meshes by their source's hash, and
+		  pipelines by the render pass, layout, shader features and vertex format they are built for. Asking twice for
+		  the same key gives another reference to the same resource instead of a second copy.
+	Variants: a pipeline with optional shader features is built on a background thread, until then its refs resolve
+			  to the generic variant (see ShaderVariants.h), which is built right away the first time it is needed.
+	Counting: ResourceRef counts the references, when the last one is gone the resource is queued for destruction.
+	Destruction: update() hands queued resources to the GeometryBuffer and DeletionQueue, which free them once every
+				 frame that could still use them is done. Releasing is thread safe, destroying happens on the main thread.
+	Reloading: reloadPipelines() rebuilds in place the pipelines built from reloaded shaders, refs see the new one.
+
+Refs keep the cache object alive, after cleanup() releasing them does nothing.
+*/
+class ResourceCache : public std::enable_shared_from_this<ResourceCache>
+{
+public:
+	ResourceCache() = default;
+
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, GeometryBuffer& geometry, DeletionQueue& deletionQueue, ShaderManager& shaders);
+	//! Destroys everything still cached whether it is referenced or not, the device has to be idle
+	void cleanup();
+
+	//! Thread safe
+	ResourceRef<MeshData> acquireMesh(const std::vector<Vertex>& vertices, const MeshIndices& indices, VertexFormat format);
+	//! Thread safe
+	ResourceRef<MeshData> acquireMesh(const MeshCache::CookedMesh& mesh, VertexFormat format);
+
+	//! Main thread
+	ResourceRef<VkPipeline> acquirePipeline(VkRenderPass renderPass, VkPipelineLayout pipelineLayout, ShaderFeatures features, VertexFormat format);
+
+	//! Main thread, once per frame
+	void update();
+
+	//! Main thread, files are what ShaderManager::update() returned. A pipeline that fails to build keeps the old one
+	void reloadPipelines(const std::vector<std::string>& files);
+
+	static void resourceGui(std::vector<void*> classInstances);
+
+	template<typename T>
+	void addRef(uint32_t id)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Cleaned)
+			getPool<T>().entries[id].refCount++;
+	}
+
+	template<typename T>
+	void release(uint32_t id)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (!m_Cleaned)
+			releaseLocked<T>(id);
+	}
+
+	template<typename T>
+	T get(uint32_t id)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Cleaned)
+			return T{};
+		return resolve<T>(id);
+	}
+
+private:
+	template<typename T>
+	struct Pool
+	{
+		struct Entry
+		{
+			T resource{};
+			uint64_t key = 0;
+			uint32_t refCount = 0;
+			bool alive = false;
+		};
+
+		std::vector<Entry> entries;
+		std::vector<uint32_t> freeIds;
+		std::unordered_map<uint64_t, uint32_t> lookup;
+		std::vector<T> pendingDestroy;//Released, destroyed by the next update()
+		uint64_t hits = 0;
+	};
+
+	template<typename T>
+	Pool<T>& getPool();
+
+	//! m_Mutex must be held
+	template<typename T>
+	void releaseLocked(uint32_t id);
+
+	//! The resource a ref to id uses right now. m_Mutex must be held
+	template<typename T>
+	T resolve(uint32_t id);
+
+	//! Returns the id of the existing entry if another thread inserted the key first, resource is then queued for destruction. m_Mutex must be held
+	template<typename T>
+	uint32_t insert(uint64_t key, const T& resource);
+
+	//! Counts another reference to key if it is cached. m_Mutex must be held
+	template<typename T>
+	bool find(uint64_t key, uint32_t& id);
+
+	ResourceRef<MeshData> acquireMesh(uint64_t key, const std::function<void(MeshData&)>& create);
+
+	void destroy(MeshData& mesh);
+	void destroy(VkPipeline pipeline);
+
+	void builderLoop();
+	//! Swaps the variants the builder finished in for their generic variant. m_Mutex must be held
+	void finishBuilds();
+
+private:
+	//! What a cached pipeline was built from, to build it again
+	struct PipelineDesc
+	{
+		VkRenderPass renderPass = VK_NULL_HANDLE;
+		VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+		ShaderFeatures features;
+		VertexFormat format = VertexFormat::Float;
+		std::vector<std::string> shaderFiles;
+		uint32_t fallback = ResourceRef<VkPipeline>::INVALID;//Counted reference to the generic variant while building
+		bool failed = false;//The variant didn't build, it stays on the generic one until the next shader reload
+	};
+
+	struct BuiltPipeline
+	{
+		uint64_t key = 0;
+		VkPipeline pipeline = VK_NULL_HANDLE;//Null if it failed
+		std::vector<std::string> shaderFiles;
+		std::string error;
+	};
+
+	VkDevice m_Device = VK_NULL_HANDLE;
+	VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+	GeometryBuffer* m_Geometry = nullptr;
+	DeletionQueue* m_DeletionQueue = nullptr;
+	ShaderManager* m_Shaders = nullptr;
+
+	std::mutex m_Mutex;
+	bool m_Cleaned = false;
+
+	Pool<MeshData> m_Meshes;
+	Pool<VkPipeline> m_Pipelines;
+	std::unordered_map<uint64_t, PipelineDesc> m_PipelineDescs;//By key, kept after a release in case it is acquired again
+
+	std::thread m_Builder;
+	std::condition_variable m_BuildWake;
+	std::deque<uint64_t> m_BuildQueue;
+	std::vector<BuiltPipeline> m_Built;
+	bool m_Stopping = false;
+};
+
+template<>
+inline ResourceCache::Pool<MeshData>& ResourceCache::getPool<MeshData>()
+{
+	return m_Meshes;
+}
+
+template<>
+inline ResourceCache::Pool<VkPipeline>& ResourceCache::getPool<VkPipeline>()
+{
+	return m_Pipelines;
+}
+
+template<typename T>
+void ResourceCache::releaseLocked(uint32_t id)
+{
+	Pool<T>& pool = getPool<T>();
+	typename Pool<T>::Entry& entry = pool.entries[id];
+	if (--entry.refCount > 0)
+		return;
+
+	//A variant released before it was built gives back the generic one it was drawn with
+	if constexpr (std::is_same_v<T, VkPipeline>)
+	{
+		auto desc = m_PipelineDescs.find(entry.key);
+		if (desc != m_PipelineDescs.end() && desc->second.fallback != ResourceRef<VkPipeline>::INVALID)
+		{
+			uint32_t fallback = desc->second.fallback;
+			desc->second.fallback = ResourceRef<VkPipeline>::INVALID;
+			releaseLocked<VkPipeline>(fallback);
+		}
+	}
+
+	pool.lookup.erase(entry.key);
+	pool.pendingDestroy.push_back(entry.resource);
+	entry = typename Pool<T>::Entry{};
+	pool.freeIds.push_back(id);
+}
+
+template<typename T>
+T ResourceCache::resolve(uint32_t id)
+{
+	return getPool<T>().entries[id].resource;
+}
+
+template<>
+inline VkPipeline ResourceCache::resolve<VkPipeline>(uint32_t id)
+{
+	//Still being built, the generic variant stands in
+	VkPipeline pipeline = m_Pipelines.entries[id].resource;
+	if (pipeline == VK_NULL_HANDLE)
+	{
+		uint32_t fallback = m_PipelineDescs.at(m_Pipelines.entries[id].key).fallback;
+		if (fallback != ResourceRef<VkPipeline>::INVALID)
+			pipeline = m_Pipelines.entries[fallback].resource;
+	}
+	return pipeline;
+}
+
+//ResourceRef needs the whole ResourceCache to count
+template<typename T>
+ResourceRef<T>::ResourceRef(const ResourceRef& other)
+	: m_Cache(other.m_Cache), m_Id(other.m_Id)
+{
+	if (m_Cache)
+		m_Cache->template addRef<T>(m_Id);
+}
+
+template<typename T>
+ResourceRef<T>& ResourceRef<T>::operator=(const ResourceRef& other)
+{
+	if (this != &other)
+	{
+		if (other.m_Cache)
+			other.m_Cache->template addRef<T>(other.m_Id);
+		reset();
+		m_Cache = other.m_Cache;
+		m_Id = other.m_Id;
+	}
+	return *this;
+}
+
+template<typename T>
+void ResourceRef<T>::reset()
+{
+	if (m_Cache)
+		m_Cache->template release<T>(m_Id);
+	m_Cache.reset();
+	m_Id = INVALID;
+}
+
+template<typename T>
+T ResourceRef<T>::get() const
+{
+	return m_Cache->template get<T>(m_Id);
+}
@@ -0,0 +1,554 @@
+#include "ShaderManager.h"
+#include "ResourceCache.h"
+#include "DescriptorManager.h"
+#include "Clever/Developer/DevTools.h"
+#include "Clever/Developer/Profiler.h"
+#include "OS-Dependant/Platform/CookedFile.h"
+
+#include <shaderc/shaderc.hpp>
+#include <spirv_cross/spirv_cross.hpp>
+
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_set>
+#include <iostream>
+
+namespace
+{
+	shaderc_shader_kind getKind(const std::string& file)
+	{
+		std::string extension = std::filesystem::path(file).extension().string();
+		if (extension == ".vert")
+			return shaderc_vertex_shader;
+		if (extension == ".frag")
+			return shaderc_fragment_shader;
+		if (extension == ".comp")
+			return shaderc_compute_shader;
+		throw std::runtime_error("failed to find the shader stage of " + file + "!");
+	}
+
+	std::string readText(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open())
+			throw std::runtime_error("failed to open shader " + path + "!");
+
+		std::stringstream text;
+		text << file.rdbuf();
+		return text.str();
+	}
+
+	//! The file named by an #include "file" line, empty for any other line
+	std::string getInclude(const std::string& line)
+	{
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0)
+			return "";
+
+		size_t open = line.find('"', start + 8);
+		size_t close = open == std::string::npos ? std::string::npos : line.find('"', open + 1);
+		if (close == std::string::npos)
+			return "";
+		return line.substr(open + 1, close - open - 1);
+	}
+
+	class DirectoryIncluder : public shaderc::CompileOptions::IncluderInterface
+	{
+	public:
+		DirectoryIncluder(const std::string& directory)
+			: m_Directory(directory)
+		{
+
+		}
+
+		shaderc_include_result* GetInclude(const char* requestedSource, shaderc_include_type, const char*, size_t) override
+		{
+			Include* include = new Include();
+			try
+			{
+				include->name = requestedSource;
+				include->content = readText(m_Directory + requestedSource);
+			}
+			catch (const std::exception& exception)
+			{
+				//An empty name tells shaderc the content is the error
+				include->name.clear();
+				include->content = exception.what();
+			}
+
+			include->result.source_name = include->name.c_str();
+			include->result.source_name_length = include->name.size();
+			include->result.content = include->content.c_str();
+			include->result.content_length = include->content.size();
+			include->result.user_data = include;
+			return &include->result;
+		}
+
+		void ReleaseInclude(shaderc_include_result* data) override
+		{
+			delete static_cast<Include*>(data->user_data);
+		}
+
+	private:
+		struct Include
+		{
+			std::string name;
+			std::string content;
+			shaderc_include_result result{};
+		};
+
+		std::string m_Directory;
+	};
+}
+
+void ShaderManager::init(VkDevice device, DescriptorManager& descriptors, const std::string& sourceDirectory, const std::string& cacheDirectory)
+{
+	m_Device = device;
+	m_Descriptors = &descriptors;
+	m_SourceDirectory = sourceDirectory;
+	m_CacheDirectory = cacheDirectory;
+	m_LastPoll = std::chrono::steady_clock::now();
+
+	std::error_code error;
+	std::filesystem::create_directories(m_CacheDirectory, error);
+	if (error)
+		std::cerr << "ShaderManager: can't create " << m_CacheDirectory << ", SPIR-V won't be cached" << std::endl;
+
+	DevTools::addDockFunction(shaderGui, { this });
+}
+
+void ShaderManager::cleanup()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (auto& [key, module] : m_Modules)
+		vkDestroyShaderModule(m_Device, module.module, nullptr);
+	for (VkShaderModule module : m_RetiredModules)
+		vkDestroyShaderModule(m_Device, module, nullptr);
+	for (auto& [hash, layout] : m_PipelineLayouts)
+	{
+		vkDestroyPipelineLayout(m_Device, layout.layout, nullptr);
+		for (VkDescriptorSetLayout setLayout : layout.setLayouts)
+		{
+			if (setLayout != m_Descriptors->getBindlessSetLayout())
+				vkDestroyDescriptorSetLayout(m_Device, setLayout, nullptr);
+		}
+	}
+	m_Modules.clear();
+	m_RetiredModules.clear();
+	m_PipelineLayouts.clear();
+	m_WriteTimes.clear();
+}
+
+VkShaderModule ShaderManager::getModule(const std::string& file, const std::vector<std::string>& defines)
+{
+	std::string key = findOrBuild(file, defines);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Modules.at(key).module;
+}
+
+ShaderManager::Reflection ShaderManager::getReflection(const std::string& file, const std::vector<std::string>& defines)
+{
+	std::string key = findOrBuild(file, defines);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Modules.at(key).reflection;
+}
+
+std::string ShaderManager::findOrBuild(const std::string& file, const std::vector<std::string>& defines)
+{
+	//The order defines are passed in doesn't make a different module
+	std::vector<std::string> sortedDefines = defines;
+	std::sort(sortedDefines.begin(), sortedDefines.end());
+
+	std::string key = file;
+	for (const std::string& define : sortedDefines)
+		key += "|" + define;
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		if (m_Modules.count(key) > 0)
+			return key;
+	}
+
+	//Compiled without the lock so other threads can keep getting their modules, a duplicate made meanwhile is dropped
+	CLEVER_PROFILE_FUNCTION();
+	Module module;
+	module.file = file;
+	module.defines = sortedDefines;
+	std::vector<uint32_t> spirv = compile(module);
+	module.reflection = reflect(spirv);
+	module.module = createModule(spirv);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_Modules.count(key) > 0)
+	{
+		vkDestroyShaderModule(m_Device, module.module, nullptr);
+		return key;
+	}
+	trackDependencies(module);
+	m_Modules.emplace(key, std::move(module));
+	return key;
+}
+
+ShaderManager::PipelineLayout ShaderManager::getPipelineLayout(const std::vector<std::string>& files)
+{
+	//Merging the interfaces
+	std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> sets;
+	std::set<uint32_t> bindlessSets;
+	VkPushConstantRange pushConstants{};
+	for (const std::string& file : files)
+	{
+		Reflection reflection = getReflection(file);
+		for (uint32_t set : reflection.bindlessSets)
+		{
+			if (set != DescriptorManager::BINDLESS_SET)
+				throw std::runtime_error("failed to lay out " + file + ", runtime sized arrays only belong in set " + std::to_string(DescriptorManager::BINDLESS_SET) + "!");
+			bindlessSets.insert(set);
+		}
+		for (auto& [set, bindings] : reflection.sets)
+		{
+			for (const VkDescriptorSetLayoutBinding& binding : bindings)
+			{
+				auto [merged, inserted] = sets[set].emplace(binding.binding, binding);
+				if (inserted)
+					continue;
+				if (merged->second.descriptorType != binding.descriptorType || merged->second.descriptorCount != binding.descriptorCount)
+					throw std::runtime_error("failed to merge set " + std::to_string(set) + " binding " + std::to_string(binding.binding) + " of " + file + "!");
+				merged->second.stageFlags |= binding.stageFlags;
+			}
+		}
+		if (reflection.pushConstantSize > 0)
+		{
+			pushConstants.stageFlags |= reflection.stage;
+			pushConstants.size = std::max(pushConstants.size, reflection.pushConstantSize);
+		}
+	}
+
+	//The bindless table is laid out by the DescriptorManager, whatever else a shader declares in it is already there
+	for (uint32_t set : bindlessSets)
+		sets.erase(set);
+
+	uint64_t hash = CookedFile::hash(&pushConstants, sizeof(pushConstants));
+	for (uint32_t set : bindlessSets)
+	{
+		uint32_t fields[] = { set, UINT32_MAX };
+		hash = CookedFile::hash(fields, sizeof(fields), hash);
+	}
+	for (auto& [set, bindings] : sets)
+	{
+		hash = CookedFile::hash(&set, sizeof(set), hash);
+		for (auto& [number, binding] : bindings)
+		{
+			uint32_t fields[] = { binding.binding, static_cast<uint32_t>(binding.descriptorType), binding.descriptorCount, binding.stageFlags };
+			hash = CookedFile::hash(fields, sizeof(fields), hash);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	auto found = m_PipelineLayouts.find(hash);
+	if (found != m_PipelineLayouts.end())
+		return found->second;
+
+	PipelineLayout layout;
+	uint32_t setCount = sets.empty() ? 0 : sets.rbegin()->first + 1;
+	if (!bindlessSets.empty())
+		setCount = std::max(setCount, *bindlessSets.rbegin() + 1);
+	for (uint32_t set = 0; set < setCount; set++)
+	{
+		if (bindlessSets.count(set) > 0)
+		{
+			if (m_Descriptors->getBindlessSetLayout() == VK_NULL_HANDLE)
+				throw std::runtime_error("failed to lay out set " + std::to_string(set) + ", the bindless table isn't created yet!");
+			layout.setLayouts.push_back(m_Descriptors->getBindlessSetLayout());
+			continue;
+		}
+
+		std::vector<VkDescriptorSetLayoutBinding> bindings;
+		for (auto& [number, binding] : sets[set])
+			bindings.push_back(binding);
+
+		VkDescriptorSetLayoutCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+		info.bindingCount = static_cast<uint32_t>(bindings.size());
+		info.pBindings = bindings.data();
+
+		VkDescriptorSetLayout setLayout;
+		if (vkCreateDescriptorSetLayout(m_Device, &info, nullptr, &setLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create Reflected DescriptorSetLayout!");
+		}
+		layout.setLayouts.push_back(setLayout);
+	}
+
+	VkPipelineLayoutCreateInfo info{};
+	info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	info.setLayoutCount = static_cast<uint32_t>(layout.setLayouts.size());
+	info.pSetLayouts = layout.setLayouts.data();
+	info.pushConstantRangeCount = pushConstants.size > 0 ? 1 : 0;
+	info.pPushConstantRanges = &pushConstants;
+
+	if (vkCreatePipelineLayout(m_Device, &info, nullptr, &layout.layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create Reflected Pipeline Layout!");
+	}
+
+	m_PipelineLayouts[hash] = layout;
+	return layout;
+}
+
+std::vector<std::string> ShaderManager::update()
+{
+	std::vector<std::string> reloaded;
+	auto now = std::chrono::steady_clock::now();
+	if (!m_HotReload || now - m_LastPoll < POLL_INTERVAL)
+		return reloaded;
+	m_LastPoll = now;
+
+	std::vector<Module> affected;
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		std::unordered_set<std::string> changed;
+		for (auto& [file, writeTime] : m_WriteTimes)
+		{
+			std::error_code error;
+			auto time = std::filesystem::last_write_time(m_SourceDirectory + file, error);
+			//Editors often delete and rewrite, a file that is missing for a moment is checked again next poll
+			if (error || time == writeTime)
+				continue;
+
+			writeTime = time;
+			changed.insert(file);
+		}
+
+		for (auto& [key, module] : m_Modules)
+		{
+			if (std::any_of(module.dependencies.begin(), module.dependencies.end(), [&](const std::string& file) { return changed.count(file) > 0; }))
+				affected.push_back(module);
+		}
+	}
+
+	for (Module& module : affected)
+	{
+		std::string key = module.file;
+		for (const std::string& define : module.defines)
+			key += "|" + define;
+
+		try
+		{
+			std::vector<uint32_t> spirv = compile(module);
+			module.reflection = reflect(spirv);
+			module.module = createModule(spirv);
+			module.error.clear();
+		}
+		catch (const std::exception& exception)
+		{
+			std::cerr << "ShaderManager: " << module.file << ": " << exception.what() << std::endl;
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Modules.at(key).error = exception.what();
+			continue;
+		}
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		Module& current = m_Modules.at(key);
+		m_RetiredModules.push_back(current.module);
+		current = std::move(module);
+		trackDependencies(current);
+
+		if (std::find(reloaded.begin(), reloaded.end(), current.file) == reloaded.end())
+			reloaded.push_back(current.file);
+	}
+
+	return reloaded;
+}
+
+std::string ShaderManager::readSources(const std::string& file, std::vector<std::string>& dependencies, uint64_t& hash)
+{
+	std::string source = readText(m_SourceDirectory + file);
+	dependencies.push_back(file);
+	hash = CookedFile::hash(file.data(), file.size(), hash);
+	hash = CookedFile::hash(source.data(), source.size(), hash);
+
+	std::istringstream lines(source);
+	std::string line;
+	while (std::getline(lines, line))
+	{
+		std::string include = getInclude(line);
+		if (include.empty() || std::find(dependencies.begin(), dependencies.end(), include) != dependencies.end())
+			continue;
+		readSources(include, dependencies, hash);
+	}
+
+	return source;
+}
+
+std::vector<uint32_t> ShaderManager::compile(Module& module)
+{
+	module.dependencies.clear();
+	uint64_t hash = CookedFile::hash(&CACHE_VERSION, sizeof(CACHE_VERSION));
+	std::string source = readSources(module.file, module.dependencies, hash);
+	for (const std::string& define : module.defines)
+		hash = CookedFile::hash(define.data(), define.size() + 1, hash);//With the terminator so "A","B" and "AB" differ
+
+	std::vector<uint32_t> spirv;
+	std::string cachePath = getCachePath(module.file, hash);
+
+	//Checking the disk cache
+	{
+		std::ifstream file(cachePath, std::ios::ate | std::ios::binary);
+		if (file.is_open())
+		{
+			size_t size = static_cast<size_t>(file.tellg());
+			if (size > 0 && size % sizeof(uint32_t) == 0)
+			{
+				spirv.resize(size / sizeof(uint32_t));
+				file.seekg(0);
+				file.read(reinterpret_cast<char*>(spirv.data()), size);
+				if (file)
+				{
+					module.fromDiskCache = true;
+					m_DiskHits++;
+					return spirv;
+				}
+			}
+		}
+	}
+
+	CLEVER_PROFILE_FUNCTION();
+	//Compiling with shaderc
+	{
+		shaderc::CompileOptions options;
+		options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_2);
+		options.SetOptimizationLevel(shaderc_optimization_level_performance);
+		options.SetIncluder(std::make_unique<DirectoryIncluder>(m_SourceDirectory));
+		for (const std::string& define : module.defines)
+		{
+			size_t equals = define.find('=');
+			if (equals == std::string::npos)
+				options.AddMacroDefinition(define);
+			else
+				options.AddMacroDefinition(define.substr(0, equals), define.substr(equals + 1));
+		}
+
+		shaderc::Compiler compiler;
+		shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(source, getKind(module.file), module.file.c_str(), options);
+		if (result.GetCompilationStatus() != shaderc_compilation_status_success)
+			throw std::runtime_error(result.GetErrorMessage());
+
+		spirv.assign(result.cbegin(), result.cend());
+		module.fromDiskCache = false;
+		m_Compiles++;
+	}
+
+	//Writing the disk cache, never read half written
+	if (!CookedFile::write(cachePath, spirv.data(), spirv.size() * sizeof(uint32_t)))
+		std::cerr << "ShaderManager: failed to cache " << module.file << std::endl;
+
+	return spirv;
+}
+
+VkShaderModule ShaderManager::createModule(const std::vector<uint32_t>& spirv)
+{
+	VkShaderModuleCreateInfo createInfo{};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = spirv.size() * sizeof(uint32_t);
+	createInfo.pCode = spirv.data();
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(m_Device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create Shader Module");
+	}
+	return shaderModule;
+}
+
+ShaderManager::Reflection ShaderManager::reflect(const std::vector<uint32_t>& spirv)
+{
+	spirv_cross::Compiler compiler(spirv);
+	spirv_cross::ShaderResources resources = compiler.get_shader_resources();
+
+	Reflection reflection;
+	switch (compiler.get_execution_model())
+	{
+	case spv::ExecutionModelVertex: reflection.stage = VK_SHADER_STAGE_VERTEX_BIT; break;
+	case spv::ExecutionModelFragment: reflection.stage = VK_SHADER_STAGE_FRAGMENT_BIT; break;
+	case spv::ExecutionModelGLCompute: reflection.stage = VK_SHADER_STAGE_COMPUTE_BIT; break;
+	default: break;
+	}
+
+	auto addBindings = [&](const spirv_cross::SmallVector<spirv_cross::Resource>& list, VkDescriptorType type)
+		{
+			for (const spirv_cross::Resource& resource : list)
+			{
+				const spirv_cross::SPIRType& spirType = compiler.get_type(resource.type_id);
+				VkDescriptorSetLayoutBinding binding{};
+				binding.binding = compiler.get_decoration(resource.id, spv::DecorationBinding);
+				binding.descriptorType = type;
+				binding.descriptorCount = spirType.array.empty() ? 1 : spirType.array[0];
+				binding.stageFlags = reflection.stage;
+				uint32_t set = compiler.get_decoration(resource.id, spv::DecorationDescriptorSet);
+				//A runtime sized array is a bindless table, its size and flags come from whoever owns it
+				if (binding.descriptorCount == 0)
+				{
+					reflection.bindlessSets.insert(set);
+					continue;
+				}
+
+				reflection.sets[set].push_back(binding);
+			}
+		};
+	addBindings(resources.uniform_buffers, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+	addBindings(resources.storage_buffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
+	addBindings(resources.sampled_images, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
+	addBindings(resources.separate_images, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE);
+	addBindings(resources.separate_samplers, VK_DESCRIPTOR_TYPE_SAMPLER);
+	addBindings(resources.storage_images, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
+
+	for (const spirv_cross::Resource& resource : resources.push_constant_buffers)
+	{
+		uint32_t size = static_cast<uint32_t>(compiler.get_declared_struct_size(compiler.get_type(resource.base_type_id)));
+		reflection.pushConstantSize = std::max(reflection.pushConstantSize, size);
+	}
+
+	for (const spirv_cross::SpecializationConstant& constant : compiler.get_specialization_constants())
+		reflection.specializationConstants.push_back({ constant.constant_id, compiler.get_name(constant.id) });
+
+	return reflection;
+}
+
+std::string ShaderManager::getCachePath(const std::string& file, uint64_t hash)
+{
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+	return m_CacheDirectory + std::filesystem::path(file).filename().string() + "." + name + ".spv";
+}
+
+void ShaderManager::trackDependencies(const Module& module)
+{
+	for (const std::string& file : module.dependencies)
+	{
+		if (m_WriteTimes.count(file) > 0)
+			continue;
+
+		std::error_code error;
+		m_WriteTimes[file] = std::filesystem::last_write_time(m_SourceDirectory + file, error);
+	}
+}
+
+void ShaderManager::shaderGui(std::vector<void*> classInstances)
+{
+	ShaderManager* shaders = (ShaderManager*)classInstances.at(0);
+	DevTools::newDock("Shaders");
+
+	std::lock_guard<std::mutex> lock(shaders->m_Mutex);
+	DevTools::checkbox("Hot Reload", &shaders->m_HotReload);
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, std::to_string(shaders->m_Modules.size()) + " modules, " + std::to_string(shaders->m_Compiles.load()) + " compiled, " + std::to_string(shaders->m_DiskHits.load()) + " from the disk cache");
+	for (auto& [key, module] : shaders->m_Modules)
+	{
+		if (module.error.empty())
+			DevTools::coloredText({ 0.8, 0.8, 0.8 }, key + (module.fromDiskCache ? ": cached" : ": compiled"));
+		else
+			DevTools::coloredText({ 0.9, 0.3, 0.3 }, key + ": " + module.error);
+	}
+
+	DevTools::endDock();
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+
+class DescriptorManager;
+
+/*
+-------------Shader Manager----------------
+
+Compiles GLSL at runtime and hands out one VkShaderModule per source file and define set:
+	Modules: getModule() builds the module on the first request and returns the same one after that, so building
+			 another pipeline from the same shaders never touches the disk. It can be called from any thread.
+	Disk cache: SPIR-V is stored in the cache directory under a hash of the source, everything it includes and the
+				defines. A hit skips shaderc entirely, an edited source or a new define set simply misses.
+	Reflection: every module is reflected with SPIRV-Cross, getPipelineLayout() builds the set layouts and push
+				constant range of a group of modules from it so compute passes don't write their layouts by hand.
+				A set holding a runtime sized array is the DescriptorManager's bindless table, its layout is shared.
+	Hot reload: update() polls the sources and their includes, the modules built from a changed file are recompiled
+				and replaced. It returns the files that changed so only the pipelines built from them are rebuilt.
+				A shader that fails to compile keeps its last good module.
+
+The stage comes from the extension, .vert, .frag or .comp. #include "file" is resolved from the source directory.
+*/
+class ShaderManager
+{
+public:
+	//! Bump to ignore every cached SPIR-V, when the compile options change
+	static const uint32_t CACHE_VERSION = 1;
+	static constexpr std::chrono::milliseconds POLL_INTERVAL{ 500 };
+
+	//! What SPIRV-Cross found in a module
+	struct Reflection
+	{
+		VkShaderStageFlagBits stage = VK_SHADER_STAGE_ALL;
+		std::map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> sets;//By set index
+		std::set<uint32_t> bindlessSets;//Sets with a runtime sized array, their bindings aren't in sets
+		uint32_t pushConstantSize = 0;
+		std::vector<std::pair<uint32_t, std::string>> specializationConstants;//constant_id and name
+	};
+
+	//! Owned by the ShaderManager, shared by every group of modules with the same reflected interface
+	struct PipelineLayout
+	{
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSetLayout> setLayouts;//Index is the set number, sets no module uses are empty layouts. The bindless one is the DescriptorManager's
+	};
+
+public:
+	ShaderManager() = default;
+
+	//! descriptors only has to be initialized before a layout using the bindless table is requested
+	void init(VkDevice device, DescriptorManager& descriptors, const std::string& sourceDirectory, const std::string& cacheDirectory);
+	//! Pipelines don't need their modules once built, so this can run before they are destroyed
+	void cleanup();
+
+	//! file is relative to the source directory, defines are NAME or NAME=VALUE. Throws if it doesn't compile
+	VkShaderModule getModule(const std::string& file, const std::vector<std::string>& defines = {});
+	//! Compiles the module first if it isn't yet
+	Reflection getReflection(const std::string& file, const std::vector<std::string>& defines = {});
+
+	//! Main thread. Bindings used by several of the files are merged, their stages or'ed together
+	PipelineLayout getPipelineLayout(const std::vector<std::string>& files);
+
+	//! Main thread, once per frame. Returns the source files whose modules were replaced
+	std::vector<std::string> update();
+
+	static void shaderGui(std::vector<void*> classInstances);
+
+private:
+	struct Module
+	{
+		std::string file;
+		std::vector<std::string> defines;
+		VkShaderModule module = VK_NULL_HANDLE;
+		Reflection reflection;
+		std::vector<std::string> dependencies;//file and everything it includes
+		bool fromDiskCache = false;
+		std::string error;//Of the last reload that failed
+	};
+
+	//! Returns the key of the module, compiling it without holding m_Mutex if it isn't cached
+	std::string findOrBuild(const std::string& file, const std::vector<std::string>& defines);
+
+	//! Reads file and its includes, hashing all of them. Throws if one is missing
+	std::string readSources(const std::string& file, std::vector<std::string>& dependencies, uint64_t& hash);
+	//! The disk cache first, shaderc on a miss. Throws with the compiler's message if it doesn't compile
+	std::vector<uint32_t> compile(Module& module);
+	VkShaderModule createModule(const std::vector<uint32_t>& spirv);
+	static Reflection reflect(const std::vector<uint32_t>& spirv);
+
+	std::string getCachePath(const std::string& file, uint64_t hash);
+	//! m_Mutex must be held
+	void trackDependencies(const Module& module);
+
+private:
+	VkDevice m_Device = VK_NULL_HANDLE;
+	DescriptorManager* m_Descriptors = nullptr;
+	std::string m_SourceDirectory;
+	std::string m_CacheDirectory;
+
+	std::mutex m_Mutex;
+	std::unordered_map<std::string, Module> m_Modules;//By file and defines
+	std::unordered_map<std::string, std::filesystem::file_time_type> m_WriteTimes;//Every file a module depends on
+	std::unordered_map<uint64_t, PipelineLayout> m_PipelineLayouts;//By a hash of the merged reflection
+	std::vector<VkShaderModule> m_RetiredModules;//Replaced by a reload, another thread may still be building a pipeline from one
+
+	bool m_HotReload = true;
+	std::chrono::steady_clock::time_point m_LastPoll;
+	std::atomic<uint32_t> m_Compiles{ 0 };
+	std::atomic<uint32_t> m_DiskHits{ 0 };
+};
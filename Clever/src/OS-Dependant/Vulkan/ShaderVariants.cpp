@@ -0,0 +1,94 @@
+#include "ShaderVariants.h"
+
+namespace ShaderVariants
+{
+	enum class Kind
+	{
+		Define,
+		Specialization,
+		State
+	};
+
+	struct FeatureLayout
+	{
+		const char* name;
+		Kind kind;
+		const char* define;//Define only
+		uint32_t constantId;//Specialization only, the constant_id in the shaders
+		bool optional;//Can be drawn with the generic variant until it is built
+	};
+
+	//Indexed by ShaderFeature
+	static const FeatureLayout s_Features[] =
+	{
+		{ "Wireframe", Kind::State, "", 0, false },
+		{ "Lit", Kind::Specialization, "", 0, true }
+	};
+
+	static const uint32_t FEATURE_COUNT = sizeof(s_Features) / sizeof(s_Features[0]);
+
+	VkSpecializationInfo Specialization::getInfo() const
+	{
+		VkSpecializationInfo info{};
+		info.mapEntryCount = static_cast<uint32_t>(entries.size());
+		info.pMapEntries = entries.data();
+		info.dataSize = data.size() * sizeof(uint32_t);
+		info.pData = data.data();
+		return info;
+	}
+
+	std::vector<std::string> getDefines(ShaderFeatures features)
+	{
+		std::vector<std::string> defines;
+		for (uint32_t i = 0; i < FEATURE_COUNT; i++)
+		{
+			if (s_Features[i].kind == Kind::Define && features.has(static_cast<ShaderFeature>(i)))
+				defines.push_back(s_Features[i].define);
+		}
+		return defines;
+	}
+
+	Specialization getSpecialization(ShaderFeatures features)
+	{
+		Specialization specialization;
+		for (uint32_t i = 0; i < FEATURE_COUNT; i++)
+		{
+			if (s_Features[i].kind != Kind::Specialization)
+				continue;
+
+			VkSpecializationMapEntry entry{};
+			entry.constantID = s_Features[i].constantId;
+			entry.offset = static_cast<uint32_t>(specialization.data.size() * sizeof(uint32_t));
+			entry.size = sizeof(uint32_t);
+			specialization.entries.push_back(entry);
+			specialization.data.push_back(features.has(static_cast<ShaderFeature>(i)) ? VK_TRUE : VK_FALSE);
+		}
+		return specialization;
+	}
+
+	ShaderFeatures getGeneric(ShaderFeatures features)
+	{
+		ShaderFeatures generic;
+		for (uint32_t i = 0; i < FEATURE_COUNT; i++)
+		{
+			ShaderFeature feature = static_cast<ShaderFeature>(i);
+			if (!s_Features[i].optional && features.has(feature))
+				generic = generic | feature;
+		}
+		return generic;
+	}
+
+	std::string getName(ShaderFeatures features)
+	{
+		std::string name;
+		for (uint32_t i = 0; i < FEATURE_COUNT; i++)
+		{
+			if (!features.has(static_cast<ShaderFeature>(i)))
+				continue;
+			if (!name.empty())
+				name += " | ";
+			name += s_Features[i].name;
+		}
+		return name.empty() ? "Generic" : name;
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/*
+-------------Shader Variants----------------
+
+Pipelines are built for a set of features instead of a hand written pipeline or shader file per combination.
+Each feature is one of:
+	Define:			compiled into the shader as a #define, every combination is its own module. Only for what changes
+					the shader's interface.
+	Specialization:	a specialization constant, one module serves every combination and the driver folds the branches
+					when the pipeline is built. The default for anything that only changes what the shader computes.
+	State:			changes fixed function state only, the shaders are the same.
+
+Optional features can be drawn without for a while. The generic variant of a set is what is left once they are
+dropped, pipelines of a variant that isn't built yet draw with it (see ResourceCache::acquirePipeline).
+*/
+enum class ShaderFeature : uint32_t
+{
+	Wireframe,	//State, lines instead of filled triangles
+	Lit			//Specialization LIT, shader.frag lights the surface instead of showing its normal
+};
+
+//! Bit set of ShaderFeature
+struct ShaderFeatures
+{
+	uint32_t bits = 0;
+
+	ShaderFeatures() = default;
+	ShaderFeatures(ShaderFeature feature)
+		: bits(1u << static_cast<uint32_t>(feature))
+	{
+
+	}
+
+	bool has(ShaderFeature feature) const
+	{
+		return (bits & ShaderFeatures(feature).bits) != 0;
+	}
+
+	ShaderFeatures operator|(ShaderFeatures other) const
+	{
+		ShaderFeatures features;
+		features.bits = bits | other.bits;
+		return features;
+	}
+
+	bool operator==(ShaderFeatures other) const
+	{
+		return bits == other.bits;
+	}
+
+	bool operator!=(ShaderFeatures other) const
+	{
+		return bits != other.bits;
+	}
+};
+
+inline ShaderFeatures operator|(ShaderFeature a, ShaderFeature b)
+{
+	return ShaderFeatures(a) | ShaderFeatures(b);
+}
+
+namespace ShaderVariants
+{
+	//! Specialization constants of a feature set, getInfo() points into it so it has to outlive the pipeline's creation
+	struct Specialization
+	{
+		std::vector<VkSpecializationMapEntry> entries;
+		std::vector<uint32_t> data;//One 32 bit value per entry, booleans are VK_TRUE or VK_FALSE
+
+		VkSpecializationInfo getInfo() const;
+	};
+
+	std::vector<std::string> getDefines(ShaderFeatures features);
+	//! Every specialization feature gets an entry, the ones not in features are set to false
+	Specialization getSpecialization(ShaderFeatures features);
+
+	//! features without the optional ones
+	ShaderFeatures getGeneric(ShaderFeatures features);
+
+	//! "Wireframe | Lit", "Generic" for none
+	std::string getName(ShaderFeatures features);
+}
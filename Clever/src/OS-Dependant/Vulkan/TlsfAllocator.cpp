@@ -0,0 +1,321 @@
+#include "TlsfAllocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+void TlsfAllocator::init(uint64_t size)
+{
+	m_Nodes.clear();
+	m_RecycledNodes.clear();
+	m_FirstLevelMap = 0;
+	for (uint32_t fl = 0; fl < FL_COUNT; fl++)
+	{
+		m_SecondLevelMap[fl] = 0;
+		for (uint32_t sl = 0; sl < SL_COUNT; sl++)
+			m_FreeLists[fl][sl] = INVALID;
+	}
+
+	m_Capacity = 0;
+	m_FreeBytes = 0;
+	m_AllocationCount = 0;
+	m_FreeRangeCount = 0;
+	m_LastPhysical = INVALID;
+
+	grow(size);
+}
+
+uint32_t TlsfAllocator::allocate(uint64_t size, uint64_t alignment, uint64_t& offset)
+{
+	if (size == 0)
+		size = 1;
+	if (alignment == 0)
+		alignment = 1;
+
+	//Worst case the range starts one byte past an aligned offset
+	uint32_t node = findFree(size + alignment - 1);
+	if (node == INVALID)
+		return INVALID;
+
+	removeFree(node);
+
+	//The padding in front stays free, the range before is in use so it can't be merged
+	uint64_t aligned = (m_Nodes[node].offset + alignment - 1) & ~(alignment - 1);
+	uint64_t padding = aligned - m_Nodes[node].offset;
+	if (padding > 0)
+	{
+		uint32_t front = splitFront(node, padding);
+		m_Nodes[front].free = true;
+		insertFree(front);
+	}
+
+	//Whatever is left behind goes back too, the range after is in use as well
+	if (m_Nodes[node].size > size)
+	{
+		uint32_t used = splitFront(node, size);
+		m_Nodes[node].free = true;
+		insertFree(node);
+		node = used;
+	}
+
+	m_Nodes[node].free = false;
+	m_FreeBytes -= m_Nodes[node].size;
+	m_AllocationCount++;
+
+	offset = m_Nodes[node].offset;
+	return node;
+}
+
+void TlsfAllocator::free(uint32_t node)
+{
+	if (node >= m_Nodes.size() || !m_Nodes[node].inUse || m_Nodes[node].free)
+		throw std::runtime_error("failed to free range, it is not allocated!");
+
+	m_FreeBytes += m_Nodes[node].size;
+	m_AllocationCount--;
+
+	uint32_t previous = m_Nodes[node].prevPhysical;
+	if (previous != INVALID && m_Nodes[previous].free)
+	{
+		removeFree(previous);
+		m_Nodes[previous].size += m_Nodes[node].size;
+		m_Nodes[previous].nextPhysical = m_Nodes[node].nextPhysical;
+		if (m_Nodes[node].nextPhysical != INVALID)
+			m_Nodes[m_Nodes[node].nextPhysical].prevPhysical = previous;
+		if (m_LastPhysical == node)
+			m_LastPhysical = previous;
+		releaseNode(node);
+		node = previous;
+	}
+
+	uint32_t next = m_Nodes[node].nextPhysical;
+	if (next != INVALID && m_Nodes[next].free)
+	{
+		removeFree(next);
+		m_Nodes[node].size += m_Nodes[next].size;
+		m_Nodes[node].nextPhysical = m_Nodes[next].nextPhysical;
+		if (m_Nodes[next].nextPhysical != INVALID)
+			m_Nodes[m_Nodes[next].nextPhysical].prevPhysical = node;
+		if (m_LastPhysical == next)
+			m_LastPhysical = node;
+		releaseNode(next);
+	}
+
+	m_Nodes[node].free = true;
+	insertFree(node);
+}
+
+void TlsfAllocator::grow(uint64_t newSize)
+{
+	if (newSize <= m_Capacity)
+		return;
+
+	uint64_t added = newSize - m_Capacity;
+	if (m_LastPhysical != INVALID && m_Nodes[m_LastPhysical].free)
+	{
+		removeFree(m_LastPhysical);
+		m_Nodes[m_LastPhysical].size += added;
+		insertFree(m_LastPhysical);
+	}
+	else
+	{
+		uint32_t node = newNode();
+		m_Nodes[node].offset = m_Capacity;
+		m_Nodes[node].size = added;
+		m_Nodes[node].prevPhysical = m_LastPhysical;
+		m_Nodes[node].free = true;
+		if (m_LastPhysical != INVALID)
+			m_Nodes[m_LastPhysical].nextPhysical = node;
+		m_LastPhysical = node;
+		insertFree(node);
+	}
+
+	m_Capacity = newSize;
+	m_FreeBytes += added;
+}
+
+uint64_t TlsfAllocator::getLargestFreeRange()
+{
+	if (m_FirstLevelMap == 0)
+		return 0;
+
+	uint32_t fl = findLastSet(m_FirstLevelMap);
+	uint32_t sl = findLastSet(m_SecondLevelMap[fl]);
+
+	uint64_t largest = 0;
+	for (uint32_t node = m_FreeLists[fl][sl]; node != INVALID; node = m_Nodes[node].nextFree)
+		largest = std::max(largest, m_Nodes[node].size);
+	return largest;
+}
+
+std::vector<TlsfAllocator::Range> TlsfAllocator::getRanges()
+{
+	std::vector<uint32_t> order;
+	for (uint32_t node = m_LastPhysical; node != INVALID; node = m_Nodes[node].prevPhysical)
+		order.push_back(node);
+
+	std::vector<Range> ranges;
+	ranges.reserve(order.size());
+	for (auto it = order.rbegin(); it != order.rend(); it++)
+		ranges.push_back({ m_Nodes[*it].offset, m_Nodes[*it].size, m_Nodes[*it].free });
+	return ranges;
+}
+
+std::vector<uint32_t> TlsfAllocator::getAllocatedNodes(bool fromBack)
+{
+	std::vector<uint32_t> nodes;
+	for (uint32_t node = m_LastPhysical; node != INVALID; node = m_Nodes[node].prevPhysical)
+	{
+		if (!m_Nodes[node].free)
+			nodes.push_back(node);
+	}
+	if (!fromBack)
+		std::reverse(nodes.begin(), nodes.end());
+	return nodes;
+}
+
+void TlsfAllocator::mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+	if (size < (1ull << FL_SHIFT))
+	{
+		fl = 0;
+		sl = static_cast<uint32_t>(size / ((1ull << FL_SHIFT) / SL_COUNT));
+		return;
+	}
+
+	uint32_t bit = findLastSet(size);
+	sl = static_cast<uint32_t>(size >> (bit - SL_LOG2)) ^ SL_COUNT;
+	fl = bit - FL_SHIFT + 1;
+}
+
+uint32_t TlsfAllocator::findLastSet(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+uint32_t TlsfAllocator::findFirstSet(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return static_cast<uint32_t>(index);
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+uint32_t TlsfAllocator::newNode()
+{
+	uint32_t node;
+	if (!m_RecycledNodes.empty())
+	{
+		node = m_RecycledNodes.back();
+		m_RecycledNodes.pop_back();
+		m_Nodes[node] = Node{};
+	}
+	else
+	{
+		node = static_cast<uint32_t>(m_Nodes.size());
+		m_Nodes.emplace_back();
+	}
+	m_Nodes[node].inUse = true;
+	return node;
+}
+
+void TlsfAllocator::releaseNode(uint32_t node)
+{
+	m_Nodes[node].inUse = false;
+	m_RecycledNodes.push_back(node);
+}
+
+void TlsfAllocator::insertFree(uint32_t node)
+{
+	uint32_t fl, sl;
+	mapping(m_Nodes[node].size, fl, sl);
+
+	uint32_t head = m_FreeLists[fl][sl];
+	m_Nodes[node].prevFree = INVALID;
+	m_Nodes[node].nextFree = head;
+	if (head != INVALID)
+		m_Nodes[head].prevFree = node;
+	m_FreeLists[fl][sl] = node;
+
+	m_FirstLevelMap |= 1ull << fl;
+	m_SecondLevelMap[fl] |= 1u << sl;
+	m_FreeRangeCount++;
+}
+
+void TlsfAllocator::removeFree(uint32_t node)
+{
+	uint32_t fl, sl;
+	mapping(m_Nodes[node].size, fl, sl);
+
+	Node& entry = m_Nodes[node];
+	if (entry.prevFree != INVALID)
+		m_Nodes[entry.prevFree].nextFree = entry.nextFree;
+	else
+		m_FreeLists[fl][sl] = entry.nextFree;
+	if (entry.nextFree != INVALID)
+		m_Nodes[entry.nextFree].prevFree = entry.prevFree;
+	entry.prevFree = INVALID;
+	entry.nextFree = INVALID;
+
+	if (m_FreeLists[fl][sl] == INVALID)
+	{
+		m_SecondLevelMap[fl] &= ~(1u << sl);
+		if (m_SecondLevelMap[fl] == 0)
+			m_FirstLevelMap &= ~(1ull << fl);
+	}
+	m_FreeRangeCount--;
+}
+
+uint32_t TlsfAllocator::findFree(uint64_t size)
+{
+	//Rounded up to the next step, every range from that list on fits
+	uint64_t step = size < (1ull << FL_SHIFT) ? (1ull << FL_SHIFT) / SL_COUNT : 1ull << (findLastSet(size) - SL_LOG2);
+	uint64_t rounded = size + step - 1;
+
+	uint32_t fl, sl;
+	mapping(rounded, fl, sl);
+	if (fl >= FL_COUNT)
+		return INVALID;
+
+	uint32_t secondMap = m_SecondLevelMap[fl] & (~0u << sl);
+	if (secondMap == 0)
+	{
+		uint64_t firstMap = fl + 1 < 64 ? m_FirstLevelMap & (~0ull << (fl + 1)) : 0;
+		if (firstMap == 0)
+			return INVALID;
+
+		fl = findFirstSet(firstMap);
+		secondMap = m_SecondLevelMap[fl];
+	}
+	sl = findFirstSet(secondMap);
+	return m_FreeLists[fl][sl];
+}
+
+uint32_t TlsfAllocator::splitFront(uint32_t node, uint64_t size)
+{
+	uint32_t front = newNode();
+	//newNode may have grown m_Nodes, no references are held across it
+	m_Nodes[front].offset = m_Nodes[node].offset;
+	m_Nodes[front].size = size;
+	m_Nodes[front].prevPhysical = m_Nodes[node].prevPhysical;
+	m_Nodes[front].nextPhysical = node;
+	if (m_Nodes[node].prevPhysical != INVALID)
+		m_Nodes[m_Nodes[node].prevPhysical].nextPhysical = front;
+
+	m_Nodes[node].offset += size;
+	m_Nodes[node].size -= size;
+	m_Nodes[node].prevPhysical = front;
+	return front;
+}
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+/*
+-------------TLSF Range Allocator----------------
+
+Two level segregated fit over a range of offsets, it only does the bookkeeping so it can hand out ranges of anything
+(device memory blocks, arenas in a buffer). Allocating and freeing are O(1) no matter how many ranges there are.
+
+Free ranges are kept in lists by size, the first level is the power of two and the second splits it in SL_COUNT
+linear steps. A search rounds the size up to the next step so any range in the list it lands on is big enough.
+Ranges know their physical neighbours so freeing merges with them right away, two free ranges are never next to
+each other.
+*/
+class TlsfAllocator
+{
+public:
+	static const uint32_t INVALID = UINT32_MAX;
+	static const uint32_t SL_LOG2 = 4;
+	static const uint32_t SL_COUNT = 1 << SL_LOG2;
+	static const uint32_t FL_SHIFT = 8;//Sizes below 1 << FL_SHIFT share the first list, split in SL_COUNT steps
+	static const uint32_t FL_COUNT = 64 - FL_SHIFT + 1;
+
+	struct Range
+	{
+		uint64_t offset;
+		uint64_t size;
+		bool free;
+	};
+
+public:
+	TlsfAllocator() = default;
+
+	void init(uint64_t size);
+
+	//! Returns INVALID when no free range fits, alignment has to be a power of two
+	uint32_t allocate(uint64_t size, uint64_t alignment, uint64_t& offset);
+	void free(uint32_t node);
+
+	//! Adds space at the end, merged with the last range when that one is free
+	void grow(uint64_t newSize);
+
+	uint64_t getOffset(uint32_t node)
+	{
+		return m_Nodes[node].offset;
+	}
+
+	uint64_t getSize(uint32_t node)
+	{
+		return m_Nodes[node].size;
+	}
+
+	uint64_t getCapacity()
+	{
+		return m_Capacity;
+	}
+
+	uint64_t getFreeBytes()
+	{
+		return m_FreeBytes;
+	}
+
+	uint32_t getAllocationCount()
+	{
+		return m_AllocationCount;
+	}
+
+	uint32_t getFreeRangeCount()
+	{
+		return m_FreeRangeCount;
+	}
+
+	//! Biggest single free range, only walks the top non empty list
+	uint64_t getLargestFreeRange();
+
+	//! Every range in address order
+	std::vector<Range> getRanges();
+
+	//! Allocated nodes in address order, last first when fromBack is set
+	std::vector<uint32_t> getAllocatedNodes(bool fromBack = false);
+
+private:
+	struct Node
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t prevPhysical = INVALID;
+		uint32_t nextPhysical = INVALID;
+		uint32_t prevFree = INVALID;
+		uint32_t nextFree = INVALID;
+		bool free = false;
+		bool inUse = false;//False once recycled
+	};
+
+	static void mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+	static uint32_t findLastSet(uint64_t value);
+	static uint32_t findFirstSet(uint64_t value);
+
+	uint32_t newNode();
+	void releaseNode(uint32_t node);
+
+	void insertFree(uint32_t node);
+	void removeFree(uint32_t node);
+	uint32_t findFree(uint64_t size);
+
+	//! Splits the front size bytes off node as a node of its own, returns the new node
+	uint32_t splitFront(uint32_t node, uint64_t size);
+
+private:
+	std::vector<Node> m_Nodes;
+	std::vector<uint32_t> m_RecycledNodes;
+
+	uint64_t m_FirstLevelMap = 0;
+	uint32_t m_SecondLevelMap[FL_COUNT] = {};
+	uint32_t m_FreeLists[FL_COUNT][SL_COUNT];
+
+	uint32_t m_LastPhysical = INVALID;
+	uint64_t m_Capacity = 0;
+	uint64_t m_FreeBytes = 0;
+	uint32_t m_AllocationCount = 0;
+	uint32_t m_FreeRangeCount = 0;
+};
@@ -0,0 +1,442 @@
+#include "TransferManager.h"
+#include "Clever/Developer/DevTools.h"
+#include "Clever/Developer/Profiler.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+void TransferManager::init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator& allocator, uint32_t graphicsFamily, VkQueue graphicsQueue, std::optional<uint32_t> transferFamily, VkQueue transferQueue)
+{
+	m_Device = device;
+	m_PhysicalDevice = physicalDevice;
+	m_Allocator = &allocator;
+	m_GraphicsFamily = graphicsFamily;
+	m_GraphicsQueue = graphicsQueue;
+
+	m_OwnershipTransfer = transferFamily.has_value() && transferFamily.value() != graphicsFamily;
+	m_TransferFamily = m_OwnershipTransfer ? transferFamily.value() : graphicsFamily;
+	m_TransferQueue = m_OwnershipTransfer ? transferQueue : graphicsQueue;
+
+	//! Creating Command Pools
+	{
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = m_TransferFamily;
+
+		if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_TransferPool) != VK_SUCCESS)
+			throw std::runtime_error("failed to create transfer command pool!");
+
+		if (m_OwnershipTransfer)
+		{
+			poolInfo.queueFamilyIndex = m_GraphicsFamily;
+			if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_AcquirePool) != VK_SUCCESS)
+				throw std::runtime_error("failed to create transfer acquire command pool!");
+		}
+	}
+
+	//! Creating Timeline Semaphore
+	{
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if (vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_Timeline) != VK_SUCCESS)
+			throw std::runtime_error("failed to create transfer timeline semaphore!");
+	}
+
+	//! Creating Staging Ring
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+		m_Alignment = std::max<VkDeviceSize>(16, properties.limits.optimalBufferCopyOffsetAlignment);
+
+		m_RingMemory = m_Allocator->createBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_RingBuffer, MemoryAllocator::ALLOCATION_DEDICATED);
+		m_RingMapped = m_RingMemory->mapped;
+	}
+
+	DevTools::addDockFunction(transferGui, { this });
+}
+
+void TransferManager::cleanup()
+{
+	//The device is idle so everything submitted is done
+	retireBatches(UINT64_MAX);
+
+	for (Copy& copy : m_Pending)
+	{
+		if (copy.stagingMemory != nullptr)
+			m_Allocator->destroyBuffer(copy.src, copy.stagingMemory);
+	}
+	m_Pending.clear();
+	for (Backlogged& upload : m_Backlog)
+	{
+		if (upload.stagingMemory != nullptr)
+			m_Allocator->destroyBuffer(upload.staging, upload.stagingMemory);
+	}
+	m_Backlog.clear();
+
+	m_Allocator->destroyBuffer(m_RingBuffer, m_RingMemory);
+
+	vkDestroySemaphore(m_Device, m_Timeline, nullptr);
+
+	vkDestroyCommandPool(m_Device, m_TransferPool, nullptr);
+	if (m_AcquirePool != VK_NULL_HANDLE)
+		vkDestroyCommandPool(m_Device, m_AcquirePool, nullptr);
+}
+
+std::shared_future<void> TransferManager::uploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size, Usage usage, VkDeviceSize dstOffset)
+{
+	CLEVER_PROFILE_FUNCTION();
+	std::promise<void> promise;
+	std::shared_future<void> future = promise.get_future().share();
+	if (size == 0)
+	{
+		promise.set_value();
+		return future;
+	}
+
+	if (size > STAGING_RING_SIZE)
+	{
+		//Too big for the ring, only these get a staging buffer of their own
+		VkBuffer staging;
+		MemoryAllocator::Allocation* stagingMemory = m_Allocator->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging);
+		memcpy(stagingMemory->mapped, data, static_cast<size_t>(size));
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_UploadCount++;
+		//Behind the backlog like any other upload, so it can't overtake earlier writes to the same buffer
+		if (!m_Backlog.empty())
+		{
+			m_Backlog.push_back({ dst, dstOffset, {}, usage, std::move(promise), staging, size, stagingMemory });
+			return future;
+		}
+		m_Pending.push_back({ dst, dstOffset, staging, 0, size, usage, stagingMemory, std::move(promise) });
+		return future;
+	}
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_UploadCount++;
+
+	//Once something is backlogged everything after it is too, so writes to the same buffer stay in order
+	VkDeviceSize offset;
+	if (m_Backlog.empty() && allocateStaging(size, offset))
+	{
+		memcpy(m_RingMapped + offset, data, static_cast<size_t>(size));
+		m_Pending.push_back({ dst, dstOffset, m_RingBuffer, offset, size, usage, nullptr, std::move(promise) });
+		return future;
+	}
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	m_Backlog.push_back({ dst, dstOffset, std::vector<uint8_t>(bytes, bytes + size), usage, std::move(promise) });
+	return future;
+}
+
+void TransferManager::update()
+{
+	CLEVER_PROFILE_FUNCTION();
+	uint64_t completedValue = 0;
+	vkGetSemaphoreCounterValue(m_Device, m_Timeline, &completedValue);
+
+	retireBatches(completedValue);
+	stageBacklog();
+	submitPending();
+}
+
+void TransferManager::waitIdle()
+{
+	CLEVER_PROFILE_FUNCTION();
+	while (true)
+	{
+		update();
+
+		bool queued;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			queued = !m_Pending.empty() || !m_Backlog.empty();
+		}
+		if (!queued && m_InFlight.empty())
+			return;
+
+		//The backlog is only staged after the batches holding the ring are done, so this goes around until it's empty
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &m_Timeline;
+		waitInfo.pValues = &m_LastSignaled;
+
+		if (vkWaitSemaphores(m_Device, &waitInfo, UINT64_MAX) != VK_SUCCESS)
+			throw std::runtime_error("failed to wait for transfer timeline semaphore!");
+	}
+}
+
+TransferManager::UsageInfo TransferManager::getUsageInfo(Usage usage)
+{
+	const VkPipelineStageFlags shaderStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+	switch (usage)
+	{
+	case Usage::Vertex:
+		return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT };
+	case Usage::Index:
+		return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT };
+	case Usage::Indirect:
+		return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT };
+	case Usage::Uniform:
+		return { shaderStages, VK_ACCESS_UNIFORM_READ_BIT };
+	case Usage::Storage:
+	default:
+		return { shaderStages, VK_ACCESS_SHADER_READ_BIT };
+	}
+}
+
+bool TransferManager::allocateStaging(VkDeviceSize size, VkDeviceSize& offset)
+{
+	uint64_t head = (m_RingHead + m_Alignment - 1) / m_Alignment * m_Alignment;
+
+	//An upload never wraps around the end of the ring, it starts over at the front instead
+	uint64_t position = head % STAGING_RING_SIZE;
+	if (position + size > STAGING_RING_SIZE)
+		head += STAGING_RING_SIZE - position;
+
+	if (head + size - m_RingTail > STAGING_RING_SIZE)
+		return false;
+
+	offset = head % STAGING_RING_SIZE;
+	m_RingHead = head + size;
+	return true;
+}
+
+void TransferManager::retireBatches(uint64_t completedValue)
+{
+	while (!m_InFlight.empty() && m_InFlight.front().residentValue <= completedValue)
+	{
+		Batch& batch = m_InFlight.front();
+		for (Copy& copy : batch.copies)
+		{
+			if (copy.stagingMemory != nullptr)
+				m_Allocator->destroyBuffer(copy.src, copy.stagingMemory);
+			copy.promise.set_value();
+		}
+
+		m_FreeTransferCommands.push_back(batch.transferCommands);
+		if (batch.acquireCommands != VK_NULL_HANDLE)
+			m_FreeAcquireCommands.push_back(batch.acquireCommands);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_RingTail = batch.ringEnd;
+		}
+		m_InFlight.pop_front();
+	}
+}
+
+void TransferManager::stageBacklog()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	while (!m_Backlog.empty())
+	{
+		Backlogged& upload = m_Backlog.front();
+		if (upload.stagingMemory != nullptr)
+		{
+			m_Pending.push_back({ upload.dst, upload.dstOffset, upload.staging, 0, upload.stagingSize, upload.usage, upload.stagingMemory, std::move(upload.promise) });
+			m_Backlog.pop_front();
+			continue;
+		}
+
+		VkDeviceSize size = upload.data.size();
+		VkDeviceSize offset;
+		if (!allocateStaging(size, offset))
+			break;
+
+		memcpy(m_RingMapped + offset, upload.data.data(), static_cast<size_t>(size));
+		m_Pending.push_back({ upload.dst, upload.dstOffset, m_RingBuffer, offset, size, upload.usage, nullptr, std::move(upload.promise) });
+		m_Backlog.pop_front();
+	}
+}
+
+void TransferManager::submitPending()
+{
+	Batch batch{};
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		batch.copies.swap(m_Pending);
+		batch.ringEnd = m_RingHead;
+	}
+	if (batch.copies.empty())
+		return;
+
+	CLEVER_PROFILE_FUNCTION();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	//! Recording Copies
+	std::vector<VkBufferMemoryBarrier> barriers;
+	barriers.reserve(batch.copies.size());
+	VkPipelineStageFlags usageStages = 0;
+
+	batch.transferCommands = getCommandBuffer(m_TransferPool, m_FreeTransferCommands);
+	vkBeginCommandBuffer(batch.transferCommands, &beginInfo);
+	for (Copy& copy : batch.copies)
+	{
+		VkBufferCopy region{};
+		region.srcOffset = copy.srcOffset;
+		region.dstOffset = copy.dstOffset;
+		region.size = copy.size;
+		vkCmdCopyBuffer(batch.transferCommands, copy.src, copy.dst, 1, &region);
+
+		UsageInfo usage = getUsageInfo(copy.usage);
+		usageStages |= usage.stage;
+
+		VkBufferMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = usage.access;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = copy.dst;
+		barrier.offset = copy.dstOffset;
+		barrier.size = copy.size;
+		barriers.push_back(barrier);
+
+		m_BytesUploaded += copy.size;
+	}
+
+	if (m_OwnershipTransfer)
+	{
+		//Release, the access mask on the graphics side is set by the acquire
+		std::vector<VkBufferMemoryBarrier> releases = barriers;
+		for (VkBufferMemoryBarrier& release : releases)
+		{
+			release.dstAccessMask = 0;
+			release.srcQueueFamilyIndex = m_TransferFamily;
+			release.dstQueueFamilyIndex = m_GraphicsFamily;
+		}
+		vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, static_cast<uint32_t>(releases.size()), releases.data(), 0, nullptr);
+	}
+	else
+	{
+		//Same queue as the frames, this barrier covers every later submission
+		vkCmdPipelineBarrier(batch.transferCommands, VK_PIPELINE_STAGE_TRANSFER_BIT, usageStages, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+	}
+
+	if (vkEndCommandBuffer(batch.transferCommands) != VK_SUCCESS)
+		throw std::runtime_error("failed to record transfer command buffer!");
+
+	//! Submitting Copies
+	uint64_t copiedValue = ++m_LastSignaled;
+	{
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &copiedValue;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.transferCommands;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &m_Timeline;
+
+		if (vkQueueSubmit(m_TransferQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("failed to submit transfer command buffer!");
+	}
+	batch.residentValue = copiedValue;
+
+	//! Acquiring On The Graphics Queue
+	if (m_OwnershipTransfer)
+	{
+		for (VkBufferMemoryBarrier& acquire : barriers)
+		{
+			acquire.srcAccessMask = 0;
+			acquire.srcQueueFamilyIndex = m_TransferFamily;
+			acquire.dstQueueFamilyIndex = m_GraphicsFamily;
+		}
+
+		batch.acquireCommands = getCommandBuffer(m_AcquirePool, m_FreeAcquireCommands);
+		vkBeginCommandBuffer(batch.acquireCommands, &beginInfo);
+		vkCmdPipelineBarrier(batch.acquireCommands, usageStages, usageStages, 0, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+		if (vkEndCommandBuffer(batch.acquireCommands) != VK_SUCCESS)
+			throw std::runtime_error("failed to record transfer acquire command buffer!");
+
+		uint64_t residentValue = ++m_LastSignaled;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = 1;
+		timelineInfo.pWaitSemaphoreValues = &copiedValue;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &residentValue;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &m_Timeline;
+		submitInfo.pWaitDstStageMask = &usageStages;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &batch.acquireCommands;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &m_Timeline;
+
+		if (vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+			throw std::runtime_error("failed to submit transfer acquire command buffer!");
+
+		batch.residentValue = residentValue;
+	}
+
+	m_BatchCount++;
+	m_InFlight.push_back(std::move(batch));
+}
+
+VkCommandBuffer TransferManager::getCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer>& freeBuffers)
+{
+	if (!freeBuffers.empty())
+	{
+		VkCommandBuffer commandBuffer = freeBuffers.back();
+		freeBuffers.pop_back();
+		return commandBuffer;
+	}
+
+	VkCommandBufferAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocInfo.commandPool = pool;
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(m_Device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		throw std::runtime_error("failed to allocate transfer command buffer!");
+	return commandBuffer;
+}
+
+void TransferManager::transferGui(std::vector<void*> classInstances)
+{
+	TransferManager* manager = (TransferManager*)classInstances.at(0);
+	DevTools::newDock("Uploads");
+
+	size_t pending;
+	size_t backlogged;
+	uint64_t ringUsed;
+	{
+		std::lock_guard<std::mutex> lock(manager->m_Mutex);
+		pending = manager->m_Pending.size();
+		backlogged = manager->m_Backlog.size();
+		ringUsed = manager->m_RingHead - manager->m_RingTail;
+	}
+
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, manager->m_OwnershipTransfer ? "Queue: dedicated transfer family " + std::to_string(manager->m_TransferFamily) : std::string("Queue: graphics"));
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Staging: " + std::to_string(ringUsed >> 10) + " / " + std::to_string(STAGING_RING_SIZE >> 10) + " KB");
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Pending: " + std::to_string(pending) + ", Backlogged: " + std::to_string(backlogged) + ", Batches in flight: " + std::to_string(manager->m_InFlight.size()));
+	DevTools::coloredText({ 0.8, 0.8, 0.8 }, "Uploaded: " + std::to_string(manager->m_UploadCount) + " uploads, " + std::to_string(manager->m_BytesUploaded >> 10) + " KB in " + std::to_string(manager->m_BatchCount) + " batches");
+	DevTools::endDock();
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "MemoryAllocator.h"
+
+/*
+-------------Transfer Manager----------------
+
+Streams buffer uploads to the GPU without ever waiting on a queue.
+
+	Staging: uploads are copied into one persistently mapped ring buffer, anything bigger than the ring gets a staging
+			 buffer of its own. When the ring is full the data is kept on the CPU and staged once space frees up.
+	Batching: every upload queued since the last update() is recorded into one command buffer and submitted together.
+	Completion: each batch signals a timeline semaphore, update() polls it and resolves the futures of finished uploads.
+	Ownership: with a dedicated transfer family the copies are released by the transfer queue and acquired on the graphics
+			   queue, the acquire submit waits on the timeline. Without one the copies run on the graphics queue.
+
+The future of an upload is ready once the buffer can be used by any command buffer submitted to the graphics queue after
+that point, no further synchronization is needed.
+*/
+class TransferManager
+{
+public:
+	static const VkDeviceSize STAGING_RING_SIZE = 32ull << 20;
+
+	//! How the graphics queue reads the buffer, decides the stages and accesses the upload is made visible to
+	enum class Usage
+	{
+		Vertex,
+		Index,
+		Indirect,
+		Uniform,
+		Storage
+	};
+
+public:
+	TransferManager() = default;
+
+	//! transferQueue is ignored without a transferFamily, the graphics queue is used instead
+	void init(VkDevice device, VkPhysicalDevice physicalDevice, MemoryAllocator& allocator, uint32_t graphicsFamily, VkQueue graphicsQueue, std::optional<uint32_t> transferFamily, VkQueue transferQueue);
+
+	//! Device has to be idle
+	void cleanup();
+
+	//! Thread safe, data is copied before this returns. dst must be created with VK_BUFFER_USAGE_TRANSFER_DST_BIT
+	//! and VK_SHARING_MODE_EXCLUSIVE, and must not be used by the GPU until the future is ready.
+	std::shared_future<void> uploadBuffer(VkBuffer dst, const void* data, VkDeviceSize size, Usage usage, VkDeviceSize dstOffset = 0);
+
+	//! Main thread, once per frame before the frame is submitted. Resolves finished uploads and submits the queued ones.
+	void update();
+
+	//! Submits everything queued and blocks until it is resident, for loading screens and teardown
+	void waitIdle();
+
+	//! Family the destination buffers belong to once their uploads are done
+	uint32_t getGraphicsFamily()
+	{
+		return m_GraphicsFamily;
+	}
+
+	bool hasDedicatedQueue()
+	{
+		return m_OwnershipTransfer;
+	}
+
+	static void transferGui(std::vector<void*> classInstances);
+
+private:
+	struct Copy
+	{
+		VkBuffer dst;
+		VkDeviceSize dstOffset;
+		VkBuffer src;
+		VkDeviceSize srcOffset;
+		VkDeviceSize size;
+		Usage usage;
+		MemoryAllocator::Allocation* stagingMemory;//Set when src is a staging buffer of its own
+		std::promise<void> promise;
+	};
+
+	//! Didn't fit in the ring, staged on a later update
+	struct Backlogged
+	{
+		VkBuffer dst;
+		VkDeviceSize dstOffset;
+		std::vector<uint8_t> data;
+		Usage usage;
+		std::promise<void> promise;
+		//Set when the upload is too big for the ring and already has a staging buffer of its own, data is empty then
+		VkBuffer staging = VK_NULL_HANDLE;
+		VkDeviceSize stagingSize = 0;
+		MemoryAllocator::Allocation* stagingMemory = nullptr;
+	};
+
+	struct Batch
+	{
+		uint64_t residentValue;//Timeline value once the graphics queue owns every destination
+		uint64_t ringEnd;//Ring space before this is free once the batch is done
+		VkCommandBuffer transferCommands;
+		VkCommandBuffer acquireCommands;
+		std::vector<Copy> copies;
+	};
+
+	struct UsageInfo
+	{
+		VkPipelineStageFlags stage;
+		VkAccessFlags access;
+	};
+
+	static UsageInfo getUsageInfo(Usage usage);
+
+	//! Ring offset for size bytes, false when the ring is too full. m_Mutex must be held
+	bool allocateStaging(VkDeviceSize size, VkDeviceSize& offset);
+
+	void retireBatches(uint64_t completedValue);
+	void stageBacklog();
+	void submitPending();
+
+	VkCommandBuffer getCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer>& freeBuffers);
+
+private:
+	VkDevice m_Device = VK_NULL_HANDLE;
+	VkPhysicalDevice m_PhysicalDevice = VK_NULL_HANDLE;
+	MemoryAllocator* m_Allocator = nullptr;
+
+	uint32_t m_GraphicsFamily = 0;
+	uint32_t m_TransferFamily = 0;
+	VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
+	VkQueue m_TransferQueue = VK_NULL_HANDLE;//The graphics queue without a dedicated family
+	bool m_OwnershipTransfer = false;
+
+	VkCommandPool m_TransferPool = VK_NULL_HANDLE;
+	VkCommandPool m_AcquirePool = VK_NULL_HANDLE;//Only with an ownership transfer
+	std::vector<VkCommandBuffer> m_FreeTransferCommands;
+	std::vector<VkCommandBuffer> m_FreeAcquireCommands;
+
+	VkSemaphore m_Timeline = VK_NULL_HANDLE;
+	uint64_t m_LastSignaled = 0;
+
+	//Ring, offsets only ever grow, the position in the buffer is offset % STAGING_RING_SIZE
+	VkBuffer m_RingBuffer = VK_NULL_HANDLE;
+	MemoryAllocator::Allocation* m_RingMemory = nullptr;
+	uint8_t* m_RingMapped = nullptr;
+	VkDeviceSize m_Alignment = 16;
+	uint64_t m_RingHead = 0;
+	uint64_t m_RingTail = 0;
+
+	std::mutex m_Mutex;//Guards the pending copies, the backlog and the ring head
+	std::vector<Copy> m_Pending;
+	std::deque<Backlogged> m_Backlog;
+
+	std::deque<Batch> m_InFlight;
+
+	//Stats for the dock
+	uint64_t m_BytesUploaded = 0;
+	uint64_t m_UploadCount = 0;
+	uint64_t m_BatchCount = 0;
+};
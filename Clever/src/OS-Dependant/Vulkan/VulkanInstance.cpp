@@ -1,8 +1,9 @@
 #include "VulkanInstance.h"
+#include "Clever/Developer/Profiler.h"
 
 
-VulkanInstance::VulkanInstance(int height, int width, int max_frames_in_flight, bool RTXEnable) :
-	m_SwapChainExtent({ static_cast<uint32_t>(height), static_cast<uint32_t>(width) }), m_max_frames_in_flight(max_frames_in_flight)
+VulkanInstance::VulkanInstance(int height, int width, int max_frames_in_flight, bool RTXEnable, bool headless, bool dynamicResolution) :
+	m_Headless(headless), m_DynamicResolution(dynamicResolution), m_SwapChainExtent({ static_cast<uint32_t>(height), static_cast<uint32_t>(width) }), m_max_frames_in_flight(max_frames_in_flight)
 {
 	createInstance();
 	m_Camera.reset(new Camera(90.0f, height, width, 0.1f, 1000.0f, glm::vec3(3, 1, 8), m_Window));
@@ -11,12 +12,22 @@ VulkanInstance::VulkanInstance(int height, int width, int max_frames_in_flight,
 
 void VulkanInstance::cleanup()
 {
+		vkDeviceWaitIdle(m_Device);
+		m_Resources->cleanup();
+		m_DeletionQueue.flushAll();
+		m_Materials.cleanup();
+
+		for (uint32_t i = 0; i < m_ReadbackBuffers.size(); i++)
+		{
+			writePendingCapture(i);
+			m_Allocator.destroyBuffer(m_ReadbackBuffers[i], m_ReadbackBuffersMemory[i]);
+		}
+
 		cleanupSwapChain();
 
 		for (size_t i = 0; i < m_max_frames_in_flight; i++)
 		{
-			vkDestroyBuffer(m_Device, m_UniformBuffers[i], nullptr);
-			vkFreeMemory(m_Device, m_UniformBuffersMemory[i], nullptr);
+			m_Allocator.destroyBuffer(m_UniformBuffers[i], m_UniformBuffersMemory[i]);
 		}
 
 		for (size_t i = 0; i < m_max_frames_in_flight; i++) {
@@ -25,13 +36,26 @@ void VulkanInstance::cleanup()
 			vkDestroyFence(m_Device, m_InFlightFences[i], nullptr);
 		}
 
+		m_Descriptors.cleanup();
+		m_Culler.cleanup();
+		m_Profiler.cleanup();
+		m_RenderGraph.cleanup();
+		m_Geometry.cleanup();
+		m_TransferManager.cleanup();
+		m_Shaders.cleanup();
+
 		vkDestroyRenderPass(m_Device, m_RenderPass, nullptr);
+		vkDestroyRenderPass(m_Device, m_LateRenderPass, nullptr);
+		if (m_UIRenderPass != VK_NULL_HANDLE)
+			vkDestroyRenderPass(m_Device, m_UIRenderPass, nullptr);
 
 		vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
 
+		m_Allocator.cleanup();
 		vkDestroyDevice(m_Device, nullptr);
 
-		vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
+		if (!m_Headless)
+			vkDestroySurfaceKHR(m_Instance, m_Surface, nullptr);
 
 
 
@@ -45,83 +69,161 @@ void VulkanInstance::cleanup()
 
 		vkDestroyInstance(m_Instance, nullptr);
 
-		glfwDestroyWindow(m_Window);
-		glfwTerminate();
+		if (!m_Headless)
+		{
+			s_WindowInstances.erase(m_Window);
+			glfwDestroyWindow(m_Window);
+			glfwTerminate();
+		}
 }
 
-bool VulkanInstance::render(float time, Renderable* renderStart, VkCommandBuffer ImGuiCommandBuffer, uint32_t count, uint32_t m_CurrentFrame, uint32_t imageIndex)
+void VulkanInstance::captureFrame(const std::string& filename)
 {
-	vkWaitForFences(m_Device, 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX);
+	if (!m_Headless)
+	{
+		std::cout << "Frame capture is only supported in headless mode" << std::endl;
+		return;
+	}
+	m_RequestedCapture = filename;
+}
+
+void VulkanInstance::writePendingCapture(uint32_t currentFrame)
+{
+	if (currentFrame >= m_PendingCaptures.size() || m_PendingCaptures[currentFrame].empty())
+		return;
 
-	if (imageIndex == uint32_t(-1))
+	if (!ImageWriter::writeImage(m_PendingCaptures[currentFrame], m_SwapChainExtent.width, m_SwapChainExtent.height, static_cast<const uint8_t*>(m_ReadbackBuffersMapped[currentFrame])))
 	{
-		VkResult result = vkAcquireNextImageKHR
-		(
-			m_Device,
-			m_SwapChain,
-			UINT64_MAX,
-			m_ImageAvailableSemaphores[m_CurrentFrame],
-			VK_NULL_HANDLE,
-			&imageIndex
-		);
-		if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-			recreateSwapChain();
-			return true;
-		}
-		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-			throw std::runtime_error("failed to acquire swap chain image!");
+		std::cout << "Failed to write capture " << m_PendingCaptures[currentFrame] << std::endl;
+	}
+	m_PendingCaptures[currentFrame].clear();
+}
+
+void VulkanInstance::beginFrame(uint32_t currentFrame)
+{
+	CLEVER_PROFILE_SCOPE("Wait For Frame Fence");
+	vkWaitForFences(m_Device, 1, &m_InFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+
+	//Everything retired before this frame's last submit is no longer in use
+	m_DeletionQueue.flush(m_FrameSerials[currentFrame]);
+	//Pipelines built from shaders edited since the last poll are rebuilt, the old ones retire behind this frame
+	{
+		std::vector<std::string> reloaded = m_Shaders.update();
+		if (!reloaded.empty())
+		{
+			m_Resources->reloadPipelines(reloaded);
+			m_Culler.reloadPipelines(reloaded, m_DeletionQueue);
 		}
 	}
+	//Resources released since the last frame are retired behind this one
+	m_Resources->update();
 
-	m_Camera->update(time);
-	updateUniformBuffer(m_CurrentFrame, time);
+	m_Profiler.newFrame(currentFrame);
 
-	vkResetFences(m_Device, 1, &m_InFlightFences[m_CurrentFrame]);
+	//Before the frame is submitted, so the acquires of finished uploads are ahead of it on the graphics queue
+	m_TransferManager.update();
 
-	vkResetCommandBuffer(m_CommandBuffers[m_CurrentFrame], 0);
+	//Only the passes that cover every pixel of the scene get cheaper with the scale
+	if (m_DynamicResolution)
+	{
+		float scaledMilliseconds = m_Profiler.getLatestMilliseconds("Culling") + m_Profiler.getLatestMilliseconds("Main Pass");
+		if (m_ResolutionController.update(currentFrame, m_Profiler.getFrameMilliseconds(), scaledMilliseconds))
+			resizeSceneTargets();
+	}
+}
+
+uint32_t VulkanInstance::acquireNextImage(uint32_t currentFrame)
+{
+	if (m_FramebufferResized || m_SwapChainStale)
+	{
+		m_FramebufferResized = false;
+		recreateSwapChain();
+		if (m_SwapChainStale)
+			return -1;
+	}
 
-	recordCommandBuffer(imageIndex, renderStart, count, m_CurrentFrame);
+	uint32_t imageIndex;
+	VkResult result = vkAcquireNextImageKHR
+	(
+		m_Device,
+		m_SwapChain,
+		UINT64_MAX,
+		m_ImageAvailableSemaphores[currentFrame],
+		VK_NULL_HANDLE,
+		&imageIndex
+	);
+
+	//Nothing was acquired so the semaphore is still unsignaled and the frame can be dropped
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		recreateSwapChain();
+		return -1;
+	}
+	else if (result == VK_SUBOPTIMAL_KHR) {
+		//The semaphore will signal, render this frame and recreate after presenting it
+		m_FramebufferResized = true;
+	}
+	else if (result != VK_SUCCESS) {
+		throw std::runtime_error("failed to acquire swap chain image!");
+	}
+	return imageIndex;
+}
 
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+void VulkanInstance::framebufferResizeCallback(GLFWwindow* window, int, int)
+{
+	auto itr = s_WindowInstances.find(window);
+	if (itr != s_WindowInstances.end())
+		itr->second->m_FramebufferResized = true;
+}
 
-	VkSemaphore waitSemaphores[] = { m_ImageAvailableSemaphores[m_CurrentFrame] };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+void VulkanInstance::render(float time, Renderable* renderStart, ImDrawData* uiDrawData, uint32_t count, uint32_t m_CurrentFrame)
+{
+	CLEVER_PROFILE_FUNCTION();
+	uint32_t imageIndex;
 
-	std::vector< VkCommandBuffer> submitCommandBuffers;
+	//The readback buffer of this frame is safe to read now that its fence signaled
+	writePendingCapture(m_CurrentFrame);
 
-	if (ImGuiCommandBuffer == VK_NULL_HANDLE)
+	if (m_Headless)
 	{
-		submitCommandBuffers.resize(1);
-		submitCommandBuffers[0] = m_CommandBuffers[m_CurrentFrame];
+		//One offscreen image per frame in flight, so the fence above already guards it
+		imageIndex = m_CurrentFrame;
+
+		if (!m_RequestedCapture.empty())
+		{
+			m_PendingCaptures[m_CurrentFrame] = m_RequestedCapture;
+			m_RequestedCapture.clear();
+		}
 	}
 	else
 	{
-		submitCommandBuffers.resize(2);
-		submitCommandBuffers[0] = m_CommandBuffers[m_CurrentFrame];
-		submitCommandBuffers[1] = ImGuiCommandBuffer;
+		imageIndex = acquireNextImage(m_CurrentFrame);
+		if (imageIndex == uint32_t(-1))
+			return;
 	}
 
+	m_Camera->update(time);
+	updateUniformBuffer(m_CurrentFrame, time);
+	m_Culler.updateInstances(m_CurrentFrame, renderStart, count);
 
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
-	submitInfo.commandBufferCount = static_cast<uint32_t>(submitCommandBuffers.size());
-	submitInfo.pCommandBuffers = submitCommandBuffers.data();
+	vkResetFences(m_Device, 1, &m_InFlightFences[m_CurrentFrame]);
 
-	VkSemaphore signalSemaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame] };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	recordFrame(imageIndex, renderStart, uiDrawData, count, m_CurrentFrame);
 
-	if (vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_InFlightFences[m_CurrentFrame]) != VK_SUCCESS) {
-		throw std::runtime_error("failed to submit draw command buffer!");
-	}
+	//Headless has no semaphores, the in flight fence is all it waits on
+	m_FrameSerials[m_CurrentFrame] = m_DeletionQueue.submit();
+	m_RenderGraph.execute(m_CurrentFrame,
+		m_Headless ? VK_NULL_HANDLE : m_ImageAvailableSemaphores[m_CurrentFrame], m_ColorReadyStage,
+		m_Headless ? VK_NULL_HANDLE : m_RenderFinishedSemaphores[m_CurrentFrame], m_InFlightFences[m_CurrentFrame]);
+
+	//Nothing to present, the in flight fence is all the pacing headless needs
+	if (m_Headless)
+		return;
 
 	VkPresentInfoKHR presentInfo{};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.pWaitSemaphores = &m_RenderFinishedSemaphores[m_CurrentFrame];
 
 	VkSwapchainKHR swapChains[] = { m_SwapChain };
 	presentInfo.swapchainCount = 1;
@@ -133,116 +235,466 @@ bool VulkanInstance::render(float time, Renderable* renderStart, VkCommandBuffer
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_FramebufferResized) {
 		m_FramebufferResized = false;
-		//recreateSwapChain();
+		recreateSwapChain();
 	}
 	else if (result != VK_SUCCESS) {
 		throw std::runtime_error("failed to present swap chain image!");
 	}
-	return false;
 }
 
-void VulkanInstance::recordCommandBuffer(uint32_t imageIndex, Renderable* renderStart, uint32_t count, uint32_t m_CurrentFrame)
+void VulkanInstance::recordFrame(uint32_t imageIndex, Renderable* renderStart, ImDrawData* uiDrawData, uint32_t count, uint32_t m_CurrentFrame)
 {
-	VkCommandBufferBeginInfo beginInfo{};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-	if (vkBeginCommandBuffer(m_CommandBuffers[m_CurrentFrame], &beginInfo) != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to begin recording command buffer!");
-	}
+	CLEVER_PROFILE_FUNCTION();
+
+	m_FrameContext.imageIndex = imageIndex;
+	m_FrameContext.renderStart = renderStart;
+	m_FrameContext.count = count;
+	m_FrameContext.uiDrawData = uiDrawData;
+
+	//The swapchain image is only usable once the acquire semaphore has been waited on
+	m_RenderGraph.setExternalImage(m_ColorTarget, m_SwapChainImages[imageIndex], VK_IMAGE_LAYOUT_UNDEFINED,
+		m_Headless ? static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT) : m_ColorReadyStage);
+	m_RenderGraph.setBuffer(m_DrawCommands, m_Culler.getDrawBuffer(m_CurrentFrame));
+	m_RenderGraph.setBuffer(m_Visibility, m_Culler.getVisibilityBuffer());
+	m_RenderGraph.setImage(m_HiZPyramid, m_Culler.getPyramidImage());
+
+	if (m_Headless)
+		m_RenderGraph.setBuffer(m_Readback, m_ReadbackBuffers[m_CurrentFrame]);
+}
 
+void VulkanInstance::beginScenePass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, uint32_t currentFrame, bool clear)
+{
 	std::array<VkClearValue, 2> clearValues{};
 	clearValues[0].color = m_ClearValue.color;
 	clearValues[1].depthStencil = { 1.0f, 0 };
 
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassInfo.renderPass = m_RenderPass;
-	renderPassInfo.framebuffer = m_FrameBuffers[imageIndex];
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = m_DynamicResolution ? m_SceneFrameBuffer : m_FrameBuffers[m_FrameContext.imageIndex];
 	renderPassInfo.renderArea.offset = { 0,0 };
-	renderPassInfo.renderArea.extent = m_SwapChainExtent;
-	renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-	renderPassInfo.pClearValues = clearValues.data();
+	renderPassInfo.renderArea.extent = m_RenderExtent;
+	renderPassInfo.clearValueCount = clear ? static_cast<uint32_t>(clearValues.size()) : 0;
+	renderPassInfo.pClearValues = clear ? clearValues.data() : nullptr;
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast<float>(m_SwapChainExtent.width);
-	viewport.height = static_cast<float>(m_SwapChainExtent.height);
+	viewport.width = static_cast<float>(m_RenderExtent.width);
+	viewport.height = static_cast<float>(m_RenderExtent.height);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(m_CommandBuffers[m_CurrentFrame], 0, 1, &viewport);
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = { 0, 0 };
-	scissor.extent = m_SwapChainExtent;
-	vkCmdSetScissor(m_CommandBuffers[m_CurrentFrame], 0, 1, &scissor);
+	scissor.extent = m_RenderExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-	vkCmdBeginRenderPass(m_CommandBuffers[m_CurrentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	//Every graphics pipeline uses the shared layout
+	m_Descriptors.bind(commandBuffer, currentFrame);
+}
 
-	for (uint32_t i = 0; i < count; i++)
+RenderGraph::ImageDesc VulkanInstance::depthImageDesc()
+{
+	RenderGraph::ImageDesc desc;
+	desc.format = findDepthFormat();
+	desc.extent = m_RenderExtent;
+	desc.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	desc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	return desc;
+}
+
+RenderGraph::ImageDesc VulkanInstance::sceneColorDesc()
+{
+	//Same format as the swapchain so both stay compatible with the scene render passes
+	RenderGraph::ImageDesc desc;
+	desc.format = VK_FORMAT_B8G8R8A8_UNORM;
+	desc.extent = m_RenderExtent;
+	desc.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	desc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	return desc;
+}
+
+void VulkanInstance::resizeSceneTargets()
+{
+	m_RenderExtent = m_DynamicResolution ? m_ResolutionController.getRenderExtent(m_SwapChainExtent) : m_SwapChainExtent;
+
+	//The graph retires the old images through the deletion queue, frames in flight keep drawing into them
+	if (m_DynamicResolution)
+		m_RenderGraph.setImageDesc(m_SceneColor, sceneColorDesc());
+	m_RenderGraph.setImageDesc(m_DepthTarget, depthImageDesc());
+	m_RenderGraph.compile();
+
+	if (m_DynamicResolution)
 	{
-		Renderable* renderData = (renderStart + (int)i);
-		VkBuffer vertexBuffers[] = { renderData->meshData.vertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindPipeline(m_CommandBuffers[m_CurrentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, renderData->pipelineInfo.graphicsPipeline);
+		VkDevice device = m_Device;
+		VkFramebuffer frameBuffer = m_SceneFrameBuffer;
+		m_DeletionQueue.push([=]()
+			{
+				vkDestroyFramebuffer(device, frameBuffer, nullptr);
+			});
+		createSceneFramebuffer();
+	}
 
-		vkCmdBindVertexBuffers(m_CommandBuffers[m_CurrentFrame], 0, 1, vertexBuffers, offsets);
+	m_Culler.recreate(m_RenderGraph.getImageView(m_DepthTarget), m_RenderExtent, m_DeletionQueue);
+}
 
-		vkCmdBindIndexBuffer(m_CommandBuffers[m_CurrentFrame], renderData->meshData.indexBuffer, 0, VK_INDEX_TYPE_UINT16);
+void VulkanInstance::buildRenderGraph()
+{
+	m_RenderGraph.init(m_Device, m_PhysicalDevice, m_Allocator, queueFamilyIndicies.graphicsIndex.value(), m_GraphicsQueue, queueFamilyIndicies.computeIndex, m_ComputeQueue, m_max_frames_in_flight, m_DeletionQueue);
 
-		vkCmdBindDescriptorSets(m_CommandBuffers[m_CurrentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, renderData->pipelineInfo.pipelineLayout, 0, 1, &renderData->pipelineInfo.descriptorSets[m_CurrentFrame], 0, nullptr);
+	//! Resources
+	{
+		m_ColorTarget = m_RenderGraph.importImage("Color", VK_IMAGE_ASPECT_COLOR_BIT);
+		m_DepthTarget = m_RenderGraph.createImage("Depth", depthImageDesc());
 
-		for (int x = 0; x < renderData->pipelineInfo.instances.size(); x++)
-		{
-			vkCmdPushConstants(m_CommandBuffers[m_CurrentFrame], renderData->pipelineInfo.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(renderData->pipelineInfo.instances[x]), &renderData->pipelineInfo.instances[x]);
+		//Dynamic resolution renders the scene at m_RenderExtent and upscales it into the swapchain image
+		m_SceneColor = m_DynamicResolution ? m_RenderGraph.createImage("Scene Color", sceneColorDesc()) : m_ColorTarget;
+		m_DrawCommands = m_RenderGraph.importBuffer("Draw Commands");
+		m_Visibility = m_RenderGraph.importBuffer("Visibility");
+		m_HiZPyramid = m_RenderGraph.importImage("Hi-Z Pyramid", VK_IMAGE_ASPECT_COLOR_BIT);
+
+		//Both are read again by the next frame's early cull
+		m_RenderGraph.markOutput(m_Visibility);
+		m_RenderGraph.markOutput(m_HiZPyramid);
 
-			vkCmdDrawIndexed(m_CommandBuffers[m_CurrentFrame], static_cast<uint32_t>(renderData->meshData.getIndexCount()), 1, 0, 0, 0);
+		if (m_Headless)
+		{
+			m_Readback = m_RenderGraph.importBuffer("Readback");
+			m_RenderGraph.markOutput(m_Readback, RenderGraph::Access::HostRead);
 		}
+		else
+		{
+			m_RenderGraph.markOutput(m_ColorTarget, RenderGraph::Access::Present);
+		}
+	}
+
+	//! Resets every query of the frame, so it has to come first
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Reset Queries", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				m_Profiler.resetQueries(commandBuffer, currentFrame);
+			});
+		m_RenderGraph.setSideEffect(pass);
+	}
+
+	//! Geometry compaction, moves meshes within the arenas before anything draws from them
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Geometry Compaction", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t)
+			{
+				m_Geometry.compact(commandBuffer);
+			});
+		m_RenderGraph.setSideEffect(pass);
+	}
+
+	//! Early cull, frustum tests last frame's visible set
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Early Cull", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				m_Profiler.beginScope(commandBuffer, currentFrame, "Culling");
+				m_Culler.cull(commandBuffer, currentFrame, HiZCuller::Phase::Early);
+				m_Profiler.endScope(commandBuffer, currentFrame);
+			});
+		m_RenderGraph.read(pass, m_Visibility, RenderGraph::Access::ComputeRead);
+		m_RenderGraph.read(pass, m_HiZPyramid, RenderGraph::Access::ComputeSampled, VK_IMAGE_LAYOUT_GENERAL);//Bound, only sampled by the late phase
+		m_RenderGraph.write(pass, m_DrawCommands, RenderGraph::Access::ComputeWrite);
+	}
+
+	//! Early pass, draws whatever was visible last frame
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Early Scene", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				m_Profiler.beginScope(commandBuffer, currentFrame, "Main Pass");
+				beginScenePass(commandBuffer, m_RenderPass, currentFrame, true);
+				drawRenderables(commandBuffer, currentFrame, HiZCuller::Phase::Early);
+				vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);//UI subpass, only used by the late pass
+				vkCmdEndRenderPass(commandBuffer);
+				m_Profiler.endScope(commandBuffer, currentFrame);
+			});
+		m_RenderGraph.read(pass, m_DrawCommands, RenderGraph::Access::IndirectRead);
+		m_RenderGraph.write(pass, m_SceneColor, RenderGraph::Access::ColorAttachment, true);
+		m_RenderGraph.write(pass, m_DepthTarget, RenderGraph::Access::DepthAttachment, true);
+	}
+
+	//! Max depth mip chain of the early pass
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Hi-Z Pyramid", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				m_Profiler.beginScope(commandBuffer, currentFrame, "Culling");
+				m_Culler.buildPyramid(commandBuffer);
+				m_Profiler.endScope(commandBuffer, currentFrame);
+			});
+		m_RenderGraph.read(pass, m_DepthTarget, RenderGraph::Access::ComputeSampled);
+		m_RenderGraph.write(pass, m_HiZPyramid, RenderGraph::Access::ComputeReadWrite, true);
+	}
+
+	//! Late cull, tests every instance against the pyramid
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Late Cull", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				m_Profiler.beginScope(commandBuffer, currentFrame, "Culling");
+				m_Culler.cull(commandBuffer, currentFrame, HiZCuller::Phase::Late);
+				m_Profiler.endScope(commandBuffer, currentFrame);
+			});
+		m_RenderGraph.read(pass, m_HiZPyramid, RenderGraph::Access::ComputeSampled, VK_IMAGE_LAYOUT_GENERAL);
+		m_RenderGraph.write(pass, m_Visibility, RenderGraph::Access::ComputeReadWrite);
+		m_RenderGraph.write(pass, m_DrawCommands, RenderGraph::Access::ComputeWrite);
+	}
+
+	//! Late pass, draws anything that was disoccluded this frame, then the dev UI on top unless it goes in the UI pass
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Late Scene", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				//Scopes stay inside their subpass, a statistics query can't span a subpass boundary
+				beginScenePass(commandBuffer, m_LateRenderPass, currentFrame, false);
+				m_Profiler.beginScope(commandBuffer, currentFrame, "Main Pass");
+				drawRenderables(commandBuffer, currentFrame, HiZCuller::Phase::Late);
+				m_Profiler.endScope(commandBuffer, currentFrame);
+
+				//Drawn without storing and reloading the swapchain image
+				vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+				if (m_FrameContext.uiDrawData != nullptr && !m_DynamicResolution)
+				{
+					m_Profiler.beginScope(commandBuffer, currentFrame, "ImGui");
+					ImGui_ImplVulkan_RenderDrawData(m_FrameContext.uiDrawData, commandBuffer);
+					m_Profiler.endScope(commandBuffer, currentFrame);
+				}
+				vkCmdEndRenderPass(commandBuffer);
+			});
+		m_RenderGraph.read(pass, m_DrawCommands, RenderGraph::Access::IndirectRead);
+		m_RenderGraph.write(pass, m_SceneColor, RenderGraph::Access::ColorAttachment);
+		m_RenderGraph.write(pass, m_DepthTarget, RenderGraph::Access::DepthAttachment);
+	}
+
+	//! Upscale, a filtered blit of the scaled scene over the whole swapchain image
+	if (m_DynamicResolution)
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Upscale", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				m_Profiler.beginScope(commandBuffer, currentFrame, "Upscale");
+
+				VkImageBlit blit{};
+				blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.srcSubresource.mipLevel = 0;
+				blit.srcSubresource.baseArrayLayer = 0;
+				blit.srcSubresource.layerCount = 1;
+				blit.srcOffsets[1] = { static_cast<int32_t>(m_RenderExtent.width), static_cast<int32_t>(m_RenderExtent.height), 1 };
+				blit.dstSubresource = blit.srcSubresource;
+				blit.dstOffsets[1] = { static_cast<int32_t>(m_SwapChainExtent.width), static_cast<int32_t>(m_SwapChainExtent.height), 1 };
+
+				vkCmdBlitImage(commandBuffer, m_RenderGraph.getImage(m_SceneColor), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					m_SwapChainImages[m_FrameContext.imageIndex], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+				m_Profiler.endScope(commandBuffer, currentFrame);
+			});
+		m_RenderGraph.read(pass, m_SceneColor, RenderGraph::Access::TransferRead);
+		m_RenderGraph.write(pass, m_ColorTarget, RenderGraph::Access::TransferWrite, true);
+	}
+
+	//! Dev UI at native resolution, over the upscaled scene
+	if (m_DynamicResolution)
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("UI", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				if (m_FrameContext.uiDrawData == nullptr)
+					return;
+
+				VkRenderPassBeginInfo renderPassInfo{};
+				renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+				renderPassInfo.renderPass = m_UIRenderPass;
+				renderPassInfo.framebuffer = m_FrameBuffers[m_FrameContext.imageIndex];
+				renderPassInfo.renderArea.offset = { 0,0 };
+				renderPassInfo.renderArea.extent = m_SwapChainExtent;
+
+				vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+				m_Profiler.beginScope(commandBuffer, currentFrame, "ImGui");
+				ImGui_ImplVulkan_RenderDrawData(m_FrameContext.uiDrawData, commandBuffer);
+				m_Profiler.endScope(commandBuffer, currentFrame);
+				vkCmdEndRenderPass(commandBuffer);
+			});
+		m_RenderGraph.write(pass, m_ColorTarget, RenderGraph::Access::ColorAttachment);
+	}
+
+	//! Headless readback, copies the frame when a capture is pending
+	if (m_Headless)
+	{
+		RenderGraph::PassHandle pass = m_RenderGraph.addPass("Readback", RenderGraph::Queue::Graphics, [this](VkCommandBuffer commandBuffer, uint32_t currentFrame)
+			{
+				if (m_PendingCaptures[currentFrame].empty())
+					return;
+
+				VkBufferImageCopy region{};
+				region.bufferOffset = 0;
+				region.bufferRowLength = 0;
+				region.bufferImageHeight = 0;
+				region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				region.imageSubresource.mipLevel = 0;
+				region.imageSubresource.baseArrayLayer = 0;
+				region.imageSubresource.layerCount = 1;
+				region.imageOffset = { 0, 0, 0 };
+				region.imageExtent = { m_SwapChainExtent.width, m_SwapChainExtent.height, 1 };
+				vkCmdCopyImageToBuffer(commandBuffer, m_SwapChainImages[m_FrameContext.imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_ReadbackBuffers[currentFrame], 1, &region);
+			});
+		m_RenderGraph.read(pass, m_ColorTarget, RenderGraph::Access::TransferRead);
+		m_RenderGraph.write(pass, m_Readback, RenderGraph::Access::TransferWrite, true);
 	}
 
-	vkCmdEndRenderPass(m_CommandBuffers[m_CurrentFrame]);
+	//The first pass that touches the swapchain image waits for the acquire there, the scene can start before it
+	m_ColorReadyStage = m_DynamicResolution ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+	m_RenderGraph.compile();
+}
+
+void VulkanInstance::drawRenderables(VkCommandBuffer commandBuffer, uint32_t m_CurrentFrame, HiZCuller::Phase phase)
+{
+	Renderable* renderStart = m_FrameContext.renderStart;
+	uint32_t count = m_FrameContext.count;
+	VkBuffer drawBuffer = m_Culler.getDrawBuffer(m_CurrentFrame);
+	uint32_t boundArena = UINT32_MAX;
+	VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
 
-	if (vkEndCommandBuffer(m_CommandBuffers[m_CurrentFrame]) != VK_SUCCESS) {
-		throw std::runtime_error("failed to record command buffer!");
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Renderable* renderData = (renderStart + (int)i);
+		uint32_t drawCount = m_Culler.getDrawCount(i);
+		//Still streaming in, drawn once its uploads are done
+		if (drawCount == 0 || !renderData->meshData.isResident())
+			continue;
+
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, renderData->getPipeline());
+
+		//The draw commands carry the mesh's firstIndex and vertexOffset, buffers only change with the arena or index width
+		GeometryBuffer::MeshRange& range = m_Culler.getDrawRange(i);
+		if (range.arena != boundArena || range.indexType != boundIndexType)
+		{
+			m_Geometry.bind(commandBuffer, range.arena, range.indexType);
+			boundArena = range.arena;
+			boundIndexType = range.indexType;
+		}
+
+		//Culled instances have their instanceCount set to 0 by cull.comp
+		VkDeviceSize drawOffset = m_Culler.getDrawOffset(i, phase);
+		if (m_MultiDrawIndirect)
+		{
+			vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, drawOffset, drawCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else
+		{
+			for (uint32_t x = 0; x < drawCount; x++)
+			{
+				vkCmdDrawIndexedIndirect(commandBuffer, drawBuffer, drawOffset + x * sizeof(VkDrawIndexedIndirectCommand), 1, sizeof(VkDrawIndexedIndirectCommand));
+			}
+		}
 	}
 }
 
 void VulkanInstance::recreateSwapChain()
 {
+	//Offscreen images never go out of date
+	if (m_Headless)
+		return;
+
+	CLEVER_PROFILE_FUNCTION();
+
+	//Minimized, frames are skipped until the window has a size again
 	int width = 0, height = 0;
-	while (width == 0 || height == 0) {
-		glfwGetFramebufferSize(m_Window, &width, &height);
-		glfwWaitEvents();
+	glfwGetFramebufferSize(m_Window, &width, &height);
+	if (width == 0 || height == 0)
+	{
+		m_SwapChainStale = true;
+		return;
 	}
+	m_SwapChainStale = false;
+	m_SwapChainExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 
-	vkDeviceWaitIdle(m_Device);
+	//Frames in flight still render into these, they are destroyed once their fences have signaled
+	{
+		VkDevice device = m_Device;
+		VkSwapchainKHR swapChain = m_SwapChain;
+		std::vector<VkFramebuffer> frameBuffers = m_FrameBuffers;
+		std::vector<VkImageView> imageViews = m_ImageViews;
+		VkFramebuffer sceneFrameBuffer = m_SceneFrameBuffer;
 
-	cleanupSwapChain();
+		m_DeletionQueue.push([=]()
+			{
+				for (auto framebuffer : frameBuffers)
+					vkDestroyFramebuffer(device, framebuffer, nullptr);
+				vkDestroyFramebuffer(device, sceneFrameBuffer, nullptr);
+				for (auto imageView : imageViews)
+					vkDestroyImageView(device, imageView, nullptr);
+
+				vkDestroySwapchainKHR(device, swapChain, nullptr);
+			});
+	}
 
-	createSwapChain();
+	//The old swapchain is retired by this, its already acquired images stay valid until presented
+	createSwapChain(m_SwapChain);
 	createImageViews();
-	createDepthResources();
+
+	//Already retired with the swapchain framebuffers above
+	m_SceneFrameBuffer = VK_NULL_HANDLE;
+	resizeSceneTargets();
 	createFramebuffers();
+
+	m_Camera->SetViewportSize(static_cast<float>(width), static_cast<float>(height));
 }
 
 void VulkanInstance::cleanupSwapChain() {
-	vkDestroyImageView(m_Device, depthImageView, nullptr);
-	vkDestroyImage(m_Device, depthImage, nullptr);
-	vkFreeMemory(m_Device, depthImageMemory, nullptr);
-
 	for (auto framebuffer : m_FrameBuffers) {
 		vkDestroyFramebuffer(m_Device, framebuffer, nullptr);
 	}
+	vkDestroyFramebuffer(m_Device, m_SceneFrameBuffer, nullptr);
 
 	for (auto imageView : m_ImageViews) {
 		vkDestroyImageView(m_Device, imageView, nullptr);
 	}
 
+	if (m_Headless)
+	{
+		for (size_t i = 0; i < m_SwapChainImages.size(); i++)
+		{
+			m_Allocator.destroyImage(m_SwapChainImages[i], m_OffscreenImagesMemory[i]);
+		}
+		return;
+	}
+
 	vkDestroySwapchainKHR(m_Device, m_SwapChain, nullptr);
 }
 
-void VulkanInstance::createSwapChain()
+void VulkanInstance::createOffscreenImages()
+{
+	m_ImageCount = static_cast<uint32_t>(m_max_frames_in_flight);
+	m_SwapChainImages.resize(m_ImageCount);
+	m_OffscreenImagesMemory.resize(m_ImageCount);
+	m_ImageViews.resize(m_ImageCount);
+
+	for (uint32_t i = 0; i < m_ImageCount; i++)
+	{
+		createImage(m_SwapChainExtent.width, m_SwapChainExtent.height, VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, getColorUsage() | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_SwapChainImages[i], m_OffscreenImagesMemory[i]);
+		m_ImageViews[i] = createImageView(m_SwapChainImages[i], VK_FORMAT_B8G8R8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+}
+
+void VulkanInstance::createReadbackBuffers()
+{
+	VkDeviceSize bufferSize = static_cast<VkDeviceSize>(m_SwapChainExtent.width) * m_SwapChainExtent.height * 4;
+
+	m_ReadbackBuffers.resize(m_max_frames_in_flight);
+	m_ReadbackBuffersMemory.resize(m_max_frames_in_flight);
+	m_ReadbackBuffersMapped.resize(m_max_frames_in_flight);
+	m_PendingCaptures.resize(m_max_frames_in_flight);
+
+	for (int i = 0; i < m_max_frames_in_flight; i++)
+	{
+		createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_ReadbackBuffers[i], m_ReadbackBuffersMemory[i]);
+		m_ReadbackBuffersMapped[i] = m_ReadbackBuffersMemory[i]->mapped;
+	}
+}
+
+void VulkanInstance::createSwapChain(VkSwapchainKHR oldSwapChain)
 {
 
 	SwapChainSupportDetails swapChainSupport;
@@ -265,6 +717,10 @@ void VulkanInstance::createSwapChain()
 		vkGetPhysicalDeviceSurfacePresentModesKHR(m_PhysicalDevice, m_Surface, &presentModeCount, swapChainSupport.presentModes.data());
 	}
 
+	//currentExtent is the window size unless the surface lets the swapchain pick
+	if (swapChainSupport.capabilities.currentExtent.width != UINT32_MAX)
+		m_SwapChainExtent = swapChainSupport.capabilities.currentExtent;
+
 	m_SwapChainExtent.width = std::clamp(m_SwapChainExtent.width, swapChainSupport.capabilities.minImageExtent.width, swapChainSupport.capabilities.maxImageExtent.width);
 	m_SwapChainExtent.height = std::clamp(m_SwapChainExtent.height, swapChainSupport.capabilities.minImageExtent.height, swapChainSupport.capabilities.maxImageExtent.height);
 
@@ -277,7 +733,7 @@ void VulkanInstance::createSwapChain()
 	swapchainCreateInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
 	swapchainCreateInfo.imageExtent = m_SwapChainExtent;
 	swapchainCreateInfo.imageArrayLayers = 1;
-	swapchainCreateInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	swapchainCreateInfo.imageUsage = getColorUsage();
 
 	uint32_t queueFamilyIndices[] = { queueFamilyIndicies.graphicsIndex.value(), queueFamilyIndicies.presentIndex.value() };
 
@@ -298,7 +754,7 @@ void VulkanInstance::createSwapChain()
 	swapchainCreateInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
 	swapchainCreateInfo.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
 	swapchainCreateInfo.clipped = VK_TRUE;
-	swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+	swapchainCreateInfo.oldSwapchain = oldSwapChain;
 
 	if (vkCreateSwapchainKHR(m_Device, &swapchainCreateInfo, nullptr, &m_SwapChain) != VK_SUCCESS)
 	{
@@ -341,28 +797,20 @@ void VulkanInstance::createImageViews()
 	}
 }
 
-void VulkanInstance::createDepthResources()
-{
-	VkFormat depthFormat = findDepthFormat();
-
-	createImage(m_SwapChainExtent.width, m_SwapChainExtent.height, depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthImageMemory);
-	depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
-}
-
 void VulkanInstance::createFramebuffers()
 {
+	//With dynamic resolution the swapchain image only holds the UI, the scene has its own framebuffer
 	int i = 0;
 	m_FrameBuffers.resize(m_ImageViews.size());
 	for (VkImageView imageView : m_ImageViews)
 	{
-		std::array<VkImageView, 2> attachments = {
-			imageView,
-			depthImageView
-		};
+		std::vector<VkImageView> attachments = { imageView };
+		if (!m_DynamicResolution)
+			attachments.push_back(m_RenderGraph.getImageView(m_DepthTarget));
 
 		VkFramebufferCreateInfo framebufferInfo{};
 		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		framebufferInfo.renderPass = m_RenderPass;
+		framebufferInfo.renderPass = m_DynamicResolution ? m_UIRenderPass : m_RenderPass;
 		framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 		framebufferInfo.pAttachments = attachments.data();
 		framebufferInfo.width = m_SwapChainExtent.width;
@@ -377,16 +825,40 @@ void VulkanInstance::createFramebuffers()
 	}
 }
 
+void VulkanInstance::createSceneFramebuffer()
+{
+	std::array<VkImageView, 2> attachments = {
+		m_RenderGraph.getImageView(m_SceneColor),
+		m_RenderGraph.getImageView(m_DepthTarget)
+	};
+
+	VkFramebufferCreateInfo framebufferInfo{};
+	framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+	framebufferInfo.renderPass = m_RenderPass;
+	framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+	framebufferInfo.pAttachments = attachments.data();
+	framebufferInfo.width = m_RenderExtent.width;
+	framebufferInfo.height = m_RenderExtent.height;
+	framebufferInfo.layers = 1;
+
+	if (vkCreateFramebuffer(m_Device, &framebufferInfo, nullptr, &m_SceneFrameBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create scene framebuffer!");
+	}
+}
+
 void VulkanInstance::createInstance()
 {
 	{
-		glfwInit();
+		if (!m_Headless)
+			glfwInit();
 
 		//! Creating Instance, Modify when extensions are needed
 		{
-			uint32_t glfwExtensionCount;
-			const char** glfwExtensions;
-			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+			uint32_t glfwExtensionCount = 0;
+			const char** glfwExtensions = nullptr;
+			if (!m_Headless)
+				glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 			CVulkan::createInstance(&m_Instance, glfwExtensions, glfwExtensionCount, {});
 		}
 
@@ -410,12 +882,8 @@ void VulkanInstance::createInstance()
 			}
 		}
 
-		//! Picking Physical Device
-		{
-			CVulkan::createPhysicalDevice(m_PhysicalDevice, queueFamilyIndicies, m_Instance);
-		}
-		
 		//! Creating Surface
+		if (!m_Headless)
 		{
 
 			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
@@ -423,14 +891,14 @@ void VulkanInstance::createInstance()
 
 			//glfwGetPrimaryMonitor() For Fullscreen, second to last nullptr needs to be replaced
 			m_Window = glfwCreateWindow(m_SwapChainExtent.width, m_SwapChainExtent.height, "Vulkan", nullptr, nullptr);
-			glfwSetWindowUserPointer(m_Window, this);
-			//glfwSetFramebufferSizeCallback(m_Window, framebufferResizeCallback);
-
 			if (!m_Window)
 			{
 				throw std::runtime_error("failed to create GLFW window!");
 			}
 
+			s_WindowInstances[m_Window] = this;
+			glfwSetFramebufferSizeCallback(m_Window, framebufferResizeCallback);
+
 			if (glfwCreateWindowSurface(m_Instance, m_Window, nullptr, &m_Surface))
 			{
 				throw std::runtime_error("failed to create window surface!");
@@ -439,26 +907,53 @@ void VulkanInstance::createInstance()
 			std::cout << "Surface Successfuly Created" << std::endl;
 		}
 
+		//! Picking Physical Device
+		//! After the surface, the present family is the one that can present to it
+		{
+			CVulkan::createPhysicalDevice(m_PhysicalDevice, queueFamilyIndicies, m_Instance, m_Surface);
+		}
+
 		//! Creating Logical Device
 		{
-			CVulkan::createDevice(&m_Device, m_PhysicalDevice, {});
+			//No surface means no swapchain extension either
+			CVulkan::createDevice(&m_Device, m_PhysicalDevice, m_Surface, m_Headless ? std::vector<const char*>{} : Constants::deviceExtensions);
+
+			VkPhysicalDeviceFeatures supportedFeatures;
+			vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+			m_MultiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
 
 			vkGetDeviceQueue(m_Device, queueFamilyIndicies.graphicsIndex.value(), 0, &m_GraphicsQueue);
 			vkGetDeviceQueue(m_Device, queueFamilyIndicies.presentIndex.value(), 0, &m_PresentQueue);
+
+			if (queueFamilyIndicies.computeIndex.has_value())
+				vkGetDeviceQueue(m_Device, queueFamilyIndicies.computeIndex.value(), 0, &m_ComputeQueue);
+
+			if (queueFamilyIndicies.transferIndex.has_value())
+				vkGetDeviceQueue(m_Device, queueFamilyIndicies.transferIndex.value(), 0, &m_TransferQueue);
 		}
 
-		//! Creating SwapChain
+		//! Creating the Memory Allocator
+		//! Every buffer and image after this point is sub-allocated from its blocks
 		{
-			createSwapChain();
+			m_Allocator.init(m_Device, m_PhysicalDevice);
 		}
 
-		//! Creating ImageViews
+		//! Creating SwapChain
+		if (m_Headless)
 		{
-			
+			createOffscreenImages();
+		}
+		else
+		{
+			createSwapChain();
 			createImageViews();
 		}
 
-		//! Creating Renderpass
+		//! Creating Renderpasses
+		//! The early pass clears, the late pass loads both. Neither changes a layout, the render graph places every
+		//! transition and dependency between passes so both start and end with their attachments in attachment layouts.
+		//! Both passes are compatible so pipelines and framebuffers made with m_RenderPass work for either.
+		//! Subpass 0 draws the scene, subpass 1 draws the dev UI over it (empty in the early pass).
 		{
 			VkAttachmentDescription colorAttachment{};
 			colorAttachment.format = VK_FORMAT_B8G8R8A8_UNORM;
@@ -467,8 +962,8 @@ void VulkanInstance::createInstance()
 			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 			colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 			colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+			colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+			colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 			VkAttachmentReference attachmentReference{};
 			attachmentReference.attachment = 0;
@@ -478,29 +973,37 @@ void VulkanInstance::createInstance()
 			depthAttachment.format = findDepthFormat();
 			depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 			depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-			depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 			depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 			depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-			depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 			depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 			VkAttachmentReference depthAttachmentRef{};
 			depthAttachmentRef.attachment = 1;
 			depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
-			VkSubpassDescription subpassDesciption{};
-			subpassDesciption.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-			subpassDesciption.colorAttachmentCount = 1;
-			subpassDesciption.pColorAttachments = &attachmentReference;
-			subpassDesciption.pDepthStencilAttachment = &depthAttachmentRef;
+			std::array<VkSubpassDescription, 2> subpassDesciptions{};
+			subpassDesciptions[SCENE_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpassDesciptions[SCENE_SUBPASS].colorAttachmentCount = 1;
+			subpassDesciptions[SCENE_SUBPASS].pColorAttachments = &attachmentReference;
+			subpassDesciptions[SCENE_SUBPASS].pDepthStencilAttachment = &depthAttachmentRef;
+
+			//Depth is left alone by the UI, it keeps the layout subpass 0 gave it
+			subpassDesciptions[UI_SUBPASS].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpassDesciptions[UI_SUBPASS].colorAttachmentCount = 1;
+			subpassDesciptions[UI_SUBPASS].pColorAttachments = &attachmentReference;
 
-			VkSubpassDependency dependency{};
-			dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-			dependency.dstSubpass = 0;
-			dependency.srcAccessMask = 0;
-			dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-			dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-			dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+			std::array<VkSubpassDependency, 1> dependencies{};
+
+			//The UI blends over the scene color, by region so tilers never leave the tile
+			dependencies[0].srcSubpass = SCENE_SUBPASS;
+			dependencies[0].dstSubpass = UI_SUBPASS;
+			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			dependencies[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
 			std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
 
@@ -508,16 +1011,40 @@ void VulkanInstance::createInstance()
 			createInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
 			createInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
 			createInfo.pAttachments = attachments.data();
-			createInfo.subpassCount = 1;
-			createInfo.pSubpasses = &subpassDesciption;
-			createInfo.dependencyCount = 1;
-			createInfo.pDependencies = &dependency;
+			createInfo.subpassCount = static_cast<uint32_t>(subpassDesciptions.size());
+			createInfo.pSubpasses = subpassDesciptions.data();
+			createInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+			createInfo.pDependencies = dependencies.data();
 
 			if (vkCreateRenderPass(m_Device, &createInfo, nullptr, &m_RenderPass) != VK_SUCCESS)
 			{
 				std::runtime_error("Failed to create RenderPass");
 			}
 
+			//Late pass
+			attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+			attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;//Nothing reads depth after the late pass
+
+			if (vkCreateRenderPass(m_Device, &createInfo, nullptr, &m_LateRenderPass) != VK_SUCCESS)
+			{
+				std::runtime_error("Failed to create late RenderPass");
+			}
+
+			//UI pass, dynamic resolution draws the UI over the upscaled swapchain image on its own
+			if (m_DynamicResolution)
+			{
+				createInfo.attachmentCount = 1;
+				createInfo.subpassCount = 1;
+				createInfo.pSubpasses = &subpassDesciptions[UI_SUBPASS];
+				createInfo.dependencyCount = 0;
+				createInfo.pDependencies = nullptr;
+
+				if (vkCreateRenderPass(m_Device, &createInfo, nullptr, &m_UIRenderPass) != VK_SUCCESS)
+				{
+					throw std::runtime_error("failed to create UI render pass!");
+				}
+			}
 		}
 
 		//! Creating the Command Pool
@@ -544,35 +1071,81 @@ void VulkanInstance::createInstance()
 				for (size_t i = 0; i < m_max_frames_in_flight; i++) {
 					createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_UniformBuffers[i], m_UniformBuffersMemory[i]);
 
-					vkMapMemory(m_Device, m_UniformBuffersMemory[i], 0, bufferSize, 0, &m_UniformBuffersMapped[i]);
+					m_UniformBuffersMapped[i] = m_UniformBuffersMemory[i]->mapped;
 				}
 			}
+
+			//Readback Buffer
+			if (m_Headless)
+			{
+				createReadbackBuffers();
+			}
 		}
 
-		//! Creating Command Buffers
+		//! Creating the Resolution Controller
 		{
-			m_CommandBuffers.resize(m_max_frames_in_flight);
-
-			VkCommandBufferAllocateInfo allocationInfo{};
-			allocationInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-			allocationInfo.commandPool = m_CommandPool;
-			allocationInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-			allocationInfo.commandBufferCount = static_cast<uint32_t>(m_CommandBuffers.size());
+			if (m_DynamicResolution)
+				m_ResolutionController.init(m_max_frames_in_flight);
 
-			if (vkAllocateCommandBuffers(m_Device, &allocationInfo, m_CommandBuffers.data()) != VK_SUCCESS)
-			{
-				std::runtime_error("Unable to allcocate Command Buffers");
-			}
+			m_RenderExtent = m_DynamicResolution ? m_ResolutionController.getRenderExtent(m_SwapChainExtent) : m_SwapChainExtent;
 		}
 
-		//! Creating Depth Resources
+		//! Creating the Render Graph
+		//! Records and submits the frame, owns the depth buffer and every barrier between passes
 		{
-			createDepthResources();
+			buildRenderGraph();
 		}
 
 		//! Creating FrameBuffers
 		{
 			createFramebuffers();
+			if (m_DynamicResolution)
+				createSceneFramebuffer();
+		}
+
+		//! Creating the Shader Manager
+		//! GLSL is compiled at runtime, the SPIR-V is cached on disk and every module is created once
+		{
+			m_Shaders.init(m_Device, m_Descriptors, "Clever/src/OS-Dependant/Shaders/", "Clever/Resource/ShaderCache/");
+		}
+
+		//! Creating the Hi-Z culler
+		{
+			m_Culler.init(m_Device, m_PhysicalDevice, m_Allocator, m_Shaders, m_RenderGraph.getImageView(m_DepthTarget), m_RenderExtent, m_UniformBuffers, m_max_frames_in_flight);
+		}
+
+		//! Creating the Transfer Manager
+		//! Uploads run on the transfer only family when there is one, so loading never stalls the frames
+		{
+			m_TransferManager.init(m_Device, m_PhysicalDevice, m_Allocator, queueFamilyIndicies.graphicsIndex.value(), m_GraphicsQueue, queueFamilyIndicies.transferIndex, m_TransferQueue);
+		}
+
+		//! Creating the Geometry Buffer
+		//! Every mesh is uploaded into its shared arenas, so draws don't rebind buffers per mesh
+		{
+			m_Geometry.init(m_Device, m_Allocator, m_TransferManager, m_DeletionQueue);
+		}
+
+		//! Creating the Resource Cache
+		//! Meshes and pipelines are shared by content and freed through the deletion queue once unreferenced
+		{
+			m_Resources->init(m_Device, m_PhysicalDevice, m_Geometry, m_DeletionQueue, m_Shaders);
+		}
+
+		//! Creating the GPU Profiler
+		{
+			m_Profiler.init(m_Device, m_PhysicalDevice, queueFamilyIndicies.graphicsIndex.value(), m_max_frames_in_flight);
+		}
+
+		//! Creating the shared Descriptor Sets
+		{
+			m_Descriptors.init(m_Device, m_UniformBuffers, m_Culler.getInstanceBuffers(), m_max_frames_in_flight);
+		}
+
+		//! Creating the Material Buffer
+		//! Empty until setMaterials, instances keep their vertex color until then
+		{
+			m_Materials.init(m_Allocator, m_Descriptors, m_DeletionQueue);
 		}
 
 		//! Creating Sync Object
@@ -580,6 +1153,7 @@ void VulkanInstance::createInstance()
 			m_ImageAvailableSemaphores.resize(m_max_frames_in_flight);
 			m_RenderFinishedSemaphores.resize(m_max_frames_in_flight);
 			m_InFlightFences.resize(m_max_frames_in_flight);
+			m_FrameSerials.resize(m_max_frames_in_flight, 0);
 
 			VkSemaphoreCreateInfo semaphoreInfo{};
 			semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -603,6 +1177,8 @@ void VulkanInstance::updateUniformBuffer(uint32_t currentFrame, float time) {
 
 	UniformBufferObject ubo{};
 	ubo.viewproj = m_Camera->GetViewProjectionMatrix();
+	ubo.materialBuffer = m_Materials.getSlot();
+	ubo.materialCount = m_Materials.getCount();
 	/*ubo.view = glm::lookAt(glm::vec3(2.0f, 2.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
 	ubo.proj = glm::perspective(glm::radians(45.0f), m_SwapChainExtent.width / (float)m_SwapChainExtent.height, 0.1f, 10.0f);
 	ubo.proj[1][1] *= -1;*/
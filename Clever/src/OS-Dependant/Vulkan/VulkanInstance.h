@@ -14,6 +14,7 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <unordered_map>
 #include <optional>
 #include <fstream>
 #include <array>
@@ -23,6 +24,19 @@
 #include "Clever/Camera/Camera.h"
 #include "Clever/WorldManager/UniformBufferObject.h"
 #include "Clever/WorldManager/Components/Component/Renderable.h"
+#include "HiZCuller.h"
+#include "DescriptorManager.h"
+#include "ImageWriter.h"
+#include "GpuProfiler.h"
+#include "RenderGraph.h"
+#include "ResolutionController.h"
+#include "DeletionQueue.h"
+#include "TransferManager.h"
+#include "MemoryAllocator.h"
+#include "GeometryBuffer.h"
+#include "ResourceCache.h"
+#include "ShaderManager.h"
+#include "MaterialBuffer.h"
 
 class VulkanInstance
 {
@@ -33,35 +47,95 @@ private:
 		std::vector<VkSurfaceFormatKHR> formats;
 		std::vector<VkPresentModeKHR> presentModes;
 	};
+public:
+	//! Both scene passes have the scene in subpass 0 and the dev UI in subpass 1, so they stay compatible with one framebuffer
+	static const uint32_t SCENE_SUBPASS = 0;
+	static const uint32_t UI_SUBPASS = 1;
+
 public:
 
 	void cleanup();
 
-	VulkanInstance(int height, int width, int max_frames_in_flight, bool RTXEnable);
+	//! Headless renders into offscreen images, no window, surface or swapchain is created.
+	//! Dynamic resolution renders the scene into a scaled target driven by GPU frame time and upscales it, the UI stays native.
+	VulkanInstance(int height, int width, int max_frames_in_flight, bool RTXEnable, bool headless = false, bool dynamicResolution = false);
 
 	GLFWwindow* getGLFWwindow()
 	{
 		return m_Window;
 	}
 
-	bool render(float time, Renderable* renderStart, VkCommandBuffer ImGuiCommandBuffer, uint32_t count, uint32_t m_CurrentFrame, uint32_t imageIndex);
+	//! Waits for the frame's fence and collects its profiler results, must run before anything of the frame is recorded
+	void beginFrame(uint32_t currentFrame);
+
+	//! Acquires the next swapchain image, recreating the swapchain first when it is stale.
+	//! Returns -1 when the frame has to be skipped (out of date or minimized).
+	uint32_t acquireNextImage(uint32_t currentFrame);
+
+	//! uiDrawData is recorded into the UI subpass of the late pass (the UI pass with dynamic resolution), null when there is no UI
+	void render(float time, Renderable* renderStart, ImDrawData* uiDrawData, uint32_t count, uint32_t m_CurrentFrame);
 
 	bool shouldClose()
 	{
+		if (m_Headless)
+			return false;
 		return glfwWindowShouldClose(m_Window);
 	}
 
+	//! Render pass and subpass the dev UI is drawn in
+	VkRenderPass getUIRenderPass()
+	{
+		return m_DynamicResolution ? m_UIRenderPass : m_LateRenderPass;
+	}
+
+	uint32_t getUISubpass()
+	{
+		return m_DynamicResolution ? 0 : UI_SUBPASS;
+	}
+
+	//! Replaces every material the shaders can fetch, an instance's material index is one of their ids
+	void setMaterials(const MaterialCache::MaterialLibrary& materials)
+	{
+		m_Materials.upload(materials);
+	}
+
+	//! Headless only, the next rendered frame is written to filename (.ppm or .png) once its fence signals
+	void captureFrame(const std::string& filename);
+
+	//! Never waits on the device, everything the old swapchain owned goes through m_DeletionQueue
 	void recreateSwapChain();
 
 private:
+	static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+
 	void cleanupSwapChain();
 
-	void createSwapChain();
+	void createSwapChain(VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
 	void createImageViews();
-	void createDepthResources();
 	void createFramebuffers();
+	void createOffscreenImages();
+	void createReadbackBuffers();
+	void writePendingCapture(uint32_t currentFrame);
+
+	//! Declares every pass of the frame once, the lambdas read the per frame state from m_FrameContext
+	void buildRenderGraph();
+	RenderGraph::ImageDesc depthImageDesc();
+	RenderGraph::ImageDesc sceneColorDesc();
 
-	void recordCommandBuffer(uint32_t imageIndex, Renderable* renderStart, uint32_t count, uint32_t m_CurrentFrame);
+	//! Resizes everything that follows m_RenderExtent without waiting on the device (scale change or new swapchain)
+	void resizeSceneTargets();
+	void createSceneFramebuffer();
+
+	//! The upscale blits into the swapchain image
+	VkImageUsageFlags getColorUsage()
+	{
+		return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (m_DynamicResolution ? VK_IMAGE_USAGE_TRANSFER_DST_BIT : 0);
+	}
+
+	//! Points the graph at this frame's swapchain image and buffers before execute
+	void recordFrame(uint32_t imageIndex, Renderable* renderStart, ImDrawData* uiDrawData, uint32_t count, uint32_t m_CurrentFrame);
+	void beginScenePass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, uint32_t currentFrame, bool clear);
+	void drawRenderables(VkCommandBuffer commandBuffer, uint32_t m_CurrentFrame, HiZCuller::Phase phase);
 
 	void updateUniformBuffer(uint32_t currentFrame, float time);
 
@@ -86,7 +160,7 @@ private:
 
 		return imageView;
 	}
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, MemoryAllocator::Allocation*& imageMemory) {
 		VkImageCreateInfo imageInfo{};
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
 		imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -102,23 +176,7 @@ private:
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-		if (vkCreateImage(m_Device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create image!");
-		}
-
-		VkMemoryRequirements memRequirements;
-		vkGetImageMemoryRequirements(m_Device, image, &memRequirements);
-
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-			throw std::runtime_error("failed to allocate image memory!");
-		}
-
-		vkBindImageMemory(m_Device, image, imageMemory, 0);
+		imageMemory = m_Allocator.createImage(imageInfo, properties, image);
 	}
 	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
 		VkCommandBuffer commandBuffer = beginSingleTimeCommands();
@@ -136,26 +194,22 @@ private:
 		barrier.subresourceRange.baseArrayLayer = 0;
 		barrier.subresourceRange.layerCount = 1;
 
-		VkPipelineStageFlags sourceStage;
-		VkPipelineStageFlags destinationStage;
+		if (format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM || hasStencilComponent(format))
+		{
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+			if (hasStencilComponent(format))
+				barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+		}
 
-		if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		//Same table the render graph uses, only writes need to be made available
+		RenderGraph::AccessInfo source = RenderGraph::getLayoutInfo(oldLayout);
+		RenderGraph::AccessInfo destination = RenderGraph::getLayoutInfo(newLayout);
 
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		}
-		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.srcAccessMask = source.write ? source.access : 0;
+		barrier.dstAccessMask = destination.access;
 
-			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		}
-		else {
-			throw std::invalid_argument("unsupported layout transition!");
-		}
+		VkPipelineStageFlags sourceStage = source.stage;
+		VkPipelineStageFlags destinationStage = destination.stage;
 
 		vkCmdPipelineBarrier(
 			commandBuffer,
@@ -188,7 +242,7 @@ private:
 		return findSupportedFormat(
 			{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
 			VK_IMAGE_TILING_OPTIMAL,
-			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+			VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 	}
 	bool hasStencilComponent(VkFormat format) {
 		return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
@@ -238,32 +292,9 @@ private:
 		}
 		throw std::runtime_error("failed to find suitable memory type!");
 	}
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory)
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, MemoryAllocator::Allocation*& bufferMemory)
 	{
-		VkBufferCreateInfo bufferInfo{};
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = size;
-		bufferInfo.usage = usage;
-		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-
-		if (vkCreateBuffer(m_Device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-			throw std::runtime_error("failed to create vertex buffer!");
-		}
-
-		VkMemoryRequirements memRequirements;
-		vkGetBufferMemoryRequirements(m_Device, buffer, &memRequirements);
-
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-		if (vkAllocateMemory(m_Device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-		{
-			throw std::runtime_error("failed to allocate vertex buffer memory!");
-		}
-
-		vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
+		bufferMemory = m_Allocator.createBuffer(size, usage, properties, buffer);
 	}
 	
 public:
@@ -315,17 +346,21 @@ public:
 public:
 	std::shared_ptr<Camera> m_Camera;
 
-	GLFWwindow* m_Window;
+	GLFWwindow* m_Window = nullptr;
+	bool m_Headless = false;
+	bool m_DynamicResolution = false;
 
 	VkInstance m_Instance;
 	VkDebugUtilsMessengerEXT m_DebugMessenger;
-	VkSurfaceKHR m_Surface;
+	VkSurfaceKHR m_Surface = VK_NULL_HANDLE;//Headless has none
 
 	VkPhysicalDevice m_PhysicalDevice;
 	VkDevice m_Device;
 
 	VkQueue m_GraphicsQueue;
 	VkQueue m_PresentQueue;
+	VkQueue m_ComputeQueue = VK_NULL_HANDLE;//Dedicated compute family, only for async compute passes
+	VkQueue m_TransferQueue = VK_NULL_HANDLE;//Transfer only family, only used by the TransferManager
 
 	VkSwapchainKHR m_SwapChain;
 	std::vector<VkImage> m_SwapChainImages;
@@ -333,21 +368,62 @@ public:
 	VkExtent2D m_SwapChainExtent;
 	std::vector<VkImageView> m_ImageViews;
 	std::vector<VkFramebuffer> m_FrameBuffers;
-
-	VkRenderPass m_RenderPass;
-
-	VkImage depthImage;
-	VkDeviceMemory depthImageMemory;
-	VkImageView depthImageView;
+	std::vector<MemoryAllocator::Allocation*> m_OffscreenImagesMemory;//Headless only, one image per frame in flight
+
+	//Headless readback, one buffer per frame in flight so captures don't stall the pipeline
+	std::vector<VkBuffer> m_ReadbackBuffers;
+	std::vector<MemoryAllocator::Allocation*> m_ReadbackBuffersMemory;
+	std::vector<void*> m_ReadbackBuffersMapped;
+	std::vector<std::string> m_PendingCaptures;
+	std::string m_RequestedCapture;
+
+	VkRenderPass m_RenderPass;//Early pass, clears
+	VkRenderPass m_LateRenderPass;//Loads the early pass and presents
+	VkRenderPass m_UIRenderPass = VK_NULL_HANDLE;//Dynamic resolution only, the UI subpass on its own over the swapchain image
+
+	//Dynamic resolution, the scene is drawn at m_RenderExtent into its own framebuffer
+	ResolutionController m_ResolutionController;
+	VkExtent2D m_RenderExtent = {};//Equal to m_SwapChainExtent without dynamic resolution
+	VkFramebuffer m_SceneFrameBuffer = VK_NULL_HANDLE;
+
+	RenderGraph m_RenderGraph;
+	RenderGraph::ResourceHandle m_ColorTarget;//Swapchain or offscreen image of the frame
+	RenderGraph::ResourceHandle m_DepthTarget;//Transient, owned by the graph
+	RenderGraph::ResourceHandle m_DrawCommands;
+	RenderGraph::ResourceHandle m_Visibility;
+	RenderGraph::ResourceHandle m_HiZPyramid;
+	RenderGraph::ResourceHandle m_Readback;//Headless only
+	RenderGraph::ResourceHandle m_SceneColor;//Transient with dynamic resolution, otherwise the same as m_ColorTarget
+	VkPipelineStageFlags m_ColorReadyStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;//Where the acquire semaphore is waited on
+
+	struct FrameContext
+	{
+		uint32_t imageIndex = 0;
+		Renderable* renderStart = nullptr;
+		uint32_t count = 0;
+		ImDrawData* uiDrawData = nullptr;
+	};
+	FrameContext m_FrameContext;
+
+	HiZCuller m_Culler;
+	DescriptorManager m_Descriptors;
+	MaterialBuffer m_Materials;
+	GpuProfiler m_Profiler;
+	DeletionQueue m_DeletionQueue;
+	TransferManager m_TransferManager;
+	GeometryBuffer m_Geometry;//Vertex and index arenas every static mesh is packed into
+	ShaderManager m_Shaders;
+	std::shared_ptr<ResourceCache> m_Resources = std::make_shared<ResourceCache>();//Shared, references held by renderables keep it alive
+	MemoryAllocator m_Allocator;
+	std::vector<uint64_t> m_FrameSerials;//Deletion queue serial of the last submit of each frame in flight
+	bool m_MultiDrawIndirect = false;
 
 	VkCommandPool m_CommandPool;
 
 	std::vector<VkBuffer> m_UniformBuffers;
-	std::vector<VkDeviceMemory> m_UniformBuffersMemory;
+	std::vector<MemoryAllocator::Allocation*> m_UniformBuffersMemory;
 	std::vector<void*> m_UniformBuffersMapped;
 
-	std::vector<VkCommandBuffer> m_CommandBuffers;
-
 	std::vector<VkSemaphore> m_ImageAvailableSemaphores;
 	std::vector<VkSemaphore> m_RenderFinishedSemaphores;
 	
@@ -361,6 +437,10 @@ public:
 
 	uint32_t m_ImageCount;
 
-	bool m_FramebufferResized = false;	
+	bool m_FramebufferResized = false;
+	bool m_SwapChainStale = false;//Recreation was skipped while the window was minimized
+
+	//The window user pointer belongs to the EventManager
+	inline static std::unordered_map<GLFWwindow*, VulkanInstance*> s_WindowInstances;
 };
 